@@ -12,6 +12,7 @@
 #cmakedefine HAVE_SYSTEMD
 
 #cmakedefine ICINGA2_UNITY_BUILD
+#cmakedefine ICINGA2_TIMER_WHEEL
 #cmakedefine ICINGA2_STACKTRACE_USE_BACKTRACE_SYMBOLS
 
 #define ICINGA_CONFIGDIR "${ICINGA2_FULL_CONFIGDIR}"
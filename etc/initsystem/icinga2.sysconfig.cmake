@@ -13,3 +13,4 @@
 #ICINGA2_USER=@ICINGA2_USER@
 #ICINGA2_GROUP=@ICINGA2_GROUP@
 #ICINGA2_COMMAND_GROUP=@ICINGA2_COMMAND_GROUP@
+#ICINGA2_SPAWN_HELPERS=1
@@ -8,6 +8,7 @@
 #include "base/application.hpp"
 #include "base/configuration.hpp"
 #include "base/logger.hpp"
+#include "base/logqueue.hpp"
 #include "base/timer.hpp"
 #include "base/utility.hpp"
 #include "base/loader.hpp"
@@ -278,6 +279,54 @@ static int Main()
 			}
 		}
 #endif /* RLIMIT_STACK */
+
+		String logQueueSize = Utility::GetFromEnvironment("ICINGA2_LOG_QUEUE_SIZE");
+		if (!logQueueSize.IsEmpty()) {
+			try {
+				Configuration::LogQueueSize = Convert::ToLong(logQueueSize);
+			} catch (const std::invalid_argument& ex) {
+				std::cout
+					<< "Error setting \"ICINGA2_LOG_QUEUE_SIZE\": " << ex.what() << '\n';
+				return EXIT_FAILURE;
+			}
+		}
+
+		String logOverflowPolicy = Utility::GetFromEnvironment("ICINGA2_LOG_OVERFLOW_POLICY");
+		if (!logOverflowPolicy.IsEmpty()) {
+			try {
+				LogQueue::StringToOverflowPolicy(logOverflowPolicy);
+			} catch (const std::invalid_argument& ex) {
+				std::cout
+					<< "Error setting \"ICINGA2_LOG_OVERFLOW_POLICY\": " << ex.what() << '\n';
+				return EXIT_FAILURE;
+			}
+
+			Configuration::LogOverflowPolicy = logOverflowPolicy;
+		}
+
+		String stateSegments = Utility::GetFromEnvironment("ICINGA2_STATE_SEGMENTS");
+		if (!stateSegments.IsEmpty()) {
+			try {
+				Configuration::StateSegments = Convert::ToLong(stateSegments);
+			} catch (const std::invalid_argument& ex) {
+				std::cout
+					<< "Error setting \"ICINGA2_STATE_SEGMENTS\": " << ex.what() << '\n';
+				return EXIT_FAILURE;
+			}
+		}
+
+#ifndef _WIN32
+		String spawnHelpers = Utility::GetFromEnvironment("ICINGA2_SPAWN_HELPERS");
+		if (!spawnHelpers.IsEmpty()) {
+			try {
+				Configuration::SpawnHelpers = Convert::ToLong(spawnHelpers);
+			} catch (const std::invalid_argument& ex) {
+				std::cout
+					<< "Error setting \"ICINGA2_SPAWN_HELPERS\": " << ex.what() << '\n';
+				return EXIT_FAILURE;
+			}
+		}
+#endif /* _WIN32 */
 	}
 
 	/* Calculate additional global constants. */
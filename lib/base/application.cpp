@@ -104,6 +104,8 @@ Application::~Application()
 
 void Application::Exit(int rc)
 {
+	Logger::FlushLogQueue();
+
 	std::cout.flush();
 	std::cerr.flush();
 
@@ -16,10 +16,18 @@
 #include "base/workqueue.hpp"
 #include "base/context.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
+#include <algorithm>
 #include <fstream>
+#include <mutex>
+#include <numeric>
+#include <unordered_set>
 #include <boost/exception/errinfo_api_function.hpp>
 #include <boost/exception/errinfo_errno.hpp>
 #include <boost/exception/errinfo_file_name.hpp>
+#include <boost/filesystem/operations.hpp>
 
 using namespace icinga;
 
@@ -463,25 +471,48 @@ void ConfigObject::SetAuthority(bool authority)
 	}
 }
 
-void ConfigObject::DumpObjects(const String& filename, int attributeTypes)
+/* Number of objects which are serialized in parallel before they're written out. */
+static const size_t l_DumpChunkSize = 16 * 1024;
+
+static std::mutex l_DumpMutex;
+
+/* Segments written since the last full dump, -1 if the next dump has to be a full one. */
+static int l_StateSegmentCount = -1;
+static int l_StateAttributeTypes = 0;
+static unsigned long l_LastStateSegment = 0;
+
+/**
+ * Returns the incremental state segments which belong to a state file, oldest first.
+ */
+static std::vector<std::pair<unsigned long, String>> GetStateSegments(const String& filename)
 {
-	Log(LogInformation, "ConfigObject")
-		<< "Dumping program state to file '" << filename << "'";
+	std::vector<std::pair<unsigned long, String>> segments;
+	String prefix = filename + ".segment.";
 
-	try {
-		Utility::Glob(filename + ".tmp.*", &Utility::Remove, GlobFile);
-	} catch (const std::exception& ex) {
-		Log(LogWarning, "ConfigObject") << DiagnosticInformation(ex);
-	}
+	Utility::Glob(prefix + "*", [&prefix, &segments](const String& path) {
+		String suffix = path.SubStr(prefix.GetLength());
 
-	std::fstream fp;
-	String tempFilename = Utility::CreateTempFile(filename + ".tmp.XXXXXX", 0600, fp);
-	fp.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+		if (suffix.IsEmpty() || suffix.FindFirstNotOf("0123456789") != String::NPos)
+			return;
 
-	if (!fp)
-		BOOST_THROW_EXCEPTION(std::runtime_error("Could not open '" + tempFilename + "' file"));
+		segments.emplace_back(Convert::ToLong(suffix), path);
+	}, GlobFile);
 
-	StdioStream::Ptr sfp = new StdioStream(&fp, false);
+	std::sort(segments.begin(), segments.end());
+
+	return segments;
+}
+
+/**
+ * Serializes all objects in parallel chunks and passes their persistent
+ * representation to the callback, in a stable order.
+ *
+ * @param changedOnly Whether to skip objects whose state didn't change since they were serialized last time.
+ * @returns The number of objects passed to the callback.
+ */
+size_t ConfigObject::SerializeObjects(int attributeTypes, bool changedOnly, const std::function<void (const String&)>& callback)
+{
+	std::vector<ConfigObject::Ptr> objects;
 
 	for (const Type::Ptr& type : Type::GetAllTypes()) {
 		auto *dtype = dynamic_cast<ConfigType *>(type.get());
@@ -489,32 +520,146 @@ void ConfigObject::DumpObjects(const String& filename, int attributeTypes)
 		if (!dtype)
 			continue;
 
-		for (const ConfigObject::Ptr& object : dtype->GetObjects()) {
+		for (const ConfigObject::Ptr& object : dtype->GetObjects())
+			objects.emplace_back(object);
+	}
+
+	WorkQueue upq(25000, Configuration::Concurrency);
+	upq.SetName("ConfigObject::DumpObjects");
+
+	std::vector<size_t> chunk;
+	std::vector<String> messages;
+	size_t count = 0;
+
+	for (size_t offset = 0; offset < objects.size(); offset += l_DumpChunkSize) {
+		chunk.resize(std::min(l_DumpChunkSize, objects.size() - offset));
+		std::iota(chunk.begin(), chunk.end(), offset);
+
+		messages.assign(chunk.size(), String());
+
+		upq.ParallelFor(chunk, [&objects, &messages, offset, attributeTypes, changedOnly](size_t i) {
+			const ConfigObject::Ptr& object = objects[i];
 			Dictionary::Ptr update = Serialize(object, attributeTypes);
 
 			if (!update)
-				continue;
+				return;
 
 			Dictionary::Ptr persistentObject = new Dictionary({
-				{ "type", type->GetName() },
+				{ "type", object->GetReflectionType()->GetName() },
 				{ "name", object->GetName() },
 				{ "update", update }
 			});
 
 			String json = JsonEncode(persistentObject);
+			size_t digest = std::hash<std::string>()(json.GetData());
+
+			if (changedOnly && digest == object->m_StateDigest)
+				return;
+
+			object->m_StateDigest = digest;
+			messages[i - offset] = std::move(json);
+		});
+
+		upq.Join();
+
+		if (upq.HasExceptions()) {
+			upq.ReportExceptions("ConfigObject");
+			BOOST_THROW_EXCEPTION(std::runtime_error("Could not serialize program state"));
+		}
+
+		for (const String& message : messages) {
+			if (message.IsEmpty())
+				continue;
 
-			NetString::WriteStringToStream(sfp, json);
+			callback(message);
+			count++;
 		}
 	}
 
+	return count;
+}
+
+/**
+ * Writes the program state to a file.
+ *
+ * If Configuration::StateSegments is set, only objects whose state changed
+ * since the previous dump are written to a new segment next to the file.
+ * The segments are compacted into the file by the first dump of the process
+ * and after Configuration::StateSegments incremental dumps.
+ */
+void ConfigObject::DumpObjects(const String& filename, int attributeTypes)
+{
+	std::unique_lock<std::mutex> lock (l_DumpMutex);
+
+	bool full = Configuration::StateSegments <= 0 || l_StateSegmentCount < 0
+		|| l_StateSegmentCount >= Configuration::StateSegments || l_StateAttributeTypes != attributeTypes;
+
+	/* Until this dump is complete the digests don't necessarily match what's on disk. */
+	int segmentCount = l_StateSegmentCount;
+	l_StateSegmentCount = -1;
+
+	String targetFilename;
+
+	if (full) {
+		targetFilename = filename;
+
+		Log(LogInformation, "ConfigObject")
+			<< "Dumping program state to file '" << filename << "'";
+	} else {
+		targetFilename = filename + ".segment." + Convert::ToString(l_LastStateSegment + 1);
+
+		Log(LogNotice, "ConfigObject")
+			<< "Dumping changed program state to file '" << targetFilename << "'";
+	}
+
+	try {
+		Utility::Glob(filename + ".tmp.*", &Utility::Remove, GlobFile);
+	} catch (const std::exception& ex) {
+		Log(LogWarning, "ConfigObject") << DiagnosticInformation(ex);
+	}
+
+	std::fstream fp;
+	String tempFilename = Utility::CreateTempFile(filename + ".tmp.XXXXXX", 0600, fp);
+	fp.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+	if (!fp)
+		BOOST_THROW_EXCEPTION(std::runtime_error("Could not open '" + tempFilename + "' file"));
+
+	StdioStream::Ptr sfp = new StdioStream(&fp, false);
+
+	size_t count = SerializeObjects(attributeTypes, !full, [&sfp](const String& message) {
+		NetString::WriteStringToStream(sfp, message);
+	});
+
 	sfp->Close();
 
 	fp.close();
 
-	Utility::RenameFile(tempFilename, filename);
+	if (full) {
+		/* The new state file includes everything the segments hold. If we crash before they're
+		 * removed, RestoreObjects() skips them as they're older than the state file.
+		 */
+		Utility::RenameFile(tempFilename, filename);
+
+		for (auto& segment : GetStateSegments(filename))
+			Utility::Remove(segment.second);
+
+		l_LastStateSegment = 0;
+		segmentCount = 0;
+	} else if (count > 0) {
+		Utility::RenameFile(tempFilename, targetFilename);
+
+		l_LastStateSegment++;
+		segmentCount++;
+	} else {
+		Utility::Remove(tempFilename);
+	}
+
+	l_StateSegmentCount = segmentCount;
+	l_StateAttributeTypes = attributeTypes;
 }
 
-void ConfigObject::RestoreObject(const String& message, int attributeTypes)
+ConfigObject::Ptr ConfigObject::RestoreObject(const String& message, int attributeTypes)
 {
 	Dictionary::Ptr persistentObject = JsonDecode(message);
 
@@ -524,7 +669,7 @@ void ConfigObject::RestoreObject(const String& message, int attributeTypes)
 	ConfigObject::Ptr object = GetObject(type, name);
 
 	if (!object)
-		return;
+		return nullptr;
 
 #ifdef I2_DEBUG
 	Log(LogDebug, "ConfigObject")
@@ -532,8 +677,8 @@ void ConfigObject::RestoreObject(const String& message, int attributeTypes)
 #endif /* I2_DEBUG */
 	Dictionary::Ptr update = persistentObject->Get("update");
 	Deserialize(object, update, false, attributeTypes);
-	object->OnStateLoaded();
-	object->SetStateLoaded(true);
+
+	return object;
 }
 
 void ConfigObject::RestoreObjects(const String& filename, int attributeTypes)
@@ -541,35 +686,74 @@ void ConfigObject::RestoreObjects(const String& filename, int attributeTypes)
 	if (!Utility::PathExists(filename))
 		return;
 
-	Log(LogInformation, "ConfigObject")
-		<< "Restoring program state from file '" << filename << "'";
+	auto segments (GetStateSegments(filename));
+	std::vector<String> files { filename };
+	std::time_t stateModified = boost::filesystem::last_write_time(filename.GetData());
 
-	std::fstream fp;
-	fp.open(filename.CStr(), std::ios_base::in);
+	for (auto& segment : segments) {
+		boost::system::error_code ec;
+		std::time_t segmentModified = boost::filesystem::last_write_time(segment.second.GetData(), ec);
+
+		/* Left over from a full dump which was interrupted before it could remove them. */
+		if (!ec && segmentModified < stateModified) {
+			Log(LogNotice, "ConfigObject")
+				<< "Ignoring state segment '" << segment.second << "' which is older than '" << filename << "'";
+			continue;
+		}
+
+		files.emplace_back(std::move(segment.second));
+	}
 
-	StdioStream::Ptr sfp = new StdioStream (&fp, false);
+	Log(LogInformation, "ConfigObject")
+		<< "Restoring program state from file '" << filename << "' and " << (files.size() - 1) << " segment(s)";
 
-	unsigned long restored = 0;
+	std::mutex mutex;
+	std::unordered_set<ConfigObject *> restoredSet;
+	std::vector<ConfigObject::Ptr> restoredObjects;
 
 	WorkQueue upq(25000, Configuration::Concurrency);
 	upq.SetName("ConfigObject::RestoreObjects");
 
-	String message;
-	StreamReadContext src;
-	for (;;) {
-		StreamReadStatus srs = NetString::ReadStringFromStream(sfp, &message, src);
+	for (const String& file : files) {
+		std::fstream fp;
+		fp.open(file.CStr(), std::ios_base::in);
 
-		if (srs == StatusEof)
-			break;
+		StdioStream::Ptr sfp = new StdioStream (&fp, false);
 
-		if (srs != StatusNewItem)
-			continue;
+		String message;
+		StreamReadContext src;
+		for (;;) {
+			StreamReadStatus srs = NetString::ReadStringFromStream(sfp, &message, src);
 
-		upq.Enqueue([message, attributeTypes]() { RestoreObject(message, attributeTypes); });
-		restored++;
+			if (srs == StatusEof)
+				break;
+
+			if (srs != StatusNewItem)
+				continue;
+
+			upq.Enqueue([message, attributeTypes, &mutex, &restoredSet, &restoredObjects]() {
+				ConfigObject::Ptr object = RestoreObject(message, attributeTypes);
+
+				if (!object)
+					return;
+
+				std::unique_lock<std::mutex> lock (mutex);
+
+				if (restoredSet.insert(object.get()).second)
+					restoredObjects.emplace_back(std::move(object));
+			});
+		}
+
+		sfp->Close();
+
+		/* Every file holds each object at most once, but later segments override earlier files. */
+		upq.Join();
 	}
 
-	sfp->Close();
+	upq.ParallelFor(restoredObjects, [](const ConfigObject::Ptr& object) {
+		object->OnStateLoaded();
+		object->SetStateLoaded(true);
+	});
 
 	upq.Join();
 
@@ -592,7 +776,7 @@ void ConfigObject::RestoreObjects(const String& filename, int attributeTypes)
 	}
 
 	Log(LogInformation, "ConfigObject")
-		<< "Restored " << restored << " objects. Loaded " << no_state << " new objects without state.";
+		<< "Restored " << restoredObjects.size() << " objects. Loaded " << no_state << " new objects without state.";
 }
 
 void ConfigObject::StopObjects()
@@ -81,8 +81,10 @@ public:
 
 private:
 	ConfigObject::Ptr m_Zone;
+	size_t m_StateDigest{0};
 
-	static void RestoreObject(const String& message, int attributeTypes);
+	static size_t SerializeObjects(int attributeTypes, bool changedOnly, const std::function<void (const String&)>& callback);
+	static ConfigObject::Ptr RestoreObject(const String& message, int attributeTypes);
 };
 
 #define DECLARE_OBJECTNAME(klass)						\
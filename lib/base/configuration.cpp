@@ -32,6 +32,8 @@ String Configuration::EventEngine;
 String Configuration::IncludeConfDir;
 String Configuration::InitRunDir;
 String Configuration::LogDir;
+String Configuration::LogOverflowPolicy{"block"};
+int Configuration::LogQueueSize{0};
 String Configuration::ModAttrPath;
 String Configuration::ObjectsPath;
 String Configuration::PidPath;
@@ -43,8 +45,10 @@ int Configuration::RLimitProcesses;
 int Configuration::RLimitStack;
 String Configuration::RunAsGroup;
 String Configuration::RunAsUser;
+int Configuration::SpawnHelpers{1};
 String Configuration::SpoolDir;
 String Configuration::StatePath;
+int Configuration::StateSegments{0};
 double Configuration::TlsHandshakeTimeout{10};
 String Configuration::VarsPath;
 String Configuration::ZonesDir;
@@ -176,6 +180,26 @@ void Configuration::SetLogDir(const String& val, bool suppress_events, const Val
 	HandleUserWrite("LogDir", &Configuration::LogDir, val, m_ReadOnly);
 }
 
+String Configuration::GetLogOverflowPolicy() const
+{
+	return Configuration::LogOverflowPolicy;
+}
+
+void Configuration::SetLogOverflowPolicy(const String& val, bool suppress_events, const Value& cookie)
+{
+	HandleUserWrite("LogOverflowPolicy", &Configuration::LogOverflowPolicy, val, m_ReadOnly);
+}
+
+int Configuration::GetLogQueueSize() const
+{
+	return Configuration::LogQueueSize;
+}
+
+void Configuration::SetLogQueueSize(int val, bool suppress_events, const Value& cookie)
+{
+	HandleUserWrite("LogQueueSize", &Configuration::LogQueueSize, val, m_ReadOnly);
+}
+
 String Configuration::GetModAttrPath() const
 {
 	return Configuration::ModAttrPath;
@@ -286,6 +310,16 @@ void Configuration::SetRunAsUser(const String& val, bool suppress_events, const
 	HandleUserWrite("RunAsUser", &Configuration::RunAsUser, val, m_ReadOnly);
 }
 
+int Configuration::GetSpawnHelpers() const
+{
+	return Configuration::SpawnHelpers;
+}
+
+void Configuration::SetSpawnHelpers(int val, bool suppress_events, const Value& cookie)
+{
+	HandleUserWrite("SpawnHelpers", &Configuration::SpawnHelpers, val, m_ReadOnly);
+}
+
 String Configuration::GetSpoolDir() const
 {
 	return Configuration::SpoolDir;
@@ -306,6 +340,16 @@ void Configuration::SetStatePath(const String& val, bool suppress_events, const
 	HandleUserWrite("StatePath", &Configuration::StatePath, val, m_ReadOnly);
 }
 
+int Configuration::GetStateSegments() const
+{
+	return Configuration::StateSegments;
+}
+
+void Configuration::SetStateSegments(int val, bool suppress_events, const Value& cookie)
+{
+	HandleUserWrite("StateSegments", &Configuration::StateSegments, val, m_ReadOnly);
+}
+
 double Configuration::GetTlsHandshakeTimeout() const
 {
 	return Configuration::TlsHandshakeTimeout;
@@ -52,6 +52,12 @@ public:
 	String GetLogDir() const override;
 	void SetLogDir(const String& value, bool suppress_events = false, const Value& cookie = Empty) override;
 
+	String GetLogOverflowPolicy() const override;
+	void SetLogOverflowPolicy(const String& value, bool suppress_events = false, const Value& cookie = Empty) override;
+
+	int GetLogQueueSize() const override;
+	void SetLogQueueSize(int value, bool suppress_events = false, const Value& cookie = Empty) override;
+
 	String GetModAttrPath() const override;
 	void SetModAttrPath(const String& value, bool suppress_events = false, const Value& cookie = Empty) override;
 
@@ -85,12 +91,18 @@ public:
 	String GetRunAsUser() const override;
 	void SetRunAsUser(const String& value, bool suppress_events = false, const Value& cookie = Empty) override;
 
+	int GetSpawnHelpers() const override;
+	void SetSpawnHelpers(int value, bool suppress_events = false, const Value& cookie = Empty) override;
+
 	String GetSpoolDir() const override;
 	void SetSpoolDir(const String& value, bool suppress_events = false, const Value& cookie = Empty) override;
 
 	String GetStatePath() const override;
 	void SetStatePath(const String& value, bool suppress_events = false, const Value& cookie = Empty) override;
 
+	int GetStateSegments() const override;
+	void SetStateSegments(int value, bool suppress_events = false, const Value& cookie = Empty) override;
+
 	double GetTlsHandshakeTimeout() const override;
 	void SetTlsHandshakeTimeout(double value, bool suppress_events = false, const Value& cookie = Empty) override;
 
@@ -124,6 +136,8 @@ public:
 	static String IncludeConfDir;
 	static String InitRunDir;
 	static String LogDir;
+	static String LogOverflowPolicy;
+	static int LogQueueSize;
 	static String ModAttrPath;
 	static String ObjectsPath;
 	static String PidPath;
@@ -135,8 +149,10 @@ public:
 	static int RLimitStack;
 	static String RunAsGroup;
 	static String RunAsUser;
+	static int SpawnHelpers;
 	static String SpoolDir;
 	static String StatePath;
+	static int StateSegments;
 	static double TlsHandshakeTimeout;
 	static String VarsPath;
 	static String ZonesDir;
@@ -5,6 +5,7 @@
 #include "base/configtype.hpp"
 #include "base/statsfunction.hpp"
 #include "base/application.hpp"
+#include "base/perfdatavalue.hpp"
 #include <fstream>
 
 using namespace icinga;
@@ -13,7 +14,7 @@ REGISTER_TYPE(FileLogger);
 
 REGISTER_STATSFUNCTION(FileLogger, &FileLogger::StatsFunc);
 
-void FileLogger::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr&)
+void FileLogger::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
 {
 	DictionaryData nodes;
 
@@ -22,6 +23,8 @@ void FileLogger::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr&)
 	}
 
 	status->Set("filelogger", new Dictionary(std::move(nodes)));
+
+	perfdata->Add(new PerfdataValue("log_queue_dropped_entries", Logger::GetDroppedLogEntries(), true));
 }
 
 /**
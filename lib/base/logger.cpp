@@ -2,7 +2,9 @@
 
 #include "base/logger.hpp"
 #include "base/logger-ti.cpp"
+#include "base/logqueue.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
 #include "base/streamlogger.hpp"
 #include "base/configtype.hpp"
 #include "base/utility.hpp"
@@ -11,6 +13,8 @@
 #include "base/scriptglobal.hpp"
 #ifdef _WIN32
 #include "base/windowseventloglogger.hpp"
+#else /* _WIN32 */
+#include <pthread.h>
 #endif /* _WIN32 */
 #include <iostream>
 #include <utility>
@@ -36,6 +40,11 @@ std::atomic<bool> Logger::m_EarlyLoggingEnabled (true);
 bool Logger::m_TimestampEnabled = true;
 LogSeverity Logger::m_ConsoleLogSeverity = LogInformation;
 
+static std::atomic<LogQueue *> l_LogQueue (nullptr);
+static std::mutex l_LogQueueMutex;
+
+static void DispatchLogEntry(const LogEntry& entry);
+
 INITIALIZE_ONCE([]() {
 	ScriptGlobal::Set("System.LogDebug", LogDebug, true);
 	ScriptGlobal::Set("System.LogNotice", LogNotice, true);
@@ -195,6 +204,81 @@ void Logger::ValidateSeverity(const Lazy<String>& lvalue, const ValidationUtils&
 	}
 }
 
+#ifndef _WIN32
+static void LogQueueAtForkChild()
+{
+	/* The queue thread didn't survive the fork(), the child starts over with a new queue. */
+	l_LogQueue.store(nullptr);
+}
+#endif /* _WIN32 */
+
+/**
+ * Returns the queue used for asynchronous logging, creating it on first use.
+ *
+ * @returns nullptr if Configuration::LogQueueSize disables asynchronous logging.
+ */
+static LogQueue *GetLogQueue()
+{
+	if (Configuration::LogQueueSize <= 0)
+		return nullptr;
+
+	LogQueue *queue = l_LogQueue.load();
+
+	if (queue)
+		return queue;
+
+	std::unique_lock<std::mutex> lock(l_LogQueueMutex);
+
+	queue = l_LogQueue.load();
+
+	if (queue)
+		return queue;
+
+#ifndef _WIN32
+	static bool atForkRegistered = false;
+
+	if (!atForkRegistered) {
+		pthread_atfork(nullptr, nullptr, &LogQueueAtForkChild);
+		atForkRegistered = true;
+	}
+#endif /* _WIN32 */
+
+	LogOverflowPolicy policy = LogOverflowBlock;
+
+	try {
+		policy = LogQueue::StringToOverflowPolicy(Configuration::LogOverflowPolicy);
+	} catch (const std::exception&) { /* use the default policy */ }
+
+	/* Never freed: the detached queue thread keeps using it until the process exits. */
+	queue = new LogQueue(Configuration::LogQueueSize, policy, &DispatchLogEntry);
+	queue->Start();
+
+	l_LogQueue.store(queue);
+
+	return queue;
+}
+
+/**
+ * Waits until all entries which were logged so far have been written to the loggers.
+ */
+void Logger::FlushLogQueue()
+{
+	LogQueue *queue = l_LogQueue.load();
+
+	if (queue)
+		queue->Flush();
+}
+
+/**
+ * Returns the number of log entries the asynchronous log queue dropped because it was full.
+ */
+uint_fast64_t Logger::GetDroppedLogEntries()
+{
+	LogQueue *queue = l_LogQueue.load();
+
+	return queue ? queue->GetDropped() : 0;
+}
+
 Log::Log(LogSeverity severity, String facility, const String& message)
 	: m_Severity(severity), m_Facility(std::move(facility))
 {
@@ -232,6 +316,28 @@ Log::~Log()
 		}
 	}
 
+	LogQueue *queue = GetLogQueue();
+
+	/* Critical entries usually precede a shutdown, make sure they're out before returning. */
+	if (queue && !LogQueue::IsQueueThread()) {
+		bool critical = entry.Severity >= LogCritical;
+
+		queue->Enqueue(std::move(entry));
+
+		if (critical)
+			queue->Flush();
+
+		return;
+	}
+
+	DispatchLogEntry(entry);
+}
+
+/**
+ * Writes a log entry to all active loggers and the console.
+ */
+static void DispatchLogEntry(const LogEntry& entry)
+{
 	for (const Logger::Ptr& logger : Logger::GetLoggers()) {
 		ObjectLock llock(logger);
 
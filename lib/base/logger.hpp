@@ -5,6 +5,7 @@
 
 #include "base/i2-base.hpp"
 #include "base/logger-ti.hpp"
+#include <cstdint>
 #include <set>
 #include <sstream>
 
@@ -76,6 +77,9 @@ public:
 	static void SetConsoleLogSeverity(LogSeverity logSeverity);
 	static LogSeverity GetConsoleLogSeverity();
 
+	static void FlushLogQueue();
+	static uint_fast64_t GetDroppedLogEntries();
+
 	void ValidateSeverity(const Lazy<String>& lvalue, const ValidationUtils& utils) final;
 
 protected:
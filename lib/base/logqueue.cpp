@@ -0,0 +1,205 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/logqueue.hpp"
+#include "base/utility.hpp"
+#include <thread>
+
+using namespace icinga;
+
+static thread_local bool l_IsQueueThread = false;
+
+/**
+ * @param capacity The minimum number of entries; rounded up to a power of two.
+ * @param policy What to do with entries while the queue is full.
+ * @param handler Called on the queue thread for every entry, in order.
+ */
+LogQueue::LogQueue(size_t capacity, LogOverflowPolicy policy, Handler handler)
+	: m_Policy(policy), m_Handler(std::move(handler))
+{
+	size_t size = 2;
+
+	while (size < capacity)
+		size <<= 1;
+
+	m_Cells.reset(new Cell[size]);
+	m_Mask = size - 1;
+
+	for (size_t i = 0; i < size; i++)
+		m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+}
+
+/**
+ * Spawns the (detached) queue thread.
+ */
+void LogQueue::Start()
+{
+	std::thread([this]() { ThreadProc(); }).detach();
+}
+
+/**
+ * Queues a log entry, waiting for room or dropping it according to the
+ * overflow policy if the queue is full.
+ */
+void LogQueue::Enqueue(LogEntry&& entry)
+{
+	if (!TryEnqueue(entry)) {
+		if (m_Policy == LogOverflowDropAll || (m_Policy == LogOverflowDropDebug && entry.Severity == LogDebug)) {
+			m_Dropped.fetch_add(1);
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		m_ProgressWaiters.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		while (!TryEnqueue(entry))
+			m_ProgressCV.wait(lock);
+
+		m_ProgressWaiters.fetch_sub(1);
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (m_ConsumerWaiting.load(std::memory_order_relaxed)) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_ConsumerCV.notify_one();
+	}
+}
+
+/**
+ * Waits until all entries which were queued before this call have been handled.
+ */
+void LogQueue::Flush()
+{
+	if (IsQueueThread())
+		return;
+
+	size_t target = m_EnqueuePos.load();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	m_ProgressWaiters.fetch_add(1);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	while (m_Handled.load() < target)
+		m_ProgressCV.wait(lock);
+
+	m_ProgressWaiters.fetch_sub(1);
+}
+
+uint_fast64_t LogQueue::GetDropped() const
+{
+	return m_Dropped.load();
+}
+
+bool LogQueue::IsQueueThread()
+{
+	return l_IsQueueThread;
+}
+
+LogOverflowPolicy LogQueue::StringToOverflowPolicy(const String& policy)
+{
+	if (policy == "block")
+		return LogOverflowBlock;
+	else if (policy == "drop-debug")
+		return LogOverflowDropDebug;
+	else if (policy == "drop-all")
+		return LogOverflowDropAll;
+	else
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid log overflow policy: " + policy));
+}
+
+/**
+ * Moves the entry into a free slot (Vyukov's bounded queue).
+ *
+ * @returns false if the queue is full, entry is left untouched then.
+ */
+bool LogQueue::TryEnqueue(LogEntry& entry)
+{
+	size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+
+	for (;;) {
+		Cell& cell = m_Cells[pos & m_Mask];
+		size_t seq = cell.Sequence.load(std::memory_order_acquire);
+		auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+		if (diff == 0) {
+			if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				cell.Entry = std::move(entry);
+				cell.Sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool LogQueue::TryDequeue(LogEntry& entry)
+{
+	Cell& cell = m_Cells[m_DequeuePos & m_Mask];
+
+	if (cell.Sequence.load(std::memory_order_acquire) != m_DequeuePos + 1)
+		return false;
+
+	entry = std::move(cell.Entry);
+	cell.Sequence.store(m_DequeuePos + m_Mask + 1, std::memory_order_release);
+	m_DequeuePos++;
+
+	return true;
+}
+
+bool LogQueue::IsEmpty() const
+{
+	return m_Cells[m_DequeuePos & m_Mask].Sequence.load(std::memory_order_acquire) != m_DequeuePos + 1;
+}
+
+void LogQueue::NotifyProgress()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (m_ProgressWaiters.load(std::memory_order_relaxed) > 0) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_ProgressCV.notify_all();
+	}
+}
+
+void LogQueue::ThreadProc()
+{
+	Utility::SetThreadName("Log");
+
+	l_IsQueueThread = true;
+
+	for (;;) {
+		LogEntry entry;
+
+		if (TryDequeue(entry)) {
+			/* Blocked producers may use the slot we've just freed. */
+			NotifyProgress();
+
+			try {
+				m_Handler(entry);
+			} catch (...) {
+				/* There's nowhere left to report this. */
+			}
+
+			m_Handled.fetch_add(1);
+			NotifyProgress();
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		m_ConsumerWaiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (IsEmpty())
+			m_ConsumerCV.wait(lock);
+
+		m_ConsumerWaiting.store(false, std::memory_order_relaxed);
+	}
+}
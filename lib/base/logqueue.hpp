@@ -0,0 +1,93 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef LOGQUEUE_H
+#define LOGQUEUE_H
+
+#include "base/i2-base.hpp"
+#include "base/logger.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace icinga
+{
+
+/**
+ * What to do with log entries for which there is no room left in a LogQueue.
+ *
+ * @ingroup base
+ */
+enum LogOverflowPolicy
+{
+	LogOverflowBlock, /**< Wait for the queue to make progress. */
+	LogOverflowDropDebug, /**< Drop debug entries, wait for everything else. */
+	LogOverflowDropAll /**< Drop the entry. */
+};
+
+/**
+ * A bounded multi-producer/single-consumer ring buffer of log entries
+ * which is drained by a dedicated thread.
+ *
+ * Producers claim slots with a CAS on the enqueue position and never take
+ * a lock unless the queue is full (and the policy says to wait) or the
+ * consumer is asleep.
+ *
+ * @ingroup base
+ */
+class LogQueue
+{
+public:
+	typedef std::function<void (const LogEntry&)> Handler;
+
+	LogQueue(size_t capacity, LogOverflowPolicy policy, Handler handler);
+
+	LogQueue(const LogQueue&) = delete;
+	LogQueue& operator=(const LogQueue&) = delete;
+
+	void Start();
+
+	void Enqueue(LogEntry&& entry);
+	void Flush();
+
+	uint_fast64_t GetDropped() const;
+
+	static bool IsQueueThread();
+	static LogOverflowPolicy StringToOverflowPolicy(const String& policy);
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> Sequence;
+		LogEntry Entry;
+	};
+
+	std::unique_ptr<Cell[]> m_Cells;
+	size_t m_Mask;
+	LogOverflowPolicy m_Policy;
+	Handler m_Handler;
+
+	alignas(64) std::atomic<size_t> m_EnqueuePos{0};
+	alignas(64) size_t m_DequeuePos{0};
+	std::atomic<size_t> m_Handled{0};
+	std::atomic<uint_fast64_t> m_Dropped{0};
+
+	std::mutex m_Mutex;
+	std::condition_variable m_ConsumerCV;
+	std::condition_variable m_ProgressCV;
+	std::atomic<bool> m_ConsumerWaiting{false};
+	std::atomic<int> m_ProgressWaiters{0};
+
+	bool TryEnqueue(LogEntry& entry);
+	bool TryDequeue(LogEntry& entry);
+	bool IsEmpty() const;
+	void NotifyProgress();
+
+	void ThreadProc();
+};
+
+}
+
+#endif /* LOGQUEUE_H */
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <climits>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <utility>
 
@@ -29,7 +30,62 @@ static const EndiannessDetector l_EndiannessDetector;
 // Assumption: The compiler will optimize (away) if/else statements using this.
 #define MACHINE_LITTLE_ENDIAN (l_EndiannessDetector.buf[0])
 
-static void PackAny(const Value& value, std::string& builder);
+template<class Builder>
+static void PackAny(const Value& value, Builder& builder);
+
+/**
+ * Collects the packed bytes in a buffer of its own and hands them to the sink
+ * in chunks, so that the sink isn't called for every single byte.
+ */
+class ChunkedBuilder
+{
+public:
+	ChunkedBuilder(const std::function<void(const char*, size_t)>& sink)
+		: m_Sink(sink)
+	{
+		m_Buffer.reserve(m_ChunkSize);
+	}
+
+	ChunkedBuilder(const ChunkedBuilder&) = delete;
+	ChunkedBuilder& operator=(const ChunkedBuilder&) = delete;
+
+	void append(const char* data, size_t length)
+	{
+		if (m_Buffer.size() + length > m_ChunkSize) {
+			Flush();
+
+			if (length > m_ChunkSize) {
+				m_Sink(data, length);
+				return;
+			}
+		}
+
+		m_Buffer.append(data, length);
+	}
+
+	ChunkedBuilder& operator+=(char c)
+	{
+		if (m_Buffer.size() >= m_ChunkSize)
+			Flush();
+
+		m_Buffer += c;
+		return *this;
+	}
+
+	void Flush()
+	{
+		if (!m_Buffer.empty()) {
+			m_Sink(m_Buffer.data(), m_Buffer.size());
+			m_Buffer.clear();
+		}
+	}
+
+private:
+	static constexpr size_t m_ChunkSize = 4096;
+
+	const std::function<void(const char*, size_t)>& m_Sink;
+	std::string m_Buffer;
+};
 
 /**
  * std::swap() seems not to work
@@ -72,7 +128,8 @@ static inline char UIntToByte(unsigned i)
 /**
  * Append the given int as big-endian 64-bit unsigned int
  */
-static inline void PackUInt64BE(uint_least64_t i, std::string& builder)
+template<class Builder>
+static inline void PackUInt64BE(uint_least64_t i, Builder& builder)
 {
 	char buf[8] = {
 		UIntToByte(i >> 56u),
@@ -109,7 +166,8 @@ union Double2BytesConverter
 /**
  * Append the given double as big-endian IEEE 754 binary64
  */
-static inline void PackFloat64BE(double f, std::string& builder)
+template<class Builder>
+static inline void PackFloat64BE(double f, Builder& builder)
 {
 	Double2BytesConverter converter;
 
@@ -128,16 +186,18 @@ static inline void PackFloat64BE(double f, std::string& builder)
 /**
  * Append the given string's length (BE uint64) and the string itself
  */
-static inline void PackString(const String& string, std::string& builder)
+template<class Builder>
+static inline void PackString(const String& string, Builder& builder)
 {
 	PackUInt64BE(string.GetLength(), builder);
-	builder += string.GetData();
+	builder.append(string.CStr(), string.GetLength());
 }
 
 /**
  * Append the given array
  */
-static inline void PackArray(const Array::Ptr& arr, std::string& builder)
+template<class Builder>
+static inline void PackArray(const Array::Ptr& arr, Builder& builder)
 {
 	ObjectLock olock(arr);
 
@@ -152,7 +212,8 @@ static inline void PackArray(const Array::Ptr& arr, std::string& builder)
 /**
  * Append the given dictionary
  */
-static inline void PackDictionary(const Dictionary::Ptr& dict, std::string& builder)
+template<class Builder>
+static inline void PackDictionary(const Dictionary::Ptr& dict, Builder& builder)
 {
 	ObjectLock olock(dict);
 
@@ -168,7 +229,8 @@ static inline void PackDictionary(const Dictionary::Ptr& dict, std::string& buil
 /**
  * Append any JSON-encodable value
  */
-static void PackAny(const Value& value, std::string& builder)
+template<class Builder>
+static void PackAny(const Value& value, Builder& builder)
 {
 	switch (value.GetType()) {
 		case ValueString:
@@ -244,3 +306,17 @@ String icinga::PackObject(const Value& value)
 
 	return std::move(builder);
 }
+
+/**
+ * Pack any JSON-encodable value like PackObject() above, but pass the result
+ * to the sink piece by piece instead of building it in memory
+ *
+ * The concatenation of all pieces equals PackObject(value). This allows e.g.
+ * to feed a hash function directly.
+ */
+void icinga::PackObject(const Value& value, const std::function<void(const char*, size_t)>& sink)
+{
+	ChunkedBuilder builder (sink);
+	PackAny(value, builder);
+	builder.Flush();
+}
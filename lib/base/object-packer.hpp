@@ -4,6 +4,8 @@
 #define OBJECT_PACKER
 
 #include "base/i2-base.hpp"
+#include <cstddef>
+#include <functional>
 
 namespace icinga
 {
@@ -12,6 +14,7 @@ class String;
 class Value;
 
 String PackObject(const Value& value);
+void PackObject(const Value& value, const std::function<void(const char*, size_t)>& sink);
 
 }
 
@@ -10,17 +10,28 @@
 #include "base/logger.hpp"
 #include "base/utility.hpp"
 #include "base/scriptglobal.hpp"
-#include "base/json.hpp"
+#include "base/configuration.hpp"
 #include <boost/algorithm/string/join.hpp>
 #include <boost/thread/once.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <queue>
 #include <thread>
 #include <iostream>
 
 #ifndef _WIN32
 #	include <execvpe.h>
 #	include <poll.h>
+#	include <spawn.h>
 #	include <string.h>
 
+#	ifdef __linux__
+#		include <sys/epoll.h>
+#	endif /* __linux__ */
+
 #	ifndef __APPLE__
 extern char **environ;
 #	else /* __APPLE__ */
@@ -41,9 +52,15 @@ static HANDLE l_Events[IOTHREADS];
 static int l_EventFDs[IOTHREADS][2];
 static std::map<Process::ConsoleHandle, Process::ProcessHandle> l_FDs[IOTHREADS];
 
-static std::mutex l_ProcessControlMutex;
-static int l_ProcessControlFD = -1;
-static pid_t l_ProcessControlPID;
+#	ifdef __linux__
+typedef std::pair<double, Process::ProcessHandle> ProcessTimeout;
+
+static int l_EpollFDs[IOTHREADS];
+static std::priority_queue<ProcessTimeout, std::vector<ProcessTimeout>, std::greater<ProcessTimeout>> l_ProcessTimeouts[IOTHREADS];
+#	endif /* __linux__ */
+
+/* Scratch space for reading plugin output, reused by all processes of an IO thread. */
+static char l_ReadBuffers[IOTHREADS][16 * 1024];
 #endif /* _WIN32 */
 static boost::once_flag l_ProcessOnceFlag = BOOST_ONCE_INIT;
 static boost::once_flag l_SpawnHelperOnceFlag = BOOST_ONCE_INIT;
@@ -54,7 +71,7 @@ Process::Process(Process::Arguments arguments, Dictionary::Ptr extraEnvironment)
 #ifdef _WIN32
 	, m_ReadPending(false), m_ReadFailed(false), m_Overlapped()
 #else /* _WIN32 */
-	, m_SentSigterm(false)
+	, m_SentSigterm(false), m_SpawnHelper(0)
 #endif /* _WIN32 */
 	, m_AdjustPriority(false), m_ResultAvailable(false)
 {
@@ -71,75 +88,109 @@ Process::~Process()
 }
 
 #ifndef _WIN32
-static Value ProcessSpawnImpl(struct msghdr *msgh, const Dictionary::Ptr& request)
+/* Commands understood by the spawn helper. */
+enum SpawnHelperCommand : uint32_t
 {
-	struct cmsghdr *cmsg = CMSG_FIRSTHDR(msgh);
-
-	if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3)) {
-		std::cerr << "Invalid 'spawn' request: FDs missing" << std::endl;
-		return Empty;
-	}
-
-	auto *fds = (int *)CMSG_DATA(cmsg);
-
-	Array::Ptr arguments = request->Get("arguments");
-	Dictionary::Ptr extraEnvironment = request->Get("extraEnvironment");
-	bool adjustPriority = request->Get("adjustPriority");
-
-	// build argv
-	auto **argv = new char *[arguments->GetLength() + 1];
-
-	for (unsigned int i = 0; i < arguments->GetLength(); i++) {
-		String arg = arguments->Get(i);
-		argv[i] = strdup(arg.CStr());
-	}
-
-	argv[arguments->GetLength()] = nullptr;
-
-	// build envp
-	int envc = 0;
+	SpawnHelperSpawn,
+	SpawnHelperWaitPID,
+	SpawnHelperKill
+};
+
+/**
+ * Fixed-size header of a spawn helper request. It is immediately followed by
+ * Length bytes of payload. Spawn requests carry the child's stdin, stdout and
+ * stderr as SCM_RIGHTS ancillary data attached to the header.
+ */
+struct SpawnHelperRequest
+{
+	uint32_t ID;
+	uint32_t Command;
+	uint32_t Length;
+};
+
+/**
+ * Fixed-size reply of the spawn helper, matched to its request by ID.
+ * Replies may arrive in a different order than the requests were sent.
+ */
+struct SpawnHelperResponse
+{
+	uint32_t ID;
+	int32_t RC;
+	int32_t Error;
+	int32_t Status;
+};
+
+/* A request which has been sent to a spawn helper and waits for its reply. */
+struct SpawnHelperCall
+{
+	SpawnHelperResponse Response;
+	bool Done{false};
+};
+
+/**
+ * The parent's end of a spawn helper connection. Requests are pipelined:
+ * callers only hold Mutex while writing their request, and whichever caller
+ * finds nobody else reading collects the replies for all pending calls.
+ */
+struct SpawnHelper
+{
+	std::mutex Mutex;
+	std::condition_variable CV;
+	int FD{-1};
+	pid_t PID{-1};
+	uint32_t NextID{0};
+	bool Reading{false};
+	std::map<uint32_t, SpawnHelperCall*> Calls;
+	std::vector<char> ReadBuffer;
+};
+
+static std::vector<std::unique_ptr<SpawnHelper>> l_SpawnHelpers;
+static std::atomic<size_t> l_NextSpawnHelper{0};
+
+/* The helper's own end of its control socket (only set inside the helper process). */
+static int l_ProcessControlFD = -1;
 
-	/* count existing environment variables */
-	while (environ[envc])
-		envc++;
+static void EncodeString(std::string& buffer, const String& value)
+{
+	buffer.append(value.CStr(), value.GetLength() + 1);
+}
 
-	auto **envp = new char *[envc + (extraEnvironment ? extraEnvironment->GetLength() : 0) + 2];
-	const char* lcnumeric = "LC_NUMERIC=";
-	const char* notifySocket = "NOTIFY_SOCKET=";
-	int j = 0;
+template<typename T>
+static void EncodeValue(std::string& buffer, T value)
+{
+	buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
 
-	for (int i = 0; i < envc; i++) {
-		if (strncmp(environ[i], lcnumeric, strlen(lcnumeric)) == 0) {
-			continue;
-		}
+template<typename T>
+static bool DecodeValue(const char *& pos, const char *end, T& value)
+{
+	if (end - pos < static_cast<ptrdiff_t>(sizeof(value)))
+		return false;
 
-		if (strncmp(environ[i], notifySocket, strlen(notifySocket)) == 0) {
-			continue;
-		}
+	memcpy(&value, pos, sizeof(value));
+	pos += sizeof(value);
+	return true;
+}
 
-		envp[j] = strdup(environ[i]);
-		++j;
-	}
+static bool DecodeStrings(const char *& pos, const char *end, uint32_t count, std::vector<char *>& strings)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		auto *nul = static_cast<const char *>(memchr(pos, '\0', end - pos));
 
-	if (extraEnvironment) {
-		ObjectLock olock(extraEnvironment);
+		if (!nul)
+			return false;
 
-		for (const Dictionary::Pair& kv : extraEnvironment) {
-			String skv = kv.first + "=" + Convert::ToString(kv.second);
-			envp[j] = strdup(skv.CStr());
-			j++;
-		}
+		strings.push_back(const_cast<char *>(pos));
+		pos = nul + 1;
 	}
 
-	envp[j] = strdup("LC_NUMERIC=C");
-	envp[j + 1] = nullptr;
-
-	extraEnvironment.reset();
+	return true;
+}
 
+static pid_t ProcessSpawnFork(char **argv, char **envp, bool adjustPriority, const int fds[3], int& errorCode)
+{
 	pid_t pid = fork();
 
-	int errorCode = 0;
-
 	if (pid < 0)
 		errorCode = errno;
 
@@ -187,59 +238,215 @@ static Value ProcessSpawnImpl(struct msghdr *msgh, const Dictionary::Ptr& reques
 		_exit(128);
 	}
 
+	return pid;
+}
+
+#ifdef POSIX_SPAWN_SETSID
+/**
+ * Spawns the command with posix_spawn() which avoids copying the helper's page
+ * tables. Only used for commands with an absolute or relative path and without
+ * priority adjustment; anything else (including spawn errors, which need to
+ * be reported on the child's stderr) is left to ProcessSpawnFork().
+ */
+static bool ProcessSpawnPosix(char **argv, char **envp, bool adjustPriority, const int fds[3], pid_t& pid)
+{
+	if (adjustPriority || !strchr(argv[0], '/'))
+		return false;
+
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	sigset_t mask;
+
+	sigemptyset(&mask);
+
+	if (posix_spawn_file_actions_init(&actions) != 0)
+		return false;
+
+	if (posix_spawnattr_init(&attr) != 0) {
+		posix_spawn_file_actions_destroy(&actions);
+		return false;
+	}
+
+	/* The control socket and fds[] are close-on-exec, only the dup2() copies survive. */
+	int rc = posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+
+	if (rc == 0)
+		rc = posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+	if (rc == 0)
+		rc = posix_spawn_file_actions_adddup2(&actions, fds[2], STDERR_FILENO);
+
+	if (rc == 0)
+		rc = posix_spawnattr_setsigmask(&attr, &mask);
+
+	if (rc == 0)
+		rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK);
+
+	if (rc == 0)
+		rc = posix_spawn(&pid, argv[0], &actions, &attr, argv, envp);
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+
+	return rc == 0;
+}
+#endif /* POSIX_SPAWN_SETSID */
+
+static void ProcessSpawnImpl(struct msghdr *msgh, const char *payload, size_t length, SpawnHelperResponse& response)
+{
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(msgh);
+
+	if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3)) {
+		std::cerr << "Invalid 'spawn' request: FDs missing" << std::endl;
+		response.Error = EINVAL;
+		return;
+	}
+
+	int fds[3];
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+	const char *pos = payload;
+	const char *end = payload + length;
+	uint8_t adjustPriority;
+	uint32_t argc, envc;
+
+	std::vector<char *> argv, extraEnvironment;
+
+	if (!DecodeValue(pos, end, adjustPriority) || !DecodeValue(pos, end, argc) || !DecodeValue(pos, end, envc)
+		|| argc == 0 || !DecodeStrings(pos, end, argc, argv) || !DecodeStrings(pos, end, envc, extraEnvironment)) {
+		std::cerr << "Invalid 'spawn' request: malformed payload" << std::endl;
+
+		(void)close(fds[0]);
+		(void)close(fds[1]);
+		(void)close(fds[2]);
+
+		response.Error = EINVAL;
+		return;
+	}
+
+	argv.push_back(nullptr);
+
+	// build envp
+	const char* lcnumeric = "LC_NUMERIC=";
+	const char* notifySocket = "NOTIFY_SOCKET=";
+	std::vector<char *> envp;
+
+	for (int i = 0; environ[i]; i++) {
+		if (strncmp(environ[i], lcnumeric, strlen(lcnumeric)) == 0) {
+			continue;
+		}
+
+		if (strncmp(environ[i], notifySocket, strlen(notifySocket)) == 0) {
+			continue;
+		}
+
+		envp.push_back(environ[i]);
+	}
+
+	envp.insert(envp.end(), extraEnvironment.begin(), extraEnvironment.end());
+
+	char lcnumericC[] = "LC_NUMERIC=C";
+	envp.push_back(lcnumericC);
+	envp.push_back(nullptr);
+
+	pid_t pid = -1;
+	int errorCode = 0;
+
+#ifdef POSIX_SPAWN_SETSID
+	if (!ProcessSpawnPosix(argv.data(), envp.data(), adjustPriority, fds, pid))
+#endif /* POSIX_SPAWN_SETSID */
+		pid = ProcessSpawnFork(argv.data(), envp.data(), adjustPriority, fds, errorCode);
+
 	(void)close(fds[0]);
 	(void)close(fds[1]);
 	(void)close(fds[2]);
 
-	// free arguments
-	for (int i = 0; argv[i]; i++)
-		free(argv[i]);
+	response.RC = pid;
+	response.Error = errorCode;
+}
 
-	delete[] argv;
+static void ProcessKillImpl(const char *payload, size_t length, SpawnHelperResponse& response)
+{
+	const char *pos = payload;
+	const char *end = payload + length;
+	int32_t pid, signum;
 
-	// free environment
-	for (int i = 0; envp[i]; i++)
-		free(envp[i]);
+	if (!DecodeValue(pos, end, pid) || !DecodeValue(pos, end, signum)) {
+		response.Error = EINVAL;
+		return;
+	}
 
-	delete[] envp;
+	errno = 0;
+	response.RC = kill(pid, signum);
+	response.Error = errno;
+}
 
-	Dictionary::Ptr response = new Dictionary({
-		{ "rc", pid },
-		{ "errno", errorCode }
-	});
+static void ProcessWaitPIDImpl(const char *payload, size_t length, SpawnHelperResponse& response)
+{
+	const char *pos = payload;
+	const char *end = payload + length;
+	int32_t pid;
 
-	return response;
+	if (!DecodeValue(pos, end, pid)) {
+		response.Error = EINVAL;
+		return;
+	}
+
+	int status = 0;
+	response.RC = waitpid(pid, &status, 0);
+	response.Status = status;
 }
 
-static Value ProcessKillImpl(struct msghdr *msgh, const Dictionary::Ptr& request)
+static bool SendAll(int fd, const char *buffer, size_t length)
 {
-	pid_t pid = request->Get("pid");
-	int signum = request->Get("signum");
+	while (length > 0) {
+		ssize_t rc = send(fd, buffer, length, 0);
 
-	errno = 0;
-	kill(pid, signum);
-	int error = errno;
+		if (rc < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
 
-	Dictionary::Ptr response = new Dictionary({
-		{ "errno", error }
-	});
+			return false;
+		}
+
+		buffer += rc;
+		length -= rc;
+	}
 
-	return response;
+	return true;
 }
 
-static Value ProcessWaitPIDImpl(struct msghdr *msgh, const Dictionary::Ptr& request)
+static bool RecvAll(int fd, char *buffer, size_t length)
 {
-	pid_t pid = request->Get("pid");
+	while (length > 0) {
+		ssize_t rc = recv(fd, buffer, length, 0);
 
-	int status;
-	int rc = waitpid(pid, &status, 0);
+		if (rc <= 0) {
+			if (rc < 0 && (errno == EINTR || errno == EAGAIN))
+				continue;
 
-	Dictionary::Ptr response = new Dictionary({
-		{ "status", status },
-		{ "rc", rc }
-	});
+			return false;
+		}
 
-	return response;
+		buffer += rc;
+		length -= rc;
+	}
+
+	return true;
+}
+
+static void FlushSpawnHelperResponses(std::vector<SpawnHelperResponse>& responses)
+{
+	if (responses.empty())
+		return;
+
+	if (!SendAll(l_ProcessControlFD, reinterpret_cast<const char *>(responses.data()), responses.size() * sizeof(SpawnHelperResponse))) {
+		BOOST_THROW_EXCEPTION(posix_error()
+			<< boost::errinfo_api_function("send")
+			<< boost::errinfo_errno(errno));
+	}
+
+	responses.clear();
 }
 
 static void ProcessHandler()
@@ -249,16 +456,20 @@ static void ProcessHandler()
 	sigprocmask(SIG_SETMASK, &mask, nullptr);
 
 	Utility::CloseAllFDs({0, 1, 2, l_ProcessControlFD});
+	Utility::SetCloExec(l_ProcessControlFD);
+
+	std::vector<char> payload;
+	std::vector<SpawnHelperResponse> responses;
 
 	for (;;) {
-		size_t length;
+		SpawnHelperRequest request;
 
 		struct msghdr msg;
 		memset(&msg, 0, sizeof(msg));
 
 		struct iovec io;
-		io.iov_base = &length;
-		io.iov_len = sizeof(length);
+		io.iov_base = &request;
+		io.iov_len = sizeof(request);
 
 		msg.msg_iov = &io;
 		msg.msg_iovlen = 1;
@@ -267,7 +478,12 @@ static void ProcessHandler()
 		msg.msg_control = cbuf;
 		msg.msg_controllen = sizeof(cbuf);
 
-		int rc = recvmsg(l_ProcessControlFD, &msg, 0);
+		int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+		flags |= MSG_CMSG_CLOEXEC;
+#endif /* MSG_CMSG_CLOEXEC */
+
+		ssize_t rc = recvmsg(l_ProcessControlFD, &msg, flags);
 
 		if (rc <= 0) {
 			if (rc < 0 && (errno == EINTR || errno == EAGAIN))
@@ -276,67 +492,75 @@ static void ProcessHandler()
 			break;
 		}
 
-		auto *mbuf = new char[length];
+#ifndef MSG_CMSG_CLOEXEC
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+				auto *fds = (int *)CMSG_DATA(cmsg);
 
-		size_t count = 0;
-		while (count < length) {
-			rc = recv(l_ProcessControlFD, mbuf + count, length - count, 0);
-
-			if (rc <= 0) {
-				if (rc < 0 && (errno == EINTR || errno == EAGAIN))
-					continue;
-
-				delete [] mbuf;
-
-				_exit(0);
+				for (size_t i = 0; i < (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int); i++)
+					Utility::SetCloExec(fds[i]);
 			}
-
-			count += rc;
-
-			if (rc == 0)
-				break;
 		}
+#endif /* MSG_CMSG_CLOEXEC */
 
-		String jrequest = String(mbuf, mbuf + count);
+		if (!RecvAll(l_ProcessControlFD, reinterpret_cast<char *>(&request) + rc, sizeof(request) - rc))
+			break;
 
-		delete [] mbuf;
+		payload.resize(request.Length);
 
-		Dictionary::Ptr request = JsonDecode(jrequest);
+		if (!RecvAll(l_ProcessControlFD, payload.data(), payload.size()))
+			break;
 
-		String command = request->Get("command");
+		SpawnHelperResponse response;
+		response.ID = request.ID;
+		response.RC = -1;
+		response.Error = 0;
+		response.Status = 0;
 
-		Value response;
+		switch (request.Command) {
+			case SpawnHelperSpawn:
+				ProcessSpawnImpl(&msg, payload.data(), payload.size(), response);
+				break;
+			case SpawnHelperWaitPID:
+				/* waitpid() may block, don't hold back the replies we already have. */
+				FlushSpawnHelperResponses(responses);
+				ProcessWaitPIDImpl(payload.data(), payload.size(), response);
+				break;
+			case SpawnHelperKill:
+				ProcessKillImpl(payload.data(), payload.size(), response);
+				break;
+			default:
+				response.Error = EINVAL;
+		}
 
-		if (command == "spawn")
-			response = ProcessSpawnImpl(&msg, request);
-		else if (command == "waitpid")
-			response = ProcessWaitPIDImpl(&msg, request);
-		else if (command == "kill")
-			response = ProcessKillImpl(&msg, request);
-		else
-			response = Empty;
+		responses.push_back(response);
 
-		String jresponse = JsonEncode(response);
+		/* Reply to everything the parent has pipelined so far with a single send(). */
+		struct pollfd pfd;
+		pfd.fd = l_ProcessControlFD;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
 
-		if (send(l_ProcessControlFD, jresponse.CStr(), jresponse.GetLength(), 0) < 0) {
-			BOOST_THROW_EXCEPTION(posix_error()
-				<< boost::errinfo_api_function("send")
-				<< boost::errinfo_errno(errno));
-		}
+		if (responses.size() >= 64 || poll(&pfd, 1, 0) <= 0)
+			FlushSpawnHelperResponses(responses);
 	}
 
 	_exit(0);
 }
 
-static void StartSpawnProcessHelper()
+static void StartSpawnProcessHelper(SpawnHelper& helper)
 {
-	if (l_ProcessControlFD != -1) {
-		(void)close(l_ProcessControlFD);
+	if (helper.FD != -1) {
+		(void)close(helper.FD);
 
 		int status;
-		(void)waitpid(l_ProcessControlPID, &status, 0);
+		(void)waitpid(helper.PID, &status, 0);
+
+		helper.FD = -1;
 	}
 
+	helper.ReadBuffer.clear();
+
 	int controlFDs[2];
 	if (socketpair(AF_UNIX, SOCK_STREAM, 0, controlFDs) < 0) {
 		BOOST_THROW_EXCEPTION(posix_error()
@@ -364,138 +588,232 @@ static void StartSpawnProcessHelper()
 
 	(void)close(controlFDs[0]);
 
-	l_ProcessControlFD = controlFDs[1];
-	l_ProcessControlPID = pid;
+	helper.FD = controlFDs[1];
+	helper.PID = pid;
 }
 
-static pid_t ProcessSpawn(const std::vector<String>& arguments, const Dictionary::Ptr& extraEnvironment, bool adjustPriority, int fds[3])
+static bool SendSpawnHelperRequest(int fd, const SpawnHelperRequest& request, const std::string& payload, const int *fds)
 {
-	Dictionary::Ptr request = new Dictionary({
-		{ "command", "spawn" },
-		{ "arguments", Array::FromVector(arguments) },
-		{ "extraEnvironment", extraEnvironment },
-		{ "adjustPriority", adjustPriority }
-	});
-
-	String jrequest = JsonEncode(request);
-	size_t length = jrequest.GetLength();
-
-	std::unique_lock<std::mutex> lock(l_ProcessControlMutex);
-
 	struct msghdr msg;
 	memset(&msg, 0, sizeof(msg));
 
-	struct iovec io;
-	io.iov_base = &length;
-	io.iov_len = sizeof(length);
+	struct iovec io[2];
+	io[0].iov_base = const_cast<SpawnHelperRequest *>(&request);
+	io[0].iov_len = sizeof(request);
+	io[1].iov_base = const_cast<char *>(payload.c_str());
+	io[1].iov_len = payload.size();
 
-	msg.msg_iov = &io;
-	msg.msg_iovlen = 1;
+	msg.msg_iov = io;
+	msg.msg_iovlen = 2;
 
 	char cbuf[CMSG_SPACE(sizeof(int) * 3)];
-	msg.msg_control = cbuf;
-	msg.msg_controllen = sizeof(cbuf);
 
-	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-	cmsg->cmsg_level = SOL_SOCKET;
-	cmsg->cmsg_type = SCM_RIGHTS;
-	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 3);
+	if (fds) {
+		msg.msg_control = cbuf;
+		msg.msg_controllen = sizeof(cbuf);
 
-	memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * 3);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 3);
 
-	msg.msg_controllen = cmsg->cmsg_len;
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * 3);
+
+		msg.msg_controllen = cmsg->cmsg_len;
+	}
+
+	ssize_t rc;
 
 	do {
-		while (sendmsg(l_ProcessControlFD, &msg, 0) < 0) {
-			StartSpawnProcessHelper();
-		}
-	} while (send(l_ProcessControlFD, jrequest.CStr(), jrequest.GetLength(), 0) < 0);
+		rc = sendmsg(fd, &msg, 0);
+	} while (rc < 0 && errno == EINTR);
 
-	char buf[4096];
+	if (rc < 0)
+		return false;
 
-	ssize_t rc = recv(l_ProcessControlFD, buf, sizeof(buf), 0);
+	/* The FDs have been passed along with the first chunk, send the rest as plain data. */
+	size_t length = sizeof(request) + payload.size();
+
+	if (static_cast<size_t>(rc) < length) {
+		std::string rest (reinterpret_cast<const char *>(&request), sizeof(request));
+		rest += payload;
+
+		return SendAll(fd, rest.c_str() + rc, length - rc);
+	}
+
+	return true;
+}
+
+static bool RecvSpawnHelperResponses(int fd, std::vector<char>& buffer, std::vector<SpawnHelperResponse>& responses)
+{
+	char chunk[sizeof(SpawnHelperResponse) * 64];
+	ssize_t rc;
+
+	do {
+		rc = recv(fd, chunk, sizeof(chunk), 0);
+	} while (rc < 0 && (errno == EINTR || errno == EAGAIN));
 
 	if (rc <= 0)
-		return -1;
+		return false;
 
-	String jresponse = String(buf, buf + rc);
+	buffer.insert(buffer.end(), chunk, chunk + rc);
 
-	Dictionary::Ptr response = JsonDecode(jresponse);
+	size_t count = buffer.size() / sizeof(SpawnHelperResponse);
 
-	if (response->Get("rc") == -1)
-		errno = response->Get("errno");
+	for (size_t i = 0; i < count; i++) {
+		SpawnHelperResponse response;
+		memcpy(&response, buffer.data() + i * sizeof(response), sizeof(response));
+		responses.push_back(response);
+	}
 
-	return response->Get("rc");
+	buffer.erase(buffer.begin(), buffer.begin() + count * sizeof(SpawnHelperResponse));
+
+	return true;
 }
 
-static int ProcessKill(pid_t pid, int signum)
+/* Fails all calls in flight, e.g. because the helper died. Must be called with helper.Mutex held. */
+static void FailSpawnHelperCalls(SpawnHelper& helper)
 {
-	Dictionary::Ptr request = new Dictionary({
-		{ "command", "kill" },
-		{ "pid", pid },
-		{ "signum", signum }
-	});
+	for (auto& kv : helper.Calls) {
+		kv.second->Response.ID = kv.first;
+		kv.second->Response.RC = -1;
+		kv.second->Response.Error = EPIPE;
+		kv.second->Response.Status = 0;
+		kv.second->Done = true;
+	}
 
-	String jrequest = JsonEncode(request);
-	size_t length = jrequest.GetLength();
+	helper.Calls.clear();
+}
 
-	std::unique_lock<std::mutex> lock(l_ProcessControlMutex);
+static SpawnHelperResponse CallSpawnHelper(SpawnHelper& helper, SpawnHelperCommand command, const std::string& payload, const int *fds = nullptr)
+{
+	SpawnHelperCall call;
+	SpawnHelperRequest request;
 
-	do {
-		while (send(l_ProcessControlFD, &length, sizeof(length), 0) < 0) {
-			StartSpawnProcessHelper();
+	request.Command = command;
+	request.Length = payload.size();
+
+	std::unique_lock<std::mutex> lock(helper.Mutex);
+
+	request.ID = helper.NextID++;
+
+	while (!SendSpawnHelperRequest(helper.FD, request, payload, fds)) {
+		/* The helper is gone. Replace it as soon as nobody reads from its socket anymore. */
+		helper.CV.wait(lock, [&helper]() { return !helper.Reading; });
+
+		FailSpawnHelperCalls(helper);
+		StartSpawnProcessHelper(helper);
+	}
+
+	helper.Calls.emplace(request.ID, &call);
+
+	std::vector<SpawnHelperResponse> responses;
+
+	while (!call.Done) {
+		if (helper.Reading) {
+			helper.CV.wait(lock);
+			continue;
 		}
-	} while (send(l_ProcessControlFD, jrequest.CStr(), jrequest.GetLength(), 0) < 0);
 
-	char buf[4096];
+		/* Nobody is collecting replies right now, do it on behalf of all pending calls. */
+		helper.Reading = true;
+		int fd = helper.FD;
 
-	ssize_t rc = recv(l_ProcessControlFD, buf, sizeof(buf), 0);
+		lock.unlock();
+		bool ok = RecvSpawnHelperResponses(fd, helper.ReadBuffer, responses);
+		lock.lock();
 
-	if (rc <= 0)
-		return -1;
+		helper.Reading = false;
 
-	String jresponse = String(buf, buf + rc);
+		if (ok) {
+			for (auto& response : responses) {
+				auto it (helper.Calls.find(response.ID));
 
-	Dictionary::Ptr response = JsonDecode(jresponse);
-	return response->Get("errno");
+				if (it != helper.Calls.end()) {
+					it->second->Response = response;
+					it->second->Done = true;
+					helper.Calls.erase(it);
+				}
+			}
+		} else {
+			FailSpawnHelperCalls(helper);
+		}
+
+		responses.clear();
+		helper.CV.notify_all();
+	}
+
+	return call.Response;
 }
 
-static int ProcessWaitPID(pid_t pid, int *status)
+static pid_t ProcessSpawn(const std::vector<String>& arguments, const Dictionary::Ptr& extraEnvironment, bool adjustPriority, int fds[3], size_t& helperIndex)
 {
-	Dictionary::Ptr request = new Dictionary({
-		{ "command", "waitpid" },
-		{ "pid", pid }
-	});
+	std::string payload;
+	uint32_t envc = 0;
 
-	String jrequest = JsonEncode(request);
-	size_t length = jrequest.GetLength();
+	EncodeValue<uint8_t>(payload, adjustPriority);
+	EncodeValue<uint32_t>(payload, arguments.size());
+	EncodeValue<uint32_t>(payload, 0);
 
-	std::unique_lock<std::mutex> lock(l_ProcessControlMutex);
+	for (const String& arg : arguments) {
+		EncodeString(payload, arg);
+	}
 
-	do {
-		while (send(l_ProcessControlFD, &length, sizeof(length), 0) < 0) {
-			StartSpawnProcessHelper();
+	if (extraEnvironment) {
+		ObjectLock olock(extraEnvironment);
+
+		for (const Dictionary::Pair& kv : extraEnvironment) {
+			EncodeString(payload, kv.first + "=" + Convert::ToString(kv.second));
+			envc++;
 		}
-	} while (send(l_ProcessControlFD, jrequest.CStr(), jrequest.GetLength(), 0) < 0);
+	}
 
-	char buf[4096];
+	memcpy(&payload[sizeof(uint8_t) + sizeof(uint32_t)], &envc, sizeof(envc));
 
-	ssize_t rc = recv(l_ProcessControlFD, buf, sizeof(buf), 0);
+	helperIndex = l_NextSpawnHelper.fetch_add(1) % l_SpawnHelpers.size();
 
-	if (rc <= 0)
-		return -1;
+	SpawnHelperResponse response = CallSpawnHelper(*l_SpawnHelpers[helperIndex], SpawnHelperSpawn, payload, fds);
+
+	if (response.RC == -1)
+		errno = response.Error;
+
+	return response.RC;
+}
+
+static int ProcessKill(size_t helperIndex, pid_t pid, int signum)
+{
+	std::string payload;
 
-	String jresponse = String(buf, buf + rc);
+	EncodeValue<int32_t>(payload, pid);
+	EncodeValue<int32_t>(payload, signum);
 
-	Dictionary::Ptr response = JsonDecode(jresponse);
-	*status = response->Get("status");
-	return response->Get("rc");
+	return CallSpawnHelper(*l_SpawnHelpers[helperIndex], SpawnHelperKill, payload).Error;
+}
+
+static int ProcessWaitPID(size_t helperIndex, pid_t pid, int *status)
+{
+	std::string payload;
+
+	EncodeValue<int32_t>(payload, pid);
+
+	SpawnHelperResponse response = CallSpawnHelper(*l_SpawnHelpers[helperIndex], SpawnHelperWaitPID, payload);
+
+	*status = response.Status;
+	return response.RC;
 }
 
 void Process::InitializeSpawnHelper()
 {
-	if (l_ProcessControlFD == -1)
-		StartSpawnProcessHelper();
+	if (!l_SpawnHelpers.empty())
+		return;
+
+	int count = std::max(Configuration::SpawnHelpers, 1);
+
+	for (int i = 0; i < count; i++) {
+		std::unique_ptr<SpawnHelper> helper (new SpawnHelper());
+		StartSpawnProcessHelper(*helper);
+		l_SpawnHelpers.emplace_back(std::move(helper));
+	}
 }
 #endif /* _WIN32 */
 
@@ -528,6 +846,29 @@ static void InitializeProcess()
 		}
 #	endif /* HAVE_PIPE2 */
 	}
+
+#	ifdef __linux__
+	for (int tid = 0; tid < IOTHREADS; tid++) {
+		l_EpollFDs[tid] = epoll_create1(EPOLL_CLOEXEC);
+
+		if (l_EpollFDs[tid] < 0) {
+			BOOST_THROW_EXCEPTION(posix_error()
+				<< boost::errinfo_api_function("epoll_create1")
+				<< boost::errinfo_errno(errno));
+		}
+
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = l_EventFDs[tid][0];
+
+		if (epoll_ctl(l_EpollFDs[tid], EPOLL_CTL_ADD, l_EventFDs[tid][0], &event) < 0) {
+			BOOST_THROW_EXCEPTION(posix_error()
+				<< boost::errinfo_api_function("epoll_ctl")
+				<< boost::errinfo_errno(errno));
+		}
+	}
+#	endif /* __linux__ */
 #endif /* _WIN32 */
 }
 
@@ -595,6 +936,111 @@ bool Process::GetAdjustPriority() const
 	return m_AdjustPriority;
 }
 
+#ifdef __linux__
+/**
+ * Waits for output of the processes assigned to IO thread #tid. The epoll set
+ * is maintained by Run() and the IO thread itself as processes come and go,
+ * and timeouts are kept in a min-heap, so a wakeup only touches processes
+ * which actually have something to do.
+ */
+void Process::IOThreadProc(int tid)
+{
+	Utility::SetThreadName("ProcessIO");
+
+	epoll_event events[256];
+	std::vector<ProcessTimeout> rescheduled;
+
+	auto& processes (l_Processes[tid]);
+	auto& fds (l_FDs[tid]);
+	auto& timeouts (l_ProcessTimeouts[tid]);
+
+	auto remove ([tid, &processes, &fds](decltype(processes.begin()) it) {
+		int fd = it->second->m_FD;
+
+		(void)epoll_ctl(l_EpollFDs[tid], EPOLL_CTL_DEL, fd, nullptr);
+		fds.erase(fd);
+		(void)close(fd);
+		processes.erase(it);
+	});
+
+	for (;;) {
+		int timeout = -1;
+
+		{
+			std::unique_lock<std::mutex> lock(l_ProcessMutex[tid]);
+
+			if (!timeouts.empty()) {
+				double delta = timeouts.top().first - Utility::GetTime();
+
+				timeout = delta > 0 ? static_cast<int>(std::ceil(delta * 1000)) : 0;
+			}
+		}
+
+		int rc = epoll_wait(l_EpollFDs[tid], events, sizeof(events) / sizeof(events[0]), timeout);
+
+		if (rc < 0)
+			continue;
+
+		std::unique_lock<std::mutex> lock(l_ProcessMutex[tid]);
+
+		for (int i = 0; i < rc; i++) {
+			int fd = events[i].data.fd;
+
+			if (fd == l_EventFDs[tid][0]) {
+				char buffer[512];
+				if (read(l_EventFDs[tid][0], buffer, sizeof(buffer)) < 0)
+					Log(LogCritical, "base", "Read from event FD failed.");
+
+				continue;
+			}
+
+			auto it2 = fds.find(fd);
+
+			if (it2 == fds.end())
+				continue; /* Already gone, e.g. after a timeout handled in the same round. */
+
+			auto it = processes.find(it2->second);
+
+			if (it == processes.end())
+				continue; /* This should never happen. */
+
+			if (!it->second->DoEvents())
+				remove(it);
+		}
+
+		double now = Utility::GetTime();
+
+		while (!timeouts.empty() && timeouts.top().first <= now) {
+			ProcessHandle handle = timeouts.top().second;
+			timeouts.pop();
+
+			auto it = processes.find(handle);
+
+			if (it == processes.end())
+				continue; /* The process has finished in the meantime. */
+
+			const Process::Ptr& process = it->second;
+			double deadline = process->m_Result.ExecutionStart + process->GetNextTimeout();
+
+			/* Stale entry, e.g. for a PID which has been reused. */
+			if (deadline >= now) {
+				rescheduled.emplace_back(deadline, handle);
+				continue;
+			}
+
+			if (!process->DoEvents())
+				remove(it);
+			else /* SIGTERM has been sent, SIGKILL follows after the extended timeout. */
+				rescheduled.emplace_back(process->m_Result.ExecutionStart + process->GetNextTimeout(), handle);
+		}
+
+		for (auto& entry : rescheduled)
+			timeouts.push(entry);
+
+		rescheduled.clear();
+	}
+}
+#else /* __linux__ */
 void Process::IOThreadProc(int tid)
 {
 #ifdef _WIN32
@@ -740,6 +1186,7 @@ void Process::IOThreadProc(int tid)
 		}
 	}
 }
+#endif /* __linux__ */
 
 String Process::PrettyPrintArguments(const Process::Arguments& arguments)
 {
@@ -981,12 +1428,13 @@ void Process::Run(const std::function<void(const ProcessResult&)>& callback)
 	fds[1] = outfds[1];
 	fds[2] = outfds[1];
 
-	m_Process = ProcessSpawn(m_Arguments, m_ExtraEnvironment, m_AdjustPriority, fds);
+	m_Process = ProcessSpawn(m_Arguments, m_ExtraEnvironment, m_AdjustPriority, fds, m_SpawnHelper);
 	m_PID = m_Process;
 
 	if (m_PID == -1) {
-		m_OutputStream << "Fork failed with error code " << errno << " (" << Utility::FormatErrorNumber(errno) << ")";
-		Log(LogCritical, "Process", m_OutputStream.str());
+		int error = errno;
+		m_Output = "Fork failed with error code " + Convert::ToString(error) + " (" + Utility::FormatErrorNumber(error) + ")";
+		Log(LogCritical, "Process", m_Output);
 	}
 
 	Log(LogNotice, "Process")
@@ -1009,6 +1457,36 @@ void Process::Run(const std::function<void(const ProcessResult&)>& callback)
 #ifndef _WIN32
 		l_FDs[tid][m_FD] = m_Process;
 #endif /* _WIN32 */
+
+#ifdef __linux__
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLET;
+		event.data.fd = m_FD;
+
+		if (epoll_ctl(l_EpollFDs[tid], EPOLL_CTL_ADD, m_FD, &event) < 0) {
+			l_FDs[tid].erase(m_FD);
+			l_Processes[tid].erase(m_Process);
+
+			BOOST_THROW_EXCEPTION(posix_error()
+				<< boost::errinfo_api_function("epoll_ctl")
+				<< boost::errinfo_errno(errno));
+		}
+
+		if (m_Timeout == 0)
+			return;
+
+		auto& timeouts (l_ProcessTimeouts[tid]);
+		double deadline = m_Result.ExecutionStart + GetNextTimeout();
+
+		/* The IO thread only needs to wake up if its next timeout moved closer. */
+		bool wakeup = timeouts.empty() || deadline < timeouts.top().first;
+
+		timeouts.emplace(deadline, m_Process);
+
+		if (!wakeup)
+			return;
+#endif /* __linux__ */
 	}
 
 #ifdef _WIN32
@@ -1045,9 +1523,9 @@ bool Process::DoEvents()
 					<< "Terminating process " << m_PID << " (" << PrettyPrintArguments(m_Arguments)
 					<< ") after timeout of " << timeout << " seconds";
 
-				m_OutputStream << "<Timeout exceeded.>";
+				m_Output += "<Timeout exceeded.>";
 
-				int error = ProcessKill(m_Process, SIGTERM);
+				int error = ProcessKill(m_SpawnHelper, m_Process, SIGTERM);
 				if (error) {
 					Log(LogWarning, "Process")
 						<< "Couldn't terminate the process " << m_PID << " (" << PrettyPrintArguments(m_Arguments)
@@ -1068,10 +1546,10 @@ bool Process::DoEvents()
 				<< ") after timeout of " << timeout << " seconds";
 
 #ifdef _WIN32
-			m_OutputStream << "<Timeout exceeded.>";
+			m_Output += "<Timeout exceeded.>";
 			TerminateProcess(m_Process, 3);
 #else /* _WIN32 */
-			int error = ProcessKill(-m_Process, SIGKILL);
+			int error = ProcessKill(m_SpawnHelper, -m_Process, SIGKILL);
 			if (error) {
 				Log(LogWarning, "Process")
 					<< "Couldn't kill the process group " << m_PID << " (" << PrettyPrintArguments(m_Arguments)
@@ -1090,19 +1568,19 @@ bool Process::DoEvents()
 
 		DWORD rc;
 		if (!m_ReadFailed && GetOverlappedResult(m_FD, &m_Overlapped, &rc, TRUE) && rc > 0) {
-			m_OutputStream.write(m_ReadBuffer, rc);
+			m_Output.GetData().append(m_ReadBuffer, rc);
 			return true;
 		}
 #else /* _WIN32 */
-		char buffer[512];
+		char *buffer = l_ReadBuffers[GetTID()];
 		for (;;) {
-			int rc = read(m_FD, buffer, sizeof(buffer));
+			int rc = read(m_FD, buffer, sizeof(l_ReadBuffers[0]));
 
 			if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
 				return true;
 
 			if (rc > 0) {
-				m_OutputStream.write(buffer, rc);
+				m_Output.GetData().append(buffer, rc);
 				continue;
 			}
 
@@ -1111,7 +1589,7 @@ bool Process::DoEvents()
 #endif /* _WIN32 */
 	}
 
-	String output = m_OutputStream.str();
+	String output = std::move(m_Output);
 
 #ifdef _WIN32
 	WaitForSingleObject(m_Process, INFINITE);
@@ -1125,7 +1603,7 @@ bool Process::DoEvents()
 	int status, exitcode;
 	if (could_not_kill || m_PID == -1) {
 		exitcode = 128;
-	} else if (ProcessWaitPID(m_Process, &status) != m_Process) {
+	} else if (ProcessWaitPID(m_SpawnHelper, m_Process, &status) != m_Process) {
 		exitcode = 128;
 
 		Log(LogWarning, "Process")
@@ -1170,7 +1648,7 @@ bool Process::DoEvents()
 		m_Result.PID = m_PID;
 		m_Result.ExecutionEnd = Utility::GetTime();
 		m_Result.ExitStatus = exitcode;
-		m_Result.Output = output;
+		m_Result.Output = std::move(output);
 		m_ResultAvailable = true;
 	}
 	m_ResultCondition.notify_all();
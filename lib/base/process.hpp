@@ -84,6 +84,7 @@ private:
 	double m_Timeout;
 #ifndef _WIN32
 	bool m_SentSigterm;
+	size_t m_SpawnHelper;
 #endif /* _WIN32 */
 
 	bool m_AdjustPriority;
@@ -99,7 +100,7 @@ private:
 	char m_ReadBuffer[1024];
 #endif /* _WIN32 */
 
-	std::ostringstream m_OutputStream;
+	String m_Output;
 	std::function<void (const ProcessResult&)> m_Callback;
 	ProcessResult m_Result;
 	bool m_ResultAvailable;
@@ -3,18 +3,13 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
-#include "base/atomic.hpp"
 #include "base/exception.hpp"
 #include "base/logger.hpp"
+#include "base/workstealingpool.hpp"
 #include <cstddef>
 #include <exception>
 #include <functional>
-#include <memory>
 #include <thread>
-#include <boost/asio/post.hpp>
-#include <boost/asio/thread_pool.hpp>
-#include <boost/thread/locks.hpp>
-#include <boost/thread/shared_mutex.hpp>
 #include <cstdint>
 
 namespace icinga
@@ -27,7 +22,7 @@ enum SchedulerPolicy
 };
 
 /**
- * A thread pool.
+ * A thread pool, backed by a WorkStealingPool.
  *
  * @ingroup base
  */
@@ -43,7 +38,8 @@ public:
 	void Stop();
 
 	/**
-	 * Appends a work item to the work queue. Work items will be processed in FIFO order.
+	 * Appends a work item to the work queue. Work items are distributed round-robin across the
+	 * worker threads which process their own items in FIFO order and steal from each other when idle.
 	 *
 	 * @param callback The callback function for the work item.
 	 * @returns true if the item was queued, false otherwise.
@@ -51,29 +47,17 @@ public:
 	template<class T>
 	bool Post(T callback, SchedulerPolicy)
 	{
-		boost::shared_lock<decltype(m_Mutex)> lock (m_Mutex);
-
-		if (m_Pool) {
-			m_Pending.fetch_add(1);
-
-			boost::asio::post(*m_Pool, [this, callback]() {
-				m_Pending.fetch_sub(1);
-
-				try {
-					callback();
-				} catch (const std::exception& ex) {
-					Log(LogCritical, "ThreadPool")
-						<< "Exception thrown in event handler:\n"
-						<< DiagnosticInformation(ex);
-				} catch (...) {
-					Log(LogCritical, "ThreadPool", "Exception of unknown type thrown in event handler.");
-				}
-			});
-
-			return true;
-		} else {
-			return false;
-		}
+		return m_Pool.Post([callback]() {
+			try {
+				callback();
+			} catch (const std::exception& ex) {
+				Log(LogCritical, "ThreadPool")
+					<< "Exception thrown in event handler:\n"
+					<< DiagnosticInformation(ex);
+			} catch (...) {
+				Log(LogCritical, "ThreadPool", "Exception of unknown type thrown in event handler.");
+			}
+		});
 	}
 
 	/**
@@ -83,14 +67,21 @@ public:
 	 */
 	inline uint_fast64_t GetPending()
 	{
-		return m_Pending.load();
+		return m_Pool.GetLength();
+	}
+
+	/**
+	 * Returns how many tasks have been taken from another worker's queue.
+	 *
+	 * @returns amount of stolen tasks.
+	 */
+	inline uint_fast64_t GetSteals()
+	{
+		return m_Pool.GetSteals();
 	}
 
 private:
-	boost::shared_mutex m_Mutex;
-	std::unique_ptr<boost::asio::thread_pool> m_Pool;
-	size_t m_Threads;
-	Atomic<uint_fast64_t> m_Pending;
+	WorkStealingPool m_Pool;
 };
 
 }
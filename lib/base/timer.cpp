@@ -9,9 +9,15 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/key_extractors.hpp>
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <vector>
+
+#ifdef ICINGA2_TIMER_WHEEL
+#	include "base/timerwheel.hpp"
+#endif /* ICINGA2_TIMER_WHEEL */
 
 using namespace icinga;
 
@@ -56,7 +62,11 @@ static std::mutex l_TimerMutex;
 static std::condition_variable l_TimerCV;
 static std::thread l_TimerThread;
 static bool l_StopTimerThread;
+#ifdef ICINGA2_TIMER_WHEEL
+static TimerWheel l_Timers;
+#else /* ICINGA2_TIMER_WHEEL */
 static TimerSet l_Timers;
+#endif /* ICINGA2_TIMER_WHEEL */
 static int l_AliveTimers = 0;
 
 static Defer l_ShutdownTimersCleanlyOnExit (&Timer::Uninitialize);
@@ -178,7 +188,11 @@ void Timer::Stop(bool wait)
 	}
 
 	m_Started = false;
+#ifdef ICINGA2_TIMER_WHEEL
+	l_Timers.Remove(this);
+#else /* ICINGA2_TIMER_WHEEL */
 	l_Timers.erase(this);
+#endif /* ICINGA2_TIMER_WHEEL */
 
 	/* Notify the worker thread that we've disabled a timer. */
 	l_TimerCV.notify_all();
@@ -218,8 +232,13 @@ void Timer::InternalReschedule(bool completed, double next)
 
 	if (m_Started && !m_Running) {
 		/* Remove and re-add the timer to update the index. */
+#ifdef ICINGA2_TIMER_WHEEL
+		l_Timers.Remove(this);
+		l_Timers.Insert(this);
+#else /* ICINGA2_TIMER_WHEEL */
 		l_Timers.erase(this);
 		l_Timers.insert(this);
+#endif /* ICINGA2_TIMER_WHEEL */
 
 		/* Notify the worker that we've rescheduled a timer. */
 		l_TimerCV.notify_all();
@@ -249,6 +268,19 @@ void Timer::AdjustTimers(double adjustment)
 
 	double now = Utility::GetTime();
 
+#ifdef ICINGA2_TIMER_WHEEL
+	std::vector<Timer *> timers;
+	l_Timers.GetTimers(timers);
+
+	for (Timer *timer : timers) {
+		if (std::fabs(now - (timer->m_Next + adjustment)) <
+			std::fabs(now - timer->m_Next)) {
+			timer->m_Next += adjustment;
+		}
+	}
+
+	l_Timers.Rebase(now);
+#else /* ICINGA2_TIMER_WHEEL */
 	typedef boost::multi_index::nth_index<TimerSet, 1>::type TimerView;
 	TimerView& idx = boost::get<1>(l_Timers);
 
@@ -266,6 +298,7 @@ void Timer::AdjustTimers(double adjustment)
 		l_Timers.erase(timer);
 		l_Timers.insert(timer);
 	}
+#endif /* ICINGA2_TIMER_WHEEL */
 
 	/* Notify the worker that we've rescheduled some timers. */
 	l_TimerCV.notify_all();
@@ -282,9 +315,34 @@ void Timer::TimerThreadProc()
 
 	Utility::SetThreadName("Timer Thread");
 
+	std::vector<Timer *> expired;
+
 	for (;;) {
 		std::unique_lock<std::mutex> lock(l_TimerMutex);
 
+#ifdef ICINGA2_TIMER_WHEEL
+		double nextExpiry;
+
+		/* Wait until there is at least one timer. */
+		while ((nextExpiry = l_Timers.GetNextExpiry()) < 0 && !l_StopTimerThread)
+			l_TimerCV.wait(lock);
+
+		if (l_StopTimerThread)
+			break;
+
+		ch::time_point<ch::system_clock, ch::duration<double>> next (ch::duration<double>{nextExpiry});
+
+		if (next - ch::system_clock::now() > ch::duration<double>(0.01)) {
+			/* Wait for the next timer. */
+			l_TimerCV.wait_until(lock, next);
+
+			continue;
+		}
+
+		/* Remove all expired timers from the wheel so they don't get called
+		 * again until the current call is completed. */
+		l_Timers.Advance(Utility::GetTime() + 0.01, expired);
+#else /* ICINGA2_TIMER_WHEEL */
 		typedef boost::multi_index::nth_index<TimerSet, 1>::type NextTimerView;
 		NextTimerView& idx = boost::get<1>(l_Timers);
 
@@ -311,11 +369,18 @@ void Timer::TimerThreadProc()
 		 * until the current call is completed. */
 		l_Timers.erase(timer);
 
-		timer->m_Running = true;
+		expired.push_back(timer);
+#endif /* ICINGA2_TIMER_WHEEL */
+
+		for (Timer *timer : expired)
+			timer->m_Running = true;
 
 		lock.unlock();
 
-		/* Asynchronously call the timer. */
-		Utility::QueueAsyncCallback([timer]() { timer->Call(); });
+		/* Asynchronously call the timers. */
+		for (Timer *timer : expired)
+			Utility::QueueAsyncCallback([timer]() { timer->Call(); });
+
+		expired.clear();
 	}
 }
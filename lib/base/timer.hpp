@@ -7,9 +7,14 @@
 #include "base/object.hpp"
 #include <boost/signals2.hpp>
 
+#ifdef ICINGA2_TIMER_WHEEL
+#	include <boost/intrusive/list_hook.hpp>
+#endif /* ICINGA2_TIMER_WHEEL */
+
 namespace icinga {
 
 class TimerHolder;
+class TimerWheel;
 
 /**
  * A timer that periodically triggers an event.
@@ -47,12 +52,19 @@ private:
 	bool m_Started{false}; /**< Whether the timer is enabled. */
 	bool m_Running{false}; /**< Whether the timer proc is currently running. */
 
+#ifdef ICINGA2_TIMER_WHEEL
+	typedef boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>> WheelHook;
+
+	WheelHook m_WheelHook; /**< Links the timer into its TimerWheel slot. */
+#endif /* ICINGA2_TIMER_WHEEL */
+
 	void Call();
 	void InternalReschedule(bool completed, double next = -1);
 
 	static void TimerThreadProc();
 
 	friend class TimerHolder;
+	friend class TimerWheel;
 };
 
 }
@@ -0,0 +1,213 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/timerwheel.hpp"
+#include "base/utility.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace icinga;
+
+TimerWheel::TimerWheel()
+	: m_CurrentTick(ToTick(Utility::GetTime()))
+{ }
+
+uint64_t TimerWheel::ToTick(double timestamp)
+{
+	if (timestamp <= 0)
+		return 0;
+
+	return static_cast<uint64_t>(std::floor(timestamp / Resolution));
+}
+
+/**
+ * Adds a timer to the wheel, based on its next scheduled timestamp.
+ *
+ * @param timer The timer. It must not be part of the wheel yet.
+ */
+void TimerWheel::Insert(Timer *timer)
+{
+	Place(timer);
+}
+
+/**
+ * Removes a timer from the wheel. Does nothing if the timer isn't part of the wheel.
+ *
+ * @param timer The timer.
+ */
+void TimerWheel::Remove(Timer *timer)
+{
+	if (timer->m_WheelHook.is_linked())
+		timer->m_WheelHook.unlink();
+}
+
+void TimerWheel::Place(Timer *timer)
+{
+	uint64_t tick = ToTick(timer->m_Next);
+
+	if (tick <= m_CurrentTick) {
+		m_Due.push_back(*timer);
+		return;
+	}
+
+	uint64_t delta = tick - m_CurrentTick;
+
+	for (int level = 0; level < Levels; level++) {
+		if (delta < (uint64_t(1) << (LevelBits * (level + 1)))) {
+			m_Slots[level][(tick >> (LevelBits * level)) & SlotMask].push_back(*timer);
+			return;
+		}
+	}
+
+	m_Overflow.push_back(*timer);
+}
+
+/**
+ * Determines the next tick at which either a timer expires or a higher level
+ * slot has to be cascaded into the lower levels.
+ *
+ * @returns The tick or the maximum uint64_t value if the wheel is empty.
+ */
+uint64_t TimerWheel::GetNextEventTick() const
+{
+	if (!m_Due.empty())
+		return m_CurrentTick;
+
+	uint64_t next = std::numeric_limits<uint64_t>::max();
+
+	for (int level = 0; level < Levels; level++) {
+		int shift = LevelBits * level;
+		uint64_t group = m_CurrentTick >> shift;
+
+		for (uint64_t i = 1; i <= Slots; i++) {
+			if (!m_Slots[level][(group + i) & SlotMask].empty()) {
+				next = std::min(next, (group + i) << shift);
+				break;
+			}
+		}
+	}
+
+	if (!m_Overflow.empty()) {
+		int shift = LevelBits * Levels;
+		next = std::min(next, ((m_CurrentTick >> shift) + 1) << shift);
+	}
+
+	return next;
+}
+
+/**
+ * Retrieves the earliest timestamp at which Advance() might return timers.
+ *
+ * @returns The timestamp or -1 if the wheel is empty.
+ */
+double TimerWheel::GetNextExpiry() const
+{
+	uint64_t next = GetNextEventTick();
+
+	if (next == std::numeric_limits<uint64_t>::max())
+		return -1;
+
+	return next * Resolution;
+}
+
+void TimerWheel::Cascade(Slot& slot)
+{
+	Slot timers;
+	timers.swap(slot);
+
+	while (!timers.empty()) {
+		Timer& timer = timers.front();
+		timers.pop_front();
+		Place(&timer);
+	}
+}
+
+void TimerWheel::Expire(Slot& slot, std::vector<Timer *>& expired)
+{
+	while (!slot.empty()) {
+		expired.push_back(&slot.front());
+		slot.pop_front();
+	}
+}
+
+/**
+ * Moves the wheel forward and collects (and removes) all timers which expire
+ * until the specified deadline. Ticks in which nothing happens are skipped.
+ *
+ * @param deadline The timestamp up to which timers should be expired.
+ * @param expired Receives the expired timers.
+ */
+void TimerWheel::Advance(double deadline, std::vector<Timer *>& expired)
+{
+	uint64_t target = ToTick(deadline);
+
+	Expire(m_Due, expired);
+
+	while (m_CurrentTick < target) {
+		uint64_t next = GetNextEventTick();
+
+		if (next > target) {
+			m_CurrentTick = target;
+			break;
+		}
+
+		/* Timers which are cascaded into the new tick itself end up in m_Due. */
+		m_CurrentTick = next;
+
+		for (int level = 1; level <= Levels; level++) {
+			int shift = LevelBits * level;
+
+			if ((next & ((uint64_t(1) << shift) - 1)) != 0)
+				break;
+
+			if (level < Levels)
+				Cascade(m_Slots[level][(next >> shift) & SlotMask]);
+			else
+				Cascade(m_Overflow);
+		}
+
+		Expire(m_Slots[0][next & SlotMask], expired);
+		Expire(m_Due, expired);
+	}
+}
+
+/**
+ * Moves the wheel to the specified timestamp and re-hashes all timers, e.g.
+ * after their timestamps have been changed or the clock jumped backwards.
+ *
+ * @param now The current timestamp.
+ */
+void TimerWheel::Rebase(double now)
+{
+	std::vector<Timer *> timers;
+	GetTimers(timers);
+
+	for (Timer *timer : timers)
+		Remove(timer);
+
+	m_CurrentTick = ToTick(now);
+
+	for (Timer *timer : timers)
+		Place(timer);
+}
+
+/**
+ * Retrieves all timers which are currently part of the wheel.
+ *
+ * @param timers Receives the timers.
+ */
+void TimerWheel::GetTimers(std::vector<Timer *>& timers) const
+{
+	for (auto& level : m_Slots) {
+		for (auto& slot : level) {
+			for (auto& timer : slot)
+				timers.push_back(const_cast<Timer *>(&timer));
+		}
+	}
+
+	for (auto& timer : m_Overflow)
+		timers.push_back(const_cast<Timer *>(&timer));
+
+	for (auto& timer : m_Due)
+		timers.push_back(const_cast<Timer *>(&timer));
+}
@@ -0,0 +1,73 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "base/i2-base.hpp"
+#include "base/timer.hpp"
+#include <boost/intrusive/list.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * A hierarchical timing wheel which keeps track of started timers.
+ *
+ * Timers are hashed into slots by the tick (of Resolution seconds) in which they
+ * expire. Each of the Levels wheels covers Slots times the range of the previous one;
+ * timers in the higher levels are cascaded down once their slot comes into range.
+ * Inserting and removing a timer are O(1) operations.
+ *
+ * This class is not thread-safe, the caller is responsible for locking.
+ *
+ * @ingroup base
+ */
+class TimerWheel
+{
+public:
+	static constexpr double Resolution = 0.01;
+
+	TimerWheel();
+
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	void Insert(Timer *timer);
+	void Remove(Timer *timer);
+
+	double GetNextExpiry() const;
+	void Advance(double deadline, std::vector<Timer *>& expired);
+	void Rebase(double now);
+
+	void GetTimers(std::vector<Timer *>& timers) const;
+
+private:
+	static constexpr int LevelBits = 8;
+	static constexpr int Levels = 4;
+	static constexpr uint64_t Slots = 1u << LevelBits;
+	static constexpr uint64_t SlotMask = Slots - 1;
+
+	typedef boost::intrusive::list<
+		Timer,
+		boost::intrusive::member_hook<Timer, Timer::WheelHook, &Timer::m_WheelHook>,
+		boost::intrusive::constant_time_size<false>
+	> Slot;
+
+	Slot m_Slots[Levels][Slots];
+	Slot m_Overflow; /**< Timers which are beyond the range of the highest level. */
+	Slot m_Due; /**< Timers which were already due when they were inserted. */
+	uint64_t m_CurrentTick; /**< The last tick which has been processed. */
+
+	static uint64_t ToTick(double timestamp);
+
+	uint64_t GetNextEventTick() const;
+	void Place(Timer *timer);
+	void Cascade(Slot& slot);
+	void Expire(Slot& slot, std::vector<Timer *>& expired);
+};
+
+}
+
+#endif /* TIMERWHEEL_H */
@@ -8,6 +8,7 @@
 #include "base/utility.hpp"
 #include "base/application.hpp"
 #include "base/exception.hpp"
+#include "base/object-packer.hpp"
 #include <boost/asio/ssl/context.hpp>
 #include <openssl/opensslv.h>
 #include <openssl/crypto.h>
@@ -847,6 +848,47 @@ String SHA1(const String& s, bool binary)
 	return BinaryToHex(digest, SHA_DIGEST_LENGTH);
 }
 
+/**
+ * Same as SHA1(PackObject(value)), but without building the packed string.
+ */
+String SHA1PackObject(const Value& value)
+{
+	char errbuf[256];
+	SHA_CTX context;
+	unsigned char digest[SHA_DIGEST_LENGTH];
+
+	if (!SHA1_Init(&context)) {
+		ERR_error_string_n(ERR_peek_error(), errbuf, sizeof errbuf);
+		Log(LogCritical, "SSL")
+			<< "Error on SHA Init: " << ERR_peek_error() << ", \"" << errbuf << "\"";
+		BOOST_THROW_EXCEPTION(openssl_error()
+			<< boost::errinfo_api_function("SHA1_Init")
+			<< errinfo_openssl_error(ERR_peek_error()));
+	}
+
+	PackObject(value, [&context, &errbuf](const char* data, size_t length) {
+		if (!SHA1_Update(&context, data, length)) {
+			ERR_error_string_n(ERR_peek_error(), errbuf, sizeof errbuf);
+			Log(LogCritical, "SSL")
+				<< "Error on SHA Update: " << ERR_peek_error() << ", \"" << errbuf << "\"";
+			BOOST_THROW_EXCEPTION(openssl_error()
+				<< boost::errinfo_api_function("SHA1_Update")
+				<< errinfo_openssl_error(ERR_peek_error()));
+		}
+	});
+
+	if (!SHA1_Final(digest, &context)) {
+		ERR_error_string_n(ERR_peek_error(), errbuf, sizeof errbuf);
+		Log(LogCritical, "SSL")
+			<< "Error on SHA Final: " << ERR_peek_error() << ", \"" << errbuf << "\"";
+		BOOST_THROW_EXCEPTION(openssl_error()
+			<< boost::errinfo_api_function("SHA1_Final")
+			<< errinfo_openssl_error(ERR_peek_error()));
+	}
+
+	return BinaryToHex(digest, SHA_DIGEST_LENGTH);
+}
+
 String SHA256(const String& s)
 {
 	char errbuf[256];
@@ -6,17 +6,16 @@
 #include "base/convert.hpp"
 #include "base/application.hpp"
 #include "base/exception.hpp"
-#include <boost/thread/tss.hpp>
+#include <functional>
 #include <math.h>
 
 using namespace icinga;
 
 std::atomic<int> WorkQueue::m_NextID(1);
-boost::thread_specific_ptr<WorkQueue *> l_ThreadWorkQueue;
 
 WorkQueue::WorkQueue(size_t maxItems, int threadCount, LogSeverity statsLogLevel)
-	: m_ID(m_NextID++), m_ThreadCount(threadCount), m_MaxItems(maxItems),
-	m_TaskStats(15 * 60), m_StatsLogLevel(statsLogLevel)
+	: m_ID(m_NextID++), m_ThreadCount(threadCount), m_Pool(threadCount, [this](size_t) { WorkerThreadInit(); }),
+	m_MaxItems(maxItems), m_TaskStats(15 * 60), m_StatsLogLevel(statsLogLevel)
 {
 	/* Initialize logger. */
 	m_StatusTimerTimeout = Utility::GetTime();
@@ -55,27 +54,22 @@ std::unique_lock<std::mutex> WorkQueue::AcquireLock()
  */
 void WorkQueue::EnqueueUnlocked(std::unique_lock<std::mutex>& lock, std::function<void ()>&& function, WorkQueuePriority priority)
 {
-	if (!m_Spawned) {
+	if (!m_Spawned.load()) {
 		Log(LogNotice, "WorkQueue")
 			<< "Spawning WorkQueue threads for '" << m_Name << "'";
 
-		for (int i = 0; i < m_ThreadCount; i++) {
-			m_Threads.create_thread([this]() { WorkerThreadProc(); });
-		}
-
-		m_Spawned = true;
+		m_Pool.Start();
+		m_Spawned.store(true);
 	}
 
 	bool wq_thread = IsWorkerThread();
 
 	if (!wq_thread) {
-		while (m_Tasks.size() >= m_MaxItems && m_MaxItems != 0)
+		while (m_Pending.load() >= m_MaxItems && m_MaxItems != 0)
 			m_CVFull.wait(lock);
 	}
 
-	m_Tasks.emplace(std::move(function), priority, ++m_NextTaskID);
-
-	m_CVEmpty.notify_one();
+	Post(std::move(function), priority);
 }
 
 /**
@@ -95,8 +89,31 @@ void WorkQueue::Enqueue(std::function<void ()>&& function, WorkQueuePriority pri
 		return;
 	}
 
-	auto lock = AcquireLock();
-	EnqueueUnlocked(lock, std::move(function), priority);
+	/* Only take the lock if the threads have to be spawned or we might have to wait for free slots. */
+	if (!m_Spawned.load() || (!wq_thread && m_MaxItems != 0 && m_Pending.load() >= m_MaxItems)) {
+		auto lock = AcquireLock();
+		EnqueueUnlocked(lock, std::move(function), priority);
+		return;
+	}
+
+	Post(std::move(function), priority);
+}
+
+void WorkQueue::Post(TaskFunction&& function, WorkQueuePriority priority)
+{
+	m_Pending.fetch_add(1);
+	m_Outstanding.fetch_add(1);
+
+	/* PriorityImmediate is 4, the pool's priorities are consecutive. */
+	size_t index = priority == PriorityImmediate ? WorkStealingPool::Priorities - 1 : static_cast<size_t>(priority);
+
+	WorkStealingPool::Callback callback = std::bind(&WorkQueue::RunTask, this, std::move(function));
+
+	/* The pool only rejects tasks while Join() is stopping it, which runs them afterwards. */
+	if (!m_Pool.Post(std::move(callback), index)) {
+		std::unique_lock<std::mutex> lock(m_DeferredMutex);
+		m_Deferred.emplace_back(std::move(callback));
+	}
 }
 
 /**
@@ -109,20 +126,41 @@ void WorkQueue::Join(bool stop)
 {
 	std::unique_lock<std::mutex> lock(m_Mutex);
 
-	while (m_Processing || !m_Tasks.empty())
-		m_CVStarved.wait(lock);
+	for (;;) {
+		while (m_Outstanding.load() > 0)
+			m_CVStarved.wait(lock);
+
+		if (!stop)
+			return;
 
-	if (stop) {
-		m_Stopped = true;
-		m_CVEmpty.notify_all();
 		lock.unlock();
 
-		m_Threads.join_all();
-		m_Spawned = false;
+		/* Tasks enqueued by running tasks are still run while the pool is stopping. */
+		m_Pool.Stop();
 
-		Log(LogNotice, "WorkQueue")
-			<< "Stopped WorkQueue threads for '" << m_Name << "'";
+		std::vector<WorkStealingPool::Callback> deferred;
+
+		{
+			std::unique_lock<std::mutex> deferredLock(m_DeferredMutex);
+			deferred.swap(m_Deferred);
+		}
+
+		lock.lock();
+
+		if (deferred.empty())
+			break;
+
+		/* Others were enqueued while the pool was stopping, keep draining until nothing is left. */
+		m_Pool.Start();
+
+		for (auto& callback : deferred)
+			m_Pool.Post(std::move(callback), WorkStealingPool::Priorities - 1);
 	}
+
+	m_Spawned.store(false);
+
+	Log(LogNotice, "WorkQueue")
+		<< "Stopped WorkQueue threads for '" << m_Name << "'";
 }
 
 /**
@@ -133,12 +171,7 @@ void WorkQueue::Join(bool stop)
  */
 bool WorkQueue::IsWorkerThread() const
 {
-	WorkQueue **pwq = l_ThreadWorkQueue.get();
-
-	if (!pwq)
-		return false;
-
-	return *pwq == this;
+	return m_Pool.IsWorkerThread();
 }
 
 void WorkQueue::SetExceptionCallback(const ExceptionCallback& callback)
@@ -184,9 +217,7 @@ void WorkQueue::ReportExceptions(const String& facility, bool verbose) const
 
 size_t WorkQueue::GetLength() const
 {
-	std::unique_lock<std::mutex> lock(m_Mutex);
-
-	return m_Tasks.size();
+	return m_Pending.load();
 }
 
 void WorkQueue::StatusTimerHandler()
@@ -195,7 +226,7 @@ void WorkQueue::StatusTimerHandler()
 
 	ASSERT(!m_Name.IsEmpty());
 
-	size_t pending = m_Tasks.size();
+	size_t pending = m_Pending.load();
 
 	double now = Utility::GetTime();
 	double gradient = (pending - m_PendingTasks) / (now - m_PendingTasksTimestamp);
@@ -214,11 +245,32 @@ void WorkQueue::StatusTimerHandler()
 	m_PendingTasks = pending;
 	m_PendingTasksTimestamp = now;
 
+	uint_fast64_t steals = m_Pool.GetSteals();
+	std::ostringstream workerInfo;
+
+	if (m_ThreadCount > 1) {
+		workerInfo << " (queues: ";
+
+		bool first = true;
+
+		for (size_t depth : m_Pool.GetQueueDepths()) {
+			if (!first)
+				workerInfo << "/";
+
+			workerInfo << depth;
+			first = false;
+		}
+
+		workerInfo << ", steals: " << steals - m_Steals << ")";
+	}
+
+	m_Steals = steals;
+
 	/* Log if there are pending items, or 5 minute timeout is reached. */
 	if (pending > 0 || m_StatusTimerTimeout < now) {
 		Log(m_StatsLogLevel, "WorkQueue")
 			<< "#" << m_ID << " (" << m_Name << ") "
-			<< "items: " << pending << ", "
+			<< "items: " << pending << workerInfo.str() << ", "
 			<< "rate: " << std::setw(2) << GetTaskCount(60) / 60.0 << "/s "
 			<< "(" << GetTaskCount(60) << "/min " << GetTaskCount(60 * 5) << "/5min " << GetTaskCount(60 * 15) << "/15min);"
 			<< timeInfo;
@@ -249,46 +301,32 @@ void WorkQueue::RunTaskFunction(const TaskFunction& func)
 	}
 }
 
-void WorkQueue::WorkerThreadProc()
+void WorkQueue::WorkerThreadInit()
 {
 	std::ostringstream idbuf;
 	idbuf << "WQ #" << m_ID;
 	Utility::SetThreadName(idbuf.str());
+}
 
-	l_ThreadWorkQueue.reset(new WorkQueue *(this));
-
-	std::unique_lock<std::mutex> lock(m_Mutex);
-
-	for (;;) {
-		while (m_Tasks.empty() && !m_Stopped)
-			m_CVEmpty.wait(lock);
-
-		if (m_Stopped)
-			break;
-
-		if (m_Tasks.size() >= m_MaxItems && m_MaxItems != 0)
-			m_CVFull.notify_all();
-
-		Task task = m_Tasks.top();
-		m_Tasks.pop();
-
-		m_Processing++;
-
-		lock.unlock();
-
-		RunTaskFunction(task.Function);
+void WorkQueue::RunTask(TaskFunction& function)
+{
+	size_t pending = m_Pending.fetch_sub(1);
 
-		/* clear the task so whatever other resources it holds are released _before_ we re-acquire the mutex */
-		task = Task();
+	if (m_MaxItems != 0 && pending >= m_MaxItems) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CVFull.notify_all();
+	}
 
-		IncreaseTaskCount();
+	RunTaskFunction(function);
 
-		lock.lock();
+	/* clear the task so whatever other resources it holds are released _before_ Join() returns */
+	function = nullptr;
 
-		m_Processing--;
+	IncreaseTaskCount();
 
-		if (m_Tasks.empty())
-			m_CVStarved.notify_all();
+	if (m_Outstanding.fetch_sub(1) == 1) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CVStarved.notify_all();
 	}
 }
 
@@ -301,18 +339,3 @@ size_t WorkQueue::GetTaskCount(RingBuffer::SizeType span)
 {
 	return m_TaskStats.UpdateAndGetValues(Utility::GetTime(), span);
 }
-
-bool icinga::operator<(const Task& a, const Task& b)
-{
-	if (a.Priority < b.Priority)
-		return true;
-
-	if (a.Priority == b.Priority) {
-		if (a.ID > b.ID)
-			return true;
-		else
-			return false;
-	}
-
-	return false;
-}
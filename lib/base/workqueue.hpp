@@ -7,12 +7,10 @@
 #include "base/timer.hpp"
 #include "base/ringbuffer.hpp"
 #include "base/logger.hpp"
-#include <boost/thread/thread.hpp>
+#include "base/workstealingpool.hpp"
 #include <boost/exception_ptr.hpp>
 #include <condition_variable>
 #include <mutex>
-#include <queue>
-#include <deque>
 #include <atomic>
 
 namespace icinga
@@ -28,23 +26,8 @@ enum WorkQueuePriority
 
 using TaskFunction = std::function<void ()>;
 
-struct Task
-{
-	Task() = default;
-
-	Task(TaskFunction function, WorkQueuePriority priority, int id)
-		: Function(std::move(function)), Priority(priority), ID(id)
-	{ }
-
-	TaskFunction Function;
-	WorkQueuePriority Priority{PriorityNormal};
-	int ID{-1};
-};
-
-bool operator<(const Task& a, const Task& b);
-
 /**
- * A workqueue.
+ * A workqueue. Tasks are executed by a WorkStealingPool.
  *
  * @ingroup base
  */
@@ -121,18 +104,15 @@ private:
 	String m_Name;
 	static std::atomic<int> m_NextID;
 	int m_ThreadCount;
-	bool m_Spawned{false};
+	std::atomic<bool> m_Spawned{false};
 
 	mutable std::mutex m_Mutex;
-	std::condition_variable m_CVEmpty;
 	std::condition_variable m_CVFull;
 	std::condition_variable m_CVStarved;
-	boost::thread_group m_Threads;
+	WorkStealingPool m_Pool;
 	size_t m_MaxItems;
-	bool m_Stopped{false};
-	int m_Processing{0};
-	std::priority_queue<Task, std::deque<Task> > m_Tasks;
-	int m_NextTaskID{0};
+	std::atomic<size_t> m_Pending{0}; /**< Tasks which have been enqueued but not started yet. */
+	std::atomic<size_t> m_Outstanding{0}; /**< Tasks which have been enqueued but not completed yet. */
 	ExceptionCallback m_ExceptionCallback;
 	std::vector<boost::exception_ptr> m_Exceptions;
 	Timer::Ptr m_StatusTimer;
@@ -142,8 +122,15 @@ private:
 	RingBuffer m_TaskStats;
 	size_t m_PendingTasks{0};
 	double m_PendingTasksTimestamp{0};
+	uint_fast64_t m_Steals{0};
+
+	std::mutex m_DeferredMutex;
+	std::vector<WorkStealingPool::Callback> m_Deferred; /**< Tasks which were enqueued while the pool was stopping. */
+
+	void Post(TaskFunction&& function, WorkQueuePriority priority);
 
-	void WorkerThreadProc();
+	void WorkerThreadInit();
+	void RunTask(TaskFunction& function);
 	void StatusTimerHandler();
 
 	void RunTaskFunction(const TaskFunction& func);
@@ -0,0 +1,237 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/workstealingpool.hpp"
+#include <algorithm>
+
+using namespace icinga;
+
+constexpr size_t WorkStealingPool::Priorities;
+
+static thread_local const WorkStealingPool *l_CurrentPool = nullptr;
+static thread_local size_t l_CurrentWorker = 0;
+
+WorkStealingPool::WorkStealingPool(size_t threads, ThreadInitializer threadInit)
+	: m_ThreadCount(std::max<size_t>(threads, 1)), m_ThreadInit(std::move(threadInit))
+{
+	for (size_t i = 0; i < m_ThreadCount; i++)
+		m_Workers.emplace_back(new Worker());
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	Stop();
+}
+
+/**
+ * Spawns the worker threads. Does nothing if the pool is already running.
+ */
+void WorkStealingPool::Start()
+{
+	if (m_Running.load())
+		return;
+
+	{
+		std::unique_lock<std::mutex> lock(m_IdleMutex);
+		m_Stopped = false;
+	}
+
+	for (size_t i = 0; i < m_ThreadCount; i++)
+		m_Workers[i]->Thread = std::thread([this, i]() { WorkerThreadProc(i); });
+
+	m_Running.store(true);
+}
+
+/**
+ * Stops accepting new tasks, waits until all queued tasks have been
+ * run and joins the worker threads.
+ */
+void WorkStealingPool::Stop()
+{
+	if (!m_Running.exchange(false))
+		return;
+
+	/* Wait for Post() calls which have seen m_Running == true. */
+	while (m_Posting.load() > 0)
+		std::this_thread::yield();
+
+	{
+		std::unique_lock<std::mutex> lock(m_IdleMutex);
+		m_Stopped = true;
+		m_IdleCV.notify_all();
+	}
+
+	for (auto& worker : m_Workers)
+		worker->Thread.join();
+}
+
+/**
+ * Queues a task.
+ *
+ * @param callback The task.
+ * @param priority The priority from 0 (lowest) to Priorities - 1 (highest).
+ * @returns true if the task was queued, false if the pool isn't running.
+ */
+bool WorkStealingPool::Post(Callback&& callback, size_t priority)
+{
+	priority = std::min(priority, Priorities - 1);
+
+	m_Posting.fetch_add(1);
+
+	/* Tasks posted by other tasks are still accepted while the pool is being stopped. */
+	if (!m_Running.load() && l_CurrentPool != this) {
+		m_Posting.fetch_sub(1);
+		return false;
+	}
+
+	Worker& worker = l_CurrentPool == this
+		? *m_Workers[l_CurrentWorker]
+		: *m_Workers[m_NextWorker.fetch_add(1) % m_ThreadCount];
+
+	{
+		std::unique_lock<std::mutex> lock(worker.Mutex);
+
+		/* Incremented while holding the lock so m_Queued is never lower than the number of queued tasks. */
+		m_Queued.fetch_add(1);
+		worker.Length.fetch_add(1);
+		worker.Queues[priority].emplace_back(std::move(callback));
+	}
+
+	m_Posting.fetch_sub(1);
+
+	if (m_Idle.load() > 0) {
+		std::unique_lock<std::mutex> lock(m_IdleMutex);
+		m_IdleCV.notify_one();
+	}
+
+	return true;
+}
+
+/**
+ * Checks whether the calling thread is one of this pool's worker threads.
+ */
+bool WorkStealingPool::IsWorkerThread() const
+{
+	return l_CurrentPool == this;
+}
+
+size_t WorkStealingPool::GetThreadCount() const
+{
+	return m_ThreadCount;
+}
+
+/**
+ * Returns the number of queued tasks which haven't been started yet.
+ */
+size_t WorkStealingPool::GetLength() const
+{
+	return m_Queued.load();
+}
+
+/**
+ * Returns the number of queued tasks per worker.
+ */
+std::vector<size_t> WorkStealingPool::GetQueueDepths() const
+{
+	std::vector<size_t> depths;
+	depths.reserve(m_Workers.size());
+
+	for (auto& worker : m_Workers)
+		depths.push_back(worker->Length.load());
+
+	return depths;
+}
+
+/**
+ * Returns how many tasks have been taken from another worker's queue.
+ */
+uint_fast64_t WorkStealingPool::GetSteals() const
+{
+	return m_Steals.load();
+}
+
+bool WorkStealingPool::PopLocal(Worker& worker, Callback& callback)
+{
+	if (worker.Length.load() == 0)
+		return false;
+
+	std::unique_lock<std::mutex> lock(worker.Mutex);
+
+	for (size_t i = Priorities; i-- > 0;) {
+		auto& queue = worker.Queues[i];
+
+		if (!queue.empty()) {
+			callback = std::move(queue.front());
+			queue.pop_front();
+
+			worker.Length.fetch_sub(1);
+			m_Queued.fetch_sub(1);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool WorkStealingPool::Steal(size_t thief, Callback& callback)
+{
+	for (size_t offset = 1; offset < m_ThreadCount; offset++) {
+		Worker& victim = *m_Workers[(thief + offset) % m_ThreadCount];
+
+		if (victim.Length.load() == 0)
+			continue;
+
+		std::unique_lock<std::mutex> lock(victim.Mutex);
+
+		for (size_t i = Priorities; i-- > 0;) {
+			auto& queue = victim.Queues[i];
+
+			if (!queue.empty()) {
+				callback = std::move(queue.back());
+				queue.pop_back();
+
+				victim.Length.fetch_sub(1);
+				m_Queued.fetch_sub(1);
+				m_Steals.fetch_add(1);
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void WorkStealingPool::WorkerThreadProc(size_t index)
+{
+	l_CurrentPool = this;
+	l_CurrentWorker = index;
+
+	if (m_ThreadInit)
+		m_ThreadInit(index);
+
+	Worker& self = *m_Workers[index];
+
+	for (;;) {
+		Callback callback;
+
+		if (PopLocal(self, callback) || Steal(index, callback)) {
+			callback();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_IdleMutex);
+
+		m_Idle.fetch_add(1);
+
+		while (m_Queued.load() == 0 && !m_Stopped)
+			m_IdleCV.wait(lock);
+
+		m_Idle.fetch_sub(1);
+
+		if (m_Stopped && m_Queued.load() == 0)
+			break;
+	}
+
+	l_CurrentPool = nullptr;
+}
@@ -0,0 +1,89 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include "base/i2-base.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * A pool of worker threads which each own a set of task deques (one per priority).
+ *
+ * Tasks posted from a worker thread are queued on that worker's deques, other
+ * tasks are distributed round-robin. Workers run their own tasks in FIFO order
+ * (highest priority first) and steal from the back of other workers' deques once
+ * they run out of work. With a single thread all tasks of the same priority are
+ * executed in the order they were posted in.
+ *
+ * @ingroup base
+ */
+class WorkStealingPool
+{
+public:
+	typedef std::function<void ()> Callback;
+	typedef std::function<void (size_t)> ThreadInitializer;
+
+	static constexpr size_t Priorities = 4;
+
+	WorkStealingPool(size_t threads, ThreadInitializer threadInit = ThreadInitializer());
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	void Start();
+	void Stop();
+
+	bool Post(Callback&& callback, size_t priority = 1);
+
+	bool IsWorkerThread() const;
+
+	size_t GetThreadCount() const;
+	size_t GetLength() const;
+	std::vector<size_t> GetQueueDepths() const;
+	uint_fast64_t GetSteals() const;
+
+private:
+	struct Worker
+	{
+		std::mutex Mutex;
+		std::deque<Callback> Queues[Priorities];
+		std::atomic<size_t> Length{0};
+		std::thread Thread;
+	};
+
+	size_t m_ThreadCount;
+	ThreadInitializer m_ThreadInit;
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+
+	std::atomic<bool> m_Running{false};
+	std::atomic<size_t> m_Posting{0};
+	std::atomic<size_t> m_Queued{0};
+	std::atomic<size_t> m_NextWorker{0};
+	std::atomic<uint_fast64_t> m_Steals{0};
+
+	std::mutex m_IdleMutex;
+	std::condition_variable m_IdleCV;
+	std::atomic<size_t> m_Idle{0};
+	bool m_Stopped{false};
+
+	void WorkerThreadProc(size_t index);
+
+	bool PopLocal(Worker& worker, Callback& callback);
+	bool Steal(size_t thief, Callback& callback);
+};
+
+}
+
+#endif /* WORKSTEALINGPOOL_H */
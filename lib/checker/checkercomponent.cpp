@@ -14,7 +14,9 @@
 #include "base/exception.hpp"
 #include "base/convert.hpp"
 #include "base/statsfunction.hpp"
+#include <algorithm>
 #include <chrono>
+#include <functional>
 
 using namespace icinga;
 
@@ -27,15 +29,54 @@ void CheckerComponent::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr
 	DictionaryData nodes;
 
 	for (const CheckerComponent::Ptr& checker : ConfigType::GetObjectsByType<CheckerComponent>()) {
-		unsigned long idle = checker->GetIdleCheckables();
-		unsigned long pending = checker->GetPendingCheckables();
+		unsigned long idle = 0;
+		unsigned long pending = 0;
+		ArrayData shards;
+
+		String perfdata_prefix = "checkercomponent_" + checker->GetName() + "_";
+		double now = Utility::GetTime();
+		size_t shardIndex = 0;
+
+		for (auto& shard : checker->m_Shards) {
+			unsigned long shardIdle, shardPending;
+			double lateness = 0;
+
+			{
+				std::unique_lock<std::mutex> lock(shard->Mutex);
+
+				shardIdle = shard->IdleCheckables.size();
+				shardPending = shard->PendingCheckables.size();
+
+				auto& idx = boost::get<1>(shard->IdleCheckables);
+
+				if (idx.begin() != idx.end())
+					lateness = std::max(0.0, now - idx.begin()->NextCheck);
+			}
+
+			idle += shardIdle;
+			pending += shardPending;
+
+			shards.emplace_back(new Dictionary({
+				{ "idle", shardIdle },
+				{ "pending", shardPending },
+				{ "lateness", lateness }
+			}));
+
+			if (checker->m_Shards.size() > 1) {
+				String shardPrefix = perfdata_prefix + "shard" + Convert::ToString(shardIndex) + "_";
+				perfdata->Add(new PerfdataValue(shardPrefix + "queue_depth", Convert::ToDouble(shardIdle + shardPending)));
+				perfdata->Add(new PerfdataValue(shardPrefix + "lateness", lateness));
+			}
+
+			shardIndex++;
+		}
 
 		nodes.emplace_back(checker->GetName(), new Dictionary({
 			{ "idle", idle },
-			{ "pending", pending }
+			{ "pending", pending },
+			{ "shards", new Array(std::move(shards)) }
 		}));
 
-		String perfdata_prefix = "checkercomponent_" + checker->GetName() + "_";
 		perfdata->Add(new PerfdataValue(perfdata_prefix + "idle", Convert::ToDouble(idle)));
 		perfdata->Add(new PerfdataValue(perfdata_prefix + "pending", Convert::ToDouble(pending)));
 	}
@@ -45,6 +86,9 @@ void CheckerComponent::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr
 
 void CheckerComponent::OnConfigLoaded()
 {
+	for (int i = 0; i < GetSchedulerThreads(); i++)
+		m_Shards.emplace_back(new Shard());
+
 	ConfigObject::OnActiveChanged.connect([this](const ConfigObject::Ptr& object, const Value&) {
 		ObjectHandler(object);
 	});
@@ -62,10 +106,12 @@ void CheckerComponent::Start(bool runtimeCreated)
 	ObjectImpl<CheckerComponent>::Start(runtimeCreated);
 
 	Log(LogInformation, "CheckerComponent")
-		<< "'" << GetName() << "' started.";
-
+		<< "'" << GetName() << "' started with " << m_Shards.size() << " scheduler thread(s).";
 
-	m_Thread = std::thread([this]() { CheckThreadProc(); });
+	for (auto& shard : m_Shards) {
+		Shard *pshard = shard.get();
+		shard->Thread = std::thread([this, pshard]() { CheckThreadProc(*pshard); });
+	}
 
 	m_ResultTimer = new Timer();
 	m_ResultTimer->SetInterval(5);
@@ -75,14 +121,16 @@ void CheckerComponent::Start(bool runtimeCreated)
 
 void CheckerComponent::Stop(bool runtimeRemoved)
 {
-	{
-		std::unique_lock<std::mutex> lock(m_Mutex);
-		m_Stopped = true;
-		m_CV.notify_all();
+	for (auto& shard : m_Shards) {
+		std::unique_lock<std::mutex> lock(shard->Mutex);
+		shard->Stopped = true;
+		shard->CV.notify_all();
 	}
 
 	m_ResultTimer->Stop();
-	m_Thread.join();
+
+	for (auto& shard : m_Shards)
+		shard->Thread.join();
 
 	Log(LogInformation, "CheckerComponent")
 		<< "'" << GetName() << "' stopped.";
@@ -90,21 +138,45 @@ void CheckerComponent::Stop(bool runtimeRemoved)
 	ObjectImpl<CheckerComponent>::Stop(runtimeRemoved);
 }
 
-void CheckerComponent::CheckThreadProc()
+void CheckerComponent::ValidateSchedulerThreads(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<CheckerComponent>::ValidateSchedulerThreads(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "scheduler_threads" }, "Value must be greater than 0."));
+}
+
+/**
+ * Returns the shard which is responsible for scheduling the specified checkable.
+ *
+ * @param checkable The checkable.
+ * @returns The shard.
+ */
+CheckerComponent::Shard& CheckerComponent::GetShard(const Checkable::Ptr& checkable)
+{
+	if (m_Shards.size() == 1)
+		return *m_Shards[0];
+
+	size_t hash = std::hash<std::string>()(checkable->GetName().GetData());
+
+	return *m_Shards[hash % m_Shards.size()];
+}
+
+void CheckerComponent::CheckThreadProc(Shard& shard)
 {
 	Utility::SetThreadName("Check Scheduler");
 	IcingaApplication::Ptr icingaApp = IcingaApplication::GetInstance();
 
-	std::unique_lock<std::mutex> lock(m_Mutex);
+	std::unique_lock<std::mutex> lock(shard.Mutex);
 
 	for (;;) {
 		typedef boost::multi_index::nth_index<CheckableSet, 1>::type CheckTimeView;
-		CheckTimeView& idx = boost::get<1>(m_IdleCheckables);
+		CheckTimeView& idx = boost::get<1>(shard.IdleCheckables);
 
-		while (idx.begin() == idx.end() && !m_Stopped)
-			m_CV.wait(lock);
+		while (idx.begin() == idx.end() && !shard.Stopped)
+			shard.CV.wait(lock);
 
-		if (m_Stopped)
+		if (shard.Stopped)
 			break;
 
 		auto it = idx.begin();
@@ -123,14 +195,14 @@ void CheckerComponent::CheckThreadProc()
 
 		if (wait > 0) {
 			/* Wait for the next check. */
-			m_CV.wait_for(lock, std::chrono::duration<double>(wait));
+			shard.CV.wait_for(lock, std::chrono::duration<double>(wait));
 
 			continue;
 		}
 
 		Checkable::Ptr checkable = csi.Object;
 
-		m_IdleCheckables.erase(checkable);
+		shard.IdleCheckables.erase(checkable);
 
 		bool forced = checkable->GetForceNextCheck();
 		bool check = true;
@@ -169,7 +241,7 @@ void CheckerComponent::CheckThreadProc()
 
 		/* reschedule the checkable if checks are disabled */
 		if (!check) {
-			m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+			shard.IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
 			lock.unlock();
 
 			Log(LogDebug, "CheckerComponent")
@@ -191,7 +263,7 @@ void CheckerComponent::CheckThreadProc()
 			<< csi.Object->GetName() << "', Next Check: "
 			<< Utility::FormatDateTime("%Y-%m-%d %H:%M:%S %z", csi.NextCheck) << "(" << csi.NextCheck << ").";
 
-		m_PendingCheckables.insert(csi);
+		shard.PendingCheckables.insert(csi);
 
 		lock.unlock();
 
@@ -210,14 +282,15 @@ void CheckerComponent::CheckThreadProc()
 		 * callback is active and making it crash safe
 		 */
 		CheckerComponent::Ptr checkComponent(this);
+		Shard *pshard = &shard;
 
-		Utility::QueueAsyncCallback([this, checkComponent, checkable]() { ExecuteCheckHelper(checkable); });
+		Utility::QueueAsyncCallback([this, checkComponent, pshard, checkable]() { ExecuteCheckHelper(*pshard, checkable); });
 
 		lock.lock();
 	}
 }
 
-void CheckerComponent::ExecuteCheckHelper(const Checkable::Ptr& checkable)
+void CheckerComponent::ExecuteCheckHelper(Shard& shard, const Checkable::Ptr& checkable)
 {
 	try {
 		checkable->ExecuteCheck();
@@ -242,20 +315,20 @@ void CheckerComponent::ExecuteCheckHelper(const Checkable::Ptr& checkable)
 	Checkable::DecreasePendingChecks();
 
 	{
-		std::unique_lock<std::mutex> lock(m_Mutex);
+		std::unique_lock<std::mutex> lock(shard.Mutex);
 
 		/* remove the object from the list of pending objects; if it's not in the
 		 * list this was a manual (i.e. forced) check and we must not re-add the
 		 * object to the list because it's already there. */
-		auto it = m_PendingCheckables.find(checkable);
+		auto it = shard.PendingCheckables.find(checkable);
 
-		if (it != m_PendingCheckables.end()) {
-			m_PendingCheckables.erase(it);
+		if (it != shard.PendingCheckables.end()) {
+			shard.PendingCheckables.erase(it);
 
 			if (checkable->IsActive())
-				m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+				shard.IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
 
-			m_CV.notify_all();
+			shard.CV.notify_all();
 		}
 	}
 
@@ -267,12 +340,8 @@ void CheckerComponent::ResultTimerHandler()
 {
 	std::ostringstream msgbuf;
 
-	{
-		std::unique_lock<std::mutex> lock(m_Mutex);
-
-		msgbuf << "Pending checkables: " << m_PendingCheckables.size() << "; Idle checkables: " << m_IdleCheckables.size() << "; Checks/s: "
-			<< (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0;
-	}
+	msgbuf << "Pending checkables: " << GetPendingCheckables() << "; Idle checkables: " << GetIdleCheckables() << "; Checks/s: "
+		<< (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0;
 
 	Log(LogNotice, "CheckerComponent", msgbuf.str());
 }
@@ -287,20 +356,22 @@ void CheckerComponent::ObjectHandler(const ConfigObject::Ptr& object)
 	Zone::Ptr zone = Zone::GetByName(checkable->GetZoneName());
 	bool same_zone = (!zone || Zone::GetLocalZone() == zone);
 
+	Shard& shard = GetShard(checkable);
+
 	{
-		std::unique_lock<std::mutex> lock(m_Mutex);
+		std::unique_lock<std::mutex> lock(shard.Mutex);
 
 		if (object->IsActive() && !object->IsPaused() && same_zone) {
-			if (m_PendingCheckables.find(checkable) != m_PendingCheckables.end())
+			if (shard.PendingCheckables.find(checkable) != shard.PendingCheckables.end())
 				return;
 
-			m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+			shard.IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
 		} else {
-			m_IdleCheckables.erase(checkable);
-			m_PendingCheckables.erase(checkable);
+			shard.IdleCheckables.erase(checkable);
+			shard.PendingCheckables.erase(checkable);
 		}
 
-		m_CV.notify_all();
+		shard.CV.notify_all();
 	}
 }
 
@@ -314,11 +385,13 @@ CheckableScheduleInfo CheckerComponent::GetCheckableScheduleInfo(const Checkable
 
 void CheckerComponent::NextCheckChangedHandler(const Checkable::Ptr& checkable)
 {
-	std::unique_lock<std::mutex> lock(m_Mutex);
+	Shard& shard = GetShard(checkable);
+
+	std::unique_lock<std::mutex> lock(shard.Mutex);
 
 	/* remove and re-insert the object from the set in order to force an index update */
 	typedef boost::multi_index::nth_index<CheckableSet, 0>::type CheckableView;
-	CheckableView& idx = boost::get<0>(m_IdleCheckables);
+	CheckableView& idx = boost::get<0>(shard.IdleCheckables);
 
 	auto it = idx.find(checkable);
 
@@ -330,19 +403,31 @@ void CheckerComponent::NextCheckChangedHandler(const Checkable::Ptr& checkable)
 	CheckableScheduleInfo csi = GetCheckableScheduleInfo(checkable);
 	idx.insert(csi);
 
-	m_CV.notify_all();
+	shard.CV.notify_all();
 }
 
 unsigned long CheckerComponent::GetIdleCheckables()
 {
-	std::unique_lock<std::mutex> lock(m_Mutex);
+	unsigned long count = 0;
+
+	for (auto& shard : m_Shards) {
+		std::unique_lock<std::mutex> lock(shard->Mutex);
 
-	return m_IdleCheckables.size();
+		count += shard->IdleCheckables.size();
+	}
+
+	return count;
 }
 
 unsigned long CheckerComponent::GetPendingCheckables()
 {
-	std::unique_lock<std::mutex> lock(m_Mutex);
+	unsigned long count = 0;
+
+	for (auto& shard : m_Shards) {
+		std::unique_lock<std::mutex> lock(shard->Mutex);
+
+		count += shard->PendingCheckables.size();
+	}
 
-	return m_PendingCheckables.size();
+	return count;
 }
@@ -12,8 +12,10 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/key_extractors.hpp>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 namespace icinga
 {
@@ -68,21 +70,35 @@ public:
 	unsigned long GetIdleCheckables();
 	unsigned long GetPendingCheckables();
 
+	void ValidateSchedulerThreads(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+
 private:
-	std::mutex m_Mutex;
-	std::condition_variable m_CV;
-	bool m_Stopped{false};
-	std::thread m_Thread;
+	/**
+	 * A partition of the checkables, scheduled by its own thread.
+	 *
+	 * @ingroup checker
+	 */
+	struct Shard
+	{
+		std::mutex Mutex;
+		std::condition_variable CV;
+		bool Stopped{false};
+		std::thread Thread;
+
+		CheckableSet IdleCheckables;
+		CheckableSet PendingCheckables;
+	};
 
-	CheckableSet m_IdleCheckables;
-	CheckableSet m_PendingCheckables;
+	std::vector<std::unique_ptr<Shard>> m_Shards;
 
 	Timer::Ptr m_ResultTimer;
 
-	void CheckThreadProc();
+	Shard& GetShard(const Checkable::Ptr& checkable);
+
+	void CheckThreadProc(Shard& shard);
 	void ResultTimerHandler();
 
-	void ExecuteCheckHelper(const Checkable::Ptr& checkable);
+	void ExecuteCheckHelper(Shard& shard, const Checkable::Ptr& checkable);
 
 	void AdjustCheckTimer();
 
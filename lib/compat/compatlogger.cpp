@@ -445,7 +445,17 @@ void CompatLogger::WriteLine(const String& line)
 	if (!m_OutputFile.good())
 		return;
 
-	m_OutputFile << "[" << (long)Utility::GetTime() << "] " << line << "\n";
+	std::ostringstream msgbuf;
+	msgbuf << "[" << (long)Utility::GetTime() << "] " << line << "\n";
+
+	String text = msgbuf.str();
+	m_OutputFile << text;
+
+	if (!m_OutputFile.good())
+		return;
+
+	m_Index.Append(text, m_OutputOffset);
+	m_OutputOffset += text.GetLength();
 }
 
 void CompatLogger::Flush()
@@ -456,6 +466,10 @@ void CompatLogger::Flush()
 		return;
 
 	m_OutputFile << std::flush;
+
+	/* The index must not refer to lines which aren't in the log file yet. */
+	if (m_OutputFile.good())
+		m_Index.Flush();
 }
 
 /**
@@ -469,6 +483,7 @@ void CompatLogger::ReopenFile(bool rotate)
 
 	if (m_OutputFile) {
 		m_OutputFile.close();
+		m_Index.Close();
 
 		if (rotate) {
 			String archiveFile = GetLogDir() + "/archives/icinga-" + Utility::FormatDateTime("%m-%d-%Y-%H", Utility::GetTime()) + ".log";
@@ -477,10 +492,12 @@ void CompatLogger::ReopenFile(bool rotate)
 				<< "Rotating compat log file '" << tempFile << "' -> '" << archiveFile << "'";
 
 			(void) rename(tempFile.CStr(), archiveFile.CStr());
+			(void) rename(CompatLogIndex::GetIndexPath(tempFile).CStr(), CompatLogIndex::GetIndexPath(archiveFile).CStr());
 		}
 	}
 
-	m_OutputFile.open(tempFile.CStr(), std::ofstream::app);
+	/* Binary mode keeps the offsets in the index the same as in the file. */
+	m_OutputFile.open(tempFile.CStr(), std::ofstream::app | std::ofstream::binary);
 
 	if (!m_OutputFile) {
 		Log(LogWarning, "CompatLogger")
@@ -489,6 +506,21 @@ void CompatLogger::ReopenFile(bool rotate)
 		return;
 	}
 
+	m_OutputOffset = m_OutputFile.seekp(0, std::ofstream::end).tellp();
+
+	/* Don't append to a line which was cut off, e.g. by a crash. */
+	if (m_OutputOffset > 0) {
+		std::ifstream fp (tempFile.CStr(), std::ifstream::in | std::ifstream::binary);
+		fp.seekg(m_OutputOffset - 1);
+
+		if (fp.get() != '\n') {
+			m_OutputFile << "\n" << std::flush;
+			m_OutputOffset++;
+		}
+	}
+
+	m_Index.Open(tempFile);
+
 	WriteLine("LOG ROTATION: " + GetRotationMethod());
 	WriteLine("LOG VERSION: 2.0");
 
@@ -5,6 +5,7 @@
 
 #include "compat/compatlogger-ti.hpp"
 #include "icinga/service.hpp"
+#include "icinga/compatlogindex.hpp"
 #include "base/timer.hpp"
 #include <fstream>
 
@@ -52,6 +53,8 @@ private:
 	void ScheduleNextRotation();
 
 	std::ofstream m_OutputFile;
+	uint64_t m_OutputOffset{0};
+	CompatLogIndex m_Index;
 	void ReopenFile(bool rotate);
 };
 
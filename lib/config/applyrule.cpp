@@ -1,7 +1,9 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "config/applyrule.hpp"
+#include "config/applyruleindex.hpp"
 #include "base/logger.hpp"
+#include <mutex>
 #include <set>
 
 using namespace icinga;
@@ -9,6 +11,9 @@ using namespace icinga;
 ApplyRule::RuleMap ApplyRule::m_Rules;
 ApplyRule::TypeMap ApplyRule::m_Types;
 
+static std::map<String, ApplyRuleIndex::Ptr> l_RuleIndexes;
+static std::mutex l_RuleIndexesMutex;
+
 ApplyRule::ApplyRule(String targetType, String name, Expression::Ptr expression,
 	Expression::Ptr filter, String package, String fkvar, String fvvar, Expression::Ptr fterm,
 	bool ignoreOnError, DebugInfo di, Dictionary::Ptr scope)
@@ -76,6 +81,9 @@ void ApplyRule::AddRule(const String& sourceType, const String& targetType, cons
 	const String& fvvar, const Expression::Ptr& fterm, bool ignoreOnError, const DebugInfo& di, const Dictionary::Ptr& scope)
 {
 	m_Rules[sourceType].push_back(ApplyRule(targetType, name, expression, filter, package, fkvar, fvvar, fterm, ignoreOnError, di, scope));
+
+	std::unique_lock<std::mutex> lock(l_RuleIndexesMutex);
+	l_RuleIndexes.erase(sourceType);
 }
 
 bool ApplyRule::EvaluateFilter(ScriptFrame& frame) const
@@ -141,6 +149,36 @@ std::vector<ApplyRule>& ApplyRule::GetRules(const String& type)
 	return it->second;
 }
 
+/**
+ * Returns the rules for the specified type which may match the object described by
+ * the top-level variables in vars, i.e. the ones the caller passes to the filter.
+ *
+ * The index for the type is built on first use and dropped whenever a rule is added.
+ */
+std::vector<ApplyRule *> ApplyRule::GetCandidateRules(const String& type, const Dictionary::Ptr& vars)
+{
+	ApplyRuleIndex::Ptr index;
+
+	{
+		std::unique_lock<std::mutex> lock(l_RuleIndexesMutex);
+
+		ApplyRuleIndex::Ptr& slot = l_RuleIndexes[type];
+
+		if (!slot) {
+			std::vector<ApplyRule>& rules = GetRules(type);
+
+			slot = new ApplyRuleIndex(rules);
+
+			Log(LogDebug, "ApplyRule")
+				<< "Indexed " << slot->GetIndexedRuleCount() << " out of " << rules.size() << " apply rules for type '" << type << "'.";
+		}
+
+		index = slot;
+	}
+
+	return index->GetCandidateRules(vars);
+}
+
 void ApplyRule::CheckMatches(bool silent)
 {
 	for (const RuleMap::value_type& kv : m_Rules) {
@@ -0,0 +1,355 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/applyruleindex.hpp"
+#include "config/vmops.hpp"
+#include "base/namespace.hpp"
+#include "base/scriptglobal.hpp"
+#include <map>
+
+using namespace icinga;
+
+ApplyRuleIndex::ApplyRuleIndex(std::vector<ApplyRule>& rules)
+{
+	std::map<std::pair<String, std::vector<String> >, size_t> pathIds;
+
+	m_Rules.reserve(rules.size());
+
+	for (ApplyRule& rule : rules) {
+		size_t id = m_Rules.size();
+		m_Rules.push_back(&rule);
+
+		std::vector<Predicate> predicates;
+
+		if (!rule.GetFilter() || !ExtractPredicates(rule, rule.GetFilter().get(), predicates)) {
+			m_UnindexedRules.push_back(id);
+			continue;
+		}
+
+		for (const Predicate& predicate : predicates) {
+			auto it = pathIds.find(std::make_pair(predicate.Root, predicate.Path));
+
+			if (it == pathIds.end()) {
+				it = pathIds.emplace(std::make_pair(predicate.Root, predicate.Path), m_Paths.size()).first;
+
+				m_Paths.emplace_back();
+				m_Paths.back().Root = predicate.Root;
+				m_Paths.back().Path = predicate.Path;
+			}
+
+			PathIndex& path = m_Paths[it->second];
+
+			switch (predicate.Type) {
+				case PredicateEqual:
+					path.Equal[predicate.Operand.GetData()].push_back(id);
+					break;
+				case PredicateContains:
+					path.Contains[predicate.Operand.GetData()].push_back(id);
+					break;
+				case PredicateMatch: {
+					std::string prefix = GetMatchPrefix(predicate.Operand);
+					path.MatchPrefixes[prefix].push_back(id);
+					path.MatchPrefixLengths.insert(prefix.size());
+					break;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Returns the rules whose filter may match for the specified top-level
+ * variables (e.g. "host" and "service"), in their original order.
+ */
+std::vector<ApplyRule *> ApplyRuleIndex::GetCandidateRules(const Dictionary::Ptr& vars) const
+{
+	std::vector<bool> candidates(m_Rules.size(), false);
+
+	for (size_t id : m_UnindexedRules)
+		candidates[id] = true;
+
+	for (const PathIndex& path : m_Paths) {
+		Value value;
+
+		if (!ResolvePath(vars, path, value)) {
+			/* The full evaluation takes care of errors and unknown variables. */
+			AddAll(path.Equal, candidates);
+			AddAll(path.Contains, candidates);
+			AddAll(path.MatchPrefixes, candidates);
+			continue;
+		}
+
+		/* Value::operator== compares strings and Empty as strings, anything else is left to the full evaluation. */
+		if (!path.Equal.empty()) {
+			if (value.IsString() || value.IsEmpty())
+				AddMatching(path.Equal, static_cast<String>(value).GetData(), candidates);
+			else
+				AddAll(path.Equal, candidates);
+		}
+
+		/* "x" in <path> is false for Empty and throws for anything other than an array. */
+		if (!path.Contains.empty() && !value.IsEmpty()) {
+			if (value.IsObjectType<Array>()) {
+				Array::Ptr arr = value;
+
+				ObjectLock olock(arr);
+				for (const Value& item : arr) {
+					if (item.IsString() || item.IsEmpty())
+						AddMatching(path.Contains, static_cast<String>(item).GetData(), candidates);
+					else {
+						AddAll(path.Contains, candidates);
+						break;
+					}
+				}
+			} else
+				AddAll(path.Contains, candidates);
+		}
+
+		if (!path.MatchPrefixes.empty()) {
+			if (value.IsObjectType<Array>()) {
+				Array::Ptr arr = value;
+
+				/* match() requires all array elements to match, the first one is as good as any. */
+				if (arr->GetLength() > 0)
+					AddPrefixMatching(path, arr->Get(0), candidates);
+			} else
+				AddPrefixMatching(path, value, candidates);
+		}
+	}
+
+	std::vector<ApplyRule *> result;
+
+	for (size_t id = 0; id < m_Rules.size(); id++) {
+		if (candidates[id])
+			result.push_back(m_Rules[id]);
+	}
+
+	return result;
+}
+
+size_t ApplyRuleIndex::GetIndexedRuleCount() const
+{
+	return m_Rules.size() - m_UnindexedRules.size();
+}
+
+/**
+ * Extracts a set of predicates from a filter expression, at least one of
+ * which is true whenever the filter is true.
+ *
+ * @returns false if no such set could be found.
+ */
+bool ApplyRuleIndex::ExtractPredicates(const ApplyRule& rule, const Expression *expr, std::vector<Predicate>& predicates)
+{
+	if (dynamic_cast<const LogicalAndExpression *>(expr)) {
+		auto binary = static_cast<const BinaryExpression *>(expr);
+
+		if (ExtractPredicates(rule, binary->m_Operand1.get(), predicates))
+			return true;
+
+		/* The right side is only safe to use if the left side can neither fail nor have side effects. */
+		if (dynamic_cast<const LiteralExpression *>(binary->m_Operand1.get()))
+			return ExtractPredicates(rule, binary->m_Operand2.get(), predicates);
+
+		return false;
+	}
+
+	if (dynamic_cast<const LogicalOrExpression *>(expr)) {
+		auto binary = static_cast<const BinaryExpression *>(expr);
+		std::vector<Predicate> left, right;
+
+		if (!ExtractPredicates(rule, binary->m_Operand1.get(), left) || !ExtractPredicates(rule, binary->m_Operand2.get(), right))
+			return false;
+
+		predicates.insert(predicates.end(), left.begin(), left.end());
+		predicates.insert(predicates.end(), right.begin(), right.end());
+		return true;
+	}
+
+	Predicate predicate;
+
+	if (dynamic_cast<const EqualExpression *>(expr)) {
+		auto binary = static_cast<const BinaryExpression *>(expr);
+
+		if ((ExtractPath(rule, binary->m_Operand1.get(), predicate.Root, predicate.Path) && GetStringLiteral(binary->m_Operand2.get(), predicate.Operand))
+			|| (ExtractPath(rule, binary->m_Operand2.get(), predicate.Root, predicate.Path) && GetStringLiteral(binary->m_Operand1.get(), predicate.Operand))) {
+			predicate.Type = PredicateEqual;
+			predicates.emplace_back(std::move(predicate));
+			return true;
+		}
+
+		return false;
+	}
+
+	if (dynamic_cast<const InExpression *>(expr)) {
+		auto binary = static_cast<const BinaryExpression *>(expr);
+
+		if (GetStringLiteral(binary->m_Operand1.get(), predicate.Operand) && ExtractPath(rule, binary->m_Operand2.get(), predicate.Root, predicate.Path)) {
+			predicate.Type = PredicateContains;
+			predicates.emplace_back(std::move(predicate));
+			return true;
+		}
+
+		return false;
+	}
+
+	auto call = dynamic_cast<const FunctionCallExpression *>(expr);
+
+	if (call && call->m_Args.size() == 2 && IsMatchFunction(rule, call->m_FName.get())
+		&& GetStringLiteral(call->m_Args[0].get(), predicate.Operand) && ExtractPath(rule, call->m_Args[1].get(), predicate.Root, predicate.Path)) {
+		predicate.Type = PredicateMatch;
+		predicates.emplace_back(std::move(predicate));
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Extracts a chain of constant field accesses on a top-level variable (e.g. host.vars.os).
+ */
+bool ApplyRuleIndex::ExtractPath(const ApplyRule& rule, const Expression *expr, String& root, std::vector<String>& path)
+{
+	std::vector<String> indexes;
+
+	while (dynamic_cast<const IndexerExpression *>(expr)) {
+		auto binary = static_cast<const BinaryExpression *>(expr);
+		String index;
+
+		if (!GetStringLiteral(binary->m_Operand2.get(), index))
+			return false;
+
+		indexes.emplace_back(std::move(index));
+		expr = binary->m_Operand1.get();
+	}
+
+	auto var = dynamic_cast<const VariableExpression *>(expr);
+
+	/* Loop variables of 'apply for' rules shadow the top-level variables. */
+	if (!var || var->GetVariable() == rule.GetFKVar() || var->GetVariable() == rule.GetFVVar())
+		return false;
+
+	root = var->GetVariable();
+	path.assign(indexes.rbegin(), indexes.rend());
+	return true;
+}
+
+bool ApplyRuleIndex::IsMatchFunction(const ApplyRule& rule, const Expression *fname)
+{
+	auto var = dynamic_cast<const VariableExpression *>(fname);
+
+	if (!var || var->GetVariable() != "match" || rule.GetFKVar() == "match" || rule.GetFVVar() == "match")
+		return false;
+
+	/* Make sure neither the rule's scope nor the globals override the built-in function. */
+	Value func;
+
+	try {
+		ScriptFrame frame(true);
+		if (rule.GetScope())
+			rule.GetScope()->CopyTo(frame.Locals);
+
+		func = fname->Evaluate(frame).GetValue();
+	} catch (const std::exception&) {
+		return false;
+	}
+
+	Namespace::Ptr systemNS = ScriptGlobal::Get("System", &Empty);
+
+	if (!systemNS || !func.IsObject())
+		return false;
+
+	Value builtin = systemNS->Get("match");
+
+	return builtin.IsObject() && builtin.Get<Object::Ptr>() == func.Get<Object::Ptr>();
+}
+
+bool ApplyRuleIndex::GetStringLiteral(const Expression *expr, String& value)
+{
+	auto literal = dynamic_cast<const LiteralExpression *>(expr);
+
+	if (!literal || !literal->GetValue().IsString())
+		return false;
+
+	value = literal->GetValue();
+	return true;
+}
+
+/**
+ * Returns the case-folded literal part of a match() pattern before the first wildcard or escape.
+ */
+std::string ApplyRuleIndex::GetMatchPrefix(const String& pattern)
+{
+	std::string prefix;
+
+	for (char ch : pattern.GetData()) {
+		if (ch == '*' || ch == '?' || ch == '\\' || ch == '\0' || static_cast<unsigned char>(ch) >= 0x80)
+			break;
+
+		prefix += ch;
+	}
+
+	return ToLowerAscii(prefix);
+}
+
+std::string ApplyRuleIndex::ToLowerAscii(const String& text)
+{
+	std::string result = text.GetData();
+
+	for (char& ch : result) {
+		if (ch >= 'A' && ch <= 'Z')
+			ch += 'a' - 'A';
+	}
+
+	return result;
+}
+
+bool ApplyRuleIndex::ResolvePath(const Dictionary::Ptr& vars, const PathIndex& path, Value& value)
+{
+	if (!vars->Get(path.Root, &value))
+		return false;
+
+	try {
+		for (const String& index : path.Path)
+			value = VMOps::GetField(value, index);
+	} catch (const std::exception&) {
+		return false;
+	}
+
+	return true;
+}
+
+void ApplyRuleIndex::AddAll(const RuleHash& hash, std::vector<bool>& candidates)
+{
+	for (const RuleHash::value_type& kv : hash) {
+		for (size_t id : kv.second)
+			candidates[id] = true;
+	}
+}
+
+void ApplyRuleIndex::AddMatching(const RuleHash& hash, const std::string& key, std::vector<bool>& candidates)
+{
+	auto it = hash.find(key);
+
+	if (it == hash.end())
+		return;
+
+	for (size_t id : it->second)
+		candidates[id] = true;
+}
+
+void ApplyRuleIndex::AddPrefixMatching(const PathIndex& path, const Value& text, std::vector<bool>& candidates)
+{
+	/* match() converts everything but arrays and dictionaries to a string. */
+	if (!text.IsString() && !text.IsEmpty()) {
+		AddAll(path.MatchPrefixes, candidates);
+		return;
+	}
+
+	std::string key = ToLowerAscii(static_cast<String>(text));
+
+	for (size_t length : path.MatchPrefixLengths) {
+		if (length > key.size())
+			break;
+
+		AddMatching(path.MatchPrefixes, key.substr(0, length), candidates);
+	}
+}
@@ -0,0 +1,87 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef APPLYRULEINDEX_H
+#define APPLYRULEINDEX_H
+
+#include "config/i2-config.hpp"
+#include "config/applyrule.hpp"
+#include "base/shared-object.hpp"
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * Candidate lookup for the apply rules of one source type.
+ *
+ * Simple predicates on the host/service an apply rule is evaluated for
+ * (host.vars.os == "Linux", "x" in host.groups, match("web*", host.name))
+ * are extracted from the rules' filters and stored in hash indexes. Rules
+ * whose filter provably does not match an object are skipped; everything
+ * else (including rules that could not be indexed) is still evaluated in full.
+ *
+ * @ingroup config
+ */
+class ApplyRuleIndex final : public SharedObject
+{
+public:
+	DECLARE_PTR_TYPEDEFS(ApplyRuleIndex);
+
+	ApplyRuleIndex(std::vector<ApplyRule>& rules);
+
+	std::vector<ApplyRule *> GetCandidateRules(const Dictionary::Ptr& vars) const;
+
+	size_t GetIndexedRuleCount() const;
+
+private:
+	enum PredicateType
+	{
+		PredicateEqual,
+		PredicateContains,
+		PredicateMatch
+	};
+
+	struct Predicate
+	{
+		PredicateType Type;
+		String Root;
+		std::vector<String> Path;
+		String Operand;
+	};
+
+	typedef std::unordered_map<std::string, std::vector<size_t> > RuleHash;
+
+	struct PathIndex
+	{
+		String Root;
+		std::vector<String> Path;
+
+		RuleHash Equal;
+		RuleHash Contains;
+		RuleHash MatchPrefixes;
+		std::set<size_t> MatchPrefixLengths;
+	};
+
+	std::vector<ApplyRule *> m_Rules;
+	std::vector<size_t> m_UnindexedRules;
+	std::vector<PathIndex> m_Paths;
+
+	static bool ExtractPredicates(const ApplyRule& rule, const Expression *expr, std::vector<Predicate>& predicates);
+	static bool ExtractPath(const ApplyRule& rule, const Expression *expr, String& root, std::vector<String>& path);
+	static bool IsMatchFunction(const ApplyRule& rule, const Expression *fname);
+	static bool GetStringLiteral(const Expression *expr, String& value);
+	static std::string GetMatchPrefix(const String& pattern);
+	static std::string ToLowerAscii(const String& text);
+
+	static bool ResolvePath(const Dictionary::Ptr& vars, const PathIndex& path, Value& value);
+	static void AddAll(const RuleHash& hash, std::vector<bool>& candidates);
+	static void AddMatching(const RuleHash& hash, const std::string& key, std::vector<bool>& candidates);
+	static void AddPrefixMatching(const PathIndex& path, const Value& text, std::vector<bool>& candidates);
+};
+
+}
+
+#endif /* APPLYRULEINDEX_H */
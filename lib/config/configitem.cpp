@@ -24,6 +24,8 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <random>
 
 using namespace icinga;
@@ -383,6 +385,46 @@ ConfigItem::Ptr ConfigItem::GetByTypeAndName(const Type::Ptr& type, const String
 	return it2->second;
 }
 
+/**
+ * Groups the types into waves so that each type's load dependencies are
+ * contained in earlier waves.
+ */
+static std::vector<std::vector<Type::Ptr>> GetLoadDependencyWaves(const std::set<Type::Ptr>& types)
+{
+	std::vector<std::vector<Type::Ptr>> waves;
+	std::set<Type::Ptr> completed;
+
+	while (completed.size() != types.size()) {
+		std::vector<Type::Ptr> wave;
+
+		for (const Type::Ptr& type : types) {
+			if (completed.find(type) != completed.end())
+				continue;
+
+			bool unresolved_dep = false;
+
+			/* skip this type (for now) if there are unresolved load dependencies */
+			for (const String& loadDep : type->GetLoadDependencies()) {
+				Type::Ptr pLoadDep = Type::GetByName(loadDep);
+				if (types.find(pLoadDep) != types.end() && completed.find(pLoadDep) == completed.end()) {
+					unresolved_dep = true;
+					break;
+				}
+			}
+
+			if (!unresolved_dep)
+				wave.push_back(type);
+		}
+
+		VERIFY(!wave.empty());
+
+		completed.insert(wave.begin(), wave.end());
+		waves.emplace_back(std::move(wave));
+	}
+
+	return waves;
+}
+
 bool ConfigItem::CommitNewItems(const ActivationContext::Ptr& context, WorkQueue& upq, std::vector<ConfigItem::Ptr>& newItems)
 {
 	typedef std::pair<ConfigItem::Ptr, bool> ItemPair;
@@ -435,114 +477,113 @@ bool ConfigItem::CommitNewItems(const ActivationContext::Ptr& context, WorkQueue
 	for (const auto& ip : items)
 		newItems.push_back(ip.first);
 
+	/* Bucket the items by type once instead of scanning all items for every type. */
+	std::map<Type::Ptr, std::vector<ItemPair>> itemsByType;
+
+	for (auto& ip : items)
+		itemsByType[ip.first->m_Type].emplace_back(std::move(ip));
+
+#ifdef I2_DEBUG
+	size_t itemCount = items.size();
+#endif /* I2_DEBUG */
+	items.clear();
+
 	std::set<Type::Ptr> types;
-	std::set<Type::Ptr> completed_types;
 
 	for (const Type::Ptr& type : Type::GetAllTypes()) {
 		if (ConfigObject::TypeInstance->IsAssignableFrom(type))
 			types.insert(type);
 	}
 
-	while (types.size() != completed_types.size()) {
-		for (const Type::Ptr& type : types) {
-			if (completed_types.find(type) != completed_types.end())
-				continue;
+	std::vector<std::vector<Type::Ptr>> waves = GetLoadDependencyWaves(types);
 
-			bool unresolved_dep = false;
+	/* Types within a wave don't depend on each other and are committed concurrently. */
+	for (size_t wave = 0; wave < waves.size(); wave++) {
+		std::vector<std::pair<const ItemPair *, size_t>> waveItems;
+		std::vector<Type::Ptr> waveTypes;
 
-			/* skip this type (for now) if there are unresolved load dependencies */
-			for (const String& loadDep : type->GetLoadDependencies()) {
-				Type::Ptr pLoadDep = Type::GetByName(loadDep);
-				if (types.find(pLoadDep) != types.end() && completed_types.find(pLoadDep) == completed_types.end()) {
-					unresolved_dep = true;
-					break;
-				}
-			}
+		for (const Type::Ptr& type : waves[wave]) {
+			auto it (itemsByType.find(type));
 
-			if (unresolved_dep)
+			if (it == itemsByType.end())
 				continue;
 
-			int committed_items = 0;
-			upq.ParallelFor(items, [&type, &committed_items](const ItemPair& ip) {
-				const ConfigItem::Ptr& item = ip.first;
+			for (const ItemPair& ip : it->second)
+				waveItems.emplace_back(&ip, waveTypes.size());
+
+			waveTypes.push_back(type);
+		}
+
+		if (waveItems.empty())
+			continue;
 
-				if (item->m_Type != type)
-					return;
+		if (waveTypes.size() > 1)
+			std::shuffle(std::begin(waveItems), std::end(waveItems), std::default_random_engine {});
 
-				ip.first->Commit(ip.second);
-				committed_items++;
-			});
+		std::vector<std::atomic<uint_fast64_t>> commitTimes (waveTypes.size());
+		auto start (std::chrono::steady_clock::now());
 
-			upq.Join();
+		upq.ParallelFor(waveItems, [&commitTimes](const std::pair<const ItemPair *, size_t>& wi) {
+			auto itemStart (std::chrono::steady_clock::now());
 
-			completed_types.insert(type);
+			wi.first->first->Commit(wi.first->second);
 
-#ifdef I2_DEBUG
-			if (committed_items > 0)
-				Log(LogDebug, "configitem")
-					<< "Committed " << committed_items << " items of type '" << type->GetName() << "'.";
-#endif /* I2_DEBUG */
+			commitTimes[wi.second] += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - itemStart).count();
+		});
 
-			if (upq.HasExceptions())
-				return false;
+		upq.Join();
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		for (size_t i = 0; i < waveTypes.size(); i++) {
+			Log(LogDebug, "configitem")
+				<< "Committed " << itemsByType[waveTypes[i]].size() << " items of type '" << waveTypes[i]->GetName()
+				<< "' in " << commitTimes[i] / 1000.0 << "ms of worker time (wave " << wave << ": "
+				<< elapsed.count() * 1000 << "ms).";
 		}
+
+		if (upq.HasExceptions())
+			return false;
 	}
 
 #ifdef I2_DEBUG
 	Log(LogDebug, "configitem")
-		<< "Committed " << items.size() << " items.";
+		<< "Committed " << itemCount << " items.";
 #endif /* I2_DEBUG */
 
-	completed_types.clear();
-
-	while (types.size() != completed_types.size()) {
-		for (const Type::Ptr& type : types) {
-			if (completed_types.find(type) != completed_types.end())
-				continue;
-
-			bool unresolved_dep = false;
-
-			/* skip this type (for now) if there are unresolved load dependencies */
-			for (const String& loadDep : type->GetLoadDependencies()) {
-				Type::Ptr pLoadDep = Type::GetByName(loadDep);
-				if (types.find(pLoadDep) != types.end() && completed_types.find(pLoadDep) == completed_types.end()) {
-					unresolved_dep = true;
-					break;
-				}
-			}
-
-			if (unresolved_dep)
-				continue;
-
+	for (auto& wave : waves) {
+		for (const Type::Ptr& type : wave) {
 			int notified_items = 0;
-			upq.ParallelFor(items, [&type, &notified_items](const ItemPair& ip) {
-				const ConfigItem::Ptr& item = ip.first;
+			auto it (itemsByType.find(type));
 
-				if (!item->m_Object || item->m_Type != type)
-					return;
+			if (it != itemsByType.end()) {
+				upq.ParallelFor(it->second, [&notified_items](const ItemPair& ip) {
+					const ConfigItem::Ptr& item = ip.first;
 
-				try {
-					item->m_Object->OnAllConfigLoaded();
-					notified_items++;
-				} catch (const std::exception& ex) {
-					if (!item->m_IgnoreOnError)
-						throw;
+					if (!item->m_Object)
+						return;
 
-					Log(LogNotice, "ConfigObject")
-						<< "Ignoring config object '" << item->m_Name << "' of type '" << item->m_Type->GetName() << "' due to errors: " << DiagnosticInformation(ex);
+					try {
+						item->m_Object->OnAllConfigLoaded();
+						notified_items++;
+					} catch (const std::exception& ex) {
+						if (!item->m_IgnoreOnError)
+							throw;
 
-					item->Unregister();
+						Log(LogNotice, "ConfigObject")
+							<< "Ignoring config object '" << item->m_Name << "' of type '" << item->m_Type->GetName() << "' due to errors: " << DiagnosticInformation(ex);
 
-					{
-						std::unique_lock<std::mutex> lock(item->m_Mutex);
-						item->m_IgnoredItems.push_back(item->m_DebugInfo.Path);
-					}
-				}
-			});
+						item->Unregister();
 
-			completed_types.insert(type);
+						{
+							std::unique_lock<std::mutex> lock(item->m_Mutex);
+							item->m_IgnoredItems.push_back(item->m_DebugInfo.Path);
+						}
+					}
+				});
 
-			upq.Join();
+				upq.Join();
+			}
 
 #ifdef I2_DEBUG
 			if (notified_items > 0)
@@ -555,10 +596,15 @@ bool ConfigItem::CommitNewItems(const ActivationContext::Ptr& context, WorkQueue
 
 			notified_items = 0;
 			for (const String& loadDep : type->GetLoadDependencies()) {
-				upq.ParallelFor(items, [loadDep, &type, &notified_items](const ItemPair& ip) {
+				auto it (itemsByType.find(Type::GetByName(loadDep)));
+
+				if (it == itemsByType.end())
+					continue;
+
+				upq.ParallelFor(it->second, [&type, &notified_items](const ItemPair& ip) {
 					const ConfigItem::Ptr& item = ip.first;
 
-					if (!item->m_Object || item->m_Type->GetName() != loadDep)
+					if (!item->m_Object)
 						return;
 
 					ActivationScope ascope(item->m_ActivationContext);
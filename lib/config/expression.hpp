@@ -286,6 +286,8 @@ public:
 protected:
 	std::unique_ptr<Expression> m_Operand1;
 	std::unique_ptr<Expression> m_Operand2;
+
+	friend class ApplyRuleIndex;
 };
 
 class VariableExpression final : public DebuggableExpression
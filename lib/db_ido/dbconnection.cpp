@@ -529,12 +529,18 @@ void DbConnection::ValidateCategories(const Lazy<Array::Ptr>& lvalue, const Vali
 		BOOST_THROW_EXCEPTION(ValidationError(this, { "categories" }, "categories filter is invalid."));
 }
 
-void DbConnection::IncreaseQueryCount()
+/**
+ * Records a statement sent to the database.
+ *
+ * @param rows The number of rows the statement writes, e.g. for multi-row INSERTs.
+ */
+void DbConnection::IncreaseQueryCount(int rows)
 {
 	double now = Utility::GetTime();
 
 	std::unique_lock<std::mutex> lock(m_StatsMutex);
 	m_QueryStats.InsertValue(now, 1);
+	m_RowStats.InsertValue(now, rows);
 }
 
 int DbConnection::GetQueryCount(RingBuffer::SizeType span)
@@ -543,6 +549,12 @@ int DbConnection::GetQueryCount(RingBuffer::SizeType span)
 	return m_QueryStats.UpdateAndGetValues(Utility::GetTime(), span);
 }
 
+int DbConnection::GetRowCount(RingBuffer::SizeType span)
+{
+	std::unique_lock<std::mutex> lock(m_StatsMutex);
+	return m_RowStats.UpdateAndGetValues(Utility::GetTime(), span);
+}
+
 bool DbConnection::IsIDCacheValid() const
 {
 	return m_IDCacheValid;
@@ -558,6 +570,146 @@ int DbConnection::GetSessionToken()
 	return Application::GetStartTime();
 }
 
+/**
+ * Checks whether an INSERT may be delayed until the end of the transaction
+ * and sent together with others, i.e. nobody waits for its result.
+ */
+bool DbConnection::IsBatchableInsert(const DbQuery& query)
+{
+	return query.Type == DbQueryInsert && query.Category != DbCatConfig && !query.ConfigUpdate
+		&& !query.StatusUpdate && !query.NotificationInsertID && query.Fields;
+}
+
+/**
+ * Returns the number of queries which were merged into a pending query for the same row.
+ */
+uint_fast64_t DbConnection::GetCoalescedQueryCount() const
+{
+	return m_CoalescedQueries.load();
+}
+
+/**
+ * Builds the key which identifies the row a status query updates.
+ *
+ * @returns An empty string if the query must not be merged with others.
+ */
+static String GetCoalescingKey(const DbQuery& query)
+{
+	if (!(query.Category & (DbCatState | DbCatProgramStatus)))
+		return String();
+
+	/* Inserts and deletes don't target a single existing row. */
+	if (!(query.Type == DbQueryUpdate || query.Type == (DbQueryInsert | DbQueryUpdate)))
+		return String();
+
+	if (!query.Fields || !query.WhereCriteria || query.NotificationInsertID)
+		return String();
+
+	std::ostringstream key;
+
+	ObjectLock olock(query.WhereCriteria);
+
+	for (const Dictionary::Pair& kv : query.WhereCriteria) {
+		key << kv.first << '=';
+
+		if (kv.second.IsObject())
+			key << static_cast<Object::Ptr>(kv.second).get();
+		else
+			key << kv.second;
+
+		key << '\0';
+	}
+
+	return key.str();
+}
+
+/**
+ * Merges a status query into a still pending query for the same row, so
+ * that a backlog holds at most one update per row and the newest fields win.
+ *
+ * @param query The new query.
+ * @param pending Set to the query the caller has to enqueue and later pass
+ *                to TakeCoalescedQuery(), or nullptr if the query can't be
+ *                merged and has to be enqueued as it is.
+ * @returns true if the query was merged and must not be enqueued.
+ */
+bool DbConnection::CoalesceQuery(const DbQuery& query, std::shared_ptr<DbQuery>& pending)
+{
+	pending = nullptr;
+
+	String key = GetCoalescingKey(query);
+
+	if (key.IsEmpty()) {
+		/* Later queries for this table must not overtake this one. */
+		if (!query.Table.IsEmpty())
+			SealCoalescedQueries(query.Table);
+
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock (m_CoalescingMutex);
+
+	auto& slot (m_CoalescingQueries[std::make_pair(query.Table, key)]);
+
+	if (!slot) {
+		slot = std::make_shared<DbQuery>(query);
+		pending = slot;
+		return false;
+	}
+
+	Dictionary::Ptr fields = slot->Fields->ShallowClone();
+	query.Fields->CopyTo(fields);
+
+	slot->Fields = fields;
+	slot->Type |= query.Type;
+	slot->StatusUpdate = slot->StatusUpdate || query.StatusUpdate;
+
+	if (!slot->Object)
+		slot->Object = query.Object;
+
+	m_CoalescedQueries++;
+
+	return true;
+}
+
+/**
+ * Stops merging queries into the currently pending ones.
+ *
+ * @param table Only affect queries for this table, all queries if empty.
+ */
+void DbConnection::SealCoalescedQueries(const String& table)
+{
+	std::unique_lock<std::mutex> lock (m_CoalescingMutex);
+
+	if (table.IsEmpty()) {
+		m_CoalescingQueries.clear();
+		return;
+	}
+
+	auto begin (m_CoalescingQueries.lower_bound(std::make_pair(table, String())));
+	auto end (begin);
+
+	while (end != m_CoalescingQueries.end() && end->first.first == table)
+		++end;
+
+	m_CoalescingQueries.erase(begin, end);
+}
+
+/**
+ * Returns the final version of a pending query right before it's executed.
+ */
+DbQuery DbConnection::TakeCoalescedQuery(const std::shared_ptr<DbQuery>& pending)
+{
+	std::unique_lock<std::mutex> lock (m_CoalescingMutex);
+
+	auto it (m_CoalescingQueries.find(std::make_pair(pending->Table, GetCoalescingKey(*pending))));
+
+	if (it != m_CoalescingQueries.end() && it->second == pending)
+		m_CoalescingQueries.erase(it);
+
+	return *pending;
+}
+
 void DbConnection::IncreasePendingQueries(int count)
 {
 	m_PendingQueries.fetch_add(count);
@@ -10,11 +10,24 @@
 #include "base/timer.hpp"
 #include "base/ringbuffer.hpp"
 #include <boost/thread/once.hpp>
+#include <memory>
 #include <mutex>
 
 namespace icinga
 {
 
+/**
+ * Rows of INSERTs into one table which are sent as a single multi-row statement.
+ *
+ * @ingroup db_ido
+ */
+struct DbInsertBatch
+{
+	String Columns;
+	std::vector<String> Rows;
+	size_t Size{0};
+};
+
 /**
  * A database connection.
  *
@@ -55,8 +68,11 @@ public:
 	bool GetStatusUpdate(const DbObject::Ptr& dbobj) const;
 
 	int GetQueryCount(RingBuffer::SizeType span);
+	int GetRowCount(RingBuffer::SizeType span);
 	virtual int GetPendingQueryCount() const = 0;
 
+	uint_fast64_t GetCoalescedQueryCount() const;
+
 	void ValidateFailoverTimeout(const Lazy<double>& lvalue, const ValidationUtils& utils) final;
 	void ValidateCategories(const Lazy<Array::Ptr>& lvalue, const ValidationUtils& utils) final;
 
@@ -82,7 +98,7 @@ protected:
 
 	void PrepareDatabase();
 
-	void IncreaseQueryCount();
+	void IncreaseQueryCount(int rows = 1);
 
 	bool IsIDCacheValid() const;
 	void SetIDCacheValid(bool valid);
@@ -96,6 +112,12 @@ protected:
 	void IncreasePendingQueries(int count);
 	void DecreasePendingQueries(int count);
 
+	static bool IsBatchableInsert(const DbQuery& query);
+
+	bool CoalesceQuery(const DbQuery& query, std::shared_ptr<DbQuery>& pending);
+	void SealCoalescedQueries(const String& table = String());
+	DbQuery TakeCoalescedQuery(const std::shared_ptr<DbQuery>& pending);
+
 	WorkQueue m_QueryQueue{10000000, 1, LogNotice};
 
 private:
@@ -121,11 +143,16 @@ private:
 
 	mutable std::mutex m_StatsMutex;
 	RingBuffer m_QueryStats{15 * 60};
+	RingBuffer m_RowStats{15 * 60};
 	bool m_ActiveChangedHandler{false};
 
 	RingBuffer m_InputQueries{10};
 	RingBuffer m_OutputQueries{10};
 	Atomic<uint_fast64_t> m_PendingQueries{0};
+
+	std::mutex m_CoalescingMutex;
+	std::map<std::pair<String, String>, std::shared_ptr<DbQuery>> m_CoalescingQueries;
+	Atomic<uint_fast64_t> m_CoalescedQueries{0};
 };
 
 struct database_error : virtual std::exception, virtual boost::exception { };
@@ -44,6 +44,24 @@ void IdoMysqlConnection::OnConfigLoaded()
 	m_Mysql.reset(create_mysql_shim());
 
 	std::swap(m_Library, shimLibrary);
+
+	for (int i = 1; i < GetWriterSessions(); i++) {
+		std::unique_ptr<IdoMysqlWriter> writer (new IdoMysqlWriter());
+		IdoMysqlWriter *w = writer.get();
+
+		w->Queue.SetName("IdoMysqlConnection, " + GetName() + ", writer " + Convert::ToString(i));
+		w->Queue.SetExceptionCallback([this, w](boost::exception_ptr exp) { WriterExceptionHandler(*w, std::move(exp)); });
+
+		m_Writers.emplace_back(std::move(writer));
+	}
+}
+
+void IdoMysqlConnection::ValidateWriterSessions(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<IdoMysqlConnection>::ValidateWriterSessions(lvalue, utils);
+
+	if (lvalue() < 1)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "writer_sessions" }, "At least one writer session is required."));
 }
 
 void IdoMysqlConnection::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
@@ -53,13 +71,20 @@ void IdoMysqlConnection::StatsFunc(const Dictionary::Ptr& status, const Array::P
 	for (const IdoMysqlConnection::Ptr& idomysqlconnection : ConfigType::GetObjectsByType<IdoMysqlConnection>()) {
 		size_t queryQueueItems = idomysqlconnection->m_QueryQueue.GetLength();
 		double queryQueueItemRate = idomysqlconnection->m_QueryQueue.GetTaskCount(60) / 60.0;
+		uint_fast64_t coalescedQueries = idomysqlconnection->GetCoalescedQueryCount();
+		int statements = idomysqlconnection->GetQueryCount(60);
+		double statementRate = statements / 60.0;
+		double rowsPerStatement = statements > 0 ? idomysqlconnection->GetRowCount(60) / static_cast<double>(statements) : 0;
 
 		nodes.emplace_back(idomysqlconnection->GetName(), new Dictionary({
 			{ "version", idomysqlconnection->GetSchemaVersion() },
 			{ "instance_name", idomysqlconnection->GetInstanceName() },
 			{ "connected", idomysqlconnection->GetConnected() },
 			{ "query_queue_items", queryQueueItems },
-			{ "query_queue_item_rate", queryQueueItemRate }
+			{ "query_queue_item_rate", queryQueueItemRate },
+			{ "query_queue_coalesced", coalescedQueries },
+			{ "statements_rate", statementRate },
+			{ "rows_per_statement", rowsPerStatement }
 		}));
 
 		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_queries_rate", idomysqlconnection->GetQueryCount(60) / 60.0));
@@ -68,6 +93,9 @@ void IdoMysqlConnection::StatsFunc(const Dictionary::Ptr& status, const Array::P
 		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_queries_15mins", idomysqlconnection->GetQueryCount(15 * 60)));
 		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_query_queue_items", queryQueueItems));
 		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_query_queue_item_rate", queryQueueItemRate));
+		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_query_queue_coalesced", coalescedQueries, true));
+		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_statements_rate", statementRate));
+		perfdata->Add(new PerfdataValue("idomysqlconnection_" + idomysqlconnection->GetName() + "_rows_per_statement", rowsPerStatement));
 	}
 
 	status->Set("idomysqlconnection", new Dictionary(std::move(nodes)));
@@ -151,6 +179,8 @@ void IdoMysqlConnection::Disconnect()
 
 	SetConnected(false);
 
+	CloseWriters();
+
 	Log(LogInformation, "IdoMysqlConnection")
 		<< "Disconnected from '" << GetName() << "' database '" << GetDatabase() << "'.";
 }
@@ -166,6 +196,18 @@ void IdoMysqlConnection::NewTransaction()
 #endif /* I2_DEBUG */
 
 	m_QueryQueue.Enqueue([this]() { InternalNewTransaction(); }, PriorityHigh);
+
+	/* The writer sessions commit on their own, the primary session might be waiting for their locks. */
+	uint_fast64_t generation = m_WriterGeneration.load();
+
+	for (auto& writer : m_Writers) {
+		IdoMysqlWriter *w = writer.get();
+
+		w->Queue.Enqueue([this, w, generation]() {
+			if (generation == w->Generation)
+				CommitWriter(*w);
+		}, PriorityHigh);
+	}
 }
 
 void IdoMysqlConnection::InternalNewTransaction()
@@ -175,6 +217,8 @@ void IdoMysqlConnection::InternalNewTransaction()
 	if (!GetConnected())
 		return;
 
+	FlushInsertBatches();
+
 	IncreasePendingQueries(2);
 
 	AsyncQuery("COMMIT");
@@ -194,37 +238,11 @@ void IdoMysqlConnection::ReconnectTimerHandler()
 	m_QueryQueue.Enqueue([this]() { Reconnect(); }, PriorityImmediate);
 }
 
-void IdoMysqlConnection::Reconnect()
+/**
+ * Opens a session with the configured connection settings.
+ */
+void IdoMysqlConnection::OpenConnection(MYSQL *connection)
 {
-	AssertOnWorkQueue();
-
-	if (!IsActive())
-		return;
-
-	CONTEXT("Reconnecting to MySQL IDO database '" + GetName() + "'");
-
-	double startTime = Utility::GetTime();
-
-	SetShouldConnect(true);
-
-	bool reconnect = false;
-
-	/* Ensure to close old connections first. */
-	if (GetConnected()) {
-		/* Check if we're really still connected */
-		if (m_Mysql->ping(&m_Connection) == 0)
-			return;
-
-		m_Mysql->close(&m_Connection);
-		SetConnected(false);
-		reconnect = true;
-	}
-
-	Log(LogDebug, "IdoMysqlConnection")
-		<< "Reconnect: Clearing ID cache.";
-
-	ClearIDCache();
-
 	String ihost, isocket_path, iuser, ipasswd, idb;
 	String isslKey, isslCert, isslCa, isslCaPath, isslCipher;
 	const char *host, *socket_path, *user , *passwd, *db;
@@ -258,8 +276,7 @@ void IdoMysqlConnection::Reconnect()
 	sslCaPath = (!isslCaPath.IsEmpty()) ? isslCaPath.CStr() : nullptr;
 	sslCipher = (!isslCipher.IsEmpty()) ? isslCipher.CStr() : nullptr;
 
-	/* connection */
-	if (!m_Mysql->init(&m_Connection)) {
+	if (!m_Mysql->init(connection)) {
 		Log(LogCritical, "IdoMysqlConnection")
 			<< "mysql_init() failed: out of memory";
 
@@ -267,15 +284,53 @@ void IdoMysqlConnection::Reconnect()
 	}
 
 	if (enableSsl)
-		m_Mysql->ssl_set(&m_Connection, sslKey, sslCert, sslCa, sslCaPath, sslCipher);
+		m_Mysql->ssl_set(connection, sslKey, sslCert, sslCa, sslCaPath, sslCipher);
 
-	if (!m_Mysql->real_connect(&m_Connection, host, user, passwd, db, port, socket_path, CLIENT_FOUND_ROWS | CLIENT_MULTI_STATEMENTS)) {
+	if (!m_Mysql->real_connect(connection, host, user, passwd, db, port, socket_path, CLIENT_FOUND_ROWS | CLIENT_MULTI_STATEMENTS)) {
 		Log(LogCritical, "IdoMysqlConnection")
 			<< "Connection to database '" << db << "' with user '" << user << "' on '" << host << ":" << port
-			<< "' " << (enableSsl ? "(SSL enabled) " : "") << "failed: \"" << m_Mysql->error(&m_Connection) << "\"";
+			<< "' " << (enableSsl ? "(SSL enabled) " : "") << "failed: \"" << m_Mysql->error(connection) << "\"";
 
-		BOOST_THROW_EXCEPTION(std::runtime_error(m_Mysql->error(&m_Connection)));
+		BOOST_THROW_EXCEPTION(std::runtime_error(m_Mysql->error(connection)));
 	}
+}
+
+void IdoMysqlConnection::Reconnect()
+{
+	AssertOnWorkQueue();
+
+	if (!IsActive())
+		return;
+
+	CONTEXT("Reconnecting to MySQL IDO database '" + GetName() + "'");
+
+	double startTime = Utility::GetTime();
+
+	SetShouldConnect(true);
+
+	bool reconnect = false;
+
+	/* Ensure to close old connections first. */
+	if (GetConnected()) {
+		/* Check if we're really still connected */
+		if (m_Mysql->ping(&m_Connection) == 0)
+			return;
+
+		m_Mysql->close(&m_Connection);
+		SetConnected(false);
+		reconnect = true;
+	}
+
+	/* Whatever is queued now won't make it into the new session. */
+	SealCoalescedQueries();
+	ResetWriters();
+
+	Log(LogDebug, "IdoMysqlConnection")
+		<< "Reconnect: Clearing ID cache.";
+
+	ClearIDCache();
+
+	OpenConnection(&m_Connection);
 
 	Log(LogNotice, "IdoMysqlConnection")
 		<< "Reconnect: '" << GetName() << "' is now connected to database '" << GetDatabase() << "'.";
@@ -425,6 +480,12 @@ void IdoMysqlConnection::Reconnect()
 	/* clear config tables for the initial config dump */
 	PrepareDatabase();
 
+	/* The writer sessions would otherwise wait for the locks of the cleanup. */
+	if (!m_Writers.empty()) {
+		Query("COMMIT");
+		Query("BEGIN");
+	}
+
 	std::ostringstream q1buf;
 	q1buf << "SELECT object_id, objecttype_id, name1, name2, is_active FROM " + GetTablePrefix() + "objects WHERE instance_id = " << static_cast<long>(m_InstanceID);
 	result = Query(q1buf.str());
@@ -503,7 +564,7 @@ void IdoMysqlConnection::ClearTableBySession(const String& table)
 		Convert::ToString(GetSessionToken()));
 }
 
-void IdoMysqlConnection::AsyncQuery(const String& query, const std::function<void (const IdoMysqlResult&)>& callback)
+void IdoMysqlConnection::AsyncQuery(const String& query, const std::function<void (const IdoMysqlResult&)>& callback, int rows)
 {
 	AssertOnWorkQueue();
 
@@ -513,14 +574,282 @@ void IdoMysqlConnection::AsyncQuery(const String& query, const std::function<voi
 	 * See https://github.com/Icinga/icinga2/issues/4603 for details.
 	 */
 	aq.Callback = callback;
+	aq.Rows = rows;
 	m_AsyncQueries.emplace_back(std::move(aq));
 }
 
+/**
+ * Adds a row to the multi-row INSERT for the table, sending the pending
+ * rows first if the columns differ or the statement would grow too large.
+ */
+void IdoMysqlConnection::AddInsertBatchRow(const String& table, const String& columns, const String& values)
+{
+	DbInsertBatch& batch = m_InsertBatches[table];
+
+	if (!batch.Rows.empty() && (batch.Columns != columns || batch.Rows.size() >= 1000
+		|| batch.Size + values.GetLength() + 3 > m_MaxPacketSize - 1024)) {
+		FlushInsertBatch(table);
+	}
+
+	if (batch.Rows.empty()) {
+		batch.Columns = columns;
+		batch.Size = GetTablePrefix().GetLength() + table.GetLength() + columns.GetLength() + 32;
+	}
+
+	batch.Size += values.GetLength() + 3;
+	batch.Rows.emplace_back(values);
+}
+
+/**
+ * Queues the pending rows for the table as a single INSERT statement.
+ */
+void IdoMysqlConnection::FlushInsertBatch(const String& table)
+{
+	auto it (m_InsertBatches.find(table));
+
+	if (it == m_InsertBatches.end() || it->second.Rows.empty())
+		return;
+
+	DbInsertBatch& batch = it->second;
+
+	std::ostringstream qbuf;
+	qbuf << "INSERT INTO " << GetTablePrefix() << table << " (" << batch.Columns << ") VALUES ";
+
+	bool first = true;
+
+	for (const String& row : batch.Rows) {
+		if (!first)
+			qbuf << ", ";
+
+		qbuf << "(" << row << ")";
+		first = false;
+	}
+
+	int rows = batch.Rows.size();
+
+	/* Every row was counted as a pending query, the statement stands in for all of them. */
+	DecreasePendingQueries(rows - 1);
+
+	AsyncQuery(qbuf.str(), IdoAsyncCallback(), rows);
+
+	batch.Rows.clear();
+	batch.Size = 0;
+}
+
+void IdoMysqlConnection::FlushInsertBatches()
+{
+	for (auto& kv : m_InsertBatches)
+		FlushInsertBatch(kv.first);
+}
+
+/**
+ * Returns the writer session which executes the statements for the object
+ * or nullptr if the primary session is responsible for them. All objects
+ * of a host share a session, so their statements keep their order.
+ */
+IdoMysqlWriter *IdoMysqlConnection::GetWriter(const DbObject::Ptr& object) const
+{
+	if (m_Writers.empty() || !object)
+		return nullptr;
+
+	size_t index = std::hash<std::string>()(object->GetName1().GetData()) % (m_Writers.size() + 1);
+
+	if (index == 0)
+		return nullptr;
+
+	return m_Writers[index - 1].get();
+}
+
+void IdoMysqlConnection::WriterQuery(IdoMysqlWriter *writer, const String& query, const IdoAsyncCallback& callback)
+{
+	if (!writer) {
+		AsyncQuery(query, callback);
+		return;
+	}
+
+	IdoAsyncQuery aq;
+	aq.Query = query;
+	aq.Callback = callback;
+	writer->Queries.emplace_back(std::move(aq));
+
+	if (writer->Queries.size() >= 1000)
+		FlushWriterQueries(*writer);
+}
+
+/**
+ * Hands the rendered statements over to the writer session.
+ */
+void IdoMysqlConnection::FlushWriterQueries(IdoMysqlWriter& writer)
+{
+	if (writer.Queries.empty())
+		return;
+
+	auto queries (std::make_shared<std::vector<IdoAsyncQuery>>());
+	queries->swap(writer.Queries);
+
+	IdoMysqlWriter *w = &writer;
+	uint_fast64_t generation = m_WriterGeneration.load();
+	unsigned int maxPacketSize = m_MaxPacketSize;
+
+	w->Queue.Enqueue([this, w, generation, maxPacketSize, queries]() {
+		ExecuteWriterQueries(*w, generation, maxPacketSize, *queries);
+	});
+}
+
+void IdoMysqlConnection::FlushWriterQueries()
+{
+	for (auto& writer : m_Writers)
+		FlushWriterQueries(*writer);
+}
+
+/**
+ * Invalidates everything the writer sessions haven't done yet, they
+ * reconnect with the next statements they are handed.
+ */
+void IdoMysqlConnection::ResetWriters()
+{
+	m_WriterGeneration.fetch_add(1);
+
+	for (auto& writer : m_Writers) {
+		DecreasePendingQueries(writer->Queries.size());
+		writer->Queries.clear();
+	}
+}
+
+/**
+ * Commits and closes the writer sessions once they've finished their statements.
+ */
+void IdoMysqlConnection::CloseWriters()
+{
+	uint_fast64_t generation = m_WriterGeneration.load();
+
+	for (auto& writer : m_Writers) {
+		IdoMysqlWriter *w = writer.get();
+
+		w->Queue.Enqueue([this, w, generation]() {
+			if (generation == w->Generation)
+				CommitWriter(*w);
+
+			CloseWriter(*w);
+		}, PriorityLow);
+
+		w->Queue.Join();
+	}
+}
+
+void IdoMysqlConnection::OpenWriter(IdoMysqlWriter& writer)
+{
+	OpenConnection(&writer.Connection);
+
+	writer.Connected = true;
+	writer.UncommittedQueries = 0;
+
+	std::vector<IdoAsyncQuery> queries;
+
+	for (const char *query : { "SET SESSION TIME_ZONE='+00:00'", "SET SESSION SQL_MODE='NO_AUTO_VALUE_ON_ZERO'", "BEGIN" }) {
+		IdoAsyncQuery aq;
+		aq.Query = query;
+		queries.emplace_back(std::move(aq));
+	}
+
+	IncreasePendingQueries(queries.size());
+	ExecuteAsyncQueries(&writer.Connection, writer.AffectedRows, writer.UncommittedQueries, writer.MaxPacketSize, queries);
+
+	Log(LogNotice, "IdoMysqlConnection")
+		<< "Writer session '" << writer.Queue.GetName() << "' is now connected to database '" << GetDatabase() << "'.";
+}
+
+void IdoMysqlConnection::CloseWriter(IdoMysqlWriter& writer)
+{
+	if (!writer.Connected)
+		return;
+
+	m_Mysql->close(&writer.Connection);
+	writer.Connected = false;
+}
+
+void IdoMysqlConnection::CommitWriter(IdoMysqlWriter& writer)
+{
+	if (!writer.Connected || writer.UncommittedQueries == 0)
+		return;
+
+	std::vector<IdoAsyncQuery> queries;
+
+	for (const char *query : { "COMMIT", "BEGIN" }) {
+		IdoAsyncQuery aq;
+		aq.Query = query;
+		queries.emplace_back(std::move(aq));
+	}
+
+	IncreasePendingQueries(queries.size());
+	ExecuteAsyncQueries(&writer.Connection, writer.AffectedRows, writer.UncommittedQueries, writer.MaxPacketSize, queries);
+
+	writer.UncommittedQueries = 0;
+}
+
+void IdoMysqlConnection::ExecuteWriterQueries(IdoMysqlWriter& writer, uint_fast64_t generation, unsigned int maxPacketSize,
+	std::vector<IdoAsyncQuery>& queries)
+{
+	/* The primary session has reconnected since, these would use stale IDs. */
+	if (generation < writer.Generation) {
+		DecreasePendingQueries(queries.size());
+		return;
+	}
+
+	if (generation != writer.Generation) {
+		CloseWriter(writer);
+		writer.Generation = generation;
+	}
+
+	writer.MaxPacketSize = maxPacketSize;
+
+	if (!writer.Connected) {
+		try {
+			OpenWriter(writer);
+		} catch (...) {
+			DecreasePendingQueries(queries.size());
+			throw;
+		}
+	}
+
+	ExecuteAsyncQueries(&writer.Connection, writer.AffectedRows, writer.UncommittedQueries, writer.MaxPacketSize, queries);
+
+	if (writer.UncommittedQueries > 25000)
+		CommitWriter(writer);
+}
+
+void IdoMysqlConnection::WriterExceptionHandler(IdoMysqlWriter& writer, boost::exception_ptr exp)
+{
+	CloseWriter(writer);
+
+	/* The primary session waits for IDs which won't arrive anymore, start over. */
+	m_QueryQueue.Enqueue([this, exp]() { ExceptionHandler(exp); }, PriorityImmediate);
+}
+
 void IdoMysqlConnection::FinishAsyncQueries()
 {
+	FlushInsertBatches();
+	FlushWriterQueries();
+
 	std::vector<IdoAsyncQuery> queries;
 	m_AsyncQueries.swap(queries);
 
+	ExecuteAsyncQueries(&m_Connection, m_AffectedRows, m_UncommittedAsyncQueries, m_MaxPacketSize, queries);
+
+	if (m_UncommittedAsyncQueries > 25000) {
+		m_UncommittedAsyncQueries = 0;
+
+		Query("COMMIT");
+		Query("BEGIN");
+	}
+}
+
+/**
+ * Sends the statements to the session as multi-statements and runs their callbacks.
+ */
+void IdoMysqlConnection::ExecuteAsyncQueries(MYSQL *connection, int& affectedRows, uint_fast32_t& uncommittedQueries,
+	unsigned int maxPacketSize, std::vector<IdoAsyncQuery>& queries)
+{
 	std::vector<IdoAsyncQuery>::size_type offset = 0;
 
 	// This will be executed if there is a problem with executing the queries,
@@ -540,10 +869,10 @@ void IdoMysqlConnection::FinishAsyncQueries()
 		std::vector<IdoAsyncQuery>::size_type count = 0;
 		size_t num_bytes = 0;
 
-		Defer decreaseQueries ([this, &offset, &count]() {
+		Defer decreaseQueries ([this, &offset, &count, &uncommittedQueries]() {
 			offset += count;
 			DecreasePendingQueries(count);
-			m_UncommittedAsyncQueries += count;
+			uncommittedQueries += count;
 		});
 
 		for (std::vector<IdoAsyncQuery>::size_type i = offset; i < queries.size(); i++) {
@@ -552,13 +881,13 @@ void IdoMysqlConnection::FinishAsyncQueries()
 			size_t size_query = aq.Query.GetLength() + 1;
 
 			if (count > 0) {
-				if (num_bytes + size_query > m_MaxPacketSize - 512)
+				if (num_bytes + size_query > maxPacketSize - 512)
 					break;
 
 				querybuf << ";";
 			}
 
-			IncreaseQueryCount();
+			IncreaseQueryCount(aq.Rows);
 			count++;
 
 			Log(LogDebug, "IdoMysqlConnection")
@@ -570,15 +899,15 @@ void IdoMysqlConnection::FinishAsyncQueries()
 
 		String query = querybuf.str();
 
-		if (m_Mysql->query(&m_Connection, query.CStr()) != 0) {
+		if (m_Mysql->query(connection, query.CStr()) != 0) {
 			std::ostringstream msgbuf;
-			String message = m_Mysql->error(&m_Connection);
+			String message = m_Mysql->error(connection);
 			msgbuf << "Error \"" << message << "\" when executing query \"" << query << "\"";
 			Log(LogCritical, "IdoMysqlConnection", msgbuf.str());
 
 			BOOST_THROW_EXCEPTION(
 				database_error()
-				<< errinfo_message(m_Mysql->error(&m_Connection))
+				<< errinfo_message(m_Mysql->error(connection))
 				<< errinfo_database_query(query)
 			);
 		}
@@ -586,22 +915,22 @@ void IdoMysqlConnection::FinishAsyncQueries()
 		for (std::vector<IdoAsyncQuery>::size_type i = offset; i < offset + count; i++) {
 			const IdoAsyncQuery& aq = queries[i];
 
-			MYSQL_RES *result = m_Mysql->store_result(&m_Connection);
+			MYSQL_RES *result = m_Mysql->store_result(connection);
 
-			m_AffectedRows = m_Mysql->affected_rows(&m_Connection);
+			affectedRows = m_Mysql->affected_rows(connection);
 
 			IdoMysqlResult iresult;
 
 			if (!result) {
-				if (m_Mysql->field_count(&m_Connection) > 0) {
+				if (m_Mysql->field_count(connection) > 0) {
 					std::ostringstream msgbuf;
-					String message = m_Mysql->error(&m_Connection);
+					String message = m_Mysql->error(connection);
 					msgbuf << "Error \"" << message << "\" when executing query \"" << aq.Query << "\"";
 					Log(LogCritical, "IdoMysqlConnection", msgbuf.str());
 
 					BOOST_THROW_EXCEPTION(
 						database_error()
-						<< errinfo_message(m_Mysql->error(&m_Connection))
+						<< errinfo_message(m_Mysql->error(connection))
 						<< errinfo_database_query(query)
 					);
 				}
@@ -611,27 +940,20 @@ void IdoMysqlConnection::FinishAsyncQueries()
 			if (aq.Callback)
 				aq.Callback(iresult);
 
-			if (m_Mysql->next_result(&m_Connection) > 0) {
+			if (m_Mysql->next_result(connection) > 0) {
 				std::ostringstream msgbuf;
-				String message = m_Mysql->error(&m_Connection);
+				String message = m_Mysql->error(connection);
 				msgbuf << "Error \"" << message << "\" when executing query \"" << query << "\"";
 				Log(LogCritical, "IdoMysqlConnection", msgbuf.str());
 
 				BOOST_THROW_EXCEPTION(
 					database_error()
-					<< errinfo_message(m_Mysql->error(&m_Connection))
+					<< errinfo_message(m_Mysql->error(connection))
 					<< errinfo_database_query(query)
 				);
 			}
 		}
 	}
-
-	if (m_UncommittedAsyncQueries > 25000) {
-		m_UncommittedAsyncQueries = 0;
-
-		Query("COMMIT");
-		Query("BEGIN");
-	}
 }
 
 IdoMysqlResult IdoMysqlConnection::Query(const String& query)
@@ -923,8 +1245,17 @@ void IdoMysqlConnection::ExecuteQuery(const DbQuery& query)
 		<< "Scheduling execute query task, type " << query.Type << ", table '" << query.Table << "'.";
 #endif /* I2_DEBUG */
 
+	std::shared_ptr<DbQuery> pending;
+
+	if (CoalesceQuery(query, pending))
+		return;
+
 	IncreasePendingQueries(1);
-	m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority, true);
+
+	if (pending)
+		m_QueryQueue.Enqueue([this, pending]() { InternalExecuteQuery(TakeCoalescedQuery(pending), -1); }, query.Priority, true);
+	else
+		m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority, true);
 }
 
 void IdoMysqlConnection::ExecuteMultipleQueries(const std::vector<DbQuery>& queries)
@@ -940,6 +1271,11 @@ void IdoMysqlConnection::ExecuteMultipleQueries(const std::vector<DbQuery>& quer
 		<< "Scheduling multiple execute query task, type " << queries[0].Type << ", table '" << queries[0].Table << "'.";
 #endif /* I2_DEBUG */
 
+	for (const DbQuery& query : queries) {
+		if (!query.Table.IsEmpty())
+			SealCoalescedQueries(query.Table);
+	}
+
 	IncreasePendingQueries(queries.size());
 	m_QueryQueue.Enqueue([this, queries]() { InternalExecuteMultipleQueries(queries); }, queries[0].Priority, true);
 }
@@ -1004,12 +1340,25 @@ void IdoMysqlConnection::InternalExecuteMultipleQueries(const std::vector<DbQuer
 		}
 	}
 
+	/* The statements of a group depend on each other, so they all go to the same session. */
+	DbObject::Ptr routeObject;
+
+	for (const DbQuery& query : queries) {
+		if (query.Object) {
+			routeObject = query.Object;
+			break;
+		}
+	}
+
 	for (const DbQuery& query : queries) {
-		InternalExecuteQuery(query);
+		InternalExecuteQuery(query, -1, routeObject);
 	}
 }
 
-void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOverride)
+/**
+ * @param routeObject The object which decides about the writer session, the query's own object if empty.
+ */
+void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOverride, const DbObject::Ptr& routeObject)
 {
 	AssertOnWorkQueue();
 
@@ -1049,7 +1398,7 @@ void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 			<< typeOverride << "', table '" << query.Table << "', queue size: '" << GetPendingQueryCount() << "'.";
 #endif /* I2_DEBUG */
 
-		m_QueryQueue.Enqueue([this, query, typeOverride]() { InternalExecuteQuery(query, typeOverride); }, query.Priority);
+		m_QueryQueue.Enqueue([this, query, typeOverride, routeObject]() { InternalExecuteQuery(query, typeOverride, routeObject); }, query.Priority);
 		return;
 	}
 
@@ -1072,7 +1421,7 @@ void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 					<< typeOverride << "', table '" << query.Table << "', queue size: '" << GetPendingQueryCount() << "'.";
 #endif /* I2_DEBUG */
 
-				m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority);
+				m_QueryQueue.Enqueue([this, query, routeObject]() { InternalExecuteQuery(query, -1, routeObject); }, query.Priority);
 				return;
 			}
 
@@ -1106,11 +1455,19 @@ void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 		type = DbQueryUpdate;
 	}
 
+	/* Grouped statements aren't batched, the rows would end up on another session than the rest of the group. */
+	bool batch = typeOverride == -1 && !routeObject && IsBatchableInsert(query);
+	IdoMysqlWriter *writer = batch ? nullptr : GetWriter(routeObject ? routeObject : query.Object);
+
+	/* Statements for a table must not overtake the rows batched for it. */
+	if (!batch)
+		FlushInsertBatch(query.Table);
+
 	if ((type & DbQueryInsert) && (type & DbQueryDelete)) {
 		std::ostringstream qdel;
 		qdel << "DELETE FROM " << GetTablePrefix() << query.Table << where.str();
 		IncreasePendingQueries(1);
-		AsyncQuery(qdel.str());
+		WriterQuery(writer, qdel.str());
 
 		type = DbQueryInsert;
 	}
@@ -1149,7 +1506,7 @@ void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 					<< kv.first << "', val '" << kv.second << "', type " << typeOverride << ", table '" << query.Table << "'.";
 #endif /* I2_DEBUG */
 
-				m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority);
+				m_QueryQueue.Enqueue([this, query, routeObject]() { InternalExecuteQuery(query, -1, routeObject); }, query.Priority);
 				return;
 			}
 
@@ -1172,6 +1529,11 @@ void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 				first = false;
 		}
 
+		if (batch) {
+			AddInsertBatchRow(query.Table, colbuf.str(), valbuf.str());
+			return;
+		}
+
 		if (type == DbQueryInsert)
 			qbuf << " (" << colbuf.str() << ") VALUES (" << valbuf.str() << ")";
 	}
@@ -1179,12 +1541,32 @@ void IdoMysqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 	if (type != DbQueryInsert)
 		qbuf << where.str();
 
-	AsyncQuery(qbuf.str(), [this, query, type, upsert](const IdoMysqlResult&) { FinishExecuteQuery(query, type, upsert); });
+	if (!writer) {
+		AsyncQuery(qbuf.str(), [this, query, type, upsert, routeObject](const IdoMysqlResult&) {
+			FinishExecuteQuery(query, type, upsert, GetAffectedRows(), GetLastInsertID(), routeObject);
+		});
+
+		return;
+	}
+
+	uint_fast64_t generation = m_WriterGeneration.load();
+
+	/* The ID caches belong to the primary session, the writer only reports the results back. */
+	WriterQuery(writer, qbuf.str(), [this, query, type, upsert, routeObject, writer, generation](const IdoMysqlResult&) {
+		int affectedRows = writer->AffectedRows;
+		DbReference insertId (static_cast<long>(m_Mysql->insert_id(&writer->Connection)));
+
+		m_QueryQueue.Enqueue([this, query, type, upsert, routeObject, generation, affectedRows, insertId]() {
+			if (generation == m_WriterGeneration.load())
+				FinishExecuteQuery(query, type, upsert, affectedRows, insertId, routeObject);
+		}, query.Priority);
+	});
 }
 
-void IdoMysqlConnection::FinishExecuteQuery(const DbQuery& query, int type, bool upsert)
+void IdoMysqlConnection::FinishExecuteQuery(const DbQuery& query, int type, bool upsert, int affectedRows,
+	const DbReference& insertId, const DbObject::Ptr& routeObject)
 {
-	if (upsert && GetAffectedRows() == 0) {
+	if (upsert && affectedRows == 0) {
 
 #ifdef I2_DEBUG /* I2_DEBUG */
 		Log(LogDebug, "IdoMysqlConnection")
@@ -1192,21 +1574,21 @@ void IdoMysqlConnection::FinishExecuteQuery(const DbQuery& query, int type, bool
 #endif /* I2_DEBUG */
 
 		IncreasePendingQueries(1);
-		m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, DbQueryDelete | DbQueryInsert); }, query.Priority);
+		m_QueryQueue.Enqueue([this, query, routeObject]() { InternalExecuteQuery(query, DbQueryDelete | DbQueryInsert, routeObject); }, query.Priority);
 
 		return;
 	}
 
 	if (type == DbQueryInsert && query.Object) {
 		if (query.ConfigUpdate) {
-			SetInsertID(query.Object, GetLastInsertID());
+			SetInsertID(query.Object, insertId);
 			SetConfigUpdate(query.Object, true);
 		} else if (query.StatusUpdate)
 			SetStatusUpdate(query.Object, true);
 	}
 
 	if (type == DbQueryInsert && query.Table == "notifications" && query.NotificationInsertID)
-		query.NotificationInsertID->SetValue(static_cast<long>(GetLastInsertID()));
+		query.NotificationInsertID->SetValue(static_cast<long>(insertId));
 }
 
 void IdoMysqlConnection::CleanUpExecuteQuery(const String& table, const String& time_column, double max_age)
@@ -1238,6 +1620,8 @@ void IdoMysqlConnection::InternalCleanUpExecuteQuery(const String& table, const
 		return;
 	}
 
+	FlushInsertBatch(table);
+
 	AsyncQuery("DELETE FROM " + GetTablePrefix() + table + " WHERE instance_id = " +
 		Convert::ToString(static_cast<long>(m_InstanceID)) + " AND " + time_column +
 		" < FROM_UNIXTIME(" + Convert::ToString(static_cast<long>(max_age)) + ")");
@@ -9,6 +9,7 @@
 #include "base/timer.hpp"
 #include "base/workqueue.hpp"
 #include "base/library.hpp"
+#include <atomic>
 #include <cstdint>
 
 namespace icinga
@@ -22,6 +23,28 @@ struct IdoAsyncQuery
 {
 	String Query;
 	IdoAsyncCallback Callback;
+	int Rows{1};
+};
+
+/**
+ * An additional session which executes the statements for a share of the
+ * objects on its own thread.
+ *
+ * @ingroup ido
+ */
+struct IdoMysqlWriter
+{
+	MYSQL Connection;
+	bool Connected{false};
+	uint_fast64_t Generation{0};
+	int AffectedRows{0};
+	unsigned int MaxPacketSize{64 * 1024};
+	uint_fast32_t UncommittedQueries{0};
+
+	/* Statements which have been rendered but not handed over yet, only used by the primary session. */
+	std::vector<IdoAsyncQuery> Queries;
+
+	WorkQueue Queue{10000000, 1, LogNotice};
 };
 
 /**
@@ -56,6 +79,8 @@ protected:
 	void NewTransaction() override;
 	void Disconnect() override;
 
+	void ValidateWriterSessions(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+
 private:
 	DbReference m_InstanceID;
 
@@ -69,6 +94,11 @@ private:
 	std::vector<IdoAsyncQuery> m_AsyncQueries;
 	uint_fast32_t m_UncommittedAsyncQueries = 0;
 
+	std::map<String, DbInsertBatch> m_InsertBatches;
+
+	std::vector<std::unique_ptr<IdoMysqlWriter>> m_Writers;
+	std::atomic<uint_fast64_t> m_WriterGeneration{0};
+
 	Timer::Ptr m_ReconnectTimer;
 	Timer::Ptr m_TxTimer;
 
@@ -79,13 +109,33 @@ private:
 	Dictionary::Ptr FetchRow(const IdoMysqlResult& result);
 	void DiscardRows(const IdoMysqlResult& result);
 
-	void AsyncQuery(const String& query, const IdoAsyncCallback& callback = IdoAsyncCallback());
+	void AsyncQuery(const String& query, const IdoAsyncCallback& callback = IdoAsyncCallback(), int rows = 1);
 	void FinishAsyncQueries();
+	void ExecuteAsyncQueries(MYSQL *connection, int& affectedRows, uint_fast32_t& uncommittedQueries,
+		unsigned int maxPacketSize, std::vector<IdoAsyncQuery>& queries);
+
+	void AddInsertBatchRow(const String& table, const String& columns, const String& values);
+	void FlushInsertBatch(const String& table);
+	void FlushInsertBatches();
+
+	IdoMysqlWriter *GetWriter(const DbObject::Ptr& object) const;
+	void WriterQuery(IdoMysqlWriter *writer, const String& query, const IdoAsyncCallback& callback = IdoAsyncCallback());
+	void FlushWriterQueries(IdoMysqlWriter& writer);
+	void FlushWriterQueries();
+	void ResetWriters();
+	void CloseWriters();
+	void OpenWriter(IdoMysqlWriter& writer);
+	void CloseWriter(IdoMysqlWriter& writer);
+	void CommitWriter(IdoMysqlWriter& writer);
+	void ExecuteWriterQueries(IdoMysqlWriter& writer, uint_fast64_t generation, unsigned int maxPacketSize,
+		std::vector<IdoAsyncQuery>& queries);
+	void WriterExceptionHandler(IdoMysqlWriter& writer, boost::exception_ptr exp);
 
 	bool FieldToEscapedString(const String& key, const Value& value, Value *result);
 	void InternalActivateObject(const DbObject::Ptr& dbobj);
 	void InternalDeactivateObject(const DbObject::Ptr& dbobj);
 
+	void OpenConnection(MYSQL *connection);
 	void Reconnect();
 
 	void AssertOnWorkQueue();
@@ -94,10 +144,11 @@ private:
 
 	bool CanExecuteQuery(const DbQuery& query);
 
-	void InternalExecuteQuery(const DbQuery& query, int typeOverride = -1);
+	void InternalExecuteQuery(const DbQuery& query, int typeOverride = -1, const DbObject::Ptr& routeObject = nullptr);
 	void InternalExecuteMultipleQueries(const std::vector<DbQuery>& queries);
 
-	void FinishExecuteQuery(const DbQuery& query, int type, bool upsert);
+	void FinishExecuteQuery(const DbQuery& query, int type, bool upsert, int affectedRows,
+		const DbReference& insertId, const DbObject::Ptr& routeObject);
 	void InternalCleanUpExecuteQuery(const String& table, const String& time_key, double time_value);
 	void InternalNewTransaction();
 
@@ -51,6 +51,24 @@ void IdoPgsqlConnection::OnConfigLoaded()
 	m_Pgsql.reset(create_pgsql_shim());
 
 	std::swap(m_Library, shimLibrary);
+
+	for (int i = 1; i < GetWriterSessions(); i++) {
+		std::unique_ptr<IdoPgsqlWriter> writer (new IdoPgsqlWriter());
+		IdoPgsqlWriter *w = writer.get();
+
+		w->Queue.SetName("IdoPgsqlConnection, " + GetName() + ", writer " + Convert::ToString(i));
+		w->Queue.SetExceptionCallback([this, w](boost::exception_ptr exp) { WriterExceptionHandler(*w, std::move(exp)); });
+
+		m_Writers.emplace_back(std::move(writer));
+	}
+}
+
+void IdoPgsqlConnection::ValidateWriterSessions(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<IdoPgsqlConnection>::ValidateWriterSessions(lvalue, utils);
+
+	if (lvalue() < 1)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "writer_sessions" }, "At least one writer session is required."));
 }
 
 void IdoPgsqlConnection::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
@@ -60,13 +78,20 @@ void IdoPgsqlConnection::StatsFunc(const Dictionary::Ptr& status, const Array::P
 	for (const IdoPgsqlConnection::Ptr& idopgsqlconnection : ConfigType::GetObjectsByType<IdoPgsqlConnection>()) {
 		size_t queryQueueItems = idopgsqlconnection->m_QueryQueue.GetLength();
 		double queryQueueItemRate = idopgsqlconnection->m_QueryQueue.GetTaskCount(60) / 60.0;
+		uint_fast64_t coalescedQueries = idopgsqlconnection->GetCoalescedQueryCount();
+		int statements = idopgsqlconnection->GetQueryCount(60);
+		double statementRate = statements / 60.0;
+		double rowsPerStatement = statements > 0 ? idopgsqlconnection->GetRowCount(60) / static_cast<double>(statements) : 0;
 
 		nodes.emplace_back(idopgsqlconnection->GetName(), new Dictionary({
 			{ "version", idopgsqlconnection->GetSchemaVersion() },
 			{ "instance_name", idopgsqlconnection->GetInstanceName() },
 			{ "connected", idopgsqlconnection->GetConnected() },
 			{ "query_queue_items", queryQueueItems },
-			{ "query_queue_item_rate", queryQueueItemRate }
+			{ "query_queue_item_rate", queryQueueItemRate },
+			{ "query_queue_coalesced", coalescedQueries },
+			{ "statements_rate", statementRate },
+			{ "rows_per_statement", rowsPerStatement }
 		}));
 
 		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_queries_rate", idopgsqlconnection->GetQueryCount(60) / 60.0));
@@ -75,6 +100,9 @@ void IdoPgsqlConnection::StatsFunc(const Dictionary::Ptr& status, const Array::P
 		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_queries_15mins", idopgsqlconnection->GetQueryCount(15 * 60)));
 		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_query_queue_items", queryQueueItems));
 		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_query_queue_item_rate", queryQueueItemRate));
+		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_query_queue_coalesced", coalescedQueries, true));
+		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_statements_rate", statementRate));
+		perfdata->Add(new PerfdataValue("idopgsqlconnection_" + idopgsqlconnection->GetName() + "_rows_per_statement", rowsPerStatement));
 	}
 
 	status->Set("idopgsqlconnection", new Dictionary(std::move(nodes)));
@@ -143,12 +171,16 @@ void IdoPgsqlConnection::Disconnect()
 	if (!GetConnected())
 		return;
 
+	FlushInsertBatches();
+
 	IncreasePendingQueries(1);
 	Query("COMMIT");
 
 	m_Pgsql->finish(m_Connection);
 	SetConnected(false);
 
+	CloseWriters();
+
 	Log(LogInformation, "IdoPgsqlConnection")
 		<< "Disconnected from '" << GetName() << "' database '" << GetDatabase() << "'.";
 }
@@ -159,6 +191,18 @@ void IdoPgsqlConnection::NewTransaction()
 		return;
 
 	m_QueryQueue.Enqueue([this]() { InternalNewTransaction(); }, PriorityNormal, true);
+
+	/* The writer sessions commit on their own, the primary session might be waiting for their locks. */
+	uint_fast64_t generation = m_WriterGeneration.load();
+
+	for (auto& writer : m_Writers) {
+		IdoPgsqlWriter *w = writer.get();
+
+		w->Queue.Enqueue([this, w, generation]() {
+			if (generation == w->Generation)
+				CommitWriter(*w);
+		}, PriorityHigh);
+	}
 }
 
 void IdoPgsqlConnection::InternalNewTransaction()
@@ -168,6 +212,8 @@ void IdoPgsqlConnection::InternalNewTransaction()
 	if (!GetConnected())
 		return;
 
+	FlushInsertBatches();
+
 	IncreasePendingQueries(2);
 	Query("COMMIT");
 	Query("BEGIN");
@@ -179,33 +225,8 @@ void IdoPgsqlConnection::ReconnectTimerHandler()
 	m_QueryQueue.Enqueue([this]() { Reconnect(); }, PriorityHigh);
 }
 
-void IdoPgsqlConnection::Reconnect()
+String IdoPgsqlConnection::GetConnectionInfo()
 {
-	AssertOnWorkQueue();
-
-	CONTEXT("Reconnecting to PostgreSQL IDO database '" + GetName() + "'");
-
-	double startTime = Utility::GetTime();
-
-	SetShouldConnect(true);
-
-	bool reconnect = false;
-
-	if (GetConnected()) {
-		/* Check if we're really still connected */
-		try {
-			IncreasePendingQueries(1);
-			Query("SELECT 1");
-			return;
-		} catch (const std::exception&) {
-			m_Pgsql->finish(m_Connection);
-			SetConnected(false);
-			reconnect = true;
-		}
-	}
-
-	ClearIDCache();
-
 	String host = GetHost();
 	String port = GetPort();
 	String user = GetUser();
@@ -239,24 +260,76 @@ void IdoPgsqlConnection::Reconnect()
 	if (!sslCa.IsEmpty())
 		conninfo += " sslrootcert=" + sslCa;
 
-	/* connection */
-	m_Connection = m_Pgsql->connectdb(conninfo.CStr());
+	return conninfo;
+}
 
-	if (!m_Connection)
-		return;
+/**
+ * Opens a session with the configured connection settings.
+ *
+ * @returns nullptr if libpq couldn't allocate the connection.
+ */
+PGconn *IdoPgsqlConnection::OpenConnection()
+{
+	PGconn *connection = m_Pgsql->connectdb(GetConnectionInfo().CStr());
 
-	if (m_Pgsql->status(m_Connection) != CONNECTION_OK) {
-		String message = m_Pgsql->errorMessage(m_Connection);
-		m_Pgsql->finish(m_Connection);
-		SetConnected(false);
+	if (!connection)
+		return nullptr;
+
+	if (m_Pgsql->status(connection) != CONNECTION_OK) {
+		String message = m_Pgsql->errorMessage(connection);
+		m_Pgsql->finish(connection);
 
 		Log(LogCritical, "IdoPgsqlConnection")
-			<< "Connection to database '" << database << "' with user '" << user << "' on '" << host << ":" << port
+			<< "Connection to database '" << GetDatabase() << "' with user '" << GetUser() << "' on '" << GetHost() << ":" << GetPort()
 			<< "' failed: \"" << message << "\"";
 
 		BOOST_THROW_EXCEPTION(std::runtime_error(message));
 	}
 
+	return connection;
+}
+
+void IdoPgsqlConnection::Reconnect()
+{
+	AssertOnWorkQueue();
+
+	CONTEXT("Reconnecting to PostgreSQL IDO database '" + GetName() + "'");
+
+	double startTime = Utility::GetTime();
+
+	SetShouldConnect(true);
+
+	bool reconnect = false;
+
+	if (GetConnected()) {
+		/* Check if we're really still connected */
+		try {
+			IncreasePendingQueries(1);
+			Query("SELECT 1");
+			return;
+		} catch (const std::exception&) {
+			m_Pgsql->finish(m_Connection);
+			SetConnected(false);
+			reconnect = true;
+		}
+	}
+
+	/* Whatever is queued now won't make it into the new session. */
+	SealCoalescedQueries();
+	ResetWriters();
+
+	/* Prepared statements belong to the old session. Batched rows are kept
+	 * and sent to the new session, just like IdoMysqlConnection does.
+	 */
+	m_PreparedStatements.clear();
+
+	ClearIDCache();
+
+	m_Connection = OpenConnection();
+
+	if (!m_Connection)
+		return;
+
 	SetConnected(true);
 
 	IdoPgsqlResult result;
@@ -372,11 +445,14 @@ void IdoPgsqlConnection::Reconnect()
 
 	Log(LogInformation, "IdoPgsqlConnection")
 		<< "PGSQL IDO instance id: " << static_cast<long>(m_InstanceID) << " (schema version: '" + version + "')"
-		<< (!sslMode.IsEmpty() ? ", sslmode='" + sslMode + "'" : "");
+		<< (!GetSslMode().IsEmpty() ? ", sslmode='" + GetSslMode() + "'" : "");
 
 	IncreasePendingQueries(1);
 	Query("BEGIN");
 
+	/* Rows which were batched before the connection was lost. */
+	FlushInsertBatches();
+
 	/* update programstatus table */
 	UpdateProgramStatus();
 
@@ -390,6 +466,13 @@ void IdoPgsqlConnection::Reconnect()
 	/* clear config tables for the initial config dump */
 	PrepareDatabase();
 
+	/* The writer sessions would otherwise wait for the locks of the cleanup. */
+	if (!m_Writers.empty()) {
+		IncreasePendingQueries(2);
+		Query("COMMIT");
+		Query("BEGIN");
+	}
+
 	std::ostringstream q1buf;
 	q1buf << "SELECT object_id, objecttype_id, name1, name2, is_active FROM " + GetTablePrefix() + "objects WHERE instance_id = " << static_cast<long>(m_InstanceID);
 	IncreasePendingQueries(1);
@@ -467,21 +550,106 @@ void IdoPgsqlConnection::ClearTableBySession(const String& table)
 		Convert::ToString(GetSessionToken()));
 }
 
-IdoPgsqlResult IdoPgsqlConnection::Query(const String& query)
+IdoPgsqlResult IdoPgsqlConnection::Query(const String& query, int rows)
 {
 	AssertOnWorkQueue();
 
+	return SessionQuery(m_Connection, m_AffectedRows, query, rows);
+}
+
+/**
+ * Executes a statement as a server-side prepared statement, preparing it
+ * on first use.
+ *
+ * @param query The statement with $1, $2, ... placeholders.
+ * @param params The parameters, Empty values are passed as NULL.
+ */
+IdoPgsqlResult IdoPgsqlConnection::QueryPrepared(const String& query, const std::vector<Value>& params)
+{
+	AssertOnWorkQueue();
+
+	return SessionQueryPrepared(m_Connection, m_AffectedRows, m_PreparedStatements, query, params);
+}
+
+/**
+ * Executes a statement on the primary or a writer session.
+ */
+IdoPgsqlResult IdoPgsqlConnection::SessionQuery(PGconn *connection, int& affectedRows, const String& query, int rows)
+{
+	Defer decreaseQueries ([this]() { DecreasePendingQueries(1); });
+
+	Log(LogDebug, "IdoPgsqlConnection")
+		<< "Query: " << query;
+
+	IncreaseQueryCount(rows);
+
+	PGresult *result = m_Pgsql->exec(connection, query.CStr());
+
+	return ProcessResult(connection, affectedRows, result, query);
+}
+
+/**
+ * Executes a prepared statement on the primary or a writer session. Once the session
+ * has 1000 statements prepared, others are prepared as the unnamed statement every time.
+ */
+IdoPgsqlResult IdoPgsqlConnection::SessionQueryPrepared(PGconn *connection, int& affectedRows,
+	std::map<String, String>& preparedStatements, const String& query, const std::vector<Value>& params)
+{
 	Defer decreaseQueries ([this]() { DecreasePendingQueries(1); });
 
+	auto it (preparedStatements.find(query));
+
+	if (it == preparedStatements.end()) {
+		String name;
+
+		if (preparedStatements.size() < 1000)
+			name = "icinga_stmt_" + Convert::ToString(preparedStatements.size());
+
+		Log(LogDebug, "IdoPgsqlConnection")
+			<< "Preparing statement '" << name << "': " << query;
+
+		PGresult *result = m_Pgsql->prepare(connection, name.CStr(), query.CStr(), params.size(), nullptr);
+
+		ProcessResult(connection, affectedRows, result, query);
+
+		if (name.IsEmpty())
+			it = preparedStatements.end();
+		else
+			it = preparedStatements.emplace(query, std::move(name)).first;
+	}
+
+	std::vector<String> values;
+	std::vector<const char *> paramValues;
+
+	values.reserve(params.size());
+	paramValues.reserve(params.size());
+
+	for (const Value& param : params) {
+		if (param.IsEmpty()) {
+			paramValues.push_back(nullptr);
+		} else {
+			values.emplace_back(Utility::ValidateUTF8(param));
+			paramValues.push_back(values.back().CStr());
+		}
+	}
+
 	Log(LogDebug, "IdoPgsqlConnection")
 		<< "Query: " << query;
 
 	IncreaseQueryCount();
 
-	PGresult *result = m_Pgsql->exec(m_Connection, query.CStr());
+	const char *name = it != preparedStatements.end() ? it->second.CStr() : "";
+
+	PGresult *result = m_Pgsql->execPrepared(connection, name, paramValues.size(),
+		paramValues.data(), nullptr, nullptr, 0);
+
+	return ProcessResult(connection, affectedRows, result, query);
+}
 
+IdoPgsqlResult IdoPgsqlConnection::ProcessResult(PGconn *connection, int& affectedRows, PGresult *result, const String& query)
+{
 	if (!result) {
-		String message = m_Pgsql->errorMessage(m_Connection);
+		String message = m_Pgsql->errorMessage(connection);
 		Log(LogCritical, "IdoPgsqlConnection")
 			<< "Error \"" << message << "\" when executing query \"" << query << "\"";
 
@@ -493,7 +661,7 @@ IdoPgsqlResult IdoPgsqlConnection::Query(const String& query)
 	}
 
 	char *rowCount = m_Pgsql->cmdTuples(result);
-	m_AffectedRows = atoi(rowCount);
+	affectedRows = atoi(rowCount);
 
 	if (m_Pgsql->resultStatus(result) == PGRES_COMMAND_OK) {
 		m_Pgsql->clear(result);
@@ -517,12 +685,20 @@ IdoPgsqlResult IdoPgsqlConnection::Query(const String& query)
 	return IdoPgsqlResult(result, [this](PGresult* result) { m_Pgsql->clear(result); });
 }
 
+/**
+ * Returns the query for the value the session's last INSERT took from the column's sequence.
+ */
+String IdoPgsqlConnection::GetSequenceQuery(const String& table, const String& column)
+{
+	return "SELECT CURRVAL(pg_get_serial_sequence('" + Escape(table) + "', '" + Escape(column) + "')) AS id";
+}
+
 DbReference IdoPgsqlConnection::GetSequenceValue(const String& table, const String& column)
 {
 	AssertOnWorkQueue();
 
 	IncreasePendingQueries(1);
-	IdoPgsqlResult result = Query("SELECT CURRVAL(pg_get_serial_sequence('" + Escape(table) + "', '" + Escape(column) + "')) AS id");
+	IdoPgsqlResult result = Query(GetSequenceQuery(table, column));
 
 	Dictionary::Ptr row = FetchRow(result, 0);
 
@@ -652,8 +828,17 @@ void IdoPgsqlConnection::InternalDeactivateObject(const DbObject::Ptr& dbobj)
 	SetObjectActive(dbobj, false);
 }
 
-bool IdoPgsqlConnection::FieldToEscapedString(const String& key, const Value& value, Value *result)
+/**
+ * Converts a field into the value which is written to the database.
+ *
+ * @param result The value, Empty for NULL.
+ * @param kind How the value has to be written into a statement.
+ * @returns false if the value refers to IDs which aren't known yet.
+ */
+bool IdoPgsqlConnection::FieldToValue(const String& key, const Value& value, Value *result, IdoPgsqlFieldKind *kind)
 {
+	*kind = IdoPgsqlFieldLiteral;
+
 	if (key == "instance_id") {
 		*result = static_cast<long>(m_InstanceID);
 		return true;
@@ -665,7 +850,8 @@ bool IdoPgsqlConnection::FieldToEscapedString(const String& key, const Value& va
 	Value rawvalue = DbValue::ExtractValue(value);
 
 	if (rawvalue.GetType() == ValueEmpty) {
-		*result = "NULL";
+		*result = Empty;
+		*kind = IdoPgsqlFieldNull;
 	} else if (rawvalue.IsObjectType<ConfigObject>()) {
 		DbObject::Ptr dbobjcol = DbObject::GetOrCreateByObject(rawvalue);
 
@@ -700,9 +886,8 @@ bool IdoPgsqlConnection::FieldToEscapedString(const String& key, const Value& va
 		*result = static_cast<long>(dbrefcol);
 	} else if (DbValue::IsTimestamp(value)) {
 		long ts = rawvalue;
-		std::ostringstream msgbuf;
-		msgbuf << "TO_TIMESTAMP(" << ts << ") AT TIME ZONE 'UTC'";
-		*result = Value(msgbuf.str());
+		*result = ts;
+		*kind = IdoPgsqlFieldTimestamp;
 	} else if (DbValue::IsObjectInsertID(value)) {
 		auto id = static_cast<long>(rawvalue);
 
@@ -712,14 +897,67 @@ bool IdoPgsqlConnection::FieldToEscapedString(const String& key, const Value& va
 		*result = id;
 		return true;
 	} else {
-		Value fvalue;
-
 		if (rawvalue.IsBoolean())
-			fvalue = Convert::ToLong(rawvalue);
+			*result = Convert::ToLong(rawvalue);
 		else
-			fvalue = rawvalue;
+			*result = rawvalue;
 
-		*result = "'" + Escape(fvalue) + "'";
+		*kind = IdoPgsqlFieldString;
+	}
+
+	return true;
+}
+
+/**
+ * Renders a value returned by FieldToValue() as an SQL literal.
+ */
+String IdoPgsqlConnection::ValueToLiteral(const Value& value, IdoPgsqlFieldKind kind)
+{
+	switch (kind) {
+		case IdoPgsqlFieldNull:
+			return "NULL";
+		case IdoPgsqlFieldTimestamp:
+			return "TO_TIMESTAMP(" + Convert::ToString(static_cast<long>(value)) + ") AT TIME ZONE 'UTC'";
+		case IdoPgsqlFieldString:
+			return "'" + Escape(value) + "'";
+		default:
+			return value;
+	}
+}
+
+bool IdoPgsqlConnection::FieldToEscapedString(const String& key, const Value& value, Value *result)
+{
+	Value fvalue;
+	IdoPgsqlFieldKind kind;
+
+	if (!FieldToValue(key, value, &fvalue, &kind))
+		return false;
+
+	if (kind == IdoPgsqlFieldLiteral)
+		*result = fvalue;
+	else
+		*result = ValueToLiteral(fvalue, kind);
+
+	return true;
+}
+
+/**
+ * Converts all fields of a dictionary, see FieldToValue().
+ *
+ * @returns false if any of the fields can't be converted yet.
+ */
+bool IdoPgsqlConnection::FieldsToValues(const Dictionary::Ptr& fields, std::vector<IdoPgsqlField>& result)
+{
+	ObjectLock olock(fields);
+
+	for (const Dictionary::Pair& kv : fields) {
+		IdoPgsqlField field;
+		field.Name = kv.first;
+
+		if (!FieldToValue(kv.first, kv.second, &field.Raw, &field.Kind))
+			return false;
+
+		result.emplace_back(std::move(field));
 	}
 
 	return true;
@@ -732,8 +970,17 @@ void IdoPgsqlConnection::ExecuteQuery(const DbQuery& query)
 
 	ASSERT(query.Category != DbCatInvalid);
 
+	std::shared_ptr<DbQuery> pending;
+
+	if (CoalesceQuery(query, pending))
+		return;
+
 	IncreasePendingQueries(1);
-	m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority, true);
+
+	if (pending)
+		m_QueryQueue.Enqueue([this, pending]() { InternalExecuteQuery(TakeCoalescedQuery(pending), -1); }, query.Priority, true);
+	else
+		m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority, true);
 }
 
 void IdoPgsqlConnection::ExecuteMultipleQueries(const std::vector<DbQuery>& queries)
@@ -744,6 +991,11 @@ void IdoPgsqlConnection::ExecuteMultipleQueries(const std::vector<DbQuery>& quer
 	if (queries.empty())
 		return;
 
+	for (const DbQuery& query : queries) {
+		if (!query.Table.IsEmpty())
+			SealCoalescedQueries(query.Table);
+	}
+
 	IncreasePendingQueries(queries.size());
 	m_QueryQueue.Enqueue([this, queries]() { InternalExecuteMultipleQueries(queries); }, queries[0].Priority, true);
 }
@@ -800,12 +1052,25 @@ void IdoPgsqlConnection::InternalExecuteMultipleQueries(const std::vector<DbQuer
 		}
 	}
 
+	/* The statements of a group depend on each other, so they all go to the same session. */
+	DbObject::Ptr routeObject;
+
 	for (const DbQuery& query : queries) {
-		InternalExecuteQuery(query);
+		if (query.Object) {
+			routeObject = query.Object;
+			break;
+		}
+	}
+
+	for (const DbQuery& query : queries) {
+		InternalExecuteQuery(query, -1, routeObject);
 	}
 }
 
-void IdoPgsqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOverride)
+/**
+ * @param routeObject The object which decides about the writer session, the query's own object if empty.
+ */
+void IdoPgsqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOverride, const DbObject::Ptr& routeObject)
 {
 	AssertOnWorkQueue();
 
@@ -838,34 +1103,16 @@ void IdoPgsqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 
 	/* check if there are missing object/insert ids and re-enqueue the query */
 	if (!CanExecuteQuery(query)) {
-		m_QueryQueue.Enqueue([this, query, typeOverride]() { InternalExecuteQuery(query, typeOverride); }, query.Priority);
+		m_QueryQueue.Enqueue([this, query, typeOverride, routeObject]() { InternalExecuteQuery(query, typeOverride, routeObject); }, query.Priority);
 		return;
 	}
 
-	std::ostringstream qbuf, where;
+	std::vector<IdoPgsqlField> where, fields;
 	int type;
 
-	if (query.WhereCriteria) {
-		where << " WHERE ";
-
-		ObjectLock olock(query.WhereCriteria);
-		Value value;
-		bool first = true;
-
-		for (const Dictionary::Pair& kv : query.WhereCriteria) {
-			if (!FieldToEscapedString(kv.first, kv.second, &value)) {
-				m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority);
-				return;
-			}
-
-			if (!first)
-				where << " AND ";
-
-			where << kv.first << " = " << value;
-
-			if (first)
-				first = false;
-		}
+	if (query.WhereCriteria && !FieldsToValues(query.WhereCriteria, where)) {
+		m_QueryQueue.Enqueue([this, query, routeObject]() { InternalExecuteQuery(query, -1, routeObject); }, query.Priority);
+		return;
 	}
 
 	type = (typeOverride != -1) ? typeOverride : query.Type;
@@ -888,100 +1135,457 @@ void IdoPgsqlConnection::InternalExecuteQuery(const DbQuery& query, int typeOver
 		type = DbQueryUpdate;
 	}
 
-	if ((type & DbQueryInsert) && (type & DbQueryDelete)) {
-		std::ostringstream qdel;
-		qdel << "DELETE FROM " << GetTablePrefix() << query.Table << where.str();
-		IncreasePendingQueries(1);
-		Query(qdel.str());
+	/* Grouped statements aren't batched, the rows would end up on another session than the rest of the group. */
+	bool batch = typeOverride == -1 && !routeObject && IsBatchableInsert(query);
+	IdoPgsqlWriter *writer = batch ? nullptr : GetWriter(routeObject ? routeObject : query.Object);
 
-		type = DbQueryInsert;
-	}
+	/* Statements for a table must not overtake the rows batched for it. */
+	if (!batch)
+		FlushInsertBatch(query.Table);
 
-	switch (type) {
-		case DbQueryInsert:
-			qbuf << "INSERT INTO " << GetTablePrefix() << query.Table;
-			break;
-		case DbQueryUpdate:
-			qbuf << "UPDATE " << GetTablePrefix() << query.Table << " SET";
-			break;
-		case DbQueryDelete:
-			qbuf << "DELETE FROM " << GetTablePrefix() << query.Table;
-			break;
-		default:
-			VERIFY(!"Invalid query type.");
-	}
+	/* Renders the statement, with placeholders for a prepared statement if params is set. */
+	auto render = [this, &query, &where, &fields](int stmtType, std::vector<Value> *params) -> String {
+		auto value = [this, params](const IdoPgsqlField& field) -> String {
+			if (!params)
+				return ValueToLiteral(field.Raw, field.Kind);
 
-	if (type == DbQueryInsert || type == DbQueryUpdate) {
-		std::ostringstream colbuf, valbuf;
+			params->push_back(field.Raw);
 
-		if (type == DbQueryUpdate && query.Fields->GetLength() == 0)
-			return;
+			String placeholder = "$" + Convert::ToString(params->size());
 
-		ObjectLock olock(query.Fields);
+			if (field.Kind == IdoPgsqlFieldTimestamp)
+				return "TO_TIMESTAMP(" + placeholder + ") AT TIME ZONE 'UTC'";
 
-		Value value;
-		bool first = true;
-		for (const Dictionary::Pair& kv : query.Fields) {
-			if (!FieldToEscapedString(kv.first, kv.second, &value)) {
-				m_QueryQueue.Enqueue([this, query]() { InternalExecuteQuery(query, -1); }, query.Priority);
-				return;
-			}
+			return placeholder;
+		};
 
-			if (type == DbQueryInsert) {
+		std::ostringstream qbuf;
+
+		switch (stmtType) {
+			case DbQueryInsert:
+				qbuf << "INSERT INTO " << GetTablePrefix() << query.Table;
+				break;
+			case DbQueryUpdate:
+				qbuf << "UPDATE " << GetTablePrefix() << query.Table << " SET";
+				break;
+			case DbQueryDelete:
+				qbuf << "DELETE FROM " << GetTablePrefix() << query.Table;
+				break;
+			default:
+				VERIFY(!"Invalid query type.");
+		}
+
+		if (stmtType == DbQueryInsert) {
+			std::ostringstream colbuf, valbuf;
+			bool first = true;
+
+			for (const IdoPgsqlField& field : fields) {
 				if (!first) {
 					colbuf << ", ";
 					valbuf << ", ";
 				}
 
-				colbuf << kv.first;
-				valbuf << value;
-			} else {
+				colbuf << field.Name;
+				valbuf << value(field);
+				first = false;
+			}
+
+			qbuf << " (" << colbuf.str() << ") VALUES (" << valbuf.str() << ")";
+		} else {
+			bool first = true;
+
+			for (const IdoPgsqlField& field : fields) {
 				if (!first)
-					qbuf << ", ";
+					qbuf << ",";
 
-				qbuf << " " << kv.first << " = " << value;
+				qbuf << " " << field.Name << " = " << value(field);
+				first = false;
 			}
+		}
 
-			if (first)
+		if (stmtType != DbQueryInsert && !where.empty()) {
+			qbuf << " WHERE ";
+
+			bool first = true;
+
+			for (const IdoPgsqlField& field : where) {
+				if (!first)
+					qbuf << " AND ";
+
+				qbuf << field.Name << " = " << value(field);
 				first = false;
+			}
 		}
 
-		if (type == DbQueryInsert)
-			qbuf << " (" << colbuf.str() << ") VALUES (" << valbuf.str() << ")";
+		return qbuf.str();
+	};
+
+	IdoPgsqlWriterStatement stmt;
+
+	if ((type & DbQueryInsert) && (type & DbQueryDelete)) {
+		if (writer) {
+			stmt.DeleteFirst = render(DbQueryDelete, nullptr);
+		} else {
+			IncreasePendingQueries(1);
+			Query(render(DbQueryDelete, nullptr));
+		}
+
+		type = DbQueryInsert;
 	}
 
-	if (type != DbQueryInsert)
-		qbuf << where.str();
+	if (type == DbQueryInsert || type == DbQueryUpdate) {
+		if (type == DbQueryUpdate && query.Fields->GetLength() == 0)
+			return;
 
-	Query(qbuf.str());
+		if (!FieldsToValues(query.Fields, fields)) {
+			m_QueryQueue.Enqueue([this, query, routeObject]() { InternalExecuteQuery(query, -1, routeObject); }, query.Priority);
+			return;
+		}
+	}
+
+	if (writer) {
+		if (type == DbQueryDelete)
+			stmt.Statement = render(type, nullptr);
+		else
+			stmt.Statement = render(type, &stmt.Params);
+
+		if (upsert) {
+			stmt.UpsertDelete = render(DbQueryDelete, nullptr);
+			stmt.UpsertInsert = render(DbQueryInsert, &stmt.UpsertParams);
+		}
+
+		/* The sequence value can only be looked up on the session which did the INSERT. */
+		if ((type == DbQueryInsert || upsert) && query.Object && query.ConfigUpdate) {
+			String idField = query.IdColumn;
+
+			if (idField.IsEmpty())
+				idField = query.Table.SubStr(0, query.Table.GetLength() - 1) + "_id";
+
+			stmt.Sequence = GetSequenceQuery(GetTablePrefix() + query.Table, idField);
+		} else if ((type == DbQueryInsert || upsert) && query.Table == "notifications" && query.NotificationInsertID) {
+			stmt.Sequence = GetSequenceQuery(GetTablePrefix() + query.Table, "notification_id");
+		}
+
+		IdoPgsqlWriter *w = writer;
+		uint_fast64_t generation = m_WriterGeneration.load();
+
+		w->Queue.Enqueue([this, w, generation, query, type, stmt]() {
+			ExecuteWriterStatement(*w, generation, query, type, stmt);
+		});
+
+		return;
+	}
+
+	if (batch) {
+		std::ostringstream colbuf, valbuf;
+		bool first = true;
+
+		for (const IdoPgsqlField& field : fields) {
+			if (!first) {
+				colbuf << ", ";
+				valbuf << ", ";
+			}
+
+			colbuf << field.Name;
+			valbuf << ValueToLiteral(field.Raw, field.Kind);
+			first = false;
+		}
+
+		AddInsertBatchRow(query.Table, colbuf.str(), valbuf.str());
+		return;
+	}
+
+	if (type == DbQueryDelete) {
+		Query(render(type, nullptr));
+	} else {
+		std::vector<Value> params;
+		String statement = render(type, &params);
+
+		/* Don't let rarely used statement shapes pile up on the server. */
+		if (m_PreparedStatements.find(statement) == m_PreparedStatements.end() && m_PreparedStatements.size() >= 1000)
+			Query(render(type, nullptr));
+		else
+			QueryPrepared(statement, params);
+	}
 
 	if (upsert && GetAffectedRows() == 0) {
 		IncreasePendingQueries(1);
-		InternalExecuteQuery(query, DbQueryDelete | DbQueryInsert);
+		InternalExecuteQuery(query, DbQueryDelete | DbQueryInsert, routeObject);
 
 		return;
 	}
 
-	if (type == DbQueryInsert && query.Object) {
-		if (query.ConfigUpdate) {
-			String idField = query.IdColumn;
+	DbReference insertId;
 
-			if (idField.IsEmpty())
-				idField = query.Table.SubStr(0, query.Table.GetLength() - 1) + "_id";
+	if (type == DbQueryInsert && query.Object && query.ConfigUpdate) {
+		String idField = query.IdColumn;
 
-			SetInsertID(query.Object, GetSequenceValue(GetTablePrefix() + query.Table, idField));
+		if (idField.IsEmpty())
+			idField = query.Table.SubStr(0, query.Table.GetLength() - 1) + "_id";
 
+		insertId = GetSequenceValue(GetTablePrefix() + query.Table, idField);
+	} else if (type == DbQueryInsert && query.Table == "notifications" && query.NotificationInsertID) {
+		insertId = GetSequenceValue(GetTablePrefix() + query.Table, "notification_id");
+	}
+
+	FinishExecuteQuery(query, type, insertId);
+}
+
+/**
+ * Updates the ID caches after a statement has been executed.
+ */
+void IdoPgsqlConnection::FinishExecuteQuery(const DbQuery& query, int type, const DbReference& insertId)
+{
+	if (type == DbQueryInsert && query.Object) {
+		if (query.ConfigUpdate) {
+			SetInsertID(query.Object, insertId);
 			SetConfigUpdate(query.Object, true);
 		} else if (query.StatusUpdate)
 			SetStatusUpdate(query.Object, true);
 	}
 
-	if (type == DbQueryInsert && query.Table == "notifications" && query.NotificationInsertID) {
-		DbReference seqval = GetSequenceValue(GetTablePrefix() + query.Table, "notification_id");
-		query.NotificationInsertID->SetValue(static_cast<long>(seqval));
+	if (type == DbQueryInsert && query.Table == "notifications" && query.NotificationInsertID)
+		query.NotificationInsertID->SetValue(static_cast<long>(insertId));
+}
+
+/**
+ * Adds a row to the multi-row INSERT for the table, sending the pending
+ * rows first if the columns differ or the statement grew large enough.
+ */
+void IdoPgsqlConnection::AddInsertBatchRow(const String& table, const String& columns, const String& values)
+{
+	DbInsertBatch& batch = m_InsertBatches[table];
+
+	if (!batch.Rows.empty() && (batch.Columns != columns || batch.Rows.size() >= 1000 || batch.Size >= 1024 * 1024))
+		FlushInsertBatch(table);
+
+	if (batch.Rows.empty())
+		batch.Columns = columns;
+
+	batch.Size += values.GetLength() + 3;
+	batch.Rows.emplace_back(values);
+}
+
+/**
+ * Sends the pending rows for the table as a single INSERT statement.
+ */
+void IdoPgsqlConnection::FlushInsertBatch(const String& table)
+{
+	auto it (m_InsertBatches.find(table));
+
+	if (it == m_InsertBatches.end() || it->second.Rows.empty())
+		return;
+
+	DbInsertBatch& batch = it->second;
+
+	std::ostringstream qbuf;
+	qbuf << "INSERT INTO " << GetTablePrefix() << table << " (" << batch.Columns << ") VALUES ";
+
+	bool first = true;
+
+	for (const String& row : batch.Rows) {
+		if (!first)
+			qbuf << ", ";
+
+		qbuf << "(" << row << ")";
+		first = false;
+	}
+
+	int rows = batch.Rows.size();
+
+	std::vector<String> sent;
+	sent.swap(batch.Rows);
+	batch.Size = 0;
+
+	/* Every row was counted as a pending query, the statement stands in for all of them. */
+	DecreasePendingQueries(rows - 1);
+
+	try {
+		Query(qbuf.str(), rows);
+	} catch (const std::exception&) {
+		/* Keep the rows for the next session if the connection was lost. */
+		if (m_Pgsql->status(m_Connection) != CONNECTION_OK) {
+			IncreasePendingQueries(rows);
+
+			batch.Rows.swap(sent);
+
+			for (const String& row : batch.Rows)
+				batch.Size += row.GetLength() + 3;
+		}
+
+		throw;
+	}
+}
+
+void IdoPgsqlConnection::FlushInsertBatches()
+{
+	for (auto& kv : m_InsertBatches)
+		FlushInsertBatch(kv.first);
+}
+
+/**
+ * Returns the writer session which executes the statements for the object
+ * or nullptr if the primary session is responsible for them. All objects
+ * of a host share a session, so their statements keep their order.
+ */
+IdoPgsqlWriter *IdoPgsqlConnection::GetWriter(const DbObject::Ptr& object) const
+{
+	if (m_Writers.empty() || !object)
+		return nullptr;
+
+	size_t index = std::hash<std::string>()(object->GetName1().GetData()) % (m_Writers.size() + 1);
+
+	if (index == 0)
+		return nullptr;
+
+	return m_Writers[index - 1].get();
+}
+
+/**
+ * Invalidates everything the writer sessions haven't done yet, they
+ * reconnect with the next statements they are handed.
+ */
+void IdoPgsqlConnection::ResetWriters()
+{
+	m_WriterGeneration.fetch_add(1);
+}
+
+/**
+ * Commits and closes the writer sessions once they've finished their statements.
+ */
+void IdoPgsqlConnection::CloseWriters()
+{
+	uint_fast64_t generation = m_WriterGeneration.load();
+
+	for (auto& writer : m_Writers) {
+		IdoPgsqlWriter *w = writer.get();
+
+		w->Queue.Enqueue([this, w, generation]() {
+			if (generation == w->Generation)
+				CommitWriter(*w);
+
+			CloseWriter(*w);
+		}, PriorityLow);
+
+		w->Queue.Join();
 	}
 }
 
+void IdoPgsqlConnection::OpenWriter(IdoPgsqlWriter& writer)
+{
+	writer.Connection = OpenConnection();
+
+	if (!writer.Connection)
+		BOOST_THROW_EXCEPTION(std::runtime_error("Could not allocate a PostgreSQL connection."));
+
+	writer.Connected = true;
+	writer.UncommittedQueries = 0;
+	writer.PreparedStatements.clear();
+
+	IncreasePendingQueries(1);
+	SessionQuery(writer.Connection, writer.AffectedRows, "BEGIN");
+
+	Log(LogNotice, "IdoPgsqlConnection")
+		<< "Writer session '" << writer.Queue.GetName() << "' is now connected to database '" << GetDatabase() << "'.";
+}
+
+void IdoPgsqlConnection::CloseWriter(IdoPgsqlWriter& writer)
+{
+	if (!writer.Connected)
+		return;
+
+	m_Pgsql->finish(writer.Connection);
+	writer.Connected = false;
+}
+
+void IdoPgsqlConnection::CommitWriter(IdoPgsqlWriter& writer)
+{
+	if (!writer.Connected || writer.UncommittedQueries == 0)
+		return;
+
+	IncreasePendingQueries(2);
+	SessionQuery(writer.Connection, writer.AffectedRows, "COMMIT");
+	SessionQuery(writer.Connection, writer.AffectedRows, "BEGIN");
+
+	writer.UncommittedQueries = 0;
+}
+
+/**
+ * Executes a statement on the writer session, including the DELETE/INSERT
+ * fallback of an upsert, and reports insert IDs back to the primary session.
+ */
+void IdoPgsqlConnection::ExecuteWriterStatement(IdoPgsqlWriter& writer, uint_fast64_t generation, const DbQuery& query,
+	int type, const IdoPgsqlWriterStatement& stmt)
+{
+	/* The primary session has reconnected since, this would use stale IDs. */
+	if (generation < writer.Generation) {
+		DecreasePendingQueries(1);
+		return;
+	}
+
+	if (generation != writer.Generation) {
+		CloseWriter(writer);
+		writer.Generation = generation;
+	}
+
+	if (!writer.Connected) {
+		try {
+			OpenWriter(writer);
+		} catch (...) {
+			DecreasePendingQueries(1);
+			throw;
+		}
+	}
+
+	if (!stmt.DeleteFirst.IsEmpty()) {
+		IncreasePendingQueries(1);
+		SessionQuery(writer.Connection, writer.AffectedRows, stmt.DeleteFirst);
+	}
+
+	if (type == DbQueryDelete)
+		SessionQuery(writer.Connection, writer.AffectedRows, stmt.Statement);
+	else
+		SessionQueryPrepared(writer.Connection, writer.AffectedRows, writer.PreparedStatements, stmt.Statement, stmt.Params);
+
+	if (!stmt.UpsertInsert.IsEmpty() && writer.AffectedRows == 0) {
+		IncreasePendingQueries(2);
+		SessionQuery(writer.Connection, writer.AffectedRows, stmt.UpsertDelete);
+		SessionQueryPrepared(writer.Connection, writer.AffectedRows, writer.PreparedStatements, stmt.UpsertInsert, stmt.UpsertParams);
+
+		type = DbQueryInsert;
+	}
+
+	writer.UncommittedQueries++;
+
+	if (type == DbQueryInsert) {
+		DbReference insertId;
+
+		if (!stmt.Sequence.IsEmpty()) {
+			IncreasePendingQueries(1);
+			IdoPgsqlResult result = SessionQuery(writer.Connection, writer.AffectedRows, stmt.Sequence);
+
+			insertId = DbReference(Convert::ToLong(m_Pgsql->getvalue(result.get(), 0, 0)));
+		}
+
+		/* The ID caches belong to the primary session, the writer only reports the results back. */
+		m_QueryQueue.Enqueue([this, query, generation, insertId]() {
+			if (generation == m_WriterGeneration.load())
+				FinishExecuteQuery(query, DbQueryInsert, insertId);
+		}, query.Priority);
+	}
+
+	if (writer.UncommittedQueries > 25000)
+		CommitWriter(writer);
+}
+
+void IdoPgsqlConnection::WriterExceptionHandler(IdoPgsqlWriter& writer, boost::exception_ptr exp)
+{
+	CloseWriter(writer);
+
+	/* The primary session waits for IDs which won't arrive anymore, start over. */
+	m_QueryQueue.Enqueue([this, exp]() { ExceptionHandler(exp); }, PriorityImmediate);
+}
+
 void IdoPgsqlConnection::CleanUpExecuteQuery(const String& table, const String& time_column, double max_age)
 {
 	if (IsPaused())
@@ -1000,6 +1604,8 @@ void IdoPgsqlConnection::InternalCleanUpExecuteQuery(const String& table, const
 		return;
 	}
 
+	FlushInsertBatch(table);
+
 	Query("DELETE FROM " + GetTablePrefix() + table + " WHERE instance_id = " +
 		Convert::ToString(static_cast<long>(m_InstanceID)) + " AND " + time_column +
 		" < TO_TIMESTAMP(" + Convert::ToString(static_cast<long>(max_age)) + ") AT TIME ZONE 'UTC'");
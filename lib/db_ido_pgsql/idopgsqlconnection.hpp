@@ -9,12 +9,69 @@
 #include "base/timer.hpp"
 #include "base/workqueue.hpp"
 #include "base/library.hpp"
+#include <atomic>
+#include <cstdint>
 
 namespace icinga
 {
 
 typedef std::shared_ptr<PGresult> IdoPgsqlResult;
 
+/**
+ * How a field value has to be written into a statement.
+ *
+ * @ingroup ido
+ */
+enum IdoPgsqlFieldKind
+{
+	IdoPgsqlFieldNull,
+	IdoPgsqlFieldLiteral, /**< A number which is written as it is. */
+	IdoPgsqlFieldString, /**< A value which is quoted and escaped. */
+	IdoPgsqlFieldTimestamp /**< A UNIX timestamp which is converted by the database. */
+};
+
+struct IdoPgsqlField
+{
+	String Name;
+	Value Raw;
+	IdoPgsqlFieldKind Kind{IdoPgsqlFieldNull};
+};
+
+/**
+ * An additional session which executes the statements for a share of the
+ * objects on its own thread.
+ *
+ * @ingroup ido
+ */
+struct IdoPgsqlWriter
+{
+	PGconn *Connection{nullptr};
+	bool Connected{false};
+	uint_fast64_t Generation{0};
+	int AffectedRows{0};
+	uint_fast32_t UncommittedQueries{0};
+	std::map<String, String> PreparedStatements;
+
+	WorkQueue Queue{10000000, 1, LogNotice};
+};
+
+/**
+ * A statement which the primary session has rendered for a writer session,
+ * along with the statements the writer might have to run after it.
+ *
+ * @ingroup ido
+ */
+struct IdoPgsqlWriterStatement
+{
+	String DeleteFirst; /**< DELETE preceding a DELETE/INSERT, if any. */
+	String Statement; /**< The statement with $1, $2, ... placeholders. */
+	std::vector<Value> Params;
+	String UpsertDelete; /**< DELETE to run if an upsert UPDATE didn't affect rows. */
+	String UpsertInsert; /**< INSERT to run after UpsertDelete. */
+	std::vector<Value> UpsertParams;
+	String Sequence; /**< Query for the sequence value after an INSERT, if needed. */
+};
+
 /**
  * An IDO pgSQL database connection.
  *
@@ -49,6 +106,8 @@ protected:
 	void NewTransaction() override;
 	void Disconnect() override;
 
+	void ValidateWriterSessions(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+
 private:
 	DbReference m_InstanceID;
 
@@ -58,22 +117,49 @@ private:
 	PGconn *m_Connection;
 	int m_AffectedRows;
 
+	std::map<String, String> m_PreparedStatements;
+	std::map<String, DbInsertBatch> m_InsertBatches;
+
+	std::vector<std::unique_ptr<IdoPgsqlWriter>> m_Writers;
+	std::atomic<uint_fast64_t> m_WriterGeneration{0};
+
 	Timer::Ptr m_ReconnectTimer;
 	Timer::Ptr m_TxTimer;
 
-	IdoPgsqlResult Query(const String& query);
+	IdoPgsqlResult Query(const String& query, int rows = 1);
+	IdoPgsqlResult QueryPrepared(const String& query, const std::vector<Value>& params);
+	IdoPgsqlResult SessionQuery(PGconn *connection, int& affectedRows, const String& query, int rows = 1);
+	IdoPgsqlResult SessionQueryPrepared(PGconn *connection, int& affectedRows, std::map<String, String>& preparedStatements,
+		const String& query, const std::vector<Value>& params);
+	IdoPgsqlResult ProcessResult(PGconn *connection, int& affectedRows, PGresult *result, const String& query);
+	String GetSequenceQuery(const String& table, const String& column);
 	DbReference GetSequenceValue(const String& table, const String& column);
 	int GetAffectedRows();
 	String Escape(const String& s);
 	Dictionary::Ptr FetchRow(const IdoPgsqlResult& result, int row);
 
+	bool FieldToValue(const String& key, const Value& value, Value *result, IdoPgsqlFieldKind *kind);
+	bool FieldsToValues(const Dictionary::Ptr& fields, std::vector<IdoPgsqlField>& result);
+	String ValueToLiteral(const Value& value, IdoPgsqlFieldKind kind);
 	bool FieldToEscapedString(const String& key, const Value& value, Value *result);
 	void InternalActivateObject(const DbObject::Ptr& dbobj);
 	void InternalDeactivateObject(const DbObject::Ptr& dbobj);
 
 	void InternalNewTransaction();
+	String GetConnectionInfo();
+	PGconn *OpenConnection();
 	void Reconnect();
 
+	IdoPgsqlWriter *GetWriter(const DbObject::Ptr& object) const;
+	void ResetWriters();
+	void CloseWriters();
+	void OpenWriter(IdoPgsqlWriter& writer);
+	void CloseWriter(IdoPgsqlWriter& writer);
+	void CommitWriter(IdoPgsqlWriter& writer);
+	void ExecuteWriterStatement(IdoPgsqlWriter& writer, uint_fast64_t generation, const DbQuery& query,
+		int type, const IdoPgsqlWriterStatement& stmt);
+	void WriterExceptionHandler(IdoPgsqlWriter& writer, boost::exception_ptr exp);
+
 	void AssertOnWorkQueue();
 
 	void ReconnectTimerHandler();
@@ -82,7 +168,11 @@ private:
 
 	bool CanExecuteQuery(const DbQuery& query);
 
-	void InternalExecuteQuery(const DbQuery& query, int typeOverride = -1);
+	void InternalExecuteQuery(const DbQuery& query, int typeOverride = -1, const DbObject::Ptr& routeObject = nullptr);
+	void FinishExecuteQuery(const DbQuery& query, int type, const DbReference& insertId);
+	void AddInsertBatchRow(const String& table, const String& columns, const String& values);
+	void FlushInsertBatch(const String& table);
+	void FlushInsertBatches();
 	void InternalExecuteMultipleQueries(const std::vector<DbQuery>& queries);
 	void InternalCleanUpExecuteQuery(const String& table, const String& time_key, double time_value);
 
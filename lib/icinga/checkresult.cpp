@@ -3,6 +3,8 @@
 #include "icinga/checkresult.hpp"
 #include "icinga/checkresult-ti.cpp"
 #include "base/scriptglobal.hpp"
+#include "base/perfdatavalue.hpp"
+#include "base/objectlock.hpp"
 
 using namespace icinga;
 
@@ -32,3 +34,62 @@ double CheckResult::CalculateLatency() const
 
 	return latency;
 }
+
+/**
+ * Returns the parsed performance data. The result is computed on first use
+ * and cached until the performance data attribute is replaced.
+ */
+std::shared_ptr<const CheckResultPerfdata> CheckResult::GetParsedPerfdata() const
+{
+	Array::Ptr perfdata = GetPerformanceData();
+
+	std::unique_lock<std::mutex> lock(m_ParsedPerfdataMutex);
+
+	if (m_ParsedPerfdata && m_ParsedPerfdataSource == perfdata)
+		return m_ParsedPerfdata;
+
+	auto parsed (std::make_shared<CheckResultPerfdata>());
+
+	if (perfdata) {
+		ObjectLock olock(perfdata);
+
+		size_t length = perfdata->GetLength();
+		parsed->Labels.reserve(length);
+		parsed->Values.reserve(length);
+		parsed->Counters.reserve(length);
+		parsed->Units.reserve(length);
+		parsed->Warn.reserve(length);
+		parsed->Crit.reserve(length);
+		parsed->Min.reserve(length);
+		parsed->Max.reserve(length);
+
+		for (const Value& val : perfdata) {
+			PerfdataValue::Ptr pdv;
+
+			if (val.IsObjectType<PerfdataValue>())
+				pdv = val;
+			else {
+				try {
+					pdv = PerfdataValue::Parse(val);
+				} catch (const std::exception&) {
+					parsed->Invalid.push_back(val);
+					continue;
+				}
+			}
+
+			parsed->Labels.push_back(pdv->GetLabel());
+			parsed->Values.push_back(pdv->GetValue());
+			parsed->Counters.push_back(pdv->GetCounter());
+			parsed->Units.push_back(pdv->GetUnit());
+			parsed->Warn.push_back(pdv->GetWarn());
+			parsed->Crit.push_back(pdv->GetCrit());
+			parsed->Min.push_back(pdv->GetMin());
+			parsed->Max.push_back(pdv->GetMax());
+		}
+	}
+
+	m_ParsedPerfdataSource = perfdata;
+	m_ParsedPerfdata = parsed;
+
+	return m_ParsedPerfdata;
+}
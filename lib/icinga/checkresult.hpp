@@ -5,10 +5,39 @@
 
 #include "icinga/i2-icinga.hpp"
 #include "icinga/checkresult-ti.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace icinga
 {
 
+/**
+ * The performance data of a check result, parsed once and shared by all
+ * consumers. The n-th element of each vector belongs to the n-th value.
+ *
+ * @ingroup icinga
+ */
+struct CheckResultPerfdata
+{
+	std::vector<String> Labels;
+	std::vector<double> Values;
+	std::vector<bool> Counters;
+	std::vector<String> Units;
+	std::vector<Value> Warn;
+	std::vector<Value> Crit;
+	std::vector<Value> Min;
+	std::vector<Value> Max;
+
+	/* Entries which could not be parsed, consumers decide whether to complain. */
+	std::vector<Value> Invalid;
+
+	size_t GetLength() const
+	{
+		return Labels.size();
+	}
+};
+
 /**
  * A check result.
  *
@@ -21,6 +50,13 @@ public:
 
 	double CalculateExecutionTime() const;
 	double CalculateLatency() const;
+
+	std::shared_ptr<const CheckResultPerfdata> GetParsedPerfdata() const;
+
+private:
+	mutable std::mutex m_ParsedPerfdataMutex;
+	mutable Array::Ptr m_ParsedPerfdataSource;
+	mutable std::shared_ptr<const CheckResultPerfdata> m_ParsedPerfdata;
 };
 
 }
@@ -0,0 +1,775 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "icinga/compatlogindex.hpp"
+#include "icinga/service.hpp"
+#include "icinga/host.hpp"
+#include "base/utility.hpp"
+#include "base/logger.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace icinga;
+
+const uint32_t CompatLogIndex::NoString;
+const uint32_t CompatLogIndex::UnknownString;
+const uint32_t CompatLogIndex::MaxStringLength;
+
+static const char l_CompatLogIndexMagic[] = "icinga2-compatlog-index 1\n";
+
+const char *CompatLogIndex::GetMagic()
+{
+	return l_CompatLogIndexMagic;
+}
+
+size_t CompatLogIndex::GetMagicLength()
+{
+	return sizeof(l_CompatLogIndexMagic) - 1;
+}
+
+String CompatLogIndex::GetIndexPath(const String& logPath)
+{
+	return logPath + ".idx";
+}
+
+/**
+ * Looks up the timestamp of a line just like ParseLine() does, also for
+ * lines which are too short to be parsed.
+ */
+static int64_t GetLineTime(const String& line)
+{
+	unsigned long time = atoi(line.SubStr(1, 11).CStr());
+
+	return time;
+}
+
+/**
+ * Looks up the id of a string, new strings are passed to the callback
+ * which has to store them with the next id.
+ */
+template<typename AddFunction>
+static uint32_t InternString(std::map<String, uint32_t>& ids, const Value& value, const AddFunction& addFn)
+{
+	if (value.IsEmpty())
+		return CompatLogIndex::NoString;
+
+	String str = value;
+
+	if (str.GetLength() > CompatLogIndex::MaxStringLength || ids.size() >= CompatLogIndex::UnknownString)
+		return CompatLogIndex::UnknownString;
+
+	auto it = ids.find(str);
+
+	if (it != ids.end())
+		return it->second;
+
+	uint32_t id = ids.size();
+	ids[str] = id;
+	addFn(str);
+
+	return id;
+}
+
+/**
+ * Builds the index entry for a non-empty line of the log file.
+ */
+template<typename InternFunction>
+static CompatLogIndexRecord MakeEntry(const String& line, uint64_t offset, const InternFunction& internFn)
+{
+	CompatLogIndexRecord record;
+	memset(&record, 0, sizeof(record));
+
+	record.Kind = CompatLogIndexRecordEntry;
+	record.Time = GetLineTime(line);
+	record.Offset = offset;
+	record.Length = line.GetLength();
+	record.Type = CompatLogIndex::NoString;
+	record.HostName = CompatLogIndex::NoString;
+	record.ServiceDescription = CompatLogIndex::NoString;
+	record.StateType = CompatLogIndex::NoString;
+	record.Class = LogEntryClassInfo;
+
+	Dictionary::Ptr bag;
+
+	try {
+		bag = CompatLogIndex::ParseLine(line);
+	} catch (const std::exception&) {
+		/* The line is too short, it doesn't show up in the log table either. */
+		return record;
+	}
+
+	record.Type = internFn(bag->Get("type"));
+	record.HostName = internFn(bag->Get("host_name"));
+	record.ServiceDescription = internFn(bag->Get("service_description"));
+	record.StateType = internFn(bag->Get("state_type"));
+	record.State = static_cast<double>(bag->Get("state"));
+	record.Attempt = static_cast<double>(bag->Get("attempt"));
+	record.Class = static_cast<double>(bag->Get("class"));
+	record.LogType = static_cast<double>(bag->Get("log_type"));
+
+	return record;
+}
+
+/**
+ * Calls the callback for every non-empty line which is terminated by a
+ * newline, i.e. the lines std::getline() returns without a partial last one.
+ *
+ * @returns the number of bytes up to and including the last newline
+ */
+template<typename LineFunction>
+static size_t ForEachLine(const char *data, size_t length, uint64_t offset, const LineFunction& lineFn)
+{
+	size_t start = 0;
+
+	for (;;) {
+		auto newline = static_cast<const char *>(memchr(data + start, '\n', length - start));
+
+		if (!newline)
+			return start;
+
+		size_t end = newline - data;
+
+		/* Archives written on Windows before the log was opened in binary mode. */
+		if (end > start && data[end - 1] == '\r')
+			end--;
+
+		if (end > start)
+			lineFn(String(data + start, data + end), offset + start);
+
+		start = newline - data + 1;
+	}
+}
+
+/**
+ * Parses a line of the compat log, e.g.
+ * [1379025342] SERVICE NOTIFICATION: contactname;hostname;servicedesc;WARNING;true;foo output
+ */
+Dictionary::Ptr CompatLogIndex::ParseLine(const String& text)
+{
+	Dictionary::Ptr bag = new Dictionary();
+
+	unsigned long time = atoi(text.SubStr(1, 11).CStr());
+
+	bag->Set("time", time);
+
+	size_t colon = text.FindFirstOf(':');
+	size_t colon_offset = colon - 13;
+
+	String type = String(text.SubStr(13, colon_offset)).Trim();
+	String options = String(text.SubStr(colon + 1)).Trim();
+
+	bag->Set("type", type);
+	bag->Set("options", options);
+
+	std::vector<String> tokens = options.Split(";");
+
+	/* set default values */
+	bag->Set("class", LogEntryClassInfo);
+	bag->Set("log_type", 0);
+	bag->Set("state", 0);
+	bag->Set("attempt", 0);
+	bag->Set("message", text); /* used as 'message' in log table, and 'log_output' in statehist table */
+
+	if (type.Contains("INITIAL HOST STATE") ||
+		type.Contains("CURRENT HOST STATE") ||
+		type.Contains("HOST ALERT")) {
+		if (tokens.size() < 5)
+			return bag;
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("state", Host::StateFromString(tokens[1]));
+		bag->Set("state_type", tokens[2]);
+		bag->Set("attempt", atoi(tokens[3].CStr()));
+		bag->Set("plugin_output", tokens[4]);
+
+		if (type.Contains("INITIAL HOST STATE")) {
+			bag->Set("class", LogEntryClassState);
+			bag->Set("log_type", LogEntryTypeHostInitialState);
+		}
+		else if (type.Contains("CURRENT HOST STATE")) {
+			bag->Set("class", LogEntryClassState);
+			bag->Set("log_type", LogEntryTypeHostCurrentState);
+		}
+		else {
+			bag->Set("class", LogEntryClassAlert);
+			bag->Set("log_type", LogEntryTypeHostAlert);
+		}
+
+		return bag;
+	} else if (type.Contains("HOST DOWNTIME ALERT") ||  type.Contains("HOST FLAPPING ALERT")) {
+		if (tokens.size() < 3)
+			return bag;
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("state_type", tokens[1]);
+		bag->Set("comment", tokens[2]);
+
+		if (type.Contains("HOST FLAPPING ALERT")) {
+			bag->Set("class", LogEntryClassAlert);
+			bag->Set("log_type", LogEntryTypeHostFlapping);
+		} else {
+			bag->Set("class", LogEntryClassAlert);
+			bag->Set("log_type", LogEntryTypeHostDowntimeAlert);
+		}
+
+		return bag;
+	} else if (type.Contains("INITIAL SERVICE STATE") ||
+		type.Contains("CURRENT SERVICE STATE") ||
+		type.Contains("SERVICE ALERT")) {
+		if (tokens.size() < 6)
+			return bag;
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("service_description", tokens[1]);
+		bag->Set("state", Service::StateFromString(tokens[2]));
+		bag->Set("state_type", tokens[3]);
+		bag->Set("attempt", atoi(tokens[4].CStr()));
+		bag->Set("plugin_output", tokens[5]);
+
+		if (type.Contains("INITIAL SERVICE STATE")) {
+			bag->Set("class", LogEntryClassState);
+			bag->Set("log_type", LogEntryTypeServiceInitialState);
+		}
+		else if (type.Contains("CURRENT SERVICE STATE")) {
+			bag->Set("class", LogEntryClassState);
+			bag->Set("log_type", LogEntryTypeServiceCurrentState);
+		}
+		else {
+			bag->Set("class", LogEntryClassAlert);
+			bag->Set("log_type", LogEntryTypeServiceAlert);
+		}
+
+		return bag;
+	} else if (type.Contains("SERVICE DOWNTIME ALERT") ||
+		type.Contains("SERVICE FLAPPING ALERT")) {
+		if (tokens.size() < 4)
+			return bag;
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("service_description", tokens[1]);
+		bag->Set("state_type", tokens[2]);
+		bag->Set("comment", tokens[3]);
+
+		if (type.Contains("SERVICE FLAPPING ALERT")) {
+			bag->Set("class", LogEntryClassAlert);
+			bag->Set("log_type", LogEntryTypeServiceFlapping);
+		} else {
+			bag->Set("class", LogEntryClassAlert);
+			bag->Set("log_type", LogEntryTypeServiceDowntimeAlert);
+		}
+
+		return bag;
+	} else if (type.Contains("TIMEPERIOD TRANSITION")) {
+		if (tokens.size() < 4)
+			return bag;
+
+		bag->Set("class", LogEntryClassState);
+		bag->Set("log_type", LogEntryTypeTimeperiodTransition);
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("service_description", tokens[1]);
+		bag->Set("state_type", tokens[2]);
+		bag->Set("comment", tokens[3]);
+	} else if (type.Contains("HOST NOTIFICATION")) {
+		if (tokens.size() < 6)
+			return bag;
+
+		bag->Set("contact_name", tokens[0]);
+		bag->Set("host_name", tokens[1]);
+		bag->Set("state_type", tokens[2].CStr());
+		bag->Set("state", Service::StateFromString(tokens[3]));
+		bag->Set("command_name", tokens[4]);
+		bag->Set("plugin_output", tokens[5]);
+
+		bag->Set("class", LogEntryClassNotification);
+		bag->Set("log_type", LogEntryTypeHostNotification);
+
+		return bag;
+	} else if (type.Contains("SERVICE NOTIFICATION")) {
+		if (tokens.size() < 7)
+			return bag;
+
+		bag->Set("contact_name", tokens[0]);
+		bag->Set("host_name", tokens[1]);
+		bag->Set("service_description", tokens[2]);
+		bag->Set("state_type", tokens[3].CStr());
+		bag->Set("state", Service::StateFromString(tokens[4]));
+		bag->Set("command_name", tokens[5]);
+		bag->Set("plugin_output", tokens[6]);
+
+		bag->Set("class", LogEntryClassNotification);
+		bag->Set("log_type", LogEntryTypeServiceNotification);
+
+		return bag;
+	} else if (type.Contains("PASSIVE HOST CHECK")) {
+		if (tokens.size() < 3)
+			return bag;
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("state", Host::StateFromString(tokens[1]));
+		bag->Set("plugin_output", tokens[2]);
+
+		bag->Set("class", LogEntryClassPassive);
+
+		return bag;
+	} else if (type.Contains("PASSIVE SERVICE CHECK")) {
+		if (tokens.size() < 4)
+			return bag;
+
+		bag->Set("host_name", tokens[0]);
+		bag->Set("service_description", tokens[1]);
+		bag->Set("state", Host::StateFromString(tokens[2]));
+		bag->Set("plugin_output", tokens[3]);
+
+		bag->Set("class", LogEntryClassPassive);
+
+		return bag;
+	} else if (type.Contains("EXTERNAL COMMAND")) {
+		bag->Set("class", LogEntryClassCommand);
+		/* string processing not implemented in 1.x */
+
+		return bag;
+	} else if (type.Contains("LOG VERSION")) {
+		bag->Set("class", LogEntryClassProgram);
+		bag->Set("log_type", LogEntryTypeVersion);
+
+		return bag;
+	} else if (type.Contains("logging initial states")) {
+		bag->Set("class", LogEntryClassProgram);
+		bag->Set("log_type", LogEntryTypeInitialStates);
+
+		return bag;
+	} else if (type.Contains("starting... (PID=")) {
+		bag->Set("class", LogEntryClassProgram);
+		bag->Set("log_type", LogEntryTypeProgramStarting);
+
+		return bag;
+	}
+	/* program */
+	else if (type.Contains("restarting...") ||
+		type.Contains("shutting down...") ||
+		type.Contains("Bailing out") ||
+		type.Contains("active mode...") ||
+		type.Contains("standby mode...")) {
+		bag->Set("class", LogEntryClassProgram);
+
+		return bag;
+	}
+
+	return bag;
+}
+
+/**
+ * Loads the index of a log file and parses the lines which were written
+ * after it.
+ *
+ * @param persist whether to write the index if it had to be (re)built, only
+ *                for files which aren't written anymore
+ * @returns false if the log file can't be read
+ */
+bool CompatLogPartition::Load(const String& logPath, bool persist)
+{
+	Clear();
+
+	m_Log.close();
+	m_Log.clear();
+	m_Log.open(logPath.CStr(), std::ifstream::in | std::ifstream::binary);
+
+	if (!m_Log)
+		return false;
+
+	uint64_t logSize = m_Log.seekg(0, std::ifstream::end).tellg();
+
+	String indexPath = CompatLogIndex::GetIndexPath(logPath);
+	std::vector<char> index;
+
+	{
+		std::ifstream fp (indexPath.CStr(), std::ifstream::in | std::ifstream::binary);
+
+		if (fp) {
+			index.resize(fp.seekg(0, std::ifstream::end).tellg());
+			fp.seekg(0);
+			fp.read(index.data(), index.size());
+			index.resize(fp.gcount());
+		}
+	}
+
+	size_t pos = CompatLogIndex::GetMagicLength();
+	uint64_t end = 0;
+
+	if (index.size() < pos || memcmp(index.data(), CompatLogIndex::GetMagic(), pos) != 0)
+		pos = index.size();
+
+	/* The log file may be written to while we're reading its index, anything
+	 * after the first record which isn't complete and plausible is ignored.
+	 */
+	while (index.size() - pos >= sizeof(CompatLogIndexRecord)) {
+		CompatLogIndexRecord record;
+		memcpy(&record, &index[pos], sizeof(record));
+		pos += sizeof(record);
+
+		if (record.Kind == CompatLogIndexRecordString) {
+			if (record.Length > CompatLogIndex::MaxStringLength || index.size() - pos < record.Length)
+				break;
+
+			String value (&index[pos], &index[pos] + record.Length);
+
+			if (m_StringIds.find(value) != m_StringIds.end())
+				break;
+
+			m_StringIds[value] = m_Strings.size();
+			m_Strings.push_back(value);
+			pos += record.Length;
+		} else if (record.Kind == CompatLogIndexRecordEntry) {
+			auto isValidString = [this](uint32_t id) { return id < m_Strings.size() || id >= CompatLogIndex::UnknownString; };
+
+			if (record.Offset < end || record.Length == 0 || record.Offset + record.Length >= logSize
+				|| !isValidString(record.Type) || !isValidString(record.HostName)
+				|| !isValidString(record.ServiceDescription) || !isValidString(record.StateType))
+				break;
+
+			AddEntry(record);
+			end = record.Offset + record.Length + 1;
+		} else
+			break;
+	}
+
+	size_t indexed = GetSize();
+
+	/* The index may still belong to a log file which was rotated. */
+	if (indexed > 0 && (!Verify(0) || !Verify(indexed - 1))) {
+		Log(LogNotice, "CompatLogIndex")
+			<< "Index '" << indexPath << "' doesn't match its log file, rebuilding it.";
+
+		Clear();
+		indexed = 0;
+		end = 0;
+	}
+
+	m_End = end;
+
+	if (end < logSize) {
+		auto internFn = [this](const Value& value) { return AddString(value); };
+		std::vector<char> buffer;
+
+		m_Log.clear();
+		m_Log.seekg(end);
+
+		for (uint64_t next = end; next < logSize;) {
+			size_t count = std::min<uint64_t>(logSize - next, 1024 * 1024);
+			size_t size = buffer.size();
+
+			buffer.resize(size + count);
+			m_Log.read(&buffer[size], count);
+			buffer.resize(size + m_Log.gcount());
+
+			if (buffer.size() == size)
+				break;
+
+			next += buffer.size() - size;
+
+			size_t complete = ForEachLine(buffer.data(), buffer.size(), m_End, [this, &internFn](const String& line, uint64_t offset) {
+				AddEntry(MakeEntry(line, offset, internFn));
+			});
+
+			buffer.erase(buffer.begin(), buffer.begin() + complete);
+			m_End += complete;
+		}
+	}
+
+	if (persist && GetSize() > indexed)
+		Save(indexPath);
+
+	m_LogPosition = UINT64_MAX;
+
+	return true;
+}
+
+size_t CompatLogPartition::GetSize() const
+{
+	return Time.size();
+}
+
+/**
+ * Returns the offset just past the last line which was terminated by a newline.
+ */
+uint64_t CompatLogPartition::GetEnd() const
+{
+	return m_End;
+}
+
+/**
+ * Looks up the id of a string.
+ *
+ * @returns false if no line of the log file has this value
+ */
+bool CompatLogPartition::FindString(const String& value, uint32_t& id) const
+{
+	auto it = m_StringIds.find(value);
+
+	if (it == m_StringIds.end())
+		return false;
+
+	id = it->second;
+	return true;
+}
+
+String CompatLogPartition::GetString(uint32_t id) const
+{
+	if (id >= m_Strings.size())
+		return String();
+
+	return m_Strings[id];
+}
+
+/**
+ * Reads a line from the log file, the index refers to the non-empty lines.
+ */
+String CompatLogPartition::ReadLine(size_t index) const
+{
+	std::string line (Length[index], '\0');
+	uint64_t offset = Offset[index];
+
+	/* Lines are usually read in order, skipping the bytes in between keeps the stream's buffer. */
+	if (m_Log && offset >= m_LogPosition && offset - m_LogPosition <= 64 * 1024) {
+		m_Log.ignore(offset - m_LogPosition);
+	} else {
+		m_Log.clear();
+		m_Log.seekg(offset);
+	}
+
+	m_Log.read(&line[0], line.size());
+	line.resize(m_Log.gcount());
+	m_LogPosition = (m_Log ? offset + line.size() : UINT64_MAX);
+
+	return line;
+}
+
+uint32_t CompatLogPartition::AddString(const Value& value)
+{
+	return InternString(m_StringIds, value, [this](const String& str) { m_Strings.push_back(str); });
+}
+
+void CompatLogPartition::AddEntry(const CompatLogIndexRecord& record)
+{
+	Time.push_back(record.Time);
+	Offset.push_back(record.Offset);
+	Length.push_back(record.Length);
+	Type.push_back(record.Type);
+	HostName.push_back(record.HostName);
+	ServiceDescription.push_back(record.ServiceDescription);
+	StateType.push_back(record.StateType);
+	State.push_back(record.State);
+	Attempt.push_back(record.Attempt);
+	Class.push_back(record.Class);
+	LogType.push_back(record.LogType);
+}
+
+/**
+ * Checks whether an entry still describes a whole line of the log file.
+ */
+bool CompatLogPartition::Verify(size_t index)
+{
+	uint64_t offset = Offset[index];
+	uint64_t start = (offset > 0 ? offset - 1 : 0);
+	std::string buffer (offset - start + Length[index] + 1, '\0');
+
+	m_Log.clear();
+	m_Log.seekg(start);
+
+	if (!m_Log.read(&buffer[0], buffer.size()))
+		return false;
+
+	if (offset > 0 && buffer[0] != '\n')
+		return false;
+
+	if (buffer.back() != '\n' && buffer.back() != '\r')
+		return false;
+
+	return GetLineTime(buffer.substr(offset - start, Length[index])) == Time[index];
+}
+
+void CompatLogPartition::Clear()
+{
+	Time.clear();
+	Offset.clear();
+	Length.clear();
+	Type.clear();
+	HostName.clear();
+	ServiceDescription.clear();
+	StateType.clear();
+	State.clear();
+	Attempt.clear();
+	Class.clear();
+	LogType.clear();
+
+	m_Strings.clear();
+	m_StringIds.clear();
+	m_End = 0;
+	m_LogPosition = UINT64_MAX;
+}
+
+/**
+ * Replaces the index file with the strings and entries of this partition.
+ */
+bool CompatLogPartition::Save(const String& indexPath) const
+{
+	String tempPath;
+
+	try {
+		std::fstream tempFile;
+		tempPath = Utility::CreateTempFile(indexPath + ".XXXXXX", 0644, tempFile);
+	} catch (const std::exception& ex) {
+		Log(LogNotice, "CompatLogIndex")
+			<< "Could not create index file for '" << indexPath << "': " << ex.what();
+		return false;
+	}
+
+	std::ofstream fp (tempPath.CStr(), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+	fp.write(CompatLogIndex::GetMagic(), CompatLogIndex::GetMagicLength());
+
+	CompatLogIndexRecord record;
+	memset(&record, 0, sizeof(record));
+	record.Kind = CompatLogIndexRecordString;
+
+	for (const String& value : m_Strings) {
+		record.Length = value.GetLength();
+		fp.write(reinterpret_cast<const char *>(&record), sizeof(record));
+		fp.write(value.CStr(), value.GetLength());
+	}
+
+	record.Kind = CompatLogIndexRecordEntry;
+
+	for (size_t i = 0; i < GetSize(); i++) {
+		record.Time = Time[i];
+		record.Offset = Offset[i];
+		record.Length = Length[i];
+		record.Type = Type[i];
+		record.HostName = HostName[i];
+		record.ServiceDescription = ServiceDescription[i];
+		record.StateType = StateType[i];
+		record.State = State[i];
+		record.Attempt = Attempt[i];
+		record.Class = Class[i];
+		record.LogType = LogType[i];
+
+		fp.write(reinterpret_cast<const char *>(&record), sizeof(record));
+	}
+
+	fp.close();
+
+	if (!fp) {
+		Log(LogNotice, "CompatLogIndex")
+			<< "Could not write index file '" << tempPath << "'.";
+
+		Utility::Remove(tempPath);
+		return false;
+	}
+
+	try {
+		Utility::RenameFile(tempPath, indexPath);
+	} catch (const std::exception& ex) {
+		Log(LogNotice, "CompatLogIndex")
+			<< "Could not rename index file '" << tempPath << "' to '" << indexPath << "': " << ex.what();
+
+		Utility::Remove(tempPath);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Starts indexing a log file. An index which doesn't cover the whole file
+ * is rebuilt, so the file has to end with a newline.
+ */
+void CompatLogIndex::Open(const String& logPath)
+{
+	Close();
+
+	CompatLogPartition partition;
+	m_Path = GetIndexPath(logPath);
+
+	if (!partition.Load(logPath, false) || !partition.Save(m_Path)) {
+		Log(LogWarning, "CompatLogIndex")
+			<< "Could not build index '" << m_Path << "'. Livestatus queries for its log file are slower.";
+		return;
+	}
+
+	m_Stream.open(m_Path.CStr(), std::ofstream::out | std::ofstream::app | std::ofstream::binary);
+
+	if (!m_Stream) {
+		Log(LogWarning, "CompatLogIndex")
+			<< "Could not open index '" << m_Path << "' for writing. Livestatus queries for its log file are slower.";
+		return;
+	}
+
+	m_StringIds = partition.m_StringIds;
+	m_Offset = partition.GetEnd();
+}
+
+/**
+ * Indexes the lines which were written to the log file at the specified offset.
+ */
+void CompatLogIndex::Append(const String& text, uint64_t offset)
+{
+	if (!m_Stream.is_open())
+		return;
+
+	if (offset != m_Offset) {
+		Log(LogWarning, "CompatLogIndex")
+			<< "Index '" << m_Path << "' is out of sync with its log file, not updating it anymore.";
+		Close();
+		return;
+	}
+
+	auto internFn = [this](const Value& value) {
+		return InternString(m_StringIds, value, [this](const String& str) {
+			CompatLogIndexRecord record;
+			memset(&record, 0, sizeof(record));
+			record.Kind = CompatLogIndexRecordString;
+			record.Length = str.GetLength();
+
+			WriteRecord(record, str);
+		});
+	};
+
+	m_Offset += ForEachLine(text.CStr(), text.GetLength(), offset, [this, &internFn](const String& line, uint64_t lineOffset) {
+		WriteRecord(MakeEntry(line, lineOffset, internFn));
+	});
+
+	if (!m_Stream) {
+		Log(LogWarning, "CompatLogIndex")
+			<< "Could not write index '" << m_Path << "', not updating it anymore.";
+		Close();
+	}
+}
+
+void CompatLogIndex::Flush()
+{
+	if (!m_Stream.is_open())
+		return;
+
+	m_Stream.flush();
+
+	if (!m_Stream) {
+		Log(LogWarning, "CompatLogIndex")
+			<< "Could not write index '" << m_Path << "', not updating it anymore.";
+		Close();
+	}
+}
+
+void CompatLogIndex::Close()
+{
+	m_Stream.close();
+	m_Stream.clear();
+	m_StringIds.clear();
+	m_Offset = 0;
+}
+
+void CompatLogIndex::WriteRecord(const CompatLogIndexRecord& record, const String& value)
+{
+	m_Stream.write(reinterpret_cast<const char *>(&record), sizeof(record));
+
+	if (!value.IsEmpty())
+		m_Stream.write(value.CStr(), value.GetLength());
+}
@@ -0,0 +1,164 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef COMPATLOGINDEX_H
+#define COMPATLOGINDEX_H
+
+#include "icinga/i2-icinga.hpp"
+#include "base/dictionary.hpp"
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <vector>
+
+namespace icinga
+{
+
+enum LogEntryType {
+	LogEntryTypeHostAlert,
+	LogEntryTypeHostDowntimeAlert,
+	LogEntryTypeHostFlapping,
+	LogEntryTypeHostNotification,
+	LogEntryTypeHostInitialState,
+	LogEntryTypeHostCurrentState,
+	LogEntryTypeServiceAlert,
+	LogEntryTypeServiceDowntimeAlert,
+	LogEntryTypeServiceFlapping,
+	LogEntryTypeServiceNotification,
+	LogEntryTypeServiceInitialState,
+	LogEntryTypeServiceCurrentState,
+	LogEntryTypeTimeperiodTransition,
+	LogEntryTypeVersion,
+	LogEntryTypeInitialStates,
+	LogEntryTypeProgramStarting
+};
+
+enum LogEntryClass {
+	LogEntryClassInfo = 0,
+	LogEntryClassAlert = 1,
+	LogEntryClassProgram = 2,
+	LogEntryClassNotification = 3,
+	LogEntryClassPassive = 4,
+	LogEntryClassCommand = 5,
+	LogEntryClassState = 6,
+	LogEntryClassText = 7
+};
+
+enum CompatLogIndexRecordKind : uint8_t {
+	CompatLogIndexRecordEntry = 1,
+	CompatLogIndexRecordString = 2
+};
+
+/**
+ * A record in a compat log index (<logfile>.idx). Entries describe one
+ * non-empty line of the log file, string records are followed by Length
+ * bytes and get the next string id, starting at 0.
+ *
+ * @ingroup icinga
+ */
+struct CompatLogIndexRecord
+{
+	int64_t Time;
+	uint64_t Offset;
+	uint32_t Length;
+	uint32_t Type;
+	uint32_t HostName;
+	uint32_t ServiceDescription;
+	uint32_t StateType;
+	int32_t State;
+	int32_t Attempt;
+	uint8_t Kind;
+	uint8_t Class;
+	uint8_t LogType;
+	uint8_t Reserved;
+};
+
+/**
+ * The parsed lines of one compat log file, column by column.
+ *
+ * @ingroup icinga
+ */
+class CompatLogPartition
+{
+public:
+	std::vector<int64_t> Time;
+	std::vector<uint64_t> Offset;
+	std::vector<uint32_t> Length;
+	std::vector<uint32_t> Type;
+	std::vector<uint32_t> HostName;
+	std::vector<uint32_t> ServiceDescription;
+	std::vector<uint32_t> StateType;
+	std::vector<int32_t> State;
+	std::vector<int32_t> Attempt;
+	std::vector<uint8_t> Class;
+	std::vector<uint8_t> LogType;
+
+	CompatLogPartition() = default;
+	CompatLogPartition(const CompatLogPartition&) = delete;
+	CompatLogPartition& operator=(const CompatLogPartition&) = delete;
+
+	bool Load(const String& logPath, bool persist);
+
+	size_t GetSize() const;
+	uint64_t GetEnd() const;
+
+	bool FindString(const String& value, uint32_t& id) const;
+	String GetString(uint32_t id) const;
+
+	String ReadLine(size_t index) const;
+
+private:
+	std::vector<String> m_Strings;
+	std::map<String, uint32_t> m_StringIds;
+	uint64_t m_End{0};
+	mutable std::ifstream m_Log;
+	mutable uint64_t m_LogPosition{UINT64_MAX};
+
+	friend class CompatLogIndex;
+
+	uint32_t AddString(const Value& value);
+	void AddEntry(const CompatLogIndexRecord& record);
+	bool Verify(size_t index);
+	void Clear();
+	bool Save(const String& indexPath) const;
+};
+
+/**
+ * Maintains the index next to the compat log file which is currently written.
+ *
+ * @ingroup icinga
+ */
+class CompatLogIndex
+{
+public:
+	/* Strings which aren't set for a line, e.g. the service of a host alert. */
+	static const uint32_t NoString = UINT32_MAX;
+
+	/* Strings which were too long to be stored, the line has to be parsed. */
+	static const uint32_t UnknownString = UINT32_MAX - 1;
+
+	/* Longer strings aren't stored in the index. */
+	static const uint32_t MaxStringLength = 64 * 1024;
+
+	static const char *GetMagic();
+	static size_t GetMagicLength();
+
+	static String GetIndexPath(const String& logPath);
+	static Dictionary::Ptr ParseLine(const String& line);
+
+	void Open(const String& logPath);
+	void Append(const String& text, uint64_t offset);
+	void Flush();
+	void Close();
+
+private:
+	String m_Path;
+	std::ofstream m_Stream;
+	std::map<String, uint32_t> m_StringIds;
+	uint64_t m_Offset{0};
+
+	void WriteRecord(const CompatLogIndexRecord& record, const String& value = String());
+};
+
+}
+
+#endif /* COMPATLOGINDEX_H */
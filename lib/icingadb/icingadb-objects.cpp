@@ -30,6 +30,8 @@
 #include "icinga/timeperiod.hpp"
 #include "icinga/pluginutility.hpp"
 #include "remote/zone.hpp"
+#include <atomic>
+#include <future>
 #include <iterator>
 #include <map>
 #include <memory>
@@ -220,7 +222,8 @@ void IcingaDB::UpdateAllConfigObjects()
 		std::map<String, String> redisCheckSums;
 		String configCheckSum = m_PrefixConfigCheckSum + lcType;
 
-		upqObjectType.Enqueue([&rcon, &configCheckSum, &redisCheckSums]() {
+		// The checksums in Redis are needed upfront to skip unchanged objects while dumping.
+		{
 			String cursor = "0";
 
 			do {
@@ -243,14 +246,15 @@ void IcingaDB::UpdateAllConfigObjects()
 
 				cursor = res->Get(0);
 			} while (cursor != "0");
-		});
+		}
 
 		auto objectChunks (ChunkObjects(ctype->GetObjects(), 500));
 		String configObject = m_PrefixConfigObject + lcType;
 
-		// Skimmed away attributes and checksums HMSETs' keys and values by Redis key.
-		std::map<String, std::vector<std::vector<String>>> ourContentRaw {{configCheckSum, {}}, {configObject, {}}};
-		std::mutex ourContentMutex;
+		// IDs of all objects dumped, anything else in Redis is deleted afterwards.
+		std::set<String> ourIds;
+		std::mutex ourIdsMutex;
+		std::atomic<size_t> unchanged (0);
 
 		upqObjectType.ParallelFor(objectChunks, [&](decltype(objectChunks)::const_reference chunk) {
 			std::map<String, std::vector<String>> hMSets;
@@ -260,18 +264,63 @@ void IcingaDB::UpdateAllConfigObjects()
 			std::vector<String> statesChksms = {"HMSET", m_PrefixConfigCheckSum + lcType + ":state"};
 			std::vector<std::vector<String> > transaction = {{"MULTI"}};
 			std::vector<String> hostZAdds = {"ZADD", "icinga:nextupdate:host"}, serviceZAdds = {"ZADD", "icinga:nextupdate:service"};
+			std::vector<String> chunkIds;
+			std::future<void> written;
 
-			auto skimObjects ([&]() {
-				std::lock_guard<std::mutex> l (ourContentMutex);
+			// Drops the objects whose checksum is already in Redis, the attributes are in the same order as the checksums.
+			auto skipUnchanged ([&]() {
+				auto checkSums (hMSets.find(configCheckSum));
+				auto objects (hMSets.find(configObject));
 
-				for (auto& kv : ourContentRaw) {
-					auto pos (hMSets.find(kv.first));
+				if (checkSums == hMSets.end() || checkSums->second.empty())
+					return;
+
+				for (decltype(checkSums->second.size()) i = 0; i < checkSums->second.size(); i += 2u) {
+					chunkIds.emplace_back(checkSums->second[i]);
+				}
 
-					if (pos != hMSets.end()) {
-						kv.second.emplace_back(std::move(pos->second));
-						hMSets.erase(pos);
+				if (objects == hMSets.end() || checkSums->second.size() != objects->second.size())
+					return;
+
+				std::vector<String> changedCheckSums, changedObjects;
+
+				for (decltype(checkSums->second.size()) i = 0, stop = checkSums->second.size() - 1u; i < stop; i += 2u) {
+					auto& id (checkSums->second[i]);
+					auto redisCheckSum (redisCheckSums.find(id));
+
+					if (redisCheckSum != redisCheckSums.end() && redisCheckSum->second == checkSums->second[i + 1u]
+						&& objects->second[i] == id) {
+						unchanged.fetch_add(1);
+						continue;
 					}
+
+					changedCheckSums.emplace_back(std::move(id));
+					changedCheckSums.emplace_back(std::move(checkSums->second[i + 1u]));
+					changedObjects.emplace_back(std::move(objects->second[i]));
+					changedObjects.emplace_back(std::move(objects->second[i + 1u]));
 				}
+
+				checkSums->second = std::move(changedCheckSums);
+				objects->second = std::move(changedObjects);
+			});
+
+			// Sends the transaction and waits until the previous one has been written,
+			// so that a worker never has more than two of them queued at once.
+			auto sendTransaction ([&]() {
+				if (transaction.size() <= 1)
+					return;
+
+				transaction.push_back({"EXEC"});
+				rcon->FireAndForgetQueries(std::move(transaction), Prio::Config);
+				transaction = {{"MULTI"}};
+
+				if (written.valid())
+					written.wait();
+
+				auto promise (Shared<std::promise<void>>::Make());
+				written = promise->get_future();
+
+				rcon->EnqueueCallback([promise](boost::asio::yield_context&) { promise->set_value(); }, Prio::Config);
 			});
 
 			bool dumpState = (lcType == "host" || lcType == "service");
@@ -298,7 +347,7 @@ void IcingaDB::UpdateAllConfigObjects()
 
 				bulkCounter++;
 				if (!(bulkCounter % 100)) {
-					skimObjects();
+					skipUnchanged();
 
 					for (auto& kv : hMSets) {
 						if (!kv.second.empty()) {
@@ -316,11 +365,7 @@ void IcingaDB::UpdateAllConfigObjects()
 
 					hMSets = decltype(hMSets)();
 
-					if (transaction.size() > 1) {
-						transaction.push_back({"EXEC"});
-						rcon->FireAndForgetQueries(std::move(transaction), Prio::Config);
-						transaction = {{"MULTI"}};
-					}
+					sendTransaction();
 				}
 
 				auto checkable (dynamic_pointer_cast<Checkable>(object));
@@ -341,7 +386,7 @@ void IcingaDB::UpdateAllConfigObjects()
 				}
 			}
 
-			skimObjects();
+			skipUnchanged();
 
 			for (auto& kv : hMSets) {
 				if (!kv.second.empty()) {
@@ -355,10 +400,10 @@ void IcingaDB::UpdateAllConfigObjects()
 				transaction.emplace_back(std::move(statesChksms));
 			}
 
-			if (transaction.size() > 1) {
-				transaction.push_back({"EXEC"});
-				rcon->FireAndForgetQueries(std::move(transaction), Prio::Config);
-			}
+			sendTransaction();
+
+			if (written.valid())
+				written.wait();
 
 			for (auto zAdds : {&hostZAdds, &serviceZAdds}) {
 				if (zAdds->size() > 2u) {
@@ -366,6 +411,14 @@ void IcingaDB::UpdateAllConfigObjects()
 				}
 			}
 
+			{
+				std::lock_guard<std::mutex> l (ourIdsMutex);
+
+				for (auto& id : chunkIds) {
+					ourIds.emplace(std::move(id));
+				}
+			}
+
 			Log(LogNotice, "IcingaDB")
 					<< "Dumped " << bulkCounter << " objects of type " << lcType;
 		});
@@ -380,52 +433,10 @@ void IcingaDB::UpdateAllConfigObjects()
 			}
 		}
 
-		std::map<String, std::map<String, String>> ourContent;
-
-		for (auto& source : ourContentRaw) {
-			auto& dest (ourContent[source.first]);
-
-			upqObjectType.Enqueue([&]() {
-				for (auto& hMSet : source.second) {
-					for (decltype(hMSet.size()) i = 0, stop = hMSet.size() - 1u; i < stop; i += 2u) {
-						dest.emplace(std::move(hMSet[i]), std::move(hMSet[i + 1u]));
-					}
-
-					hMSet.clear();
-				}
-
-				source.second.clear();
-			});
-		}
-
-		upqObjectType.Join();
-		ourContentRaw.clear();
-
-		auto& ourCheckSums (ourContent[configCheckSum]);
-		auto& ourObjects (ourContent[configObject]);
-		std::vector<String> setChecksum, setObject, delChecksum, delObject;
-
-		auto redisCurrent (redisCheckSums.begin());
-		auto redisEnd (redisCheckSums.end());
-		auto ourCurrent (ourCheckSums.begin());
-		auto ourEnd (ourCheckSums.end());
-
-		auto flushSets ([&]() {
-			setChecksum.insert(setChecksum.begin(), {"HMSET", configCheckSum});
-			setObject.insert(setObject.begin(), {"HMSET", configObject});
-
-			std::vector<std::vector<String>> transaction;
-
-			transaction.emplace_back(std::vector<String>{"MULTI"});
-			transaction.emplace_back(std::move(setChecksum));
-			transaction.emplace_back(std::move(setObject));
-			transaction.emplace_back(std::vector<String>{"EXEC"});
-
-			setChecksum.clear();
-			setObject.clear();
+		Log(LogNotice, "IcingaDB")
+				<< "Skipped " << unchanged.load() << " unchanged objects of type " << lcType;
 
-			rcon->FireAndForgetQueries(std::move(transaction), Prio::Config);
-		});
+		std::vector<String> delChecksum, delObject;
 
 		auto flushDels ([&]() {
 			delChecksum.insert(delChecksum.begin(), {"HDEL", configCheckSum});
@@ -444,52 +455,14 @@ void IcingaDB::UpdateAllConfigObjects()
 			rcon->FireAndForgetQueries(std::move(transaction), Prio::Config);
 		});
 
-		auto setOne ([&]() {
-			setChecksum.emplace_back(ourCurrent->first);
-			setChecksum.emplace_back(ourCurrent->second);
-			setObject.emplace_back(ourCurrent->first);
-			setObject.emplace_back(ourObjects[ourCurrent->first]);
-
-			if (setChecksum.size() == 100u) {
-				flushSets();
-			}
-		});
-
-		auto delOne ([&]() {
-			delChecksum.emplace_back(redisCurrent->first);
-			delObject.emplace_back(redisCurrent->first);
-
-			if (delChecksum.size() == 100u) {
-				flushDels();
-			}
-		});
-
-		for (;;) {
-			if (redisCurrent == redisEnd) {
-				for (; ourCurrent != ourEnd; ++ourCurrent) {
-					setOne();
-				}
+		for (auto& kv : redisCheckSums) {
+			if (ourIds.find(kv.first) == ourIds.end()) {
+				delChecksum.emplace_back(kv.first);
+				delObject.emplace_back(kv.first);
 
-				break;
-			} else if (ourCurrent == ourEnd) {
-				for (; redisCurrent != redisEnd; ++redisCurrent) {
-					delOne();
+				if (delChecksum.size() == 100u) {
+					flushDels();
 				}
-
-				break;
-			} else if (redisCurrent->first < ourCurrent->first) {
-				delOne();
-				++redisCurrent;
-			} else if (redisCurrent->first > ourCurrent->first) {
-				setOne();
-				++ourCurrent;
-			} else {
-				if (redisCurrent->second != ourCurrent->second) {
-					setOne();
-				}
-
-				++redisCurrent;
-				++ourCurrent;
 			}
 		}
 
@@ -497,10 +470,6 @@ void IcingaDB::UpdateAllConfigObjects()
 			flushDels();
 		}
 
-		if (setChecksum.size()) {
-			flushSets();
-		}
-
 		for (auto& key : GetTypeDumpSignalKeys(type)) {
 			rcon->FireAndForgetQuery({"XADD", "icinga:dump", "*", "key", key, "state", "done"}, Prio::Config);
 		}
@@ -1118,10 +1087,9 @@ void IcingaDB::UpdateState(const Checkable::Ptr& checkable, StateUpdate mode)
 	String checksum = HashValue(stateAttrs);
 
 	if (mode & StateUpdate::Volatile) {
-		m_Rcon->FireAndForgetQueries({
-			{"HSET", redisStateKey, objectKey, JsonEncode(stateAttrs)},
-			{"HSET", redisChecksumKey, objectKey, JsonEncode(new Dictionary({{"checksum", checksum}}))},
-		}, Prio::RuntimeStateSync);
+		// Coalesced by the connection, so only the latest state of a burst is sent
+		m_Rcon->FireAndForgetHSet(redisStateKey, objectKey, JsonEncode(stateAttrs), Prio::RuntimeStateSync);
+		m_Rcon->FireAndForgetHSet(redisChecksumKey, objectKey, JsonEncode(new Dictionary({{"checksum", checksum}})), Prio::RuntimeStateSync);
 	}
 
 	if (mode & StateUpdate::RuntimeOnly) {
@@ -1520,7 +1488,21 @@ IcingaDB::CreateConfigUpdate(const ConfigObject::Ptr& object, const String typeN
 	attrs.emplace_back(objectKey);
 	attrs.emplace_back(JsonEncode(attr));
 
-	String checksum = HashValue(attr);
+	/* Comments and downtimes change without a new version, e.g. when a downtime is triggered.
+	 * Runtime updates are always hashed, their version might be set only after the update.
+	 */
+	Type::Ptr type = object->GetReflectionType();
+	bool cacheable = type != Comment::TypeInstance && type != Downtime::TypeInstance;
+	double version = object->GetVersion();
+	String checksum;
+
+	if (!cacheable || runtimeUpdate || !m_ConfigChecksums.Get(objectKey, version, checksum)) {
+		checksum = HashValue(attr);
+
+		if (cacheable)
+			m_ConfigChecksums.Set(objectKey, version, checksum);
+	}
+
 	chksms.emplace_back(objectKey);
 	chksms.emplace_back(JsonEncode(new Dictionary({{"checksum", checksum}})));
 
@@ -1537,6 +1519,8 @@ void IcingaDB::SendConfigDelete(const ConfigObject::Ptr& object)
 	String typeName = type->GetName().ToLower();
 	String objectKey = GetObjectIdentifier(object);
 
+	m_ConfigChecksums.Remove(objectKey);
+
 	m_Rcon->FireAndForgetQueries({
 		{"HDEL", m_PrefixConfigObject + typeName, objectKey},
 		{"HDEL", m_PrefixConfigCheckSum + typeName, objectKey},
@@ -2,7 +2,6 @@
 
 #include "icingadb/icingadb.hpp"
 #include "base/configtype.hpp"
-#include "base/object-packer.hpp"
 #include "base/logger.hpp"
 #include "base/serializer.hpp"
 #include "base/tlsutility.hpp"
@@ -139,7 +138,7 @@ Dictionary::Ptr IcingaDB::SerializeVars(const Dictionary::Ptr& vars)
 
 	for (auto& kv : vars) {
 		res->Set(
-			SHA1(PackObject((Array::Ptr)new Array({m_EnvironmentId, kv.first, kv.second}))),
+			SHA1PackObject((Array::Ptr)new Array({m_EnvironmentId, kv.first, kv.second})),
 			(Dictionary::Ptr)new Dictionary({
 				{"environment_id", m_EnvironmentId},
 				{"name_checksum", SHA1(kv.first)},
@@ -230,7 +229,7 @@ String IcingaDB::HashValue(const Value& value, const std::set<String>& propertie
 		}
 	}
 
-	return SHA1(PackObject(temp));
+	return SHA1PackObject(temp);
 }
 
 String IcingaDB::GetLowerCaseTypeNameDB(const ConfigObject::Ptr& obj)
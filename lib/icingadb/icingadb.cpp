@@ -187,6 +187,7 @@ void IcingaDB::PublishStats()
 	status->Set("config_dump_in_progress", m_ConfigDumpInProgress);
 	status->Set("timestamp", TimestampToMilliseconds(Utility::GetTime()));
 	status->Set("icingadb_environment", m_EnvironmentId);
+	status->Set("redis_writes", m_Rcon->GetWriteStats());
 
 	std::vector<String> query {"XADD", "icinga:stats", "MAXLEN", "1", "*"};
 
@@ -249,3 +250,27 @@ bool IcingaDB::DumpedGlobals::IsNew(const String& id)
 	std::lock_guard<std::mutex> l (m_Mutex);
 	return m_Ids.emplace(id).second;
 }
+
+bool IcingaDB::ConfigChecksums::Get(const String& id, double version, String& checksum)
+{
+	std::lock_guard<std::mutex> l (m_Mutex);
+	auto it (m_Checksums.find(id));
+
+	if (it == m_Checksums.end() || it->second.first != version)
+		return false;
+
+	checksum = it->second.second;
+	return true;
+}
+
+void IcingaDB::ConfigChecksums::Set(const String& id, double version, const String& checksum)
+{
+	std::lock_guard<std::mutex> l (m_Mutex);
+	m_Checksums[id] = std::make_pair(version, checksum);
+}
+
+void IcingaDB::ConfigChecksums::Remove(const String& id)
+{
+	std::lock_guard<std::mutex> l (m_Mutex);
+	m_Checksums.erase(id);
+}
@@ -13,6 +13,7 @@
 #include "icinga/downtime.hpp"
 #include "remote/messageorigin.hpp"
 #include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -57,6 +58,19 @@ private:
 		std::mutex m_Mutex;
 	};
 
+	/* Config checksums by object, valid as long as the object's version doesn't change. */
+	class ConfigChecksums
+	{
+	public:
+		bool Get(const String& id, double version, String& checksum);
+		void Set(const String& id, double version, const String& checksum);
+		void Remove(const String& id);
+
+	private:
+		std::map<String, std::pair<double, String>> m_Checksums;
+		std::mutex m_Mutex;
+	};
+
 	enum StateUpdate
 	{
 		Volatile    = 1ull << 0,
@@ -190,6 +204,8 @@ private:
 		DumpedGlobals CustomVar, ActionUrl, NotesUrl, IconImage;
 	} m_DumpedGlobals;
 
+	ConfigChecksums m_ConfigChecksums;
+
 	static String m_EnvironmentId;
 	static std::once_flag m_EnvironmentIdOnce;
 };
@@ -30,6 +30,13 @@ namespace asio = boost::asio;
 
 boost::regex RedisConnection::m_ErrAuth ("\\AERR AUTH ");
 
+/* How long to collect HSET fields before queueing them as one HSET per key */
+static const boost::posix_time::milliseconds l_HSetWindow (50);
+
+/* Write buffer of plain connections, queries are only flushed once the write queue has been emptied */
+static const size_t l_ReadBufferSize = 1024;
+static const size_t l_WriteBufferSize = 64 * 1024;
+
 RedisConnection::RedisConnection(const String& host, int port, const String& path, const String& password, int db,
 	bool useTls, bool insecure, const String& certPath, const String& keyPath, const String& caPath, const String& crlPath,
 	const String& tlsProtocolmin, const String& cipherList, double connectTimeout, DebugInfo di, const RedisConnection::Ptr& parent)
@@ -123,6 +130,7 @@ void RedisConnection::FireAndForgetQuery(RedisConnection::Query query, RedisConn
 	auto item (Shared<Query>::Make(std::move(query)));
 
 	asio::post(m_Strand, [this, item, priority]() {
+		QueuePendingHSets(priority);
 		m_Queues.Writes[priority].emplace(WriteQueueItem{item, nullptr, nullptr, nullptr});
 		m_QueuedWrites.Set();
 		IncreasePendingQueries(1);
@@ -145,12 +153,91 @@ void RedisConnection::FireAndForgetQueries(RedisConnection::Queries queries, Red
 	auto item (Shared<Queries>::Make(std::move(queries)));
 
 	asio::post(m_Strand, [this, item, priority]() {
+		QueuePendingHSets(priority);
 		m_Queues.Writes[priority].emplace(WriteQueueItem{nullptr, item, nullptr, nullptr});
 		m_QueuedWrites.Set();
 		IncreasePendingQueries(item->size());
 	});
 }
 
+/**
+ * Queue setting a hash field for sending
+ *
+ * Fields are collected for a short time and sent as one HSET per key. If the
+ * same field is set again in the meantime, only the latest value is sent.
+ *
+ * @param key Redis key of the hash
+ * @param field Hash field
+ * @param value Field value
+ * @param priority The query's priority
+ */
+void RedisConnection::FireAndForgetHSet(const String& key, const String& field, String value, RedisConnection::QueryPriority priority)
+{
+	Log(LogDebug, "IcingaDB")
+		<< "Firing and forgetting query: 'HSET' '" << key << "' '" << field << "' ...";
+
+	Ptr keepAlive (this);
+
+	asio::post(m_Strand, [this, keepAlive, key, field, value, priority]() mutable {
+		m_PendingHSets[priority][key][field] = std::move(value);
+		m_HSetFieldsIn.fetch_add(1);
+
+		if (!m_PendingHSetsScheduled) {
+			m_PendingHSetsScheduled = true;
+
+			IoEngine::SpawnCoroutine(m_Strand, [this, keepAlive](asio::yield_context yc) {
+				asio::deadline_timer timer (m_Strand.context());
+				timer.expires_from_now(l_HSetWindow);
+				timer.async_wait(yc);
+
+				QueuePendingHSets(QueryPriority::SyncConnection);
+			});
+		}
+	});
+}
+
+/**
+ * Move the pending HSET fields into the write queue
+ *
+ * Called before anything else is queued with the same priority to keep the order of queries.
+ *
+ * @param priority Only move the fields with this priority, SyncConnection moves all
+ */
+void RedisConnection::QueuePendingHSets(RedisConnection::QueryPriority priority)
+{
+	for (auto it (m_PendingHSets.begin()); it != m_PendingHSets.end();) {
+		if (priority != QueryPriority::SyncConnection && it->first != priority) {
+			++it;
+			continue;
+		}
+
+		auto& queue (m_Queues.Writes[it->first]);
+
+		for (auto& hash : it->second) {
+			auto query (Shared<Query>::Make());
+			query->reserve(2 + hash.second.size() * 2);
+			query->emplace_back("HSET");
+			query->emplace_back(hash.first);
+
+			for (auto& field : hash.second) {
+				query->emplace_back(field.first);
+				query->emplace_back(std::move(field.second));
+			}
+
+			m_HSetFieldsOut.fetch_add(hash.second.size());
+			queue.emplace(WriteQueueItem{query, nullptr, nullptr, nullptr});
+			IncreasePendingQueries(1);
+		}
+
+		it = m_PendingHSets.erase(it);
+		m_QueuedWrites.Set();
+	}
+
+	if (m_PendingHSets.empty()) {
+		m_PendingHSetsScheduled = false;
+	}
+}
+
 /**
  * Queue a Redis query for sending, wait for the response and return (or throw) it
  *
@@ -171,6 +258,7 @@ RedisConnection::Reply RedisConnection::GetResultOfQuery(RedisConnection::Query
 	auto item (Shared<std::pair<Query, std::promise<Reply>>>::Make(std::move(query), std::move(promise)));
 
 	asio::post(m_Strand, [this, item, priority]() {
+		QueuePendingHSets(priority);
 		m_Queues.Writes[priority].emplace(WriteQueueItem{nullptr, nullptr, item, nullptr});
 		m_QueuedWrites.Set();
 		IncreasePendingQueries(1);
@@ -201,6 +289,7 @@ RedisConnection::Replies RedisConnection::GetResultsOfQueries(RedisConnection::Q
 	auto item (Shared<std::pair<Queries, std::promise<Replies>>>::Make(std::move(queries), std::move(promise)));
 
 	asio::post(m_Strand, [this, item, priority]() {
+		QueuePendingHSets(priority);
 		m_Queues.Writes[priority].emplace(WriteQueueItem{nullptr, nullptr, nullptr, item});
 		m_QueuedWrites.Set();
 		IncreasePendingQueries(item->first.size());
@@ -214,6 +303,7 @@ RedisConnection::Replies RedisConnection::GetResultsOfQueries(RedisConnection::Q
 void RedisConnection::EnqueueCallback(const std::function<void(boost::asio::yield_context&)>& callback, RedisConnection::QueryPriority priority)
 {
 	asio::post(m_Strand, [this, callback, priority]() {
+		QueuePendingHSets(priority);
 		m_Queues.Writes[priority].emplace(WriteQueueItem{nullptr, nullptr, nullptr, nullptr, callback});
 		m_QueuedWrites.Set();
 	});
@@ -299,7 +389,7 @@ void RedisConnection::Connect(asio::yield_context& yc)
 					Log(m_Parent ? LogNotice : LogInformation, "IcingaDB")
 						<< "Trying to connect to Redis server (async) on host '" << m_Host << ":" << m_Port << "'";
 
-					auto conn (Shared<TcpConn>::Make(m_Strand.context()));
+					auto conn (Shared<TcpConn>::Make(m_Strand.context(), l_ReadBufferSize, l_WriteBufferSize));
 					auto connectTimeout (MakeTimeout(conn));
 					Defer cancelTimeout ([&connectTimeout]() { connectTimeout->Cancel(); });
 
@@ -311,7 +401,7 @@ void RedisConnection::Connect(asio::yield_context& yc)
 				Log(LogInformation, "IcingaDB")
 					<< "Trying to connect to Redis server (async) on unix socket path '" << m_Path << "'";
 
-				auto conn (Shared<UnixConn>::Make(m_Strand.context()));
+				auto conn (Shared<UnixConn>::Make(m_Strand.context(), l_ReadBufferSize, l_WriteBufferSize));
 				auto connectTimeout (MakeTimeout(conn));
 				Defer cancelTimeout ([&connectTimeout]() { connectTimeout->Cancel(); });
 
@@ -449,6 +539,9 @@ void RedisConnection::WriteLoop(asio::yield_context& yc)
 			goto WriteFirstOfHighestPrio;
 		}
 
+		// Send everything written so far with as few writes as possible
+		Flush(yc);
+
 		m_QueuedWrites.Clear();
 	}
 }
@@ -610,6 +703,9 @@ void RedisConnection::WriteItem(boost::asio::yield_context& yc, RedisConnection:
 	}
 
 	if (next.Callback) {
+		// The callback may wait for the responses to the previous queries
+		Flush(yc);
+
 		next.Callback(yc);
 	}
 }
@@ -650,6 +746,70 @@ void RedisConnection::WriteOne(RedisConnection::Query& query, asio::yield_contex
 	}
 }
 
+/**
+ * Send the queries written so far, if any
+ */
+void RedisConnection::Flush(asio::yield_context& yc)
+{
+	if (!m_UnflushedQueries) {
+		return;
+	}
+
+	auto queries (m_UnflushedQueries);
+	auto bytes (m_UnflushedBytes);
+
+	m_UnflushedQueries = 0;
+	m_UnflushedBytes = 0;
+
+	try {
+		if (m_Path.IsEmpty()) {
+			if (m_TLSContext) {
+				Flush(m_TlsConn, yc);
+			} else {
+				Flush(m_TcpConn, yc);
+			}
+		} else {
+			Flush(m_UnixConn, yc);
+		}
+	} catch (const boost::coroutines::detail::forced_unwind&) {
+		throw;
+	} catch (const std::exception& ex) {
+		Log(LogCritical, "IcingaDB")
+			<< "Error during sending " << queries << " queries: " << ex.what();
+
+		return;
+	} catch (...) {
+		Log(LogCritical, "IcingaDB")
+			<< "Error during sending " << queries << " queries";
+
+		return;
+	}
+
+	m_Flushes.fetch_add(1);
+	m_FlushedQueries.fetch_add(queries);
+	m_FlushedBytes.fetch_add(bytes);
+}
+
+/**
+ * Get statistics about the pipelined writes and the HSET coalescing
+ *
+ * @return pipeline_depth (queries per write), bytes_per_write and coalescing_ratio (fields set per field sent)
+ */
+Dictionary::Ptr RedisConnection::GetWriteStats() const
+{
+	double flushes = m_Flushes.load();
+	double fieldsOut = m_HSetFieldsOut.load();
+
+	return new Dictionary({
+		{ "writes", flushes },
+		{ "queries", m_FlushedQueries.load() },
+		{ "bytes", m_FlushedBytes.load() },
+		{ "pipeline_depth", flushes ? m_FlushedQueries.load() / flushes : 0 },
+		{ "bytes_per_write", flushes ? m_FlushedBytes.load() / flushes : 0 },
+		{ "coalescing_ratio", fieldsOut ? m_HSetFieldsIn.load() / fieldsOut : 1 }
+	});
+}
+
 /**
  * Specify a callback that is run each time a connection is successfully established
  *
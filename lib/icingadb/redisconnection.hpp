@@ -6,6 +6,7 @@
 #include "base/array.hpp"
 #include "base/atomic.hpp"
 #include "base/convert.hpp"
+#include "base/dictionary.hpp"
 #include "base/io-engine.hpp"
 #include "base/object.hpp"
 #include "base/ringbuffer.hpp"
@@ -28,6 +29,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
 #include <boost/utility/string_view.hpp>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -86,6 +88,7 @@ namespace icinga
 
 		void FireAndForgetQuery(Query query, QueryPriority priority);
 		void FireAndForgetQueries(Queries queries, QueryPriority priority);
+		void FireAndForgetHSet(const String& key, const String& field, String value, QueryPriority priority);
 
 		Reply GetResultOfQuery(Query query, QueryPriority priority);
 		Replies GetResultsOfQueries(Queries queries, QueryPriority priority);
@@ -98,6 +101,8 @@ namespace icinga
 
 		void SetConnectedCallback(std::function<void(boost::asio::yield_context& yc)> callback);
 
+		Dictionary::Ptr GetWriteStats() const;
+
 	private:
 		/**
 		 * What to do with the responses to Redis queries.
@@ -151,7 +156,7 @@ namespace icinga
 		static std::vector<char> ReadLine(AsyncReadStream& stream, boost::asio::yield_context& yc, size_t hint = 0);
 
 		template<class AsyncWriteStream>
-		static void WriteRESP(AsyncWriteStream& stream, const Query& query, boost::asio::yield_context& yc);
+		static size_t WriteRESP(AsyncWriteStream& stream, const Query& query, boost::asio::yield_context& yc);
 
 		static boost::regex m_ErrAuth;
 
@@ -166,6 +171,8 @@ namespace icinga
 		void WriteItem(boost::asio::yield_context& yc, WriteQueueItem item);
 		Reply ReadOne(boost::asio::yield_context& yc);
 		void WriteOne(Query& query, boost::asio::yield_context& yc);
+		void Flush(boost::asio::yield_context& yc);
+		void QueuePendingHSets(QueryPriority priority);
 
 		template<class StreamPtr>
 		Reply ReadOne(StreamPtr& stream, boost::asio::yield_context& yc);
@@ -173,6 +180,9 @@ namespace icinga
 		template<class StreamPtr>
 		void WriteOne(StreamPtr& stream, Query& query, boost::asio::yield_context& yc);
 
+		template<class StreamPtr>
+		void Flush(StreamPtr& stream, boost::asio::yield_context& yc);
+
 		void IncreasePendingQueries(int count);
 		void DecreasePendingQueries(int count);
 
@@ -218,6 +228,10 @@ namespace icinga
 		// Kinds of queries not to actually send yet
 		std::set<QueryPriority> m_SuppressedQueryKinds;
 
+		// HSET fields not queued yet, the latest value per key and field wins
+		std::map<QueryPriority, std::map<String, std::map<String, String>>> m_PendingHSets;
+		bool m_PendingHSetsScheduled{false};
+
 		// Indicate that there's something to send/receive
 		AsioConditionVariable m_QueuedWrites, m_QueuedReads;
 
@@ -227,6 +241,13 @@ namespace icinga
 		RingBuffer m_InputQueries{10};
 		RingBuffer m_OutputQueries{10};
 		int m_PendingQueries{0};
+		size_t m_UnflushedQueries{0};
+		size_t m_UnflushedBytes{0};
+		std::atomic<uint_fast64_t> m_Flushes{0};
+		std::atomic<uint_fast64_t> m_FlushedQueries{0};
+		std::atomic<uint_fast64_t> m_FlushedBytes{0};
+		std::atomic<uint_fast64_t> m_HSetFieldsIn{0};
+		std::atomic<uint_fast64_t> m_HSetFieldsOut{0};
 		boost::asio::deadline_timer m_LogStatsTimer;
 		Ptr m_Parent;
 	};
@@ -379,7 +400,43 @@ void RedisConnection::WriteOne(StreamPtr& stream, RedisConnection::Query& query,
 	auto strm (stream);
 
 	try {
-		WriteRESP(*strm, query, yc);
+		m_UnflushedBytes += WriteRESP(*strm, query, yc);
+		++m_UnflushedQueries;
+	} catch (const boost::coroutines::detail::forced_unwind&) {
+		throw;
+	} catch (...) {
+		if (m_Connecting.exchange(false)) {
+			m_Connected.store(false);
+			stream = nullptr;
+
+			if (!m_Connecting.exchange(true)) {
+				Ptr keepAlive (this);
+
+				IoEngine::SpawnCoroutine(m_Strand, [this, keepAlive](asio::yield_context yc) { Connect(yc); });
+			}
+		}
+
+		throw;
+	}
+}
+
+/**
+ * Send everything written by WriteOne() to Redis at once
+ *
+ * @param stream Redis server connection
+ */
+template<class StreamPtr>
+void RedisConnection::Flush(StreamPtr& stream, boost::asio::yield_context& yc)
+{
+	namespace asio = boost::asio;
+
+	if (!stream) {
+		throw RedisDisconnected();
+	}
+
+	auto strm (stream);
+
+	try {
 		strm->async_flush(yc);
 	} catch (const boost::coroutines::detail::forced_unwind&) {
 		throw;
@@ -610,9 +667,11 @@ std::vector<char> RedisConnection::ReadLine(AsyncReadStream& stream, boost::asio
  *
  * @param stream Redis server connection
  * @param query Redis protocol value
+ *
+ * @return The amount of bytes written
  */
 template<class AsyncWriteStream>
-void RedisConnection::WriteRESP(AsyncWriteStream& stream, const Query& query, boost::asio::yield_context& yc)
+size_t RedisConnection::WriteRESP(AsyncWriteStream& stream, const Query& query, boost::asio::yield_context& yc)
 {
 	namespace asio = boost::asio;
 
@@ -625,7 +684,7 @@ void RedisConnection::WriteRESP(AsyncWriteStream& stream, const Query& query, bo
 		msg << "$" << arg.GetLength() << "\r\n" << arg << "\r\n";
 	}
 
-	asio::async_write(stream, writeBuffer, yc);
+	return asio::async_write(stream, writeBuffer, yc);
 }
 
 }
@@ -14,5 +14,34 @@ Filter::Ptr Aggregator::GetFilter() const
 	return m_Filter;
 }
 
+/**
+ * Looks up the aggregated column once per table, rather than for every row.
+ * An aggregator refers to a single column only.
+ */
+const Column& Aggregator::GetColumn(const Table::Ptr& table, const String& name)
+{
+	if (!m_Column || m_ColumnTable != table) {
+		m_Column.reset(new Column(table->GetColumn(name)));
+		m_ColumnTable = table;
+	}
+
+	return *m_Column;
+}
+
+bool Aggregator::CanApplyBatch(const Table::Ptr&) const
+{
+	return false;
+}
+
+void Aggregator::ApplyBatch(LivestatusRowBatch&, AggregatorState **) const
+{
+	BOOST_THROW_EXCEPTION(std::logic_error("Aggregator can't be applied in batches."));
+}
+
+void Aggregator::MergeState(AggregatorState *, AggregatorState **) const
+{
+	BOOST_THROW_EXCEPTION(std::logic_error("Aggregator states can't be merged."));
+}
+
 AggregatorState::~AggregatorState()
 { }
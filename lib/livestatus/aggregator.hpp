@@ -6,10 +6,13 @@
 #include "livestatus/i2-livestatus.hpp"
 #include "livestatus/table.hpp"
 #include "livestatus/filter.hpp"
+#include <memory>
 
 namespace icinga
 {
 
+class LivestatusRowBatch;
+
 /**
  * @ingroup livestatus
  */
@@ -28,15 +31,27 @@ public:
 
 	virtual void Apply(const Table::Ptr& table, const Value& row, AggregatorState **state) = 0;
 	virtual double GetResultAndFreeState(AggregatorState *state) const = 0;
+
+	/* Whether ApplyBatch() can aggregate the table's rows. */
+	virtual bool CanApplyBatch(const Table::Ptr& table) const;
+
+	/* Aggregates each row into states[batch.GetGroup(i)], may run in any thread. */
+	virtual void ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const;
+
+	/* Adds a state which was aggregated separately to *into and frees it. */
+	virtual void MergeState(AggregatorState *state, AggregatorState **into) const;
 	void SetFilter(const Filter::Ptr& filter);
 
 protected:
 	Aggregator() = default;
 
 	Filter::Ptr GetFilter() const;
+	const Column& GetColumn(const Table::Ptr& table, const String& name);
 
 private:
 	Filter::Ptr m_Filter;
+	Table::Ptr m_ColumnTable;
+	std::unique_ptr<Column> m_Column;
 };
 
 }
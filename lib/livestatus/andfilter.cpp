@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/andfilter.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -13,3 +14,17 @@ bool AndFilter::Apply(const Table::Ptr& table, const Value& row)
 
 	return true;
 }
+
+void AndFilter::ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const
+{
+	matches.assign(batch.GetSize(), 1);
+
+	std::vector<char> subMatches;
+
+	for (const Filter::Ptr& filter : m_Filters) {
+		filter->ApplyBatch(batch, subMatches);
+
+		for (size_t i = 0; i < matches.size(); i++)
+			matches[i] &= subMatches[i];
+	}
+}
@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/attributefilter.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 #include "base/convert.hpp"
 #include "base/array.hpp"
 #include "base/objectlock.hpp"
@@ -12,13 +13,55 @@ using namespace icinga;
 
 AttributeFilter::AttributeFilter(String column, String op, String operand)
 	: m_Column(std::move(column)), m_Operator(std::move(op)), m_Operand(std::move(operand))
-{ }
+{
+	/* Converted once, so that the filter can be applied by several threads. */
+	try {
+		m_OperandNumber = Convert::ToDouble(m_Operand);
+		m_HasOperandNumber = true;
+	} catch (const std::exception&) {
+		/* Not an error unless the operand is compared to a number. */
+	}
+}
 
-bool AttributeFilter::Apply(const Table::Ptr& table, const Value& row)
+const String& AttributeFilter::GetColumn() const
+{
+	return m_Column;
+}
+
+const String& AttributeFilter::GetOperator() const
+{
+	return m_Operator;
+}
+
+const String& AttributeFilter::GetOperand() const
 {
-	Column column = table->GetColumn(m_Column);
+	return m_Operand;
+}
 
-	Value value = column.ExtractValue(row);
+/**
+ * Looks up the column once per table, rather than for every row.
+ */
+const Column& AttributeFilter::GetResolvedColumn(const Table::Ptr& table)
+{
+	if (!m_ResolvedColumn || m_ColumnTable != table) {
+		m_ResolvedColumn.reset(new Column(table->GetColumn(m_Column)));
+		m_ColumnTable = table;
+	}
+
+	return *m_ResolvedColumn;
+}
+
+double AttributeFilter::GetOperandNumber() const
+{
+	if (!m_HasOperandNumber)
+		return Convert::ToDouble(m_Operand);
+
+	return m_OperandNumber;
+}
+
+bool AttributeFilter::Apply(const Table::Ptr& table, const Value& row)
+{
+	Value value = GetResolvedColumn(table).ExtractValue(row);
 
 	if (value.IsObjectType<Array>()) {
 		Array::Ptr array = value;
@@ -41,7 +84,7 @@ bool AttributeFilter::Apply(const Table::Ptr& table, const Value& row)
 	} else {
 		if (m_Operator == "=") {
 			if (value.GetType() == ValueNumber || value.GetType() == ValueBoolean)
-				return (static_cast<double>(value) == Convert::ToDouble(m_Operand));
+				return (static_cast<double>(value) == GetOperandNumber());
 			else
 				return (static_cast<String>(value) == m_Operand);
 		} else if (m_Operator == "~") {
@@ -94,22 +137,22 @@ bool AttributeFilter::Apply(const Table::Ptr& table, const Value& row)
 			return ret;
 		} else if (m_Operator == "<") {
 			if (value.GetType() == ValueNumber)
-				return (static_cast<double>(value) < Convert::ToDouble(m_Operand));
+				return (static_cast<double>(value) < GetOperandNumber());
 			else
 				return (static_cast<String>(value) < m_Operand);
 		} else if (m_Operator == ">") {
 			if (value.GetType() == ValueNumber)
-				return (static_cast<double>(value) > Convert::ToDouble(m_Operand));
+				return (static_cast<double>(value) > GetOperandNumber());
 			else
 				return (static_cast<String>(value) > m_Operand);
 		} else if (m_Operator == "<=") {
 			if (value.GetType() == ValueNumber)
-				return (static_cast<double>(value) <= Convert::ToDouble(m_Operand));
+				return (static_cast<double>(value) <= GetOperandNumber());
 			else
 				return (static_cast<String>(value) <= m_Operand);
 		} else if (m_Operator == ">=") {
 			if (value.GetType() == ValueNumber)
-				return (static_cast<double>(value) >= Convert::ToDouble(m_Operand));
+				return (static_cast<double>(value) >= GetOperandNumber());
 			else
 				return (static_cast<String>(value) >= m_Operand);
 		} else {
@@ -119,3 +162,49 @@ bool AttributeFilter::Apply(const Table::Ptr& table, const Value& row)
 
 	return false;
 }
+
+bool AttributeFilter::CanApplyBatch(const Table::Ptr& table) const
+{
+	const LivestatusNumberColumn *column = table->GetNumberColumn(m_Column);
+
+	if (!column || !m_HasOperandNumber)
+		return false;
+
+	/* Apply() compares booleans as strings, except for equality. */
+	if (column->Boolean)
+		return m_Operator == "=";
+
+	return m_Operator == "=" || m_Operator == "<" || m_Operator == ">" || m_Operator == "<=" || m_Operator == ">=";
+}
+
+void AttributeFilter::ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const
+{
+	const LivestatusNumberBatch& column = batch.GetNumberColumn(m_Column);
+	const std::vector<double>& values = column.Values;
+	const std::vector<char>& empty = column.Empty;
+	size_t size = batch.GetSize();
+
+	matches.resize(size);
+
+	/* Apply() compares empty values as empty strings, which are less than
+	 * any number operand and never equal to one.
+	 */
+	if (m_Operator == "=") {
+		for (size_t i = 0; i < size; i++)
+			matches[i] = !empty[i] && values[i] == m_OperandNumber;
+	} else if (m_Operator == "<") {
+		for (size_t i = 0; i < size; i++)
+			matches[i] = empty[i] || values[i] < m_OperandNumber;
+	} else if (m_Operator == ">") {
+		for (size_t i = 0; i < size; i++)
+			matches[i] = !empty[i] && values[i] > m_OperandNumber;
+	} else if (m_Operator == "<=") {
+		for (size_t i = 0; i < size; i++)
+			matches[i] = empty[i] || values[i] <= m_OperandNumber;
+	} else if (m_Operator == ">=") {
+		for (size_t i = 0; i < size; i++)
+			matches[i] = !empty[i] && values[i] >= m_OperandNumber;
+	} else {
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Operator '" + m_Operator + "' for column '" + m_Column + "' can't be applied in batches."));
+	}
+}
@@ -4,6 +4,7 @@
 #define ATTRIBUTEFILTER_H
 
 #include "livestatus/filter.hpp"
+#include <memory>
 
 using namespace icinga;
 
@@ -21,11 +22,26 @@ public:
 	AttributeFilter(String column, String op, String operand);
 
 	bool Apply(const Table::Ptr& table, const Value& row) override;
+	bool CanApplyBatch(const Table::Ptr& table) const override;
+	void ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const override;
+
+	const String& GetColumn() const;
+	const String& GetOperator() const;
+	const String& GetOperand() const;
 
 protected:
 	String m_Column;
 	String m_Operator;
 	String m_Operand;
+
+private:
+	Table::Ptr m_ColumnTable;
+	std::unique_ptr<Column> m_ResolvedColumn;
+	bool m_HasOperandNumber{false};
+	double m_OperandNumber{0};
+
+	const Column& GetResolvedColumn(const Table::Ptr& table);
+	double GetOperandNumber() const;
 };
 
 }
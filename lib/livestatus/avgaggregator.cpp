@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/avgaggregator.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -18,7 +19,7 @@ AvgAggregatorState *AvgAggregator::EnsureState(AggregatorState **state)
 
 void AvgAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_AvgAttr);
+	const Column& column = GetColumn(table, m_AvgAttr);
 
 	Value value = column.ExtractValue(row);
 
@@ -36,3 +37,35 @@ double AvgAggregator::GetResultAndFreeState(AggregatorState *state) const
 
 	return result;
 }
+
+bool AvgAggregator::CanApplyBatch(const Table::Ptr& table) const
+{
+	return table->GetNumberColumn(m_AvgAttr) != nullptr;
+}
+
+void AvgAggregator::ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const
+{
+	const std::vector<double>& values = batch.GetNumberColumn(m_AvgAttr).Values;
+
+	for (size_t i = 0; i < batch.GetSize(); i++) {
+		double value = values[i];
+		AvgAggregatorState *pstate = EnsureState(&states[batch.GetGroup(i)]);
+
+		pstate->Avg += value;
+		pstate->AvgCount++;
+	}
+}
+
+void AvgAggregator::MergeState(AggregatorState *state, AggregatorState **into) const
+{
+	if (!state)
+		return;
+
+	AvgAggregatorState *pstate = static_cast<AvgAggregatorState *>(state);
+	AvgAggregatorState *pinto = EnsureState(into);
+
+	pinto->Avg += pstate->Avg;
+	pinto->AvgCount += pstate->AvgCount;
+
+	delete pstate;
+}
@@ -30,6 +30,9 @@ public:
 
 	void Apply(const Table::Ptr& table, const Value& row, AggregatorState **state) override;
 	double GetResultAndFreeState(AggregatorState *state) const override;
+	bool CanApplyBatch(const Table::Ptr& table) const override;
+	void ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const override;
+	void MergeState(AggregatorState *state, AggregatorState **into) const override;
 
 private:
 	String m_AvgAttr;
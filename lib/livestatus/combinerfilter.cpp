@@ -8,3 +8,18 @@ void CombinerFilter::AddSubFilter(const Filter::Ptr& filter)
 {
 	m_Filters.push_back(filter);
 }
+
+const std::vector<Filter::Ptr>& CombinerFilter::GetSubFilters() const
+{
+	return m_Filters;
+}
+
+bool CombinerFilter::CanApplyBatch(const Table::Ptr& table) const
+{
+	for (const Filter::Ptr& filter : m_Filters) {
+		if (!filter->CanApplyBatch(table))
+			return false;
+	}
+
+	return true;
+}
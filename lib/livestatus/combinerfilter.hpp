@@ -19,6 +19,9 @@ public:
 	DECLARE_PTR_TYPEDEFS(CombinerFilter);
 
 	void AddSubFilter(const Filter::Ptr& filter);
+	const std::vector<Filter::Ptr>& GetSubFilters() const;
+
+	bool CanApplyBatch(const Table::Ptr& table) const override;
 
 protected:
 	std::vector<Filter::Ptr> m_Filters;
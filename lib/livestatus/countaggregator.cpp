@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/countaggregator.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -28,3 +29,34 @@ double CountAggregator::GetResultAndFreeState(AggregatorState *state) const
 
 	return result;
 }
+
+bool CountAggregator::CanApplyBatch(const Table::Ptr& table) const
+{
+	return GetFilter()->CanApplyBatch(table);
+}
+
+void CountAggregator::ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const
+{
+	std::vector<char> matches;
+	GetFilter()->ApplyBatch(batch, matches);
+
+	for (size_t i = 0; i < batch.GetSize(); i++) {
+		CountAggregatorState *pstate = EnsureState(&states[batch.GetGroup(i)]);
+
+		if (matches[i])
+			pstate->Count++;
+	}
+}
+
+void CountAggregator::MergeState(AggregatorState *state, AggregatorState **into) const
+{
+	if (!state)
+		return;
+
+	CountAggregatorState *pstate = static_cast<CountAggregatorState *>(state);
+	CountAggregatorState *pinto = EnsureState(into);
+
+	pinto->Count += pstate->Count;
+
+	delete pstate;
+}
@@ -5,10 +5,13 @@
 
 #include "livestatus/i2-livestatus.hpp"
 #include "livestatus/table.hpp"
+#include <vector>
 
 namespace icinga
 {
 
+class LivestatusRowBatch;
+
 /**
  * @ingroup livestatus
  */
@@ -19,6 +22,12 @@ public:
 
 	virtual bool Apply(const Table::Ptr& table, const Value& row) = 0;
 
+	/* Whether ApplyBatch() can evaluate the filter for the table's rows. */
+	virtual bool CanApplyBatch(const Table::Ptr& table) const = 0;
+
+	/* Sets matches[i] for each row of the batch, may run in any thread. */
+	virtual void ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const = 0;
+
 protected:
 	Filter() = default;
 };
@@ -0,0 +1,111 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "livestatus/historytable.hpp"
+#include "base/convert.hpp"
+
+using namespace icinga;
+
+/**
+ * Remembers the hints for SelectLogEntries(), the log files are read as usual.
+ */
+bool HistoryTable::FetchIndexedRows(const std::vector<LivestatusIndexHint>& hints, const AddRowFunction& addRowFn)
+{
+	m_IndexHints = hints;
+
+	FetchRows(addRowFn);
+
+	m_IndexHints.clear();
+
+	return true;
+}
+
+template<typename T, typename Predicate>
+static void NarrowSelection(std::vector<char>& selection, const std::vector<T>& column, const Predicate& predicate)
+{
+	for (size_t i = 0; i < selection.size(); i++)
+		selection[i] = selection[i] && predicate(column[i]);
+}
+
+template<typename T>
+static void NarrowSelection(std::vector<char>& selection, const std::vector<T>& column, const String& op, double operand)
+{
+	if (op == "=")
+		NarrowSelection(selection, column, [operand](T value) { return value == operand; });
+	else if (op == "<")
+		NarrowSelection(selection, column, [operand](T value) { return value < operand; });
+	else if (op == ">")
+		NarrowSelection(selection, column, [operand](T value) { return value > operand; });
+	else if (op == "<=")
+		NarrowSelection(selection, column, [operand](T value) { return value <= operand; });
+	else if (op == ">=")
+		NarrowSelection(selection, column, [operand](T value) { return value >= operand; });
+}
+
+/**
+ * Selects the entries of a log file which can satisfy the hints for the
+ * specified columns, using only the index. The whole filter is still
+ * applied to the rows.
+ *
+ * @returns false if none of them can
+ */
+bool HistoryTable::SelectLogEntries(const CompatLogPartition& partition, const std::set<String>& columns, std::vector<size_t>& entries) const
+{
+	std::vector<char> selection (partition.GetSize(), 1);
+
+	for (const LivestatusIndexHint& hint : m_IndexHints) {
+		if (hint.Negate || hint.Operand.IsEmpty() || columns.find(hint.Column) == columns.end())
+			continue;
+
+		const std::vector<uint32_t> *strings = nullptr;
+
+		if (hint.Column == "type")
+			strings = &partition.Type;
+		else if (hint.Column == "host_name")
+			strings = &partition.HostName;
+		else if (hint.Column == "service_description")
+			strings = &partition.ServiceDescription;
+		else if (hint.Column == "state_type")
+			strings = &partition.StateType;
+
+		if (strings) {
+			if (hint.Operator != "=")
+				continue;
+
+			/* Strings which were too long for the index may still match. */
+			uint32_t id = CompatLogIndex::UnknownString;
+			partition.FindString(hint.Operand, id);
+
+			NarrowSelection(selection, *strings, [id](uint32_t value) {
+				return value == id || value == CompatLogIndex::UnknownString;
+			});
+
+			continue;
+		}
+
+		double operand;
+
+		try {
+			operand = Convert::ToDouble(hint.Operand);
+		} catch (const std::exception&) {
+			continue;
+		}
+
+		if (hint.Column == "time")
+			NarrowSelection(selection, partition.Time, hint.Operator, operand);
+		else if (hint.Column == "state" && hint.Operator == "=")
+			NarrowSelection(selection, partition.State, hint.Operator, operand);
+		else if (hint.Column == "attempt" && hint.Operator == "=")
+			NarrowSelection(selection, partition.Attempt, hint.Operator, operand);
+		else if (hint.Column == "class" && hint.Operator == "=")
+			NarrowSelection(selection, partition.Class, hint.Operator, operand);
+	}
+
+	entries.clear();
+
+	for (size_t i = 0; i < selection.size(); i++) {
+		if (selection[i])
+			entries.push_back(i);
+	}
+
+	return !entries.empty();
+}
@@ -4,7 +4,9 @@
 #define HISTORYTABLE_H
 
 #include "livestatus/table.hpp"
+#include "icinga/compatlogindex.hpp"
 #include "base/dictionary.hpp"
+#include <set>
 
 namespace icinga
 {
@@ -16,7 +18,20 @@ namespace icinga
 class HistoryTable : public Table
 {
 public:
-	virtual void UpdateLogEntries(const Dictionary::Ptr& bag, int line_count, int lineno, const AddRowFunction& addRowFn) = 0;
+	/**
+	 * Processes the lines of a log file.
+	 *
+	 * @returns false if no more rows are needed
+	 */
+	virtual bool UpdateLogEntries(const CompatLogPartition& partition, const AddRowFunction& addRowFn) = 0;
+
+protected:
+	bool FetchIndexedRows(const std::vector<LivestatusIndexHint>& hints, const AddRowFunction& addRowFn) override;
+
+	bool SelectLogEntries(const CompatLogPartition& partition, const std::set<String>& columns, std::vector<size_t>& entries) const;
+
+private:
+	std::vector<LivestatusIndexHint> m_IndexHints;
 };
 
 }
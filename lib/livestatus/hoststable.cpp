@@ -26,6 +26,13 @@ HostsTable::HostsTable(LivestatusGroupByType type)
 	:Table(type)
 {
 	AddColumns(this);
+
+	/* The rows' own numeric columns can be read in batches by stats queries. */
+	AddNumberColumn("state", &HostsTable::StateNumberAccessor);
+	AddNumberColumn("acknowledged", &HostsTable::AcknowledgedNumberAccessor, true);
+	AddNumberColumn("scheduled_downtime_depth", &HostsTable::ScheduledDowntimeDepthNumberAccessor);
+	AddNumberColumn("latency", &HostsTable::LatencyNumberAccessor);
+	AddNumberColumn("execution_time", &HostsTable::ExecutionTimeNumberAccessor);
 }
 
 void HostsTable::AddColumns(Table *table, const String& prefix,
@@ -187,6 +194,62 @@ void HostsTable::FetchRows(const AddRowFunction& addRowFn)
 	}
 }
 
+bool HostsTable::FetchIndexedRows(const std::vector<LivestatusIndexHint>& hints, const AddRowFunction& addRowFn)
+{
+	if (GetGroupByType() != LivestatusGroupByNone)
+		return false;
+
+	std::vector<Host::Ptr> hosts;
+	bool indexed = false;
+
+	for (auto& hint : hints) {
+		if (hint.Column == "name" && hint.Operator == "=" && !hint.Negate) {
+			Host::Ptr host = Host::GetByName(hint.Operand);
+
+			hosts.clear();
+
+			if (host)
+				hosts.push_back(host);
+
+			indexed = true;
+			break;
+		} else if (hint.Column == "groups" && hint.Operator == ">=" && !hint.Negate && !indexed) {
+			HostGroup::Ptr hg = HostGroup::GetByName(hint.Operand);
+
+			if (hg) {
+				std::set<Host::Ptr> members = hg->GetMembers();
+				hosts.assign(members.begin(), members.end());
+			}
+
+			indexed = true;
+		}
+	}
+
+	/* A host's state also depends on its reachability, only acknowledgements are indexed. */
+	for (auto& hint : hints) {
+		if (indexed)
+			break;
+
+		if (hint.Column == "acknowledged" && hint.Operator == "=" && Convert::ToDouble(hint.Operand) == (hint.Negate ? 0 : 1)) {
+			for (const Checkable::Ptr& checkable : LivestatusIndex::GetAcknowledged(Host::TypeInstance)) {
+				hosts.push_back(static_pointer_cast<Host>(checkable));
+			}
+
+			indexed = true;
+		}
+	}
+
+	if (!indexed)
+		return false;
+
+	for (const Host::Ptr& host : hosts) {
+		if (!addRowFn(host, LivestatusGroupByNone, Empty))
+			break;
+	}
+
+	return true;
+}
+
 Object::Ptr HostsTable::HostGroupAccessor(const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject)
 {
 	/* return the current group by value set from within FetchRows()
@@ -1520,3 +1583,69 @@ Value HostsTable::OriginalAttributesAccessor(const Value& row)
 
 	return JsonEncode(host->GetOriginalAttributes());
 }
+
+bool HostsTable::StateNumberAccessor(const Value& row, double& value)
+{
+	Host::Ptr host = static_cast<Host::Ptr>(row);
+
+	if (!host)
+		return false;
+
+	value = host->IsReachable() ? host->GetState() : 2;
+	return true;
+}
+
+bool HostsTable::AcknowledgedNumberAccessor(const Value& row, double& value)
+{
+	Host::Ptr host = static_cast<Host::Ptr>(row);
+
+	if (!host)
+		return false;
+
+	ObjectLock olock(host);
+	value = host->IsAcknowledged();
+	return true;
+}
+
+bool HostsTable::ScheduledDowntimeDepthNumberAccessor(const Value& row, double& value)
+{
+	Host::Ptr host = static_cast<Host::Ptr>(row);
+
+	if (!host)
+		return false;
+
+	value = host->GetDowntimeDepth();
+	return true;
+}
+
+bool HostsTable::LatencyNumberAccessor(const Value& row, double& value)
+{
+	Host::Ptr host = static_cast<Host::Ptr>(row);
+
+	if (!host)
+		return false;
+
+	CheckResult::Ptr cr = host->GetLastCheckResult();
+
+	if (!cr)
+		return false;
+
+	value = cr->CalculateLatency();
+	return true;
+}
+
+bool HostsTable::ExecutionTimeNumberAccessor(const Value& row, double& value)
+{
+	Host::Ptr host = static_cast<Host::Ptr>(row);
+
+	if (!host)
+		return false;
+
+	CheckResult::Ptr cr = host->GetLastCheckResult();
+
+	if (!cr)
+		return false;
+
+	value = cr->CalculateExecutionTime();
+	return true;
+}
@@ -28,6 +28,7 @@ public:
 
 protected:
 	void FetchRows(const AddRowFunction& addRowFn) override;
+	bool FetchIndexedRows(const std::vector<LivestatusIndexHint>& hints, const AddRowFunction& addRowFn) override;
 
 	static Object::Ptr HostGroupAccessor(const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject);
 
@@ -126,6 +127,12 @@ protected:
 	static Value IsReachableAccessor(const Value& row);
 	static Value CVIsJsonAccessor(const Value& row);
 	static Value OriginalAttributesAccessor(const Value& row);
+
+	static bool StateNumberAccessor(const Value& row, double& value);
+	static bool AcknowledgedNumberAccessor(const Value& row, double& value);
+	static bool ScheduledDowntimeDepthNumberAccessor(const Value& row, double& value);
+	static bool LatencyNumberAccessor(const Value& row, double& value);
+	static bool ExecutionTimeNumberAccessor(const Value& row, double& value);
 };
 
 }
@@ -18,7 +18,7 @@ InvAvgAggregatorState *InvAvgAggregator::EnsureState(AggregatorState **state)
 
 void InvAvgAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_InvAvgAttr);
+	const Column& column = GetColumn(table, m_InvAvgAttr);
 
 	Value value = column.ExtractValue(row);
 
@@ -18,7 +18,7 @@ InvSumAggregatorState *InvSumAggregator::EnsureState(AggregatorState **state)
 
 void InvSumAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_InvSumAttr);
+	const Column& column = GetColumn(table, m_InvSumAttr);
 
 	Value value = column.ExtractValue(row);
 
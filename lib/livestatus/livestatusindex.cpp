@@ -0,0 +1,134 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "livestatus/livestatusindex.hpp"
+#include "icinga/host.hpp"
+#include "base/configtype.hpp"
+
+using namespace icinga;
+
+std::mutex LivestatusIndex::m_Mutex;
+std::map<Service::Ptr, int> LivestatusIndex::m_ServiceStates;
+std::map<int, std::set<Service::Ptr>> LivestatusIndex::m_ServicesByState;
+std::set<Checkable::Ptr> LivestatusIndex::m_Acknowledged;
+
+void LivestatusIndex::EnsureInitialized()
+{
+	static std::once_flag once;
+
+	std::call_once(once, []() {
+		/* Connect first, so that nothing changes unnoticed while the index is built. */
+		Checkable::OnNewCheckResult.connect([](const Checkable::Ptr& checkable, const CheckResult::Ptr&, const MessageOrigin::Ptr&) {
+			UpdateCheckable(checkable);
+		});
+		Checkable::OnAcknowledgementSet.connect([](const Checkable::Ptr& checkable, const String&, const String&,
+			AcknowledgementType, bool, bool, double, double, const MessageOrigin::Ptr&) {
+			UpdateCheckable(checkable);
+		});
+		Checkable::OnAcknowledgementCleared.connect([](const Checkable::Ptr& checkable, const String&, double, const MessageOrigin::Ptr&) {
+			UpdateCheckable(checkable);
+		});
+		ConfigObject::OnActiveChanged.connect([](const ConfigObject::Ptr& object, const Value&) {
+			Checkable::Ptr checkable = dynamic_pointer_cast<Checkable>(object);
+
+			if (!checkable)
+				return;
+
+			if (checkable->IsActive())
+				UpdateCheckable(checkable);
+			else
+				RemoveCheckable(checkable);
+		});
+
+		for (const Host::Ptr& host : ConfigType::GetObjectsByType<Host>()) {
+			UpdateCheckable(host);
+		}
+
+		for (const Service::Ptr& service : ConfigType::GetObjectsByType<Service>()) {
+			UpdateCheckable(service);
+		}
+	});
+}
+
+void LivestatusIndex::UpdateCheckable(const Checkable::Ptr& checkable)
+{
+	Service::Ptr service = dynamic_pointer_cast<Service>(checkable);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (service) {
+		int state = service->GetState();
+		auto it = m_ServiceStates.find(service);
+
+		if (it == m_ServiceStates.end()) {
+			m_ServiceStates.emplace(service, state);
+			m_ServicesByState[state].insert(service);
+		} else if (it->second != state) {
+			m_ServicesByState[it->second].erase(service);
+			m_ServicesByState[state].insert(service);
+			it->second = state;
+		}
+	}
+
+	/* GetAcknowledgement() might clear an expired acknowledgement and re-enter here.
+	 * An expired one is kept until it's cleared, the filter sorts it out.
+	 */
+	if (checkable->GetAcknowledgementRaw() != AcknowledgementNone)
+		m_Acknowledged.insert(checkable);
+	else
+		m_Acknowledged.erase(checkable);
+}
+
+void LivestatusIndex::RemoveCheckable(const Checkable::Ptr& checkable)
+{
+	Service::Ptr service = dynamic_pointer_cast<Service>(checkable);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (service) {
+		auto it = m_ServiceStates.find(service);
+
+		if (it != m_ServiceStates.end()) {
+			m_ServicesByState[it->second].erase(service);
+			m_ServiceStates.erase(it);
+		}
+	}
+
+	m_Acknowledged.erase(checkable);
+}
+
+/**
+ * Returns the services in the given state, or in any other state if negate is set.
+ */
+std::vector<Service::Ptr> LivestatusIndex::GetServicesByState(int state, bool negate)
+{
+	EnsureInitialized();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	std::vector<Service::Ptr> result;
+
+	for (auto& kv : m_ServicesByState) {
+		if ((kv.first == state) != negate)
+			result.insert(result.end(), kv.second.begin(), kv.second.end());
+	}
+
+	return result;
+}
+
+/**
+ * Returns the hosts or services which are acknowledged. This might include
+ * expired acknowledgements which haven't been cleared yet.
+ */
+std::vector<Checkable::Ptr> LivestatusIndex::GetAcknowledged(const Type::Ptr& type)
+{
+	EnsureInitialized();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	std::vector<Checkable::Ptr> result;
+
+	for (const Checkable::Ptr& checkable : m_Acknowledged) {
+		if (checkable->GetReflectionType() == type)
+			result.push_back(checkable);
+	}
+
+	return result;
+}
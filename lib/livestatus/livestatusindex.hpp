@@ -0,0 +1,47 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef LIVESTATUSINDEX_H
+#define LIVESTATUSINDEX_H
+
+#include "livestatus/i2-livestatus.hpp"
+#include "icinga/checkable.hpp"
+#include "icinga/service.hpp"
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * Service states and acknowledged checkables, so that queries filtering
+ * by them don't have to look at every object.
+ *
+ * The index is built on first use and kept up to date by the check
+ * result, acknowledgement and activation signals afterwards.
+ *
+ * @ingroup livestatus
+ */
+class LivestatusIndex
+{
+public:
+	static std::vector<Service::Ptr> GetServicesByState(int state, bool negate = false);
+	static std::vector<Checkable::Ptr> GetAcknowledged(const Type::Ptr& type);
+
+private:
+	LivestatusIndex();
+
+	static std::mutex m_Mutex;
+	static std::map<Service::Ptr, int> m_ServiceStates;
+	static std::map<int, std::set<Service::Ptr>> m_ServicesByState;
+	static std::set<Checkable::Ptr> m_Acknowledged;
+
+	static void EnsureInitialized();
+	static void UpdateCheckable(const Checkable::Ptr& checkable);
+	static void RemoveCheckable(const Checkable::Ptr& checkable);
+};
+
+}
+
+#endif /* LIVESTATUSINDEX_H */
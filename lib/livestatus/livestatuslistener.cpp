@@ -8,13 +8,21 @@
 #include "base/configtype.hpp"
 #include "base/logger.hpp"
 #include "base/exception.hpp"
-#include "base/tcpsocket.hpp"
-#include "base/unixsocket.hpp"
-#include "base/networkstream.hpp"
+#include "base/defer.hpp"
 #include "base/application.hpp"
 #include "base/function.hpp"
 #include "base/statsfunction.hpp"
 #include "base/convert.hpp"
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#ifndef _WIN32
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif /* _WIN32 */
 
 using namespace icinga;
 
@@ -24,6 +32,54 @@ static int l_ClientsConnected = 0;
 static int l_Connections = 0;
 static std::mutex l_ComponentMutex;
 
+/* A longer line without line break ends the connection. */
+static const size_t l_MaxLineLength = 1024 * 1024;
+
+/**
+ * Sends what a query writes to the client right away, so that the response
+ * is never buffered as a whole. Streamed results arrive in batches of about
+ * 64 KiB. The CPU-bound slot of the query is given back while it waits for
+ * the client.
+ */
+template<class AsyncStream>
+class LivestatusClientStream final : public Stream
+{
+public:
+	DECLARE_PTR_TYPEDEFS(LivestatusClientStream);
+
+	LivestatusClientStream(AsyncStream& client, boost::asio::yield_context yc)
+		: m_Client(client), m_Yc(yc)
+	{ }
+
+	void Write(const void *buffer, size_t count) override
+	{
+		boost::system::error_code ec;
+
+		{
+			IoBoundWorkSlot dontLockTheIoThread (m_Yc);
+
+			boost::asio::async_write(m_Client, boost::asio::buffer(buffer, count), m_Yc[ec]);
+		}
+
+		if (ec)
+			BOOST_THROW_EXCEPTION(std::runtime_error("Cannot write query result to client: " + ec.message()));
+	}
+
+	size_t Read(void *, size_t, bool) override
+	{
+		BOOST_THROW_EXCEPTION(std::runtime_error("Queries are not read from this stream."));
+	}
+
+	bool IsEof() const override
+	{
+		return false;
+	}
+
+private:
+	AsyncStream& m_Client;
+	boost::asio::yield_context m_Yc;
+};
+
 REGISTER_STATSFUNCTION(LivestatusListener, &LivestatusListener::StatsFunc);
 
 void LivestatusListener::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
@@ -46,36 +102,90 @@ void LivestatusListener::StatsFunc(const Dictionary::Ptr& status, const Array::P
  */
 void LivestatusListener::Start(bool runtimeCreated)
 {
+	namespace asio = boost::asio;
+
 	ObjectImpl<LivestatusListener>::Start(runtimeCreated);
 
 	Log(LogInformation, "LivestatusListener")
 		<< "'" << GetName() << "' started.";
 
+	auto& io (IoEngine::Get().GetIoContext());
+	LivestatusListener::Ptr keepAlive (this);
+
+	m_ListenerStrand = Shared<asio::io_context::strand>::Make(io);
+
 	if (GetSocketType() == "tcp") {
-		TcpSocket::Ptr socket = new TcpSocket();
+		using asio::ip::tcp;
+
+		auto acceptor (Shared<tcp::acceptor>::Make(io));
 
 		try {
-			socket->Bind(GetBindHost(), GetBindPort(), AF_UNSPEC);
-		} catch (std::exception&) {
+			tcp::resolver resolver (io);
+			tcp::resolver::query query (GetBindHost(), GetBindPort(), tcp::resolver::query::passive);
+
+			auto result (resolver.resolve(query));
+			auto current (result.begin());
+
+			for (;;) {
+				try {
+					acceptor->open(current->endpoint().protocol());
+
+					{
+						auto fd (acceptor->native_handle());
+
+						const int optFalse = 0;
+						setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char *>(&optFalse), sizeof(optFalse));
+
+						const int optTrue = 1;
+						setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&optTrue), sizeof(optTrue));
+#ifdef SO_REUSEPORT
+						setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char *>(&optTrue), sizeof(optTrue));
+#endif /* SO_REUSEPORT */
+					}
+
+					acceptor->bind(current->endpoint());
+
+					break;
+				} catch (const std::exception&) {
+					if (++current == result.end()) {
+						throw;
+					}
+
+					if (acceptor->is_open()) {
+						acceptor->close();
+					}
+				}
+			}
+
+			acceptor->listen(SOMAXCONN);
+		} catch (const std::exception&) {
 			Log(LogCritical, "LivestatusListener")
 				<< "Cannot bind TCP socket on host '" << GetBindHost() << "' port '" << GetBindPort() << "'.";
 			return;
 		}
 
-		m_Listener = socket;
+		m_TcpAcceptor = acceptor;
 
-		m_Thread = std::thread([this]() { ServerThreadProc(); });
+		IoEngine::SpawnCoroutine(*m_ListenerStrand, [this, keepAlive, acceptor](asio::yield_context yc) {
+			ListenerCoroutineProc(yc, *acceptor);
+		});
 
 		Log(LogInformation, "LivestatusListener")
 			<< "Created TCP socket listening on host '" << GetBindHost() << "' port '" << GetBindPort() << "'.";
 	}
 	else if (GetSocketType() == "unix") {
 #ifndef _WIN32
-		UnixSocket::Ptr socket = new UnixSocket();
+		using asio::local::stream_protocol;
+
+		auto acceptor (Shared<stream_protocol::acceptor>::Make(io));
 
 		try {
-			socket->Bind(GetSocketPath());
-		} catch (std::exception&) {
+			unlink(GetSocketPath().CStr());
+
+			acceptor->open();
+			acceptor->bind(stream_protocol::endpoint(GetSocketPath().CStr()));
+			acceptor->listen(SOMAXCONN);
+		} catch (const std::exception&) {
 			Log(LogCritical, "LivestatusListener")
 				<< "Cannot bind UNIX socket to '" << GetSocketPath() << "'.";
 			return;
@@ -90,9 +200,11 @@ void LivestatusListener::Start(bool runtimeCreated)
 			return;
 		}
 
-		m_Listener = socket;
+		m_UnixAcceptor = acceptor;
 
-		m_Thread = std::thread([this]() { ServerThreadProc(); });
+		IoEngine::SpawnCoroutine(*m_ListenerStrand, [this, keepAlive, acceptor](asio::yield_context yc) {
+			ListenerCoroutineProc(yc, *acceptor);
+		});
 
 		Log(LogInformation, "LivestatusListener")
 			<< "Created UNIX socket in '" << GetSocketPath() << "'.";
@@ -111,10 +223,23 @@ void LivestatusListener::Stop(bool runtimeRemoved)
 	Log(LogInformation, "LivestatusListener")
 		<< "'" << GetName() << "' stopped.";
 
-	m_Listener->Close();
+	if (!m_ListenerStrand)
+		return;
+
+	LivestatusListener::Ptr keepAlive (this);
+
+	/* The acceptors are only touched by the listener strand, closing them ends the accept loop. */
+	boost::asio::post(*m_ListenerStrand, [this, keepAlive]() {
+		boost::system::error_code ec;
 
-	if (m_Thread.joinable())
-		m_Thread.join();
+		if (m_TcpAcceptor)
+			m_TcpAcceptor->close(ec);
+
+#ifndef _WIN32
+		if (m_UnixAcceptor)
+			m_UnixAcceptor->close(ec);
+#endif /* _WIN32 */
+	});
 }
 
 int LivestatusListener::GetClientsConnected()
@@ -131,74 +256,123 @@ int LivestatusListener::GetConnections()
 	return l_Connections;
 }
 
-void LivestatusListener::ServerThreadProc()
+template<class Acceptor>
+void LivestatusListener::ListenerCoroutineProc(boost::asio::yield_context yc, Acceptor& server)
 {
-	m_Listener->Listen();
+	namespace asio = boost::asio;
 
-	try {
-		for (;;) {
-			timeval tv = { 0, 500000 };
+	auto& io (IoEngine::Get().GetIoContext());
 
-			if (m_Listener->Poll(true, false, &tv)) {
-				Socket::Ptr client = m_Listener->Accept();
-				Log(LogNotice, "LivestatusListener", "Client connected");
-				Utility::QueueAsyncCallback([this, client]() { ClientHandler(client); }, LowLatencyScheduler);
-			}
+	for (;;) {
+		auto client (Shared<typename Acceptor::protocol_type::socket>::Make(io));
+		boost::system::error_code ec;
 
-			if (!IsActive())
-				break;
+		server.async_accept(*client, yc[ec]);
+
+		if (!server.is_open() || !IsActive())
+			break;
+
+		if (ec) {
+			Log(LogCritical, "LivestatusListener")
+				<< "Cannot accept new connection: " << ec.message();
+			continue;
 		}
-	} catch (std::exception&) {
-		Log(LogCritical, "LivestatusListener", "Cannot accept new connection.");
-	}
 
-	m_Listener->Close();
+		Log(LogNotice, "LivestatusListener", "Client connected");
+
+		auto strand (Shared<asio::io_context::strand>::Make(io));
+		LivestatusListener::Ptr keepAlive (this);
+
+		IoEngine::SpawnCoroutine(*strand, [this, keepAlive, strand, client](asio::yield_context yc) {
+			ClientHandler(yc, *client);
+		});
+	}
 }
 
-void LivestatusListener::ClientHandler(const Socket::Ptr& client)
+/**
+ * Answers the queries of a client until it disconnects or doesn't ask for keep-alive.
+ *
+ * A query ends with an empty line. Pipelined queries just stay in the read buffer
+ * until the previous one has been answered, so the responses keep their order.
+ * The query writes its response directly to the client while it is executed.
+ */
+template<class AsyncStream>
+void LivestatusListener::ClientHandler(boost::asio::yield_context yc, AsyncStream& client)
 {
+	namespace asio = boost::asio;
+
 	{
 		std::unique_lock<std::mutex> lock(l_ComponentMutex);
 		l_ClientsConnected++;
 		l_Connections++;
 	}
 
-	Stream::Ptr stream = new NetworkStream(client);
-
-	StreamReadContext context;
+	Defer disconnected ([]() {
+		std::unique_lock<std::mutex> lock(l_ComponentMutex);
+		l_ClientsConnected--;
+	});
 
-	for (;;) {
-		String line;
+	asio::streambuf readBuffer (l_MaxLineLength);
+	bool eof = false;
 
+	while (!eof) {
 		std::vector<String> lines;
 
 		for (;;) {
-			StreamReadStatus srs = stream->ReadLine(&line, context);
+			boost::system::error_code ec;
+			size_t length = asio::async_read_until(client, readBuffer, '\n', yc[ec]);
+			auto begin (asio::buffers_begin(readBuffer.data()));
+			String line;
+
+			if (ec == asio::error::not_found) {
+				Log(LogWarning, "LivestatusListener")
+					<< "Query line exceeds " << l_MaxLineLength << " bytes, closing the connection.";
+				lines.clear();
+				eof = true;
+				break;
+			}
+
+			if (ec) {
+				/* Like Stream::ReadLine(), a last line without line break still counts. */
+				eof = true;
+				length = readBuffer.size();
+				line = String(begin, begin + length);
+			} else {
+				line = String(begin, begin + length - 1u);
+			}
 
-			if (srs == StatusEof)
+			readBuffer.consume(length);
+			boost::algorithm::trim_right(line);
+
+			if (line.IsEmpty())
 				break;
 
-			if (srs != StatusNewItem)
-				continue;
+			lines.emplace_back(std::move(line));
 
-			if (line.GetLength() > 0)
-				lines.push_back(line);
-			else
+			if (eof)
 				break;
 		}
 
 		if (lines.empty())
 			break;
 
-		LivestatusQuery::Ptr query = new LivestatusQuery(lines, GetCompatLogPath());
-		if (!query->Execute(stream))
+		typename LivestatusClientStream<AsyncStream>::Ptr response = new LivestatusClientStream<AsyncStream>(client, yc);
+		bool keepAlive;
+
+		{
+			CpuBoundWork handlingQuery (yc);
+
+			LivestatusQuery::Ptr query = new LivestatusQuery(lines, GetCompatLogPath());
+			keepAlive = query->Execute(response);
+		}
+
+		if (!keepAlive || !IsActive())
 			break;
 	}
 
-	{
-		std::unique_lock<std::mutex> lock(l_ComponentMutex);
-		l_ClientsConnected--;
-	}
+	boost::system::error_code ec;
+	client.shutdown(AsyncStream::shutdown_both, ec);
+	client.close(ec);
 }
 
 
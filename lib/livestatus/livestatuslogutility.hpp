@@ -4,42 +4,13 @@
 #define LIVESTATUSLOGUTILITY_H
 
 #include "livestatus/historytable.hpp"
+#include "icinga/compatlogindex.hpp"
 
 using namespace icinga;
 
 namespace icinga
 {
 
-enum LogEntryType {
-	LogEntryTypeHostAlert,
-	LogEntryTypeHostDowntimeAlert,
-	LogEntryTypeHostFlapping,
-	LogEntryTypeHostNotification,
-	LogEntryTypeHostInitialState,
-	LogEntryTypeHostCurrentState,
-	LogEntryTypeServiceAlert,
-	LogEntryTypeServiceDowntimeAlert,
-	LogEntryTypeServiceFlapping,
-	LogEntryTypeServiceNotification,
-	LogEntryTypeServiceInitialState,
-	LogEntryTypeServiceCurrentState,
-	LogEntryTypeTimeperiodTransition,
-	LogEntryTypeVersion,
-	LogEntryTypeInitialStates,
-	LogEntryTypeProgramStarting
-};
-
-enum LogEntryClass {
-	LogEntryClassInfo = 0,
-	LogEntryClassAlert = 1,
-	LogEntryClassProgram = 2,
-	LogEntryClassNotification = 3,
-	LogEntryClassPassive = 4,
-	LogEntryClassCommand = 5,
-	LogEntryClassState = 6,
-	LogEntryClassText = 7
-};
-
 /**
  * @ingroup livestatus
  */
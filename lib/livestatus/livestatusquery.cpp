@@ -13,6 +13,7 @@
 #include "livestatus/negatefilter.hpp"
 #include "livestatus/orfilter.hpp"
 #include "livestatus/andfilter.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 #include "icinga/externalcommandprocessor.hpp"
 #include "base/debug.hpp"
 #include "base/convert.hpp"
@@ -24,6 +25,8 @@
 #include "base/serializer.hpp"
 #include "base/timer.hpp"
 #include "base/initialize.hpp"
+#include "base/configuration.hpp"
+#include "base/workqueue.hpp"
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
 
@@ -31,9 +34,14 @@ using namespace icinga;
 
 static int l_ExternalCommands = 0;
 static std::mutex l_QueryMutex;
+static const std::streamoff l_StreamingBatchSize = 64 * 1024;
+
+/* Rows per column batch and minimum rows per parallel stats partition */
+static const size_t l_StatsBatchSize = 1024;
+static const size_t l_StatsPartitionSize = 16 * 1024;
 
 LivestatusQuery::LivestatusQuery(const std::vector<String>& lines, const String& compat_log_path)
-	: m_KeepAlive(false), m_OutputFormat("csv"), m_ColumnHeaders(true), m_Limit(-1), m_ErrorCode(0),
+	: m_KeepAlive(false), m_OutputFormat("csv"), m_ColumnHeaders(true), m_Limit(-1), m_ResultStreamed(false), m_ErrorCode(0),
 	m_LogTimeFrom(0), m_LogTimeUntil(static_cast<long>(Utility::GetTime()))
 {
 	if (lines.size() == 0) {
@@ -258,6 +266,16 @@ LivestatusQuery::LivestatusQuery(const std::vector<String>& lines, const String&
 	m_Aggregators.swap(aggregators);
 }
 
+/**
+ * Whether stats are aggregated column by column in parallel partitions where
+ * the filters and aggregators support it, or row by row. Both give the same
+ * results, apart from rounding.
+ */
+void LivestatusQuery::SetBatchedStats(bool batched)
+{
+	m_BatchedStats = batched;
+}
+
 int LivestatusQuery::GetExternalCommands()
 {
 	std::unique_lock<std::mutex> lock(l_QueryMutex);
@@ -448,7 +466,6 @@ void LivestatusQuery::ExecuteGetHelper(const Stream::Ptr& stream)
 		return;
 	}
 
-	std::vector<LivestatusRowValue> objects = table->FilterRows(m_Filter, m_Limit);
 	std::vector<String> columns;
 
 	if (m_Columns.size() > 0)
@@ -471,7 +488,12 @@ void LivestatusQuery::ExecuteGetHelper(const Stream::Ptr& stream)
 
 		ArrayData header;
 
-		for (const LivestatusRowValue& object : objects) {
+		/* Without the fixed16 header the length isn't needed upfront,
+		 * so the rows are sent in batches while they are fetched.
+		 */
+		bool streaming = (m_ResponseHeader != "fixed16");
+
+		auto appendRow = [this, &column_objs, &header, &result, &first_row, streaming, &stream](const LivestatusRowValue& object) {
 			ArrayData row;
 
 			row.reserve(column_objs.size());
@@ -489,35 +511,77 @@ void LivestatusQuery::ExecuteGetHelper(const Stream::Ptr& stream)
 			}
 
 			AppendResultRow(result, new Array(std::move(row)), first_row);
+
+			if (streaming && result.tellp() >= l_StreamingBatchSize)
+				WriteResultBatch(stream, result);
+		};
+
+		if (streaming) {
+			table->FilterRows(m_Filter, m_Limit, appendRow);
+
+			EndResultSet(result);
+			WriteResultBatch(stream, result);
+
+			return;
+		}
+
+		for (const LivestatusRowValue& object : table->FilterRows(m_Filter, m_Limit)) {
+			appendRow(object);
 		}
 	} else {
-		std::map<std::vector<Value>, std::vector<AggregatorState *> > allStats;
+		std::vector<Column> statsColumns;
+		statsColumns.reserve(m_Columns.size());
+
+		for (const String& columnName : m_Columns)
+			statsColumns.emplace_back(table->GetColumn(columnName));
+
+		/* Aggregators which support it process the rows column by column
+		 * after they've been fetched, the others get each row right away.
+		 */
+		std::vector<size_t> batchAggregators, rowAggregators;
+
+		for (size_t i = 0; i < m_Aggregators.size(); i++) {
+			if (m_BatchedStats && m_Aggregators[i]->CanApplyBatch(table))
+				batchAggregators.push_back(i);
+			else
+				rowAggregators.push_back(i);
+		}
+
+		/* group key -> index into groupStats */
+		std::map<std::vector<Value>, size_t> allStats;
+		std::vector<std::vector<AggregatorState *> > groupStats;
 
-		/* add aggregated stats */
-		for (const LivestatusRowValue& object : objects) {
+		std::vector<LivestatusRowValue> rows;
+		std::vector<size_t> rowGroups;
+
+		table->FilterRows(m_Filter, m_Limit, [this, &table, &statsColumns, &batchAggregators, &rowAggregators,
+			&allStats, &groupStats, &rows, &rowGroups](const LivestatusRowValue& object) {
 			std::vector<Value> statsKey;
+			statsKey.reserve(statsColumns.size());
 
-			for (const String& columnName : m_Columns) {
-				Column column = table->GetColumn(columnName);
+			for (const Column& column : statsColumns)
 				statsKey.emplace_back(column.ExtractValue(object.Row, object.GroupByType, object.GroupByObject));
-			}
 
 			auto it = allStats.find(statsKey);
 
 			if (it == allStats.end()) {
-				std::vector<AggregatorState *> newStats(m_Aggregators.size(), nullptr);
-				it = allStats.insert(std::make_pair(statsKey, newStats)).first;
+				it = allStats.insert(std::make_pair(std::move(statsKey), groupStats.size())).first;
+				groupStats.emplace_back(m_Aggregators.size(), nullptr);
 			}
 
-			auto& stats = it->second;
+			auto& stats = groupStats[it->second];
 
-			int index = 0;
+			for (size_t index : rowAggregators)
+				m_Aggregators[index]->Apply(table, object.Row, &stats[index]);
 
-			for (const Aggregator::Ptr& aggregator : m_Aggregators) {
-				aggregator->Apply(table, object.Row, &stats[index]);
-				index++;
+			if (!batchAggregators.empty()) {
+				rows.push_back(object);
+				rowGroups.push_back(it->second);
 			}
-		}
+		});
+
+		if (!batchAggregators.empty())
+			AggregateBatches(table, batchAggregators, rows, rowGroups, groupStats);
 
 		/* add column headers both for raw and aggregated data */
 		if (m_ColumnHeaders) {
@@ -543,7 +607,7 @@ void LivestatusQuery::ExecuteGetHelper(const Stream::Ptr& stream)
 				row.push_back(keyPart);
 			}
 
-			auto& stats = kv.second;
+			auto& stats = groupStats[kv.second];
 
 			for (size_t i = 0; i < m_Aggregators.size(); i++)
 				row.push_back(m_Aggregators[i]->GetResultAndFreeState(stats[i]));
@@ -570,6 +634,94 @@ void LivestatusQuery::ExecuteGetHelper(const Stream::Ptr& stream)
 	SendResponse(stream, LivestatusErrorOK, result.str());
 }
 
+/**
+ * Aggregates the rows column by column. The rows are split into partitions
+ * which are aggregated in parallel, each into its own states. Those are
+ * merged in partition order afterwards, so the result doesn't depend on
+ * the order in which the partitions finish.
+ */
+void LivestatusQuery::AggregateBatches(const Table::Ptr& table, const std::vector<size_t>& aggregators, const std::vector<LivestatusRowValue>& rows,
+	const std::vector<size_t>& rowGroups, std::vector<std::vector<AggregatorState *> >& groupStats) const
+{
+	size_t groupCount = groupStats.size();
+	size_t partitionCount = std::min<size_t>(std::max(Configuration::Concurrency, 1),
+		(rows.size() + l_StatsPartitionSize - 1) / l_StatsPartitionSize);
+
+	if (partitionCount == 0)
+		return;
+
+	/* The state of the i-th aggregator for group g is at i * groupCount + g. */
+	std::vector<std::vector<AggregatorState *> > partitionStats (partitionCount,
+		std::vector<AggregatorState *>(aggregators.size() * groupCount, nullptr));
+
+	auto aggregatePartition = [this, &table, &aggregators, &rows, &rowGroups, &partitionStats, groupCount, partitionCount](size_t partition) {
+		size_t begin = rows.size() * partition / partitionCount;
+		size_t end = rows.size() * (partition + 1) / partitionCount;
+		auto& states = partitionStats[partition];
+
+		for (size_t offset = begin; offset < end; offset += l_StatsBatchSize) {
+			LivestatusRowBatch batch (table, &rows[offset], &rowGroups[offset], std::min(l_StatsBatchSize, end - offset));
+
+			for (size_t i = 0; i < aggregators.size(); i++)
+				m_Aggregators[aggregators[i]]->ApplyBatch(batch, &states[i * groupCount]);
+		}
+	};
+
+	if (partitionCount == 1) {
+		aggregatePartition(0);
+	} else {
+		std::vector<size_t> partitions;
+
+		for (size_t i = 0; i < partitionCount; i++)
+			partitions.push_back(i);
+
+		WorkQueue upq (0, partitionCount, LogDebug);
+		upq.SetName("LivestatusQuery:Stats");
+		upq.ParallelFor(partitions, false, aggregatePartition);
+		upq.Join();
+
+		if (upq.HasExceptions()) {
+			for (auto& states : partitionStats) {
+				for (AggregatorState *state : states)
+					delete state;
+			}
+
+			boost::rethrow_exception(upq.GetExceptions()[0]);
+		}
+	}
+
+	for (auto& states : partitionStats) {
+		for (size_t i = 0; i < aggregators.size(); i++) {
+			const Aggregator::Ptr& aggregator = m_Aggregators[aggregators[i]];
+
+			for (size_t group = 0; group < groupCount; group++)
+				aggregator->MergeState(states[i * groupCount + group], &groupStats[group][aggregators[i]]);
+		}
+	}
+}
+
+/**
+ * Sends what has been rendered so far and clears the buffer.
+ */
+void LivestatusQuery::WriteResultBatch(const Stream::Ptr& stream, std::ostringstream& result)
+{
+	String data = result.str();
+
+	result.str("");
+
+	if (data.IsEmpty())
+		return;
+
+	m_ResultStreamed = true;
+
+	try {
+		stream->Write(data.CStr(), data.GetLength());
+	} catch (const std::exception&) {
+		Log(LogCritical, "LivestatusQuery", "Cannot write query response to socket.");
+		throw;
+	}
+}
+
 void LivestatusQuery::ExecuteCommandHelper(const Stream::Ptr& stream)
 {
 	{
@@ -636,6 +788,15 @@ bool LivestatusQuery::Execute(const Stream::Ptr& stream)
 		else
 			BOOST_THROW_EXCEPTION(std::runtime_error("Invalid livestatus query verb."));
 	} catch (const std::exception& ex) {
+		/* An error message would look like part of the result the client has already started to read. */
+		if (m_ResultStreamed) {
+			Log(LogWarning, "LivestatusQuery")
+				<< "Query failed after part of the result had been sent, closing the connection: " << DiagnosticInformation(ex, false);
+
+			stream->Close();
+			return false;
+		}
+
 		SendResponse(stream, LivestatusErrorQuery, DiagnosticInformation(ex));
 	}
 
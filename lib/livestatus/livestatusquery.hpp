@@ -10,6 +10,7 @@
 #include "base/stream.hpp"
 #include "base/scriptframe.hpp"
 #include <deque>
+#include <sstream>
 
 using namespace icinga;
 
@@ -37,6 +38,8 @@ public:
 
 	static int GetExternalCommands();
 
+	void SetBatchedStats(bool batched);
+
 private:
 	String m_Verb;
 
@@ -55,6 +58,8 @@ private:
 	int m_Limit;
 
 	String m_ResponseHeader;
+	bool m_ResultStreamed;
+	bool m_BatchedStats{true};
 
 	/* Parameters for COMMAND/SCRIPT queries. */
 	String m_Command;
@@ -76,6 +81,9 @@ private:
 	static String QuoteStringPython(const String& str);
 
 	void ExecuteGetHelper(const Stream::Ptr& stream);
+	void WriteResultBatch(const Stream::Ptr& stream, std::ostringstream& result);
+	void AggregateBatches(const Table::Ptr& table, const std::vector<size_t>& aggregators, const std::vector<LivestatusRowValue>& rows,
+		const std::vector<size_t>& rowGroups, std::vector<std::vector<AggregatorState *> >& groupStats) const;
 	void ExecuteCommandHelper(const Stream::Ptr& stream);
 	void ExecuteErrorHelper(const Stream::Ptr& stream);
 
@@ -0,0 +1,54 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "livestatus/livestatusrowbatch.hpp"
+
+using namespace icinga;
+
+LivestatusRowBatch::LivestatusRowBatch(Table::Ptr table, const LivestatusRowValue *rows, const size_t *groups, size_t size)
+	: m_Table(std::move(table)), m_Rows(rows), m_Groups(groups), m_Size(size)
+{ }
+
+const Table::Ptr& LivestatusRowBatch::GetTable() const
+{
+	return m_Table;
+}
+
+size_t LivestatusRowBatch::GetSize() const
+{
+	return m_Size;
+}
+
+/**
+ * Returns the index of the stats group the row belongs to.
+ */
+size_t LivestatusRowBatch::GetGroup(size_t index) const
+{
+	return m_Groups[index];
+}
+
+const LivestatusNumberBatch& LivestatusRowBatch::GetNumberColumn(const String& name)
+{
+	auto it = m_NumberColumns.find(name);
+
+	if (it != m_NumberColumns.end())
+		return it->second;
+
+	const LivestatusNumberColumn *column = m_Table->GetNumberColumn(name);
+
+	if (!column)
+		BOOST_THROW_EXCEPTION(std::invalid_argument("Column '" + name + "' of table '" + m_Table->GetName() + "' can't be read in batches."));
+
+	LivestatusNumberBatch& batch = m_NumberColumns[name];
+	batch.Boolean = column->Boolean;
+	batch.Values.resize(m_Size);
+	batch.Empty.resize(m_Size);
+
+	for (size_t i = 0; i < m_Size; i++) {
+		if (!column->Accessor(m_Rows[i].Row, batch.Values[i])) {
+			batch.Values[i] = 0;
+			batch.Empty[i] = 1;
+		}
+	}
+
+	return batch;
+}
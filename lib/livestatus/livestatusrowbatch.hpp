@@ -0,0 +1,60 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef LIVESTATUSROWBATCH_H
+#define LIVESTATUSROWBATCH_H
+
+#include "livestatus/i2-livestatus.hpp"
+#include "livestatus/table.hpp"
+#include <map>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * The values of a numeric column for all rows of a batch. Empty values are
+ * 0, just like an empty Value converted to a number.
+ *
+ * @ingroup livestatus
+ */
+struct LivestatusNumberBatch
+{
+	std::vector<double> Values;
+	std::vector<char> Empty;
+	bool Boolean;
+};
+
+/**
+ * A range of rows which stats filters and aggregators process column by
+ * column. Each numeric column is read once per batch and shared by all
+ * filters and aggregators referring to it.
+ *
+ * A batch belongs to a single thread.
+ *
+ * @ingroup livestatus
+ */
+class LivestatusRowBatch
+{
+public:
+	LivestatusRowBatch(Table::Ptr table, const LivestatusRowValue *rows, const size_t *groups, size_t size);
+
+	LivestatusRowBatch(const LivestatusRowBatch&) = delete;
+	LivestatusRowBatch& operator=(const LivestatusRowBatch&) = delete;
+
+	const Table::Ptr& GetTable() const;
+	size_t GetSize() const;
+	size_t GetGroup(size_t index) const;
+
+	const LivestatusNumberBatch& GetNumberColumn(const String& name);
+
+private:
+	Table::Ptr m_Table;
+	const LivestatusRowValue *m_Rows;
+	const size_t *m_Groups;
+	size_t m_Size;
+	std::map<String, LivestatusNumberBatch> m_NumberColumns;
+};
+
+}
+
+#endif /* LIVESTATUSROWBATCH_H */
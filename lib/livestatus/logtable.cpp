@@ -92,12 +92,38 @@ void LogTable::FetchRows(const AddRowFunction& addRowFn)
 }
 
 /* gets called in LivestatusLogUtility::CreateLogCache */
-void LogTable::UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, int line_count, int lineno, const AddRowFunction& addRowFn)
+bool LogTable::UpdateLogEntries(const CompatLogPartition& partition, const AddRowFunction& addRowFn)
 {
-	/* additional attributes only for log table */
-	log_entry_attrs->Set("lineno", lineno);
+	static const std::set<String> indexedColumns {
+		"time", "type", "host_name", "service_description", "state_type", "state", "attempt", "class"
+	};
 
-	addRowFn(log_entry_attrs, LivestatusGroupByNone, Empty);
+	std::vector<size_t> entries;
+
+	/* only the lines which can match the filter are read and parsed */
+	if (!SelectLogEntries(partition, indexedColumns, entries))
+		return true;
+
+	for (size_t lineno : entries) {
+		String line = partition.ReadLine(lineno);
+		Dictionary::Ptr log_entry_attrs;
+
+		try {
+			log_entry_attrs = LivestatusLogUtility::GetAttributes(line);
+		} catch (const std::exception&) {
+			Log(LogDebug, "LogTable")
+				<< "Skipping invalid log line: '" << line << "'.";
+			continue;
+		}
+
+		/* additional attributes only for log table */
+		log_entry_attrs->Set("lineno", static_cast<int>(lineno));
+
+		if (!addRowFn(log_entry_attrs, LivestatusGroupByNone, Empty))
+			return false;
+	}
+
+	return true;
 }
 
 Object::Ptr LogTable::HostAccessor(const Value& row, const Column::ObjectAccessor&)
@@ -26,7 +26,7 @@ public:
 	String GetName() const override;
 	String GetPrefix() const override;
 
-	void UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, int line_count, int lineno, const AddRowFunction& addRowFn) override;
+	bool UpdateLogEntries(const CompatLogPartition& partition, const AddRowFunction& addRowFn) override;
 
 protected:
 	void FetchRows(const AddRowFunction& addRowFn) override;
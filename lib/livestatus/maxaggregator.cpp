@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/maxaggregator.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -18,7 +19,7 @@ MaxAggregatorState *MaxAggregator::EnsureState(AggregatorState **state)
 
 void MaxAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_MaxAttr);
+	const Column& column = GetColumn(table, m_MaxAttr);
 
 	Value value = column.ExtractValue(row);
 
@@ -36,3 +37,38 @@ double MaxAggregator::GetResultAndFreeState(AggregatorState *state) const
 
 	return result;
 }
+
+bool MaxAggregator::CanApplyBatch(const Table::Ptr& table) const
+{
+	const LivestatusNumberColumn *column = table->GetNumberColumn(m_MaxAttr);
+
+	/* Apply() can't compare booleans to numbers. */
+	return column && !column->Boolean;
+}
+
+void MaxAggregator::ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const
+{
+	const std::vector<double>& values = batch.GetNumberColumn(m_MaxAttr).Values;
+
+	for (size_t i = 0; i < batch.GetSize(); i++) {
+		double value = values[i];
+		MaxAggregatorState *pstate = EnsureState(&states[batch.GetGroup(i)]);
+
+		if (value > pstate->Max)
+			pstate->Max = value;
+	}
+}
+
+void MaxAggregator::MergeState(AggregatorState *state, AggregatorState **into) const
+{
+	if (!state)
+		return;
+
+	MaxAggregatorState *pstate = static_cast<MaxAggregatorState *>(state);
+	MaxAggregatorState *pinto = EnsureState(into);
+
+	if (pstate->Max > pinto->Max)
+		pinto->Max = pstate->Max;
+
+	delete pstate;
+}
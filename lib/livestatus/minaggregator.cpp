@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/minaggregator.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -18,7 +19,7 @@ MinAggregatorState *MinAggregator::EnsureState(AggregatorState **state)
 
 void MinAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_MinAttr);
+	const Column& column = GetColumn(table, m_MinAttr);
 
 	Value value = column.ExtractValue(row);
 
@@ -43,3 +44,38 @@ double MinAggregator::GetResultAndFreeState(AggregatorState *state) const
 
 	return result;
 }
+
+bool MinAggregator::CanApplyBatch(const Table::Ptr& table) const
+{
+	const LivestatusNumberColumn *column = table->GetNumberColumn(m_MinAttr);
+
+	/* Apply() can't compare booleans to numbers. */
+	return column && !column->Boolean;
+}
+
+void MinAggregator::ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const
+{
+	const std::vector<double>& values = batch.GetNumberColumn(m_MinAttr).Values;
+
+	for (size_t i = 0; i < batch.GetSize(); i++) {
+		double value = values[i];
+		MinAggregatorState *pstate = EnsureState(&states[batch.GetGroup(i)]);
+
+		if (value < pstate->Min)
+			pstate->Min = value;
+	}
+}
+
+void MinAggregator::MergeState(AggregatorState *state, AggregatorState **into) const
+{
+	if (!state)
+		return;
+
+	MinAggregatorState *pstate = static_cast<MinAggregatorState *>(state);
+	MinAggregatorState *pinto = EnsureState(into);
+
+	if (pstate->Min < pinto->Min)
+		pinto->Min = pstate->Min;
+
+	delete pstate;
+}
@@ -12,3 +12,21 @@ bool NegateFilter::Apply(const Table::Ptr& table, const Value& row)
 {
 	return !m_Inner->Apply(table, row);
 }
+
+bool NegateFilter::CanApplyBatch(const Table::Ptr& table) const
+{
+	return m_Inner->CanApplyBatch(table);
+}
+
+void NegateFilter::ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const
+{
+	m_Inner->ApplyBatch(batch, matches);
+
+	for (char& match : matches)
+		match = !match;
+}
+
+const Filter::Ptr& NegateFilter::GetInner() const
+{
+	return m_Inner;
+}
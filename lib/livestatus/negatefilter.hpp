@@ -21,6 +21,10 @@ public:
 	NegateFilter(Filter::Ptr inner);
 
 	bool Apply(const Table::Ptr& table, const Value& row) override;
+	bool CanApplyBatch(const Table::Ptr& table) const override;
+	void ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const override;
+
+	const Filter::Ptr& GetInner() const;
 
 private:
 	Filter::Ptr m_Inner;
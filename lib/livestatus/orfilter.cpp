@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/orfilter.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -16,3 +17,22 @@ bool OrFilter::Apply(const Table::Ptr& table, const Value& row)
 
 	return false;
 }
+
+void OrFilter::ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const
+{
+	if (m_Filters.empty()) {
+		matches.assign(batch.GetSize(), 1);
+		return;
+	}
+
+	matches.assign(batch.GetSize(), 0);
+
+	std::vector<char> subMatches;
+
+	for (const Filter::Ptr& filter : m_Filters) {
+		filter->ApplyBatch(batch, subMatches);
+
+		for (size_t i = 0; i < matches.size(); i++)
+			matches[i] |= subMatches[i];
+	}
+}
@@ -19,6 +19,7 @@ public:
 	DECLARE_PTR_TYPEDEFS(OrFilter);
 
 	bool Apply(const Table::Ptr& table, const Value& row) override;
+	void ApplyBatch(LivestatusRowBatch& batch, std::vector<char>& matches) const override;
 };
 
 }
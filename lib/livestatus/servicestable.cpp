@@ -5,6 +5,7 @@
 #include "livestatus/servicegroupstable.hpp"
 #include "livestatus/hostgroupstable.hpp"
 #include "livestatus/endpointstable.hpp"
+#include "livestatus/livestatusindex.hpp"
 #include "icinga/service.hpp"
 #include "icinga/servicegroup.hpp"
 #include "icinga/hostgroup.hpp"
@@ -28,6 +29,13 @@ ServicesTable::ServicesTable(LivestatusGroupByType type)
 	: Table(type)
 {
 	AddColumns(this);
+
+	/* The rows' own numeric columns can be read in batches by stats queries. */
+	AddNumberColumn("state", &ServicesTable::StateNumberAccessor);
+	AddNumberColumn("acknowledged", &ServicesTable::AcknowledgedNumberAccessor, true);
+	AddNumberColumn("scheduled_downtime_depth", &ServicesTable::ScheduledDowntimeDepthNumberAccessor);
+	AddNumberColumn("latency", &ServicesTable::LatencyNumberAccessor);
+	AddNumberColumn("execution_time", &ServicesTable::ExecutionTimeNumberAccessor);
 }
 
 
@@ -164,10 +172,9 @@ void ServicesTable::FetchRows(const AddRowFunction& addRowFn)
 			}
 		}
 	} else if (GetGroupByType() == LivestatusGroupByHostGroup) {
+		/* GetMembers() and GetServices() return copies, so no locks are held while the rows are added. */
 		for (const HostGroup::Ptr& hg : ConfigType::GetObjectsByType<HostGroup>()) {
-			ObjectLock ylock(hg);
 			for (const Host::Ptr& host : hg->GetMembers()) {
-				ObjectLock ylock(host);
 				for (const Service::Ptr& service : host->GetServices()) {
 					/* the caller must know which groupby type and value are set for this row */
 					if (!addRowFn(service, LivestatusGroupByHostGroup, hg))
@@ -183,6 +190,87 @@ void ServicesTable::FetchRows(const AddRowFunction& addRowFn)
 	}
 }
 
+bool ServicesTable::FetchIndexedRows(const std::vector<LivestatusIndexHint>& hints, const AddRowFunction& addRowFn)
+{
+	if (GetGroupByType() != LivestatusGroupByNone)
+		return false;
+
+	std::vector<Service::Ptr> services;
+	bool indexed = false;
+
+	/* The most selective index first. */
+	for (auto& hint : hints) {
+		if (hint.Column == "host_name" && hint.Operator == "=" && !hint.Negate) {
+			Host::Ptr host = Host::GetByName(hint.Operand);
+
+			if (host)
+				services = host->GetServices();
+
+			indexed = true;
+			break;
+		}
+	}
+
+	for (auto& hint : hints) {
+		if (indexed)
+			break;
+
+		if (hint.Column == "groups" && hint.Operator == ">=" && !hint.Negate) {
+			ServiceGroup::Ptr sg = ServiceGroup::GetByName(hint.Operand);
+
+			if (sg) {
+				std::set<Service::Ptr> members = sg->GetMembers();
+				services.assign(members.begin(), members.end());
+			}
+
+			indexed = true;
+		} else if (hint.Column == "host_groups" && hint.Operator == ">=" && !hint.Negate) {
+			HostGroup::Ptr hg = HostGroup::GetByName(hint.Operand);
+
+			if (hg) {
+				for (const Host::Ptr& host : hg->GetMembers()) {
+					std::vector<Service::Ptr> hostServices = host->GetServices();
+					services.insert(services.end(), hostServices.begin(), hostServices.end());
+				}
+			}
+
+			indexed = true;
+		}
+	}
+
+	for (auto& hint : hints) {
+		if (indexed)
+			break;
+
+		if (hint.Column == "state" && hint.Operator == "=") {
+			double state = Convert::ToDouble(hint.Operand);
+
+			if (state == static_cast<int>(state))
+				services = LivestatusIndex::GetServicesByState(static_cast<int>(state), hint.Negate);
+			else if (hint.Negate)
+				return false;
+
+			indexed = true;
+		} else if (hint.Column == "acknowledged" && hint.Operator == "=" && Convert::ToDouble(hint.Operand) == (hint.Negate ? 0 : 1)) {
+			for (const Checkable::Ptr& checkable : LivestatusIndex::GetAcknowledged(Service::TypeInstance)) {
+				services.push_back(static_pointer_cast<Service>(checkable));
+			}
+
+			indexed = true;
+		}
+	}
+
+	if (!indexed)
+		return false;
+
+	for (const Service::Ptr& service : services) {
+		if (!addRowFn(service, LivestatusGroupByNone, Empty))
+			break;
+	}
+
+	return true;
+}
+
 Object::Ptr ServicesTable::HostAccessor(const Value& row, const Column::ObjectAccessor& parentObjectAccessor)
 {
 	Value service;
@@ -1203,3 +1291,69 @@ Value ServicesTable::OriginalAttributesAccessor(const Value& row)
 
 	return JsonEncode(service->GetOriginalAttributes());
 }
+
+bool ServicesTable::StateNumberAccessor(const Value& row, double& value)
+{
+	Service::Ptr service = static_cast<Service::Ptr>(row);
+
+	if (!service)
+		return false;
+
+	value = service->GetState();
+	return true;
+}
+
+bool ServicesTable::AcknowledgedNumberAccessor(const Value& row, double& value)
+{
+	Service::Ptr service = static_cast<Service::Ptr>(row);
+
+	if (!service)
+		return false;
+
+	ObjectLock olock(service);
+	value = service->IsAcknowledged();
+	return true;
+}
+
+bool ServicesTable::ScheduledDowntimeDepthNumberAccessor(const Value& row, double& value)
+{
+	Service::Ptr service = static_cast<Service::Ptr>(row);
+
+	if (!service)
+		return false;
+
+	value = service->GetDowntimeDepth();
+	return true;
+}
+
+bool ServicesTable::LatencyNumberAccessor(const Value& row, double& value)
+{
+	Service::Ptr service = static_cast<Service::Ptr>(row);
+
+	if (!service)
+		return false;
+
+	CheckResult::Ptr cr = service->GetLastCheckResult();
+
+	if (!cr)
+		return false;
+
+	value = cr->CalculateLatency();
+	return true;
+}
+
+bool ServicesTable::ExecutionTimeNumberAccessor(const Value& row, double& value)
+{
+	Service::Ptr service = static_cast<Service::Ptr>(row);
+
+	if (!service)
+		return false;
+
+	CheckResult::Ptr cr = service->GetLastCheckResult();
+
+	if (!cr)
+		return false;
+
+	value = cr->CalculateExecutionTime();
+	return true;
+}
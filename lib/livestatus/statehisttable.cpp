@@ -36,26 +36,68 @@ StateHistTable::StateHistTable(const String& compat_log_path, time_t from, time_
 	AddColumns(this);
 }
 
-void StateHistTable::UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, int line_count, int lineno, const AddRowFunction& addRowFn)
+/* gets called in LivestatusLogUtility::CreateLogCache */
+bool StateHistTable::UpdateLogEntries(const CompatLogPartition& partition, const AddRowFunction&)
 {
-	unsigned int time = log_entry_attrs->Get("time");
-	String host_name = log_entry_attrs->Get("host_name");
-	String service_description = log_entry_attrs->Get("service_description");
-	unsigned long state = log_entry_attrs->Get("state");
-	int log_type = log_entry_attrs->Get("log_type");
-	String state_type = log_entry_attrs->Get("state_type"); //SOFT, HARD, STARTED, STOPPED, ...
-	String log_line = log_entry_attrs->Get("message"); /* use message from log table */
+	static const std::set<String> indexedColumns { "host_name", "service_description" };
 
-	Checkable::Ptr checkable;
+	std::vector<size_t> entries;
+
+	if (!SelectLogEntries(partition, indexedColumns, entries))
+		return true;
+
+	/* the objects are looked up once per host and service in the log file */
+	std::map<std::pair<uint32_t, uint32_t>, Checkable::Ptr> checkables;
+
+	for (size_t lineno : entries) {
+		uint32_t host_id = partition.HostName[lineno];
+		uint32_t service_id = partition.ServiceDescription[lineno];
+		Checkable::Ptr checkable;
+
+		if (host_id == CompatLogIndex::UnknownString || service_id == CompatLogIndex::UnknownString) {
+			/* the names are too long for the index */
+			Dictionary::Ptr log_entry_attrs = LivestatusLogUtility::GetAttributes(partition.ReadLine(lineno));
+			String host_name = log_entry_attrs->Get("host_name");
+			String service_description = log_entry_attrs->Get("service_description");
+
+			checkable = GetCheckable(host_name, service_description);
+		} else {
+			auto key = std::make_pair(host_id, service_id);
+			auto it = checkables.find(key);
+
+			if (it == checkables.end())
+				it = checkables.insert(std::make_pair(key, GetCheckable(partition.GetString(host_id), partition.GetString(service_id)))).first;
+
+			checkable = it->second;
+		}
+
+		/* invalid log line for state history */
+		if (!checkable)
+			continue;
+
+		UpdateCheckableState(checkable, partition, lineno);
+	}
+
+	return true;
+}
+
+Checkable::Ptr StateHistTable::GetCheckable(const String& host_name, const String& service_description)
+{
+	if (host_name.IsEmpty())
+		return nullptr;
 
 	if (service_description.IsEmpty())
-		checkable = Host::GetByName(host_name);
+		return Host::GetByName(host_name);
 	else
-		checkable = Service::GetByNamePair(host_name, service_description);
+		return Service::GetByNamePair(host_name, service_description);
+}
 
-	/* invalid log line for state history */
-	if (!checkable)
-		return;
+void StateHistTable::UpdateCheckableState(const Checkable::Ptr& checkable, const CompatLogPartition& partition, size_t lineno)
+{
+	unsigned int time = partition.Time[lineno];
+	unsigned long state = partition.State[lineno];
+	int log_type = partition.LogType[lineno];
+	String state_type = partition.GetString(partition.StateType[lineno]); //SOFT, HARD, STARTED, STOPPED, ...
 
 	Array::Ptr state_hist_service_states;
 	Dictionary::Ptr state_hist_bag;
@@ -87,8 +129,8 @@ void StateHistTable::UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, in
 		state_hist_bag->Set("in_notification_period", 1); // assume "always"
 		state_hist_bag->Set("is_flapping", 0);
 		state_hist_bag->Set("time", time);
-		state_hist_bag->Set("lineno", lineno);
-		state_hist_bag->Set("log_output", log_line); /* complete line */
+		state_hist_bag->Set("lineno", static_cast<int>(lineno));
+		state_hist_bag->Set("log_output", partition.ReadLine(lineno)); /* complete line */
 		state_hist_bag->Set("from", time); /* starting at current timestamp */
 		state_hist_bag->Set("until", time); /* will be updated later on state change */
 		state_hist_bag->Set("query_part", query_part); /* required for _part calculations */
@@ -134,6 +176,7 @@ void StateHistTable::UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, in
 
 					/* 2. add new state_hist_bag */
 					Dictionary::Ptr state_hist_bag_new = new Dictionary();
+					String log_line = partition.ReadLine(lineno);
 
 					state_hist_bag_new->Set("host_name", state_hist_bag->Get("host_name"));
 					state_hist_bag_new->Set("service_description", state_hist_bag->Get("service_description"));
@@ -144,7 +187,7 @@ void StateHistTable::UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, in
 					state_hist_bag_new->Set("notification_period", notification_period_name);
 					state_hist_bag_new->Set("is_flapping", state_hist_bag->Get("is_flapping")); // keep value from previous state!
 					state_hist_bag_new->Set("time", time);
-					state_hist_bag_new->Set("lineno", lineno);
+					state_hist_bag_new->Set("lineno", static_cast<int>(lineno));
 					state_hist_bag_new->Set("log_output", log_line); /* complete line */
 					state_hist_bag_new->Set("from", time); /* starting at current timestamp */
 					state_hist_bag_new->Set("until", time + 1); /* will be updated later */
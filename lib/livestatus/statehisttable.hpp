@@ -27,7 +27,7 @@ public:
 	String GetName() const override;
 	String GetPrefix() const override;
 
-	void UpdateLogEntries(const Dictionary::Ptr& log_entry_attrs, int line_count, int lineno, const AddRowFunction& addRowFn) override;
+	bool UpdateLogEntries(const CompatLogPartition& partition, const AddRowFunction& addRowFn) override;
 
 protected:
 	void FetchRows(const AddRowFunction& addRowFn) override;
@@ -68,6 +68,9 @@ private:
 	time_t m_TimeFrom;
 	time_t m_TimeUntil;
 	String m_CompatLogPath;
+
+	static Checkable::Ptr GetCheckable(const String& host_name, const String& service_description);
+	void UpdateCheckableState(const Checkable::Ptr& checkable, const CompatLogPartition& partition, size_t lineno);
 };
 
 }
@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/stdaggregator.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 #include <math.h>
 
 using namespace icinga;
@@ -19,7 +20,7 @@ StdAggregatorState *StdAggregator::EnsureState(AggregatorState **state)
 
 void StdAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_StdAttr);
+	const Column& column = GetColumn(table, m_StdAttr);
 
 	Value value = column.ExtractValue(row);
 
@@ -38,3 +39,37 @@ double StdAggregator::GetResultAndFreeState(AggregatorState *state) const
 
 	return result;
 }
+
+bool StdAggregator::CanApplyBatch(const Table::Ptr& table) const
+{
+	return table->GetNumberColumn(m_StdAttr) != nullptr;
+}
+
+void StdAggregator::ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const
+{
+	const std::vector<double>& values = batch.GetNumberColumn(m_StdAttr).Values;
+
+	for (size_t i = 0; i < batch.GetSize(); i++) {
+		double value = values[i];
+		StdAggregatorState *pstate = EnsureState(&states[batch.GetGroup(i)]);
+
+		pstate->StdSum += value;
+		pstate->StdQSum += pow(value, 2);
+		pstate->StdCount++;
+	}
+}
+
+void StdAggregator::MergeState(AggregatorState *state, AggregatorState **into) const
+{
+	if (!state)
+		return;
+
+	StdAggregatorState *pstate = static_cast<StdAggregatorState *>(state);
+	StdAggregatorState *pinto = EnsureState(into);
+
+	pinto->StdSum += pstate->StdSum;
+	pinto->StdQSum += pstate->StdQSum;
+	pinto->StdCount += pstate->StdCount;
+
+	delete pstate;
+}
@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/sumaggregator.hpp"
+#include "livestatus/livestatusrowbatch.hpp"
 
 using namespace icinga;
 
@@ -18,7 +19,7 @@ SumAggregatorState *SumAggregator::EnsureState(AggregatorState **state)
 
 void SumAggregator::Apply(const Table::Ptr& table, const Value& row, AggregatorState **state)
 {
-	Column column = table->GetColumn(m_SumAttr);
+	const Column& column = GetColumn(table, m_SumAttr);
 
 	Value value = column.ExtractValue(row);
 
@@ -35,3 +36,33 @@ double SumAggregator::GetResultAndFreeState(AggregatorState *state) const
 
 	return result;
 }
+
+bool SumAggregator::CanApplyBatch(const Table::Ptr& table) const
+{
+	return table->GetNumberColumn(m_SumAttr) != nullptr;
+}
+
+void SumAggregator::ApplyBatch(LivestatusRowBatch& batch, AggregatorState **states) const
+{
+	const std::vector<double>& values = batch.GetNumberColumn(m_SumAttr).Values;
+
+	for (size_t i = 0; i < batch.GetSize(); i++) {
+		double value = values[i];
+		SumAggregatorState *pstate = EnsureState(&states[batch.GetGroup(i)]);
+
+		pstate->Sum += value;
+	}
+}
+
+void SumAggregator::MergeState(AggregatorState *state, AggregatorState **into) const
+{
+	if (!state)
+		return;
+
+	SumAggregatorState *pstate = static_cast<SumAggregatorState *>(state);
+	SumAggregatorState *pinto = EnsureState(into);
+
+	pinto->Sum += pstate->Sum;
+
+	delete pstate;
+}
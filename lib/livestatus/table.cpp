@@ -17,6 +17,9 @@
 #include "livestatus/logtable.hpp"
 #include "livestatus/statehisttable.hpp"
 #include "livestatus/filter.hpp"
+#include "livestatus/andfilter.hpp"
+#include "livestatus/attributefilter.hpp"
+#include "livestatus/negatefilter.hpp"
 #include "base/array.hpp"
 #include "base/dictionary.hpp"
 #include <boost/algorithm/string/case_conv.hpp>
@@ -79,13 +82,19 @@ void Table::AddColumn(const String& name, const Column& column)
 		ret.first->second = column;
 }
 
-Column Table::GetColumn(const String& name) const
+String Table::StripPrefix(const String& name) const
 {
-	String dname = name;
 	String prefix = GetPrefix() + "_";
 
-	if (dname.Find(prefix) == 0)
-		dname = dname.SubStr(prefix.GetLength());
+	if (name.Find(prefix) == 0)
+		return name.SubStr(prefix.GetLength());
+
+	return name;
+}
+
+Column Table::GetColumn(const String& name) const
+{
+	String dname = StripPrefix(name);
 
 	auto it = m_Columns.find(dname);
 
@@ -95,6 +104,25 @@ Column Table::GetColumn(const String& name) const
 	return it->second;
 }
 
+/**
+ * Registers a batch accessor for a numeric column which was added with
+ * AddColumn(). It has to return the same numbers as the column's accessor.
+ */
+void Table::AddNumberColumn(const String& name, NumberAccessor accessor, bool boolean)
+{
+	m_NumberColumns[name] = { accessor, boolean };
+}
+
+const LivestatusNumberColumn *Table::GetNumberColumn(const String& name) const
+{
+	auto it = m_NumberColumns.find(StripPrefix(name));
+
+	if (it == m_NumberColumns.end())
+		return nullptr;
+
+	return &it->second;
+}
+
 std::vector<String> Table::GetColumnNames() const
 {
 	std::vector<String> names;
@@ -110,16 +138,77 @@ std::vector<LivestatusRowValue> Table::FilterRows(const Filter::Ptr& filter, int
 {
 	std::vector<LivestatusRowValue> rs;
 
-	FetchRows([this, filter, limit, &rs](const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject) {
-		return FilteredAddRow(rs, filter, limit, row, groupByType, groupByObject);
+	FilterRows(filter, limit, [&rs](const LivestatusRowValue& row) {
+		rs.push_back(row);
 	});
 
 	return rs;
 }
 
-bool Table::FilteredAddRow(std::vector<LivestatusRowValue>& rs, const Filter::Ptr& filter, int limit, const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject)
+/**
+ * Passes the matching rows to the callback as soon as they are fetched.
+ */
+void Table::FilterRows(const Filter::Ptr& filter, int limit, const FilteredRowFunction& callback)
+{
+	std::vector<LivestatusIndexHint> hints;
+	int count = 0;
+
+	if (filter)
+		CollectIndexHints(filter, false, hints);
+
+	AddRowFunction addRowFn = [this, filter, limit, &callback, &count](const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject) {
+		return FilteredAddRow(callback, count, filter, limit, row, groupByType, groupByObject);
+	};
+
+	if (hints.empty() || !FetchIndexedRows(hints, addRowFn))
+		FetchRows(addRowFn);
+}
+
+/**
+ * Collects the column conditions which hold for every matching row, i.e.
+ * the ones which aren't below an Or filter.
+ */
+void Table::CollectIndexHints(const Filter::Ptr& filter, bool negate, std::vector<LivestatusIndexHint>& hints) const
+{
+	AttributeFilter::Ptr attributeFilter = dynamic_pointer_cast<AttributeFilter>(filter);
+
+	if (attributeFilter) {
+		hints.push_back({ StripPrefix(attributeFilter->GetColumn()), attributeFilter->GetOperator(), attributeFilter->GetOperand(), negate });
+		return;
+	}
+
+	NegateFilter::Ptr negateFilter = dynamic_pointer_cast<NegateFilter>(filter);
+
+	/* Only a negated attribute filter is still a single condition. */
+	if (negateFilter) {
+		if (!negate && dynamic_pointer_cast<AttributeFilter>(negateFilter->GetInner()))
+			CollectIndexHints(negateFilter->GetInner(), true, hints);
+
+		return;
+	}
+
+	AndFilter::Ptr andFilter = dynamic_pointer_cast<AndFilter>(filter);
+
+	if (andFilter && !negate) {
+		for (const Filter::Ptr& subFilter : andFilter->GetSubFilters()) {
+			CollectIndexHints(subFilter, false, hints);
+		}
+	}
+}
+
+/**
+ * Fetches only the rows which can satisfy the hints.
+ *
+ * @return false if the table has no index for any of the hints, FetchRows() is used then
+ */
+bool Table::FetchIndexedRows(const std::vector<LivestatusIndexHint>&, const AddRowFunction&)
+{
+	return false;
+}
+
+bool Table::FilteredAddRow(const FilteredRowFunction& callback, int& count, const Filter::Ptr& filter, int limit, const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject)
 {
-	if (limit != -1 && static_cast<int>(rs.size()) == limit)
+	if (limit != -1 && count == limit)
 		return false;
 
 	if (!filter || filter->Apply(this, row)) {
@@ -128,7 +217,8 @@ bool Table::FilteredAddRow(std::vector<LivestatusRowValue>& rs, const Filter::Pt
 		rval.GroupByType = groupByType;
 		rval.GroupByObject = groupByObject;
 
-		rs.emplace_back(std::move(rval));
+		count++;
+		callback(rval);
 	}
 
 	return true;
@@ -22,6 +22,35 @@ struct LivestatusRowValue {
 };
 
 typedef std::function<bool (const Value&, LivestatusGroupByType, const Object::Ptr&)> AddRowFunction;
+typedef std::function<void (const LivestatusRowValue&)> FilteredRowFunction;
+
+/**
+ * A column condition every row of the result has to satisfy. Tables may use
+ * it to fetch only the rows which can match, the whole filter is still
+ * applied to them.
+ */
+struct LivestatusIndexHint {
+	String Column;
+	String Operator;
+	String Operand;
+	bool Negate;
+};
+
+/**
+ * Reads a numeric column without boxing the value. Returns false if the
+ * column is empty for the row.
+ */
+typedef bool (*NumberAccessor)(const Value& row, double& value);
+
+/**
+ * A column which stats queries can read in batches, see LivestatusRowBatch.
+ * Boolean columns return bool values from their regular accessor, which
+ * compare differently than numbers.
+ */
+struct LivestatusNumberColumn {
+	NumberAccessor Accessor;
+	bool Boolean;
+};
 
 class Filter;
 
@@ -39,17 +68,22 @@ public:
 	virtual String GetPrefix() const = 0;
 
 	std::vector<LivestatusRowValue> FilterRows(const intrusive_ptr<Filter>& filter, int limit = -1);
+	void FilterRows(const intrusive_ptr<Filter>& filter, int limit, const FilteredRowFunction& callback);
 
 	void AddColumn(const String& name, const Column& column);
 	Column GetColumn(const String& name) const;
 	std::vector<String> GetColumnNames() const;
 
+	void AddNumberColumn(const String& name, NumberAccessor accessor, bool boolean = false);
+	const LivestatusNumberColumn *GetNumberColumn(const String& name) const;
+
 	LivestatusGroupByType GetGroupByType() const;
 
 protected:
 	Table(LivestatusGroupByType type = LivestatusGroupByNone);
 
 	virtual void FetchRows(const AddRowFunction& addRowFn) = 0;
+	virtual bool FetchIndexedRows(const std::vector<LivestatusIndexHint>& hints, const AddRowFunction& addRowFn);
 
 	static Value ZeroAccessor(const Value&);
 	static Value OneAccessor(const Value&);
@@ -62,8 +96,12 @@ protected:
 
 private:
 	std::map<String, Column> m_Columns;
+	std::map<String, LivestatusNumberColumn> m_NumberColumns;
+
+	String StripPrefix(const String& name) const;
+	void CollectIndexHints(const intrusive_ptr<Filter>& filter, bool negate, std::vector<LivestatusIndexHint>& hints) const;
 
-	bool FilteredAddRow(std::vector<LivestatusRowValue>& rs, const intrusive_ptr<Filter>& filter, int limit, const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject);
+	bool FilteredAddRow(const FilteredRowFunction& callback, int& count, const intrusive_ptr<Filter>& filter, int limit, const Value& row, LivestatusGroupByType groupByType, const Object::Ptr& groupByObject);
 };
 
 }
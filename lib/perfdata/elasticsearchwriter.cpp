@@ -66,11 +66,15 @@ void ElasticsearchWriter::StatsFunc(const Dictionary::Ptr& status, const Array::
 
 		nodes.emplace_back(elasticsearchwriter->GetName(), new Dictionary({
 			{ "work_queue_items", workQueueItems },
-			{ "work_queue_item_rate", workQueueItemRate }
+			{ "work_queue_item_rate", workQueueItemRate },
+			{ "connects", elasticsearchwriter->m_Connection.GetConnectCount() },
+			{ "requests", elasticsearchwriter->m_Connection.GetRequestCount() },
+			{ "request_latency", elasticsearchwriter->m_Connection.GetLatencyHistogram() }
 		}));
 
 		perfdata->Add(new PerfdataValue("elasticsearchwriter_" + elasticsearchwriter->GetName() + "_work_queue_items", workQueueItems));
 		perfdata->Add(new PerfdataValue("elasticsearchwriter_" + elasticsearchwriter->GetName() + "_work_queue_item_rate", workQueueItemRate));
+		elasticsearchwriter->m_Connection.AddPerfdata("elasticsearchwriter_" + elasticsearchwriter->GetName(), perfdata);
 	}
 
 	status->Set("elasticsearchwriter", new Dictionary(std::move(nodes)));
@@ -112,9 +116,20 @@ void ElasticsearchWriter::Resume()
 /* Pause is equivalent to Stop, but with HA capabilities to resume at runtime. */
 void ElasticsearchWriter::Pause()
 {
-	Flush();
+	/* The flush timer and the work queue use m_Connection as well. */
+	{
+		std::unique_lock<std::mutex> lock(m_DataBufferMutex);
+		Flush();
+	}
+
 	m_WorkQueue.Join();
-	Flush();
+
+	{
+		std::unique_lock<std::mutex> lock(m_DataBufferMutex);
+		Flush();
+
+		m_Connection.Disconnect();
+	}
 
 	Log(LogInformation, "ElasticsearchWriter")
 		<< "'" << GetName() << "' paused.";
@@ -146,51 +161,39 @@ void ElasticsearchWriter::AddCheckResult(const Dictionary::Ptr& fields, const Ch
 	if (!GetEnableSendPerfdata())
 		return;
 
-	Array::Ptr perfdata = cr->GetPerformanceData();
+	auto perfdata (cr->GetParsedPerfdata());
 
 	CheckCommand::Ptr checkCommand = checkable->GetCheckCommand();
 
-	if (perfdata) {
-		ObjectLock olock(perfdata);
-		for (const Value& val : perfdata) {
-			PerfdataValue::Ptr pdv;
-
-			if (val.IsObjectType<PerfdataValue>())
-				pdv = val;
-			else {
-				try {
-					pdv = PerfdataValue::Parse(val);
-				} catch (const std::exception&) {
-					Log(LogWarning, "ElasticsearchWriter")
-						<< "Ignoring invalid perfdata for checkable '"
-						<< checkable->GetName() << "' and command '"
-						<< checkCommand->GetName() << "' with value: " << val;
-					continue;
-				}
-			}
+	for (const Value& val : perfdata->Invalid) {
+		Log(LogWarning, "ElasticsearchWriter")
+			<< "Ignoring invalid perfdata for checkable '"
+			<< checkable->GetName() << "' and command '"
+			<< checkCommand->GetName() << "' with value: " << val;
+	}
 
-			String escapedKey = pdv->GetLabel();
-			boost::replace_all(escapedKey, " ", "_");
-			boost::replace_all(escapedKey, ".", "_");
-			boost::replace_all(escapedKey, "\\", "_");
-			boost::algorithm::replace_all(escapedKey, "::", ".");
+	for (size_t i = 0; i < perfdata->GetLength(); i++) {
+		String escapedKey = perfdata->Labels[i];
+		boost::replace_all(escapedKey, " ", "_");
+		boost::replace_all(escapedKey, ".", "_");
+		boost::replace_all(escapedKey, "\\", "_");
+		boost::algorithm::replace_all(escapedKey, "::", ".");
 
-			String perfdataPrefix = prefix + "perfdata." + escapedKey;
+		String perfdataPrefix = prefix + "perfdata." + escapedKey;
 
-			fields->Set(perfdataPrefix + ".value", pdv->GetValue());
+		fields->Set(perfdataPrefix + ".value", perfdata->Values[i]);
 
-			if (!pdv->GetMin().IsEmpty())
-				fields->Set(perfdataPrefix + ".min", pdv->GetMin());
-			if (!pdv->GetMax().IsEmpty())
-				fields->Set(perfdataPrefix + ".max", pdv->GetMax());
-			if (!pdv->GetWarn().IsEmpty())
-				fields->Set(perfdataPrefix + ".warn", pdv->GetWarn());
-			if (!pdv->GetCrit().IsEmpty())
-				fields->Set(perfdataPrefix + ".crit", pdv->GetCrit());
+		if (!perfdata->Min[i].IsEmpty())
+			fields->Set(perfdataPrefix + ".min", perfdata->Min[i]);
+		if (!perfdata->Max[i].IsEmpty())
+			fields->Set(perfdataPrefix + ".max", perfdata->Max[i]);
+		if (!perfdata->Warn[i].IsEmpty())
+			fields->Set(perfdataPrefix + ".warn", perfdata->Warn[i]);
+		if (!perfdata->Crit[i].IsEmpty())
+			fields->Set(perfdataPrefix + ".crit", perfdata->Crit[i]);
 
-			if (!pdv->GetUnit().IsEmpty())
-				fields->Set(perfdataPrefix + ".unit", pdv->GetUnit());
-		}
+		if (!perfdata->Units[i].IsEmpty())
+			fields->Set(perfdataPrefix + ".unit", perfdata->Units[i]);
 	}
 }
 
@@ -426,6 +429,7 @@ void ElasticsearchWriter::Flush()
 
 	/* Ensure you hold a lock against m_DataBuffer so that things
 	 * don't go missing after creating the body and clearing the buffer.
+	 * The lock also serializes all uses of m_Connection.
 	 */
 	String body = boost::algorithm::join(m_DataBuffer, "\n");
 	m_DataBuffer.clear();
@@ -466,22 +470,6 @@ void ElasticsearchWriter::SendRequest(const String& body)
 
 	url->SetPath(path);
 
-	OptionalTlsStream stream;
-
-	try {
-		stream = Connect();
-	} catch (const std::exception& ex) {
-		Log(LogWarning, "ElasticsearchWriter")
-			<< "Flush failed, cannot connect to Elasticsearch: " << DiagnosticInformation(ex, false);
-		return;
-	}
-
-	Defer s ([&stream]() {
-		if (stream.first) {
-			stream.first->next_layer().shutdown();
-		}
-	});
-
 	http::request<http::string_body> request (http::verb::post, std::string(url->Format(true)), 10);
 
 	request.set(http::field::user_agent, "Icinga/" + Application::GetAppVersion());
@@ -511,37 +499,28 @@ void ElasticsearchWriter::SendRequest(const String& body)
 		<< "Sending " << request.method_string() << " request" << ((!username.IsEmpty() && !password.IsEmpty()) ? " with basic auth" : "" )
 		<< " to '" << url->Format() << "'.";
 
-	try {
-		if (stream.first) {
-			http::write(*stream.first, request);
-			stream.first->flush();
-		} else {
-			http::write(*stream.second, request);
-			stream.second->flush();
-		}
-	} catch (const std::exception&) {
-		Log(LogWarning, "ElasticsearchWriter")
-			<< "Cannot write to HTTP API on host '" << GetHost() << "' port '" << GetPort() << "'.";
-		throw;
-	}
-
-	http::parser<false, http::string_body> parser;
-	beast::flat_buffer buf;
+	HttpWriterConnection::Response response;
+	bool connected = true;
 
 	try {
-		if (stream.first) {
-			http::read(*stream.first, buf, parser);
-		} else {
-			http::read(*stream.second, buf, parser);
-		}
+		response = m_Connection.Send([this, &connected]() {
+			connected = false;
+			OptionalTlsStream stream = Connect();
+			connected = true;
+			return stream;
+		}, request);
 	} catch (const std::exception& ex) {
+		if (!connected) {
+			Log(LogWarning, "ElasticsearchWriter")
+				<< "Flush failed, cannot connect to Elasticsearch: " << DiagnosticInformation(ex, false);
+			return;
+		}
+
 		Log(LogWarning, "ElasticsearchWriter")
-			<< "Failed to parse HTTP response from host '" << GetHost() << "' port '" << GetPort() << "': " << DiagnosticInformation(ex, false);
+			<< "Cannot send data to HTTP API on host '" << GetHost() << "' port '" << GetPort() << "': " << DiagnosticInformation(ex, false);
 		throw;
 	}
 
-	auto& response (parser.get());
-
 	if (response.result_int() > 299) {
 		if (response.result() == http::status::unauthorized) {
 			/* More verbose error logging with Elasticsearch is hidden behind a proxy. */
@@ -598,17 +577,17 @@ OptionalTlsStream ElasticsearchWriter::Connect()
 	bool tls = GetEnableTls();
 
 	if (tls) {
-		Shared<boost::asio::ssl::context>::Ptr sslContext;
-
-		try {
-			sslContext = MakeAsioSslContext(GetCertPath(), GetKeyPath(), GetCaPath());
-		} catch (const std::exception&) {
-			Log(LogWarning, "ElasticsearchWriter")
-				<< "Unable to create SSL context.";
-			throw;
+		if (!m_SslContext) {
+			try {
+				m_SslContext = MakeAsioSslContext(GetCertPath(), GetKeyPath(), GetCaPath());
+			} catch (const std::exception&) {
+				Log(LogWarning, "ElasticsearchWriter")
+					<< "Unable to create SSL context.";
+				throw;
+			}
 		}
 
-		stream.first = Shared<AsioTlsStream>::Make(IoEngine::Get().GetIoContext(), *sslContext, GetHost());
+		stream.first = Shared<AsioTlsStream>::Make(IoEngine::Get().GetIoContext(), *m_SslContext, GetHost());
 
 	} else {
 		stream.second = Shared<AsioTcpStream>::Make(IoEngine::Get().GetIoContext());
@@ -625,6 +604,8 @@ OptionalTlsStream ElasticsearchWriter::Connect()
 	if (tls) {
 		auto& tlsStream (stream.first->next_layer());
 
+		m_Connection.ResumeTlsSession(tlsStream);
+
 		try {
 			tlsStream.handshake(tlsStream.client);
 		} catch (const std::exception&) {
@@ -644,6 +625,8 @@ OptionalTlsStream ElasticsearchWriter::Connect()
 				));
 			}
 		}
+
+		m_Connection.SaveTlsSession(tlsStream);
 	}
 
 	return std::move(stream);
@@ -660,6 +643,9 @@ void ElasticsearchWriter::ExceptionHandler(boost::exception_ptr exp)
 
 	Log(LogDebug, "ElasticsearchWriter")
 		<< "Exception during Elasticsearch operation: " << DiagnosticInformation(std::move(exp));
+
+	std::unique_lock<std::mutex> lock(m_DataBufferMutex);
+	m_Connection.Disconnect();
 }
 
 String ElasticsearchWriter::FormatTimestamp(double ts)
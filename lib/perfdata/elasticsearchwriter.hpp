@@ -4,6 +4,7 @@
 #define ELASTICSEARCHWRITER_H
 
 #include "perfdata/elasticsearchwriter-ti.hpp"
+#include "perfdata/httpwriterconnection.hpp"
 #include "icinga/service.hpp"
 #include "base/configobject.hpp"
 #include "base/workqueue.hpp"
@@ -34,6 +35,8 @@ private:
 	Timer::Ptr m_FlushTimer;
 	std::vector<String> m_DataBuffer;
 	std::mutex m_DataBufferMutex;
+	HttpWriterConnection m_Connection; /* only used with m_DataBufferMutex held */
+	Shared<boost::asio::ssl::context>::Ptr m_SslContext;
 
 	void AddCheckResult(const Dictionary::Ptr& fields, const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
 
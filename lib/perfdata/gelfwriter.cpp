@@ -14,6 +14,7 @@
 #include "base/utility.hpp"
 #include "base/perfdatavalue.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
 #include "base/stream.hpp"
 #include "base/networkstream.hpp"
 #include "base/context.hpp"
@@ -58,15 +59,27 @@ void GelfWriter::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perf
 		size_t workQueueItems = gelfwriter->m_WorkQueue.GetLength();
 		double workQueueItemRate = gelfwriter->m_WorkQueue.GetTaskCount(60) / 60.0;
 
-		nodes.emplace_back(gelfwriter->GetName(), new Dictionary({
+		Dictionary::Ptr node = new Dictionary({
 			{ "work_queue_items", workQueueItems },
 			{ "work_queue_item_rate", workQueueItemRate },
 			{ "connected", gelfwriter->GetConnected() },
 			{ "source", gelfwriter->GetSource() }
-		}));
+		});
+
+		nodes.emplace_back(gelfwriter->GetName(), node);
 
 		perfdata->Add(new PerfdataValue("gelfwriter_" + gelfwriter->GetName() + "_work_queue_items", workQueueItems));
 		perfdata->Add(new PerfdataValue("gelfwriter_" + gelfwriter->GetName() + "_work_queue_item_rate", workQueueItemRate));
+
+		PerfdataSpool::Ptr spool = gelfwriter->m_Spool;
+
+		if (spool) {
+			node->Set("spool_size", spool->GetSize());
+			node->Set("spool_dropped_bytes", spool->GetDroppedBytes());
+
+			perfdata->Add(new PerfdataValue("gelfwriter_" + gelfwriter->GetName() + "_spool_size", spool->GetSize()));
+			perfdata->Add(new PerfdataValue("gelfwriter_" + gelfwriter->GetName() + "_spool_dropped_bytes", spool->GetDroppedBytes(), true));
+		}
 	}
 
 	status->Set("gelfwriter", new Dictionary(std::move(nodes)));
@@ -89,6 +102,21 @@ void GelfWriter::Resume()
 	m_ReconnectTimer->Start();
 	m_ReconnectTimer->Reschedule(0);
 
+	if (GetEnableSpool()) {
+		if (!m_Spool) {
+			m_Spool = new PerfdataSpool(Configuration::SpoolDir + "/perfdata-spool/gelfwriter-" + GetName(),
+				static_cast<uint_fast64_t>(GetSpoolMaxSize()) * 1024 * 1024);
+		}
+
+		/* Timer for replaying spooled messages, spool_replay_rate KiB per run */
+		m_SpoolTimer = new Timer();
+		m_SpoolTimer->SetInterval(1);
+		m_SpoolTimer->OnTimerExpired.connect([this](const Timer * const&) {
+			m_WorkQueue.Enqueue([this]() { ReplaySpool(); });
+		});
+		m_SpoolTimer->Start();
+	}
+
 	/* Register event handlers. */
 	Checkable::OnNewCheckResult.connect([this](const Checkable::Ptr& checkable, const CheckResult::Ptr& cr, const MessageOrigin::Ptr&) {
 		CheckResultHandler(checkable, cr);
@@ -108,6 +136,7 @@ void GelfWriter::Resume()
 void GelfWriter::Pause()
 {
 	m_ReconnectTimer.reset();
+	m_SpoolTimer.reset();
 
 	try {
 		ReconnectInternal();
@@ -229,6 +258,38 @@ void GelfWriter::ReconnectTimerHandler()
 	m_WorkQueue.Enqueue([this]() { Reconnect(); }, PriorityNormal);
 }
 
+/* Sends the oldest spooled messages once the connection is back. Called inside the WQ. */
+void GelfWriter::ReplaySpool()
+{
+	AssertOnWorkQueue();
+
+	if (IsPaused())
+		return;
+
+	ObjectLock olock(this);
+
+	if (!GetConnected())
+		return;
+
+	String data = m_Spool->Peek(static_cast<size_t>(GetSpoolReplayRate()) * 1024);
+
+	if (data.IsEmpty())
+		return;
+
+	if (m_Stream.first) {
+		boost::asio::write(*m_Stream.first, boost::asio::buffer(data.GetData()));
+		m_Stream.first->flush();
+	} else {
+		boost::asio::write(*m_Stream.second, boost::asio::buffer(data.GetData()));
+		m_Stream.second->flush();
+	}
+
+	m_Spool->Consume();
+
+	Log(LogNotice, "GelfWriter")
+		<< "Replayed " << data.GetLength() << " bytes of spooled messages, " << m_Spool->GetSize() << " bytes left.";
+}
+
 void GelfWriter::Disconnect()
 {
 	AssertOnWorkQueue();
@@ -318,47 +379,35 @@ void GelfWriter::CheckResultHandlerInternal(const Checkable::Ptr& checkable, con
 	}
 
 	if (cr && GetEnableSendPerfdata()) {
-		Array::Ptr perfdata = cr->GetPerformanceData();
-
-		if (perfdata) {
-			ObjectLock olock(perfdata);
-			for (const Value& val : perfdata) {
-				PerfdataValue::Ptr pdv;
-
-				if (val.IsObjectType<PerfdataValue>())
-					pdv = val;
-				else {
-					try {
-						pdv = PerfdataValue::Parse(val);
-					} catch (const std::exception&) {
-						Log(LogWarning, "GelfWriter")
-							<< "Ignoring invalid perfdata for checkable '"
-							<< checkable->GetName() << "' and command '"
-							<< checkCommand->GetName() << "' with value: " << val;
-						continue;
-					}
-				}
-
-				String escaped_key = pdv->GetLabel();
-				boost::replace_all(escaped_key, " ", "_");
-				boost::replace_all(escaped_key, ".", "_");
-				boost::replace_all(escaped_key, "\\", "_");
-				boost::algorithm::replace_all(escaped_key, "::", ".");
-
-				fields->Set("_" + escaped_key, pdv->GetValue());
-
-				if (!pdv->GetMin().IsEmpty())
-					fields->Set("_" + escaped_key + "_min", pdv->GetMin());
-				if (!pdv->GetMax().IsEmpty())
-					fields->Set("_" + escaped_key + "_max", pdv->GetMax());
-				if (!pdv->GetWarn().IsEmpty())
-					fields->Set("_" + escaped_key + "_warn", pdv->GetWarn());
-				if (!pdv->GetCrit().IsEmpty())
-					fields->Set("_" + escaped_key + "_crit", pdv->GetCrit());
-
-				if (!pdv->GetUnit().IsEmpty())
-					fields->Set("_" + escaped_key + "_unit", pdv->GetUnit());
-			}
+		auto perfdata (cr->GetParsedPerfdata());
+
+		for (const Value& val : perfdata->Invalid) {
+			Log(LogWarning, "GelfWriter")
+				<< "Ignoring invalid perfdata for checkable '"
+				<< checkable->GetName() << "' and command '"
+				<< checkCommand->GetName() << "' with value: " << val;
+		}
+
+		for (size_t i = 0; i < perfdata->GetLength(); i++) {
+			String escaped_key = perfdata->Labels[i];
+			boost::replace_all(escaped_key, " ", "_");
+			boost::replace_all(escaped_key, ".", "_");
+			boost::replace_all(escaped_key, "\\", "_");
+			boost::algorithm::replace_all(escaped_key, "::", ".");
+
+			fields->Set("_" + escaped_key, perfdata->Values[i]);
+
+			if (!perfdata->Min[i].IsEmpty())
+				fields->Set("_" + escaped_key + "_min", perfdata->Min[i]);
+			if (!perfdata->Max[i].IsEmpty())
+				fields->Set("_" + escaped_key + "_max", perfdata->Max[i]);
+			if (!perfdata->Warn[i].IsEmpty())
+				fields->Set("_" + escaped_key + "_warn", perfdata->Warn[i]);
+			if (!perfdata->Crit[i].IsEmpty())
+				fields->Set("_" + escaped_key + "_crit", perfdata->Crit[i]);
+
+			if (!perfdata->Units[i].IsEmpty())
+				fields->Set("_" + escaped_key + "_unit", perfdata->Units[i]);
 		}
 	}
 
@@ -510,8 +559,12 @@ void GelfWriter::SendLogMessage(const Checkable::Ptr& checkable, const String& g
 
 	ObjectLock olock(this);
 
-	if (!GetConnected())
+	if (!GetConnected()) {
+		if (m_Spool)
+			m_Spool->Append(log);
+
 		return;
+	}
 
 	try {
 		Log(LogDebug, "GelfWriter")
@@ -528,6 +581,25 @@ void GelfWriter::SendLogMessage(const Checkable::Ptr& checkable, const String& g
 		Log(LogCritical, "GelfWriter")
 			<< "Cannot write to TCP socket on host '" << GetHost() << "' port '" << GetPort() << "'.";
 
+		if (m_Spool)
+			m_Spool->Append(log);
+
 		throw ex;
 	}
 }
+
+void GelfWriter::ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<GelfWriter>::ValidateSpoolMaxSize(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_max_size" }, "Value must be greater than 0."));
+}
+
+void GelfWriter::ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<GelfWriter>::ValidateSpoolReplayRate(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_replay_rate" }, "Value must be greater than 0."));
+}
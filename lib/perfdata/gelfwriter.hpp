@@ -4,6 +4,7 @@
 #define GELFWRITER_H
 
 #include "perfdata/gelfwriter-ti.hpp"
+#include "perfdata/perfdataspool.hpp"
 #include "icinga/service.hpp"
 #include "base/configobject.hpp"
 #include "base/tcpsocket.hpp"
@@ -27,6 +28,9 @@ public:
 
 	static void StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata);
 
+	void ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+
 protected:
 	void OnConfigLoaded() override;
 	void Resume() override;
@@ -38,6 +42,9 @@ private:
 
 	Timer::Ptr m_ReconnectTimer;
 
+	PerfdataSpool::Ptr m_Spool;
+	Timer::Ptr m_SpoolTimer;
+
 	void CheckResultHandler(const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
 	void CheckResultHandlerInternal(const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
 	void NotificationToUserHandler(const Notification::Ptr& notification, const Checkable::Ptr& checkable,
@@ -53,6 +60,7 @@ private:
 	void SendLogMessage(const Checkable::Ptr& checkable, const String& gelfMessage);
 
 	void ReconnectTimerHandler();
+	void ReplaySpool();
 
 	void Disconnect();
 	void DisconnectInternal();
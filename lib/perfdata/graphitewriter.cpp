@@ -14,6 +14,7 @@
 #include "base/utility.hpp"
 #include "base/perfdatavalue.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
 #include "base/stream.hpp"
 #include "base/networkstream.hpp"
 #include "base/exception.hpp"
@@ -61,14 +62,26 @@ void GraphiteWriter::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr&
 		size_t workQueueItems = graphitewriter->m_WorkQueue.GetLength();
 		double workQueueItemRate = graphitewriter->m_WorkQueue.GetTaskCount(60) / 60.0;
 
-		nodes.emplace_back(graphitewriter->GetName(), new Dictionary({
+		Dictionary::Ptr node = new Dictionary({
 			{ "work_queue_items", workQueueItems },
 			{ "work_queue_item_rate", workQueueItemRate },
 			{ "connected", graphitewriter->GetConnected() }
-		}));
+		});
+
+		nodes.emplace_back(graphitewriter->GetName(), node);
 
 		perfdata->Add(new PerfdataValue("graphitewriter_" + graphitewriter->GetName() + "_work_queue_items", workQueueItems));
 		perfdata->Add(new PerfdataValue("graphitewriter_" + graphitewriter->GetName() + "_work_queue_item_rate", workQueueItemRate));
+
+		PerfdataSpool::Ptr spool = graphitewriter->m_Spool;
+
+		if (spool) {
+			node->Set("spool_size", spool->GetSize());
+			node->Set("spool_dropped_bytes", spool->GetDroppedBytes());
+
+			perfdata->Add(new PerfdataValue("graphitewriter_" + graphitewriter->GetName() + "_spool_size", spool->GetSize()));
+			perfdata->Add(new PerfdataValue("graphitewriter_" + graphitewriter->GetName() + "_spool_dropped_bytes", spool->GetDroppedBytes(), true));
+		}
 	}
 
 	status->Set("graphitewriter", new Dictionary(std::move(nodes)));
@@ -94,6 +107,21 @@ void GraphiteWriter::Resume()
 	m_ReconnectTimer->Start();
 	m_ReconnectTimer->Reschedule(0);
 
+	if (GetEnableSpool()) {
+		if (!m_Spool) {
+			m_Spool = new PerfdataSpool(Configuration::SpoolDir + "/perfdata-spool/graphitewriter-" + GetName(),
+				static_cast<uint_fast64_t>(GetSpoolMaxSize()) * 1024 * 1024);
+		}
+
+		/* Timer for replaying spooled metrics, spool_replay_rate KiB per run */
+		m_SpoolTimer = new Timer();
+		m_SpoolTimer->SetInterval(1);
+		m_SpoolTimer->OnTimerExpired.connect([this](const Timer * const&) {
+			m_WorkQueue.Enqueue([this]() { ReplaySpool(); });
+		});
+		m_SpoolTimer->Start();
+	}
+
 	/* Register event handlers. */
 	Checkable::OnNewCheckResult.connect([this](const Checkable::Ptr& checkable, const CheckResult::Ptr& cr, const MessageOrigin::Ptr&) {
 		CheckResultHandler(checkable, cr);
@@ -106,6 +134,7 @@ void GraphiteWriter::Resume()
 void GraphiteWriter::Pause()
 {
 	m_ReconnectTimer.reset();
+	m_SpoolTimer.reset();
 
 	try {
 		ReconnectInternal();
@@ -221,6 +250,36 @@ void GraphiteWriter::ReconnectTimerHandler()
 	m_WorkQueue.Enqueue([this]() { Reconnect(); }, PriorityHigh);
 }
 
+/**
+ * Sends the oldest spooled metrics once the connection is back.
+ *
+ * Called inside the WQ.
+ */
+void GraphiteWriter::ReplaySpool()
+{
+	namespace asio = boost::asio;
+
+	AssertOnWorkQueue();
+
+	if (IsPaused() || !GetConnected())
+		return;
+
+	std::unique_lock<std::mutex> lock(m_StreamMutex);
+
+	String data = m_Spool->Peek(static_cast<size_t>(GetSpoolReplayRate()) * 1024);
+
+	if (data.IsEmpty())
+		return;
+
+	asio::write(*m_Stream, asio::buffer(data.GetData()));
+	m_Stream->flush();
+
+	m_Spool->Consume();
+
+	Log(LogNotice, "GraphiteWriter")
+		<< "Replayed " << data.GetLength() << " bytes of spooled metrics, " << m_Spool->GetSize() << " bytes left.";
+}
+
 /**
  * Disconnect the stream.
  *
@@ -340,44 +399,31 @@ void GraphiteWriter::CheckResultHandlerInternal(const Checkable::Ptr& checkable,
  */
 void GraphiteWriter::SendPerfdata(const Checkable::Ptr& checkable, const String& prefix, const CheckResult::Ptr& cr, double ts)
 {
-	Array::Ptr perfdata = cr->GetPerformanceData();
-
-	if (!perfdata)
-		return;
+	auto perfdata (cr->GetParsedPerfdata());
 
 	CheckCommand::Ptr checkCommand = checkable->GetCheckCommand();
 
-	ObjectLock olock(perfdata);
-	for (const Value& val : perfdata) {
-		PerfdataValue::Ptr pdv;
-
-		if (val.IsObjectType<PerfdataValue>())
-			pdv = val;
-		else {
-			try {
-				pdv = PerfdataValue::Parse(val);
-			} catch (const std::exception&) {
-				Log(LogWarning, "GraphiteWriter")
-					<< "Ignoring invalid perfdata for checkable '"
-					<< checkable->GetName() << "' and command '"
-					<< checkCommand->GetName() << "' with value: " << val;
-				continue;
-			}
-		}
+	for (const Value& val : perfdata->Invalid) {
+		Log(LogWarning, "GraphiteWriter")
+			<< "Ignoring invalid perfdata for checkable '"
+			<< checkable->GetName() << "' and command '"
+			<< checkCommand->GetName() << "' with value: " << val;
+	}
 
-		String escapedKey = EscapeMetricLabel(pdv->GetLabel());
+	for (size_t i = 0; i < perfdata->GetLength(); i++) {
+		String escapedKey = EscapeMetricLabel(perfdata->Labels[i]);
 
-		SendMetric(checkable, prefix, escapedKey + ".value", pdv->GetValue(), ts);
+		SendMetric(checkable, prefix, escapedKey + ".value", perfdata->Values[i], ts);
 
 		if (GetEnableSendThresholds()) {
-			if (!pdv->GetCrit().IsEmpty())
-				SendMetric(checkable, prefix, escapedKey + ".crit", pdv->GetCrit(), ts);
-			if (!pdv->GetWarn().IsEmpty())
-				SendMetric(checkable, prefix, escapedKey + ".warn", pdv->GetWarn(), ts);
-			if (!pdv->GetMin().IsEmpty())
-				SendMetric(checkable, prefix, escapedKey + ".min", pdv->GetMin(), ts);
-			if (!pdv->GetMax().IsEmpty())
-				SendMetric(checkable, prefix, escapedKey + ".max", pdv->GetMax(), ts);
+			if (!perfdata->Crit[i].IsEmpty())
+				SendMetric(checkable, prefix, escapedKey + ".crit", perfdata->Crit[i], ts);
+			if (!perfdata->Warn[i].IsEmpty())
+				SendMetric(checkable, prefix, escapedKey + ".warn", perfdata->Warn[i], ts);
+			if (!perfdata->Min[i].IsEmpty())
+				SendMetric(checkable, prefix, escapedKey + ".min", perfdata->Min[i], ts);
+			if (!perfdata->Max[i].IsEmpty())
+				SendMetric(checkable, prefix, escapedKey + ".max", perfdata->Max[i], ts);
 		}
 	}
 }
@@ -406,8 +452,12 @@ void GraphiteWriter::SendMetric(const Checkable::Ptr& checkable, const String& p
 
 	std::unique_lock<std::mutex> lock(m_StreamMutex);
 
-	if (!GetConnected())
+	if (!GetConnected()) {
+		if (m_Spool)
+			m_Spool->Append(msgbuf.str());
+
 		return;
+	}
 
 	try {
 		asio::write(*m_Stream, asio::buffer(msgbuf.str()));
@@ -416,6 +466,9 @@ void GraphiteWriter::SendMetric(const Checkable::Ptr& checkable, const String& p
 		Log(LogCritical, "GraphiteWriter")
 			<< "Cannot write to TCP socket on host '" << GetHost() << "' port '" << GetPort() << "'.";
 
+		if (m_Spool)
+			m_Spool->Append(msgbuf.str());
+
 		throw ex;
 	}
 }
@@ -511,3 +564,19 @@ void GraphiteWriter::ValidateServiceNameTemplate(const Lazy<String>& lvalue, con
 	if (!MacroProcessor::ValidateMacroString(lvalue()))
 		BOOST_THROW_EXCEPTION(ValidationError(this, { "service_name_template" }, "Closing $ not found in macro format string '" + lvalue() + "'."));
 }
+
+void GraphiteWriter::ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<GraphiteWriter>::ValidateSpoolMaxSize(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_max_size" }, "Value must be greater than 0."));
+}
+
+void GraphiteWriter::ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<GraphiteWriter>::ValidateSpoolReplayRate(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_replay_rate" }, "Value must be greater than 0."));
+}
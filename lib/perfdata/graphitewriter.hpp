@@ -4,6 +4,7 @@
 #define GRAPHITEWRITER_H
 
 #include "perfdata/graphitewriter-ti.hpp"
+#include "perfdata/perfdataspool.hpp"
 #include "icinga/service.hpp"
 #include "base/configobject.hpp"
 #include "base/tcpsocket.hpp"
@@ -30,6 +31,8 @@ public:
 
 	void ValidateHostNameTemplate(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
 	void ValidateServiceNameTemplate(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
 
 protected:
 	void OnConfigLoaded() override;
@@ -43,6 +46,9 @@ private:
 
 	Timer::Ptr m_ReconnectTimer;
 
+	PerfdataSpool::Ptr m_Spool;
+	Timer::Ptr m_SpoolTimer;
+
 	void CheckResultHandler(const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
 	void CheckResultHandlerInternal(const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
 	void SendMetric(const Checkable::Ptr& checkable, const String& prefix, const String& name, double value, double ts);
@@ -52,6 +58,7 @@ private:
 	static Value EscapeMacroMetric(const Value& value);
 
 	void ReconnectTimerHandler();
+	void ReplaySpool();
 
 	void Disconnect();
 	void DisconnectInternal();
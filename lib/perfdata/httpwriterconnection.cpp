@@ -0,0 +1,189 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "perfdata/httpwriterconnection.hpp"
+#include "base/convert.hpp"
+#include "base/perfdatavalue.hpp"
+#include "base/utility.hpp"
+#include <boost/asio/error.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/write.hpp>
+#include <boost/system/system_error.hpp>
+
+using namespace icinga;
+
+/* Upper bounds of the latency buckets in seconds, the last one takes everything else. */
+static const double l_LatencyBounds[HttpWriterConnection::LatencyBuckets - 1] = {
+	0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5
+};
+
+/**
+ * Whether the error is what writing to or reading from a connection gives
+ * after the server closed it. On its own this doesn't tell whether the
+ * server has seen the request, Send() checks how far the exchange got.
+ */
+static bool IsStaleConnectionError(const boost::system::system_error& ex)
+{
+	auto& code (ex.code());
+
+	return code == boost::asio::error::eof || code == boost::asio::error::connection_reset
+		|| code == boost::asio::error::broken_pipe || code == boost::beast::http::error::end_of_stream;
+}
+
+/**
+ * Sends the request and reads the response, connecting first if there is
+ * no open connection. A request on a reused connection which the server
+ * has closed in the meantime is retried on a new one, but only if sending
+ * it failed or the connection was closed before any byte of the response.
+ *
+ * @param connect Opens a new connection
+ * @param request The request
+ * @return The response
+ */
+HttpWriterConnection::Response HttpWriterConnection::Send(const ConnectFunction& connect, Request& request)
+{
+	namespace beast = boost::beast;
+	namespace http = beast::http;
+
+	request.keep_alive(true);
+
+	for (;;) {
+		bool reused = m_Stream.first || m_Stream.second;
+
+		if (!reused) {
+			m_Stream = connect();
+			m_Connects.fetch_add(1);
+		}
+
+		double start = Utility::GetTime();
+
+		http::parser<false, http::string_body> parser;
+		beast::flat_buffer buf;
+		bool written = false;
+
+		try {
+			if (m_Stream.first) {
+				http::write(*m_Stream.first, request);
+				m_Stream.first->flush();
+				written = true;
+				http::read(*m_Stream.first, buf, parser);
+			} else {
+				http::write(*m_Stream.second, request);
+				m_Stream.second->flush();
+				written = true;
+				http::read(*m_Stream.second, buf, parser);
+			}
+		} catch (const boost::system::system_error& ex) {
+			Disconnect();
+
+			/* Once the server has started to respond, it has processed the request. */
+			if (reused && IsStaleConnectionError(ex) && (!written || (buf.size() == 0 && !parser.got_some())))
+				continue;
+
+			throw;
+		} catch (const std::exception&) {
+			Disconnect();
+			throw;
+		}
+
+		m_Requests.fetch_add(1);
+		RecordLatency(Utility::GetTime() - start);
+
+		Response response (parser.release());
+
+		if (!response.keep_alive())
+			Disconnect();
+
+		return response;
+	}
+}
+
+void HttpWriterConnection::Disconnect()
+{
+	if (m_Stream.first) {
+		try {
+			m_Stream.first->next_layer().shutdown();
+		} catch (const std::exception&) {
+			/* The peer might be gone already. */
+		}
+	} else if (m_Stream.second) {
+		boost::system::error_code ec;
+		m_Stream.second->lowest_layer().close(ec);
+	}
+
+	m_Stream = OptionalTlsStream();
+}
+
+/**
+ * Offers the session of the previous connection to the server. Must be
+ * called before the handshake.
+ */
+void HttpWriterConnection::ResumeTlsSession(UnbufferedAsioTlsStream& stream)
+{
+	if (m_TlsSession)
+		SSL_set_session(stream.native_handle(), m_TlsSession.get());
+}
+
+/**
+ * Remembers the session of a new connection for the next one.
+ */
+void HttpWriterConnection::SaveTlsSession(UnbufferedAsioTlsStream& stream)
+{
+	SSL_SESSION *session = SSL_get1_session(stream.native_handle());
+
+	if (session)
+		m_TlsSession = std::shared_ptr<SSL_SESSION>(session, SSL_SESSION_free);
+}
+
+void HttpWriterConnection::RecordLatency(double latency)
+{
+	size_t bucket = 0;
+
+	while (bucket < LatencyBuckets - 1 && latency > l_LatencyBounds[bucket])
+		bucket++;
+
+	m_Latencies[bucket].fetch_add(1);
+}
+
+uint_fast64_t HttpWriterConnection::GetConnectCount() const
+{
+	return m_Connects.load();
+}
+
+uint_fast64_t HttpWriterConnection::GetRequestCount() const
+{
+	return m_Requests.load();
+}
+
+/**
+ * Returns the number of requests whose latency was at most the key in
+ * seconds, like Prometheus' cumulative "le" buckets.
+ */
+Dictionary::Ptr HttpWriterConnection::GetLatencyHistogram() const
+{
+	DictionaryData buckets;
+	uint_fast64_t count = 0;
+
+	for (size_t i = 0; i < LatencyBuckets; i++) {
+		count += m_Latencies[i].load();
+		buckets.emplace_back(i < LatencyBuckets - 1 ? Convert::ToString(l_LatencyBounds[i]) : String("+Inf"), count);
+	}
+
+	return new Dictionary(std::move(buckets));
+}
+
+void HttpWriterConnection::AddPerfdata(const String& prefix, const Array::Ptr& perfdata) const
+{
+	perfdata->Add(new PerfdataValue(prefix + "_connects", GetConnectCount(), true));
+	perfdata->Add(new PerfdataValue(prefix + "_requests", GetRequestCount(), true));
+
+	uint_fast64_t count = 0;
+
+	for (size_t i = 0; i < LatencyBuckets; i++) {
+		count += m_Latencies[i].load();
+		perfdata->Add(new PerfdataValue(prefix + "_request_latency_le_"
+			+ (i < LatencyBuckets - 1 ? Convert::ToString(l_LatencyBounds[i]) : String("inf")), count, true));
+	}
+}
@@ -0,0 +1,62 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef HTTPWRITERCONNECTION_H
+#define HTTPWRITERCONNECTION_H
+
+#include "base/array.hpp"
+#include "base/dictionary.hpp"
+#include "base/tlsstream.hpp"
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <openssl/ssl.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace icinga
+{
+
+/**
+ * A persistent HTTP/1.1 connection to a metric backend.
+ *
+ * The connection is kept open as long as the server allows it and is
+ * re-established on demand, resuming the previous TLS session if possible.
+ * Must only be used from a single thread, except for the statistics.
+ *
+ * @ingroup perfdata
+ */
+class HttpWriterConnection
+{
+public:
+	typedef boost::beast::http::request<boost::beast::http::string_body> Request;
+	typedef boost::beast::http::response<boost::beast::http::string_body> Response;
+	typedef std::function<OptionalTlsStream ()> ConnectFunction;
+
+	static constexpr size_t LatencyBuckets = 10;
+
+	Response Send(const ConnectFunction& connect, Request& request);
+	void Disconnect();
+
+	void ResumeTlsSession(UnbufferedAsioTlsStream& stream);
+	void SaveTlsSession(UnbufferedAsioTlsStream& stream);
+
+	uint_fast64_t GetConnectCount() const;
+	uint_fast64_t GetRequestCount() const;
+	Dictionary::Ptr GetLatencyHistogram() const;
+	void AddPerfdata(const String& prefix, const Array::Ptr& perfdata) const;
+
+private:
+	OptionalTlsStream m_Stream;
+	std::shared_ptr<SSL_SESSION> m_TlsSession;
+
+	std::atomic<uint_fast64_t> m_Connects{0};
+	std::atomic<uint_fast64_t> m_Requests{0};
+	std::atomic<uint_fast64_t> m_Latencies[LatencyBuckets] {};
+
+	void RecordLatency(double latency);
+};
+
+}
+
+#endif /* HTTPWRITERCONNECTION_H */
@@ -8,6 +8,7 @@
 #include "icinga/icingaapplication.hpp"
 #include "icinga/checkcommand.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
 #include "base/defer.hpp"
 #include "base/io-engine.hpp"
 #include "base/tcpsocket.hpp"
@@ -96,6 +97,22 @@ void InfluxdbCommonWriter::Resume()
 	m_FlushTimer->Start();
 	m_FlushTimer->Reschedule(0);
 
+	if (GetEnableSpool()) {
+		if (!m_Spool) {
+			m_Spool = new PerfdataSpool(Configuration::SpoolDir + "/perfdata-spool/"
+				+ GetReflectionType()->GetName().ToLower() + "-" + GetName(),
+				static_cast<uint_fast64_t>(GetSpoolMaxSize()) * 1024 * 1024);
+		}
+
+		/* Setup timer for replaying spooled data points, spool_replay_rate KiB per run */
+		m_SpoolTimer = new Timer();
+		m_SpoolTimer->SetInterval(1);
+		m_SpoolTimer->OnTimerExpired.connect([this](const Timer * const&) {
+			m_WorkQueue.Enqueue([this]() { ReplaySpool(); });
+		});
+		m_SpoolTimer->Start();
+	}
+
 	/* Register for new metrics. */
 	Checkable::OnNewCheckResult.connect([this](const Checkable::Ptr& checkable, const CheckResult::Ptr& cr, const MessageOrigin::Ptr&) {
 		CheckResultHandler(checkable, cr);
@@ -105,11 +122,16 @@ void InfluxdbCommonWriter::Resume()
 /* Pause is equivalent to Stop, but with HA capabilities to resume at runtime. */
 void InfluxdbCommonWriter::Pause()
 {
+	m_SpoolTimer.reset();
+
 	/* Force a flush. */
 	Log(LogDebug, GetReflectionType()->GetName())
 		<< "Processing pending tasks and flushing data buffers.";
 
-	m_WorkQueue.Enqueue([this]() { FlushWQ(); }, PriorityLow);
+	m_WorkQueue.Enqueue([this]() {
+		FlushWQ();
+		m_Connection.Disconnect();
+	}, PriorityLow);
 
 	/* Wait for the flush to complete, implicitly waits for all WQ tasks enqueued prior to pausing. */
 	m_WorkQueue.Join();
@@ -132,7 +154,7 @@ void InfluxdbCommonWriter::ExceptionHandler(boost::exception_ptr exp)
 	Log(LogDebug, GetReflectionType()->GetName())
 		<< "Exception during InfluxDB operation: " << DiagnosticInformation(std::move(exp));
 
-	//TODO: Close the connection, if we keep it open.
+	m_Connection.Disconnect();
 }
 
 OptionalTlsStream InfluxdbCommonWriter::Connect()
@@ -144,17 +166,17 @@ OptionalTlsStream InfluxdbCommonWriter::Connect()
 	bool ssl = GetSslEnable();
 
 	if (ssl) {
-		Shared<boost::asio::ssl::context>::Ptr sslContext;
-
-		try {
-			sslContext = MakeAsioSslContext(GetSslCert(), GetSslKey(), GetSslCaCert());
-		} catch (const std::exception& ex) {
-			Log(LogWarning, GetReflectionType()->GetName())
-				<< "Unable to create SSL context.";
-			throw;
+		if (!m_SslContext) {
+			try {
+				m_SslContext = MakeAsioSslContext(GetSslCert(), GetSslKey(), GetSslCaCert());
+			} catch (const std::exception& ex) {
+				Log(LogWarning, GetReflectionType()->GetName())
+					<< "Unable to create SSL context.";
+				throw;
+			}
 		}
 
-		stream.first = Shared<AsioTlsStream>::Make(IoEngine::Get().GetIoContext(), *sslContext, GetHost());
+		stream.first = Shared<AsioTlsStream>::Make(IoEngine::Get().GetIoContext(), *m_SslContext, GetHost());
 
 	} else {
 		stream.second = Shared<AsioTcpStream>::Make(IoEngine::Get().GetIoContext());
@@ -171,6 +193,8 @@ OptionalTlsStream InfluxdbCommonWriter::Connect()
 	if (ssl) {
 		auto& tlsStream (stream.first->next_layer());
 
+		m_Connection.ResumeTlsSession(tlsStream);
+
 		try {
 			tlsStream.handshake(tlsStream.client);
 		} catch (const std::exception& ex) {
@@ -190,6 +214,8 @@ OptionalTlsStream InfluxdbCommonWriter::Connect()
 				));
 			}
 		}
+
+		m_Connection.SaveTlsSession(tlsStream);
 	}
 
 	return std::move(stream);
@@ -222,76 +248,61 @@ void InfluxdbCommonWriter::CheckResultHandlerWQ(const Checkable::Ptr& checkable,
 	resolvers.emplace_back("host", host);
 	resolvers.emplace_back("icinga", IcingaApplication::GetInstance());
 
-	String prefix;
-
 	double ts = cr->GetExecutionEnd();
 
-	// Clone the template and perform an in-place macro expansion of measurement and tag values
-	Dictionary::Ptr tmpl_clean = service ? GetServiceTemplate() : GetHostTemplate();
-	Dictionary::Ptr tmpl = static_pointer_cast<Dictionary>(tmpl_clean->ShallowClone());
-	tmpl->Set("measurement", MacroProcessor::ResolveMacros(tmpl->Get("measurement"), resolvers, cr));
+	/* Expand the measurement and tag macros and escape them once, all data points of this check result share them. */
+	Dictionary::Ptr tmpl = service ? GetServiceTemplate() : GetHostTemplate();
+	std::string prefix;
 
-	Dictionary::Ptr tagsClean = tmpl->Get("tags");
-	if (tagsClean) {
-		Dictionary::Ptr tags = new Dictionary();
+	AppendKeyOrTagValue(prefix, MacroProcessor::ResolveMacros(tmpl->Get("measurement"), resolvers, cr));
 
-		{
-			ObjectLock olock(tagsClean);
-			for (const Dictionary::Pair& pair : tagsClean) {
-				String missing_macro;
-				Value value = MacroProcessor::ResolveMacros(pair.second, resolvers, cr, &missing_macro);
+	Dictionary::Ptr tags = tmpl->Get("tags");
+	if (tags) {
+		ObjectLock olock(tags);
+		for (const Dictionary::Pair& pair : tags) {
+			String missing_macro;
+			Value value = MacroProcessor::ResolveMacros(pair.second, resolvers, cr, &missing_macro);
 
-				if (missing_macro.IsEmpty()) {
-					tags->Set(pair.first, value);
-				}
+			// Empty macro expansion, no tag
+			if (missing_macro.IsEmpty() && !value.IsEmpty()) {
+				prefix += ',';
+				AppendKeyOrTagValue(prefix, pair.first);
+				prefix += '=';
+				AppendKeyOrTagValue(prefix, value);
 			}
 		}
-
-		tmpl->Set("tags", tags);
 	}
 
 	CheckCommand::Ptr checkCommand = checkable->GetCheckCommand();
 
-	Array::Ptr perfdata = cr->GetPerformanceData();
-
-	if (perfdata) {
-		ObjectLock olock(perfdata);
-		for (const Value& val : perfdata) {
-			PerfdataValue::Ptr pdv;
-
-			if (val.IsObjectType<PerfdataValue>())
-				pdv = val;
-			else {
-				try {
-					pdv = PerfdataValue::Parse(val);
-				} catch (const std::exception&) {
-					Log(LogWarning, GetReflectionType()->GetName())
-						<< "Ignoring invalid perfdata for checkable '"
-						<< checkable->GetName() << "' and command '"
-						<< checkCommand->GetName() << "' with value: " << val;
-					continue;
-				}
-			}
+	auto perfdata (cr->GetParsedPerfdata());
 
-			Dictionary::Ptr fields = new Dictionary();
-			fields->Set("value", pdv->GetValue());
-
-			if (GetEnableSendThresholds()) {
-				if (!pdv->GetCrit().IsEmpty())
-					fields->Set("crit", pdv->GetCrit());
-				if (!pdv->GetWarn().IsEmpty())
-					fields->Set("warn", pdv->GetWarn());
-				if (!pdv->GetMin().IsEmpty())
-					fields->Set("min", pdv->GetMin());
-				if (!pdv->GetMax().IsEmpty())
-					fields->Set("max", pdv->GetMax());
-			}
-			if (!pdv->GetUnit().IsEmpty()) {
-				fields->Set("unit", pdv->GetUnit());
-			}
+	for (const Value& val : perfdata->Invalid) {
+		Log(LogWarning, GetReflectionType()->GetName())
+			<< "Ignoring invalid perfdata for checkable '"
+			<< checkable->GetName() << "' and command '"
+			<< checkCommand->GetName() << "' with value: " << val;
+	}
 
-			SendMetric(checkable, tmpl, pdv->GetLabel(), fields, ts);
+	for (size_t i = 0; i < perfdata->GetLength(); i++) {
+		Dictionary::Ptr fields = new Dictionary();
+		fields->Set("value", perfdata->Values[i]);
+
+		if (GetEnableSendThresholds()) {
+			if (!perfdata->Crit[i].IsEmpty())
+				fields->Set("crit", perfdata->Crit[i]);
+			if (!perfdata->Warn[i].IsEmpty())
+				fields->Set("warn", perfdata->Warn[i]);
+			if (!perfdata->Min[i].IsEmpty())
+				fields->Set("min", perfdata->Min[i]);
+			if (!perfdata->Max[i].IsEmpty())
+				fields->Set("max", perfdata->Max[i]);
+		}
+		if (!perfdata->Units[i].IsEmpty()) {
+			fields->Set("unit", perfdata->Units[i]);
 		}
+
+		SendMetric(checkable, prefix, perfdata->Labels[i], fields, ts);
 	}
 
 	if (GetEnableSendMetadata()) {
@@ -315,18 +326,33 @@ void InfluxdbCommonWriter::CheckResultHandlerWQ(const Checkable::Ptr& checkable,
 		fields->Set("latency", cr->CalculateLatency());
 		fields->Set("execution_time", cr->CalculateExecutionTime());
 
-		SendMetric(checkable, tmpl, Empty, fields, ts);
+		SendMetric(checkable, prefix, Empty, fields, ts);
 	}
 }
 
-String InfluxdbCommonWriter::EscapeKeyOrTagValue(const String& str)
+/**
+ * Appends a measurement, tag key, tag value or field key in line protocol.
+ *
+ * @param buffer Line protocol buffer
+ * @param str Unescaped string
+ */
+void InfluxdbCommonWriter::AppendKeyOrTagValue(std::string& buffer, const String& str)
 {
-	// Iterate over the key name and escape commas and spaces with a backslash
-	String result = str;
-	boost::algorithm::replace_all(result, "\"", "\\\"");
-	boost::algorithm::replace_all(result, "=", "\\=");
-	boost::algorithm::replace_all(result, ",", "\\,");
-	boost::algorithm::replace_all(result, " ", "\\ ");
+	// Escape quotes, equal signs, commas and spaces with a backslash
+	size_t start = buffer.size();
+
+	for (char ch : str) {
+		switch (ch) {
+			case '"':
+			case '=':
+			case ',':
+			case ' ':
+				buffer += '\\';
+				break;
+		}
+
+		buffer += ch;
+	}
 
 	// InfluxDB 'feature': although backslashes are allowed in keys they also act
 	// as escape sequences when followed by ',' or ' '.  When your tag is like
@@ -334,52 +360,53 @@ String InfluxdbCommonWriter::EscapeKeyOrTagValue(const String& str)
 	// and through experimentation they also escape '='.  To be safe we replace
 	// trailing backslashes with and underscore.
 	// See https://github.com/influxdata/influxdb/issues/8587 for more info
-	size_t length = result.GetLength();
-	if (result[length - 1] == '\\')
-		result[length - 1] = '_';
-
-	return result;
+	if (buffer.size() > start && buffer.back() == '\\')
+		buffer.back() = '_';
 }
 
-String InfluxdbCommonWriter::EscapeValue(const Value& value)
+/**
+ * Appends a field value in line protocol.
+ *
+ * @param buffer Line protocol buffer
+ * @param value Field value
+ */
+void InfluxdbCommonWriter::AppendValue(std::string& buffer, const Value& value)
 {
 	if (value.IsObjectType<InfluxdbInteger>()) {
-		std::ostringstream os;
-		os << static_cast<InfluxdbInteger::Ptr>(value)->GetValue() << "i";
-		return os.str();
+		buffer += std::to_string(static_cast<InfluxdbInteger::Ptr>(value)->GetValue());
+		buffer += 'i';
+	} else if (value.IsBoolean()) {
+		buffer += value ? "true" : "false";
+	} else if (value.IsString()) {
+		buffer += '"';
+		AppendKeyOrTagValue(buffer, value);
+		buffer += '"';
+	} else {
+		buffer += Convert::ToString(value).GetData();
 	}
-
-	if (value.IsBoolean())
-		return value ? "true" : "false";
-
-	if (value.IsString())
-		return "\"" + EscapeKeyOrTagValue(value) + "\"";
-
-	return value;
 }
 
-void InfluxdbCommonWriter::SendMetric(const Checkable::Ptr& checkable, const Dictionary::Ptr& tmpl,
-	const String& label, const Dictionary::Ptr& fields, double ts)
+/**
+ * Appends a newline terminated data point in line protocol.
+ *
+ * @param buffer Line protocol buffer
+ * @param prefix Escaped measurement and tags
+ * @param label Perfdata label, empty for metadata
+ * @param fields Field keys and values
+ * @param ts Timestamp in seconds
+ */
+void InfluxdbCommonWriter::AppendDataPoint(std::string& buffer, const std::string& prefix, const String& label,
+	const Dictionary::Ptr& fields, double ts)
 {
-	std::ostringstream msgbuf;
-	msgbuf << EscapeKeyOrTagValue(tmpl->Get("measurement"));
-
-	Dictionary::Ptr tags = tmpl->Get("tags");
-	if (tags) {
-		ObjectLock olock(tags);
-		for (const Dictionary::Pair& pair : tags) {
-			// Empty macro expansion, no tag
-			if (!pair.second.IsEmpty()) {
-				msgbuf << "," << EscapeKeyOrTagValue(pair.first) << "=" << EscapeKeyOrTagValue(pair.second);
-			}
-		}
-	}
+	buffer += prefix;
 
 	// Label may be empty in the case of metadata
-	if (!label.IsEmpty())
-		msgbuf << ",metric=" << EscapeKeyOrTagValue(label);
+	if (!label.IsEmpty()) {
+		buffer += ",metric=";
+		AppendKeyOrTagValue(buffer, label);
+	}
 
-	msgbuf << " ";
+	buffer += ' ';
 
 	{
 		bool first = true;
@@ -389,25 +416,41 @@ void InfluxdbCommonWriter::SendMetric(const Checkable::Ptr& checkable, const Dic
 			if (first)
 				first = false;
 			else
-				msgbuf << ",";
+				buffer += ',';
 
-			msgbuf << EscapeKeyOrTagValue(pair.first) << "=" << EscapeValue(pair.second);
+			AppendKeyOrTagValue(buffer, pair.first);
+			buffer += '=';
+			AppendValue(buffer, pair.second);
 		}
 	}
 
-	msgbuf << " " <<  static_cast<unsigned long>(ts);
+	buffer += ' ';
+	buffer += std::to_string(static_cast<unsigned long>(ts));
+	buffer += '\n';
+}
 
-	Log(LogDebug, GetReflectionType()->GetName())
-		<< "Checkable '" << checkable->GetName() << "' adds to metric list:'" << msgbuf.str() << "'.";
+void InfluxdbCommonWriter::SendMetric(const Checkable::Ptr& checkable, const std::string& prefix,
+	const String& label, const Dictionary::Ptr& fields, double ts)
+{
+#ifdef I2_DEBUG /* I2_DEBUG */
+	size_t start = m_DataBuffer.size();
+#endif /* I2_DEBUG */
 
 	// Buffer the data point
-	m_DataBuffer.emplace_back(msgbuf.str());
-	m_DataBufferSize = m_DataBuffer.size();
+	AppendDataPoint(m_DataBuffer, prefix, label, fields, ts);
+	m_DataBufferSize++;
+
+#ifdef I2_DEBUG /* I2_DEBUG */
+	/* Copying every data point is too expensive for release builds, even if the message is dropped. */
+	Log(LogDebug, GetReflectionType()->GetName())
+		<< "Checkable '" << checkable->GetName() << "' adds to metric list:'"
+		<< m_DataBuffer.substr(start, m_DataBuffer.size() - start - 1) << "'.";
+#endif /* I2_DEBUG */
 
 	// Flush if we've buffered too much to prevent excessive memory use
-	if (static_cast<int>(m_DataBuffer.size()) >= GetFlushThreshold()) {
+	if (static_cast<int>(m_DataBufferSize) >= GetFlushThreshold()) {
 		Log(LogDebug, GetReflectionType()->GetName())
-			<< "Data buffer overflow writing " << m_DataBuffer.size() << " data points";
+			<< "Data buffer overflow writing " << m_DataBufferSize << " data points";
 
 		try {
 			FlushWQ();
@@ -427,7 +470,7 @@ void InfluxdbCommonWriter::FlushTimeoutWQ()
 	AssertOnWorkQueue();
 
 	Log(LogDebug, GetReflectionType()->GetName())
-		<< "Timer expired writing " << m_DataBuffer.size() << " data points";
+		<< "Timer expired writing " << m_DataBufferSize << " data points";
 
 	FlushWQ();
 }
@@ -446,63 +489,52 @@ void InfluxdbCommonWriter::FlushWQ()
 	Log(LogDebug, GetReflectionType()->GetName())
 		<< "Flushing data buffer to InfluxDB.";
 
-	String body = boost::algorithm::join(m_DataBuffer, "\n");
+	/* Hand the buffer over to the request, the next batch will probably be as large. */
+	String body (std::move(m_DataBuffer));
 	m_DataBuffer.clear();
+	m_DataBuffer.reserve(body.GetLength());
 	m_DataBufferSize = 0;
 
-	OptionalTlsStream stream;
+	/* Keep a copy for the spool, the request takes over the body. */
+	String spoolData;
 
-	try {
-		stream = Connect();
-	} catch (const std::exception& ex) {
-		Log(LogWarning, GetReflectionType()->GetName())
-			<< "Flush failed, cannot connect to InfluxDB: " << DiagnosticInformation(ex, false);
-		return;
-	}
-
-	Defer s ([&stream]() {
-		if (stream.first) {
-			stream.first->next_layer().shutdown();
-		}
-	});
+	if (m_Spool)
+		spoolData = body;
 
 	auto request (AssembleRequest(std::move(body)));
+	HttpWriterConnection::Response response;
+	bool connected = true;
 
 	try {
-		if (stream.first) {
-			http::write(*stream.first, request);
-			stream.first->flush();
-		} else {
-			http::write(*stream.second, request);
-			stream.second->flush();
-		}
+		response = m_Connection.Send([this, &connected]() {
+			connected = false;
+			OptionalTlsStream stream = Connect();
+			connected = true;
+			return stream;
+		}, request);
 	} catch (const std::exception& ex) {
-		Log(LogWarning, GetReflectionType()->GetName())
-			<< "Cannot write to TCP socket on host '" << GetHost() << "' port '" << GetPort() << "'.";
-		throw;
-	}
+		if (m_Spool)
+			m_Spool->Append(spoolData);
 
-	http::parser<false, http::string_body> parser;
-	beast::flat_buffer buf;
-
-	try {
-		if (stream.first) {
-			http::read(*stream.first, buf, parser);
-		} else {
-			http::read(*stream.second, buf, parser);
+		if (!connected) {
+			Log(LogWarning, GetReflectionType()->GetName())
+				<< "Flush failed, cannot connect to InfluxDB: " << DiagnosticInformation(ex, false);
+			return;
 		}
-	} catch (const std::exception& ex) {
+
 		Log(LogWarning, GetReflectionType()->GetName())
-			<< "Failed to parse HTTP response from host '" << GetHost() << "' port '" << GetPort() << "': " << DiagnosticInformation(ex);
+			<< "Cannot send data to InfluxDB on host '" << GetHost() << "' port '" << GetPort() << "': " << DiagnosticInformation(ex, false);
 		throw;
 	}
 
-	auto& response (parser.get());
-
 	if (response.result() != http::status::no_content) {
 		Log(LogWarning, GetReflectionType()->GetName())
 			<< "Unexpected response code: " << response.result();
 
+		/* InfluxDB might just be overloaded, the data points are fine. */
+		if (m_Spool && response.result_int() >= 500)
+			m_Spool->Append(spoolData);
+
 		auto& contentType (response[http::field::content_type]);
 		if (contentType != "application/json") {
 			Log(LogWarning, GetReflectionType()->GetName())
@@ -528,6 +560,48 @@ void InfluxdbCommonWriter::FlushWQ()
 	}
 }
 
+/**
+ * Sends the oldest spooled data points once InfluxDB is reachable again.
+ *
+ * Called inside the WQ.
+ */
+void InfluxdbCommonWriter::ReplaySpool()
+{
+	AssertOnWorkQueue();
+
+	if (IsPaused())
+		return;
+
+	String data = m_Spool->Peek(static_cast<size_t>(GetSpoolReplayRate()) * 1024);
+
+	if (data.IsEmpty())
+		return;
+
+	size_t length = data.GetLength();
+	auto request (AssembleRequest(std::move(data)));
+	HttpWriterConnection::Response response;
+
+	try {
+		response = m_Connection.Send([this]() { return Connect(); }, request);
+	} catch (const std::exception& ex) {
+		Log(LogDebug, GetReflectionType()->GetName())
+			<< "Replaying spooled data failed, retrying later: " << DiagnosticInformation(ex, false);
+		return;
+	}
+
+	/* Retry on server errors only, a rejected batch would block the spool forever. */
+	if (response.result_int() >= 500) {
+		Log(LogWarning, GetReflectionType()->GetName())
+			<< "Unexpected response code while replaying spooled data: " << response.result();
+		return;
+	}
+
+	m_Spool->Consume();
+
+	Log(LogNotice, GetReflectionType()->GetName())
+		<< "Replayed " << length << " bytes of spooled data points, " << m_Spool->GetSize() << " bytes left.";
+}
+
 boost::beast::http::request<boost::beast::http::string_body> InfluxdbCommonWriter::AssembleBaseRequest(String body)
 {
 	namespace http = boost::beast::http;
@@ -537,7 +611,7 @@ boost::beast::http::request<boost::beast::http::string_body> InfluxdbCommonWrite
 
 	request.set(http::field::user_agent, "Icinga/" + Application::GetAppVersion());
 	request.set(http::field::host, url->GetHost() + ":" + url->GetPort());
-	request.body() = std::move(body);
+	request.body() = std::move(body.GetData());
 	request.content_length(request.body().size());
 
 	return std::move(request);
@@ -591,3 +665,18 @@ void InfluxdbCommonWriter::ValidateServiceTemplate(const Lazy<Dictionary::Ptr>&
 	}
 }
 
+void InfluxdbCommonWriter::ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<InfluxdbCommonWriter>::ValidateSpoolMaxSize(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_max_size" }, "Value must be greater than 0."));
+}
+
+void InfluxdbCommonWriter::ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<InfluxdbCommonWriter>::ValidateSpoolReplayRate(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_replay_rate" }, "Value must be greater than 0."));
+}
@@ -4,6 +4,8 @@
 #define INFLUXDBCOMMONWRITER_H
 
 #include "perfdata/influxdbcommonwriter-ti.hpp"
+#include "perfdata/httpwriterconnection.hpp"
+#include "perfdata/perfdataspool.hpp"
 #include "icinga/service.hpp"
 #include "base/configobject.hpp"
 #include "base/perfdatavalue.hpp"
@@ -16,6 +18,7 @@
 #include <boost/beast/http/string_body.hpp>
 #include <atomic>
 #include <fstream>
+#include <string>
 
 namespace icinga
 {
@@ -33,8 +36,15 @@ public:
 	template<class InfluxWriter>
 	static void StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata);
 
+	static void AppendKeyOrTagValue(std::string& buffer, const String& str);
+	static void AppendValue(std::string& buffer, const Value& value);
+	static void AppendDataPoint(std::string& buffer, const std::string& prefix, const String& label,
+		const Dictionary::Ptr& fields, double ts);
+
 	void ValidateHostTemplate(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils) override;
 	void ValidateServiceTemplate(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
 
 protected:
 	void OnConfigLoaded() override;
@@ -49,19 +59,21 @@ protected:
 private:
 	Timer::Ptr m_FlushTimer;
 	WorkQueue m_WorkQueue{10000000, 1};
-	std::vector<String> m_DataBuffer;
+	std::string m_DataBuffer;
 	std::atomic_size_t m_DataBufferSize{0};
+	HttpWriterConnection m_Connection;
+	Shared<boost::asio::ssl::context>::Ptr m_SslContext;
+	PerfdataSpool::Ptr m_Spool;
+	Timer::Ptr m_SpoolTimer;
 
 	void CheckResultHandler(const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
 	void CheckResultHandlerWQ(const Checkable::Ptr& checkable, const CheckResult::Ptr& cr);
-	void SendMetric(const Checkable::Ptr& checkable, const Dictionary::Ptr& tmpl,
+	void SendMetric(const Checkable::Ptr& checkable, const std::string& prefix,
 		const String& label, const Dictionary::Ptr& fields, double ts);
 	void FlushTimeout();
 	void FlushTimeoutWQ();
 	void FlushWQ();
-
-	static String EscapeKeyOrTagValue(const String& str);
-	static String EscapeValue(const Value& value);
+	void ReplaySpool();
 
 	OptionalTlsStream Connect();
 
@@ -81,15 +93,31 @@ void InfluxdbCommonWriter::StatsFunc(const Dictionary::Ptr& status, const Array:
 		double workQueueItemRate = influxwriter->m_WorkQueue.GetTaskCount(60) / 60.0;
 		size_t dataBufferItems = influxwriter->m_DataBufferSize;
 
-		nodes.emplace_back(influxwriter->GetName(), new Dictionary({
+		Dictionary::Ptr node = new Dictionary({
 			{ "work_queue_items", workQueueItems },
 			{ "work_queue_item_rate", workQueueItemRate },
-			{ "data_buffer_items", dataBufferItems }
-		}));
+			{ "data_buffer_items", dataBufferItems },
+			{ "connects", influxwriter->m_Connection.GetConnectCount() },
+			{ "requests", influxwriter->m_Connection.GetRequestCount() },
+			{ "request_latency", influxwriter->m_Connection.GetLatencyHistogram() }
+		});
+
+		nodes.emplace_back(influxwriter->GetName(), node);
 
 		perfdata->Add(new PerfdataValue(typeName + "_" + influxwriter->GetName() + "_work_queue_items", workQueueItems));
 		perfdata->Add(new PerfdataValue(typeName + "_" + influxwriter->GetName() + "_work_queue_item_rate", workQueueItemRate));
 		perfdata->Add(new PerfdataValue(typeName + "_" + influxwriter->GetName() + "_data_queue_items", dataBufferItems));
+		influxwriter->m_Connection.AddPerfdata(typeName + "_" + influxwriter->GetName(), perfdata);
+
+		PerfdataSpool::Ptr spool = influxwriter->m_Spool;
+
+		if (spool) {
+			node->Set("spool_size", spool->GetSize());
+			node->Set("spool_dropped_bytes", spool->GetDroppedBytes());
+
+			perfdata->Add(new PerfdataValue(typeName + "_" + influxwriter->GetName() + "_spool_size", spool->GetSize()));
+			perfdata->Add(new PerfdataValue(typeName + "_" + influxwriter->GetName() + "_spool_dropped_bytes", spool->GetDroppedBytes(), true));
+		}
 	}
 
 	status->Set(typeName, new Dictionary(std::move(nodes)));
@@ -15,6 +15,7 @@
 #include "base/utility.hpp"
 #include "base/perfdatavalue.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
 #include "base/stream.hpp"
 #include "base/networkstream.hpp"
 #include "base/exception.hpp"
@@ -49,15 +50,28 @@ void OpenTsdbWriter::OnConfigLoaded()
  * Feature stats interface
  *
  * @param status Key value pairs for feature stats
+ * @param perfdata Array of PerfdataValue objects
  */
-void OpenTsdbWriter::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr&)
+void OpenTsdbWriter::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
 {
 	DictionaryData nodes;
 
 	for (const OpenTsdbWriter::Ptr& opentsdbwriter : ConfigType::GetObjectsByType<OpenTsdbWriter>()) {
-		nodes.emplace_back(opentsdbwriter->GetName(), new Dictionary({
+		Dictionary::Ptr node = new Dictionary({
 			{ "connected", opentsdbwriter->GetConnected() }
-		}));
+		});
+
+		nodes.emplace_back(opentsdbwriter->GetName(), node);
+
+		PerfdataSpool::Ptr spool = opentsdbwriter->m_Spool;
+
+		if (spool) {
+			node->Set("spool_size", spool->GetSize());
+			node->Set("spool_dropped_bytes", spool->GetDroppedBytes());
+
+			perfdata->Add(new PerfdataValue("opentsdbwriter_" + opentsdbwriter->GetName() + "_spool_size", spool->GetSize()));
+			perfdata->Add(new PerfdataValue("opentsdbwriter_" + opentsdbwriter->GetName() + "_spool_dropped_bytes", spool->GetDroppedBytes(), true));
+		}
 	}
 
 	status->Set("opentsdbwriter", new Dictionary(std::move(nodes)));
@@ -81,6 +95,19 @@ void OpenTsdbWriter::Resume()
 	m_ReconnectTimer->Start();
 	m_ReconnectTimer->Reschedule(0);
 
+	if (GetEnableSpool()) {
+		if (!m_Spool) {
+			m_Spool = new PerfdataSpool(Configuration::SpoolDir + "/perfdata-spool/opentsdbwriter-" + GetName(),
+				static_cast<uint_fast64_t>(GetSpoolMaxSize()) * 1024 * 1024);
+		}
+
+		/* Timer for replaying spooled metrics, spool_replay_rate KiB per run */
+		m_SpoolTimer = new Timer();
+		m_SpoolTimer->SetInterval(1);
+		m_SpoolTimer->OnTimerExpired.connect([this](const Timer * const&) { ReplaySpool(); });
+		m_SpoolTimer->Start();
+	}
+
 	Service::OnNewCheckResult.connect([this](const Checkable::Ptr& checkable, const CheckResult::Ptr& cr, const MessageOrigin::Ptr&) {
 		CheckResultHandler(checkable, cr);
 	});
@@ -92,6 +119,7 @@ void OpenTsdbWriter::Resume()
 void OpenTsdbWriter::Pause()
 {
 	m_ReconnectTimer.reset();
+	m_SpoolTimer.reset();
 
 	Log(LogInformation, "OpentsdbWriter")
 		<< "'" << GetName() << "' paused.";
@@ -145,6 +173,41 @@ void OpenTsdbWriter::ReconnectTimerHandler()
 		<< "Finished reconnecting to OpenTSDB in " << std::setw(2) << Utility::GetTime() - startTime << " second(s).";
 }
 
+/**
+ * Sends the oldest spooled metrics once the connection is back.
+ */
+void OpenTsdbWriter::ReplaySpool()
+{
+	if (IsPaused())
+		return;
+
+	ObjectLock olock(this);
+
+	if (!GetConnected())
+		return;
+
+	String data = m_Spool->Peek(static_cast<size_t>(GetSpoolReplayRate()) * 1024);
+
+	if (data.IsEmpty())
+		return;
+
+	try {
+		boost::asio::write(*m_Stream, boost::asio::buffer(data.GetData()));
+		m_Stream->flush();
+	} catch (const std::exception& ex) {
+		Log(LogCritical, "OpenTsdbWriter")
+			<< "Cannot write to TCP socket on host '" << GetHost() << "' port '" << GetPort() << "'.";
+
+		SetConnected(false);
+		return;
+	}
+
+	m_Spool->Consume();
+
+	Log(LogNotice, "OpenTsdbWriter")
+		<< "Replayed " << data.GetLength() << " bytes of spooled metrics, " << m_Spool->GetSize() << " bytes left.";
+}
+
 /**
  * Registered check result handler processing data.
  * Calculates tags from the config.
@@ -301,56 +364,43 @@ void OpenTsdbWriter::CheckResultHandler(const Checkable::Ptr& checkable, const C
 void OpenTsdbWriter::SendPerfdata(const Checkable::Ptr& checkable, const String& metric,
 	const std::map<String, String>& tags, const CheckResult::Ptr& cr, double ts)
 {
-	Array::Ptr perfdata = cr->GetPerformanceData();
-
-	if (!perfdata)
-		return;
+	auto perfdata (cr->GetParsedPerfdata());
 
 	CheckCommand::Ptr checkCommand = checkable->GetCheckCommand();
 
-	ObjectLock olock(perfdata);
-	for (const Value& val : perfdata) {
-		PerfdataValue::Ptr pdv;
-
-		if (val.IsObjectType<PerfdataValue>())
-			pdv = val;
-		else {
-			try {
-				pdv = PerfdataValue::Parse(val);
-			} catch (const std::exception&) {
-				Log(LogWarning, "OpenTsdbWriter")
-					<< "Ignoring invalid perfdata for checkable '"
-					<< checkable->GetName() << "' and command '"
-					<< checkCommand->GetName() << "' with value: " << val;
-				continue;
-			}
-		}
-		
+	for (const Value& val : perfdata->Invalid) {
+		Log(LogWarning, "OpenTsdbWriter")
+			<< "Ignoring invalid perfdata for checkable '"
+			<< checkable->GetName() << "' and command '"
+			<< checkCommand->GetName() << "' with value: " << val;
+	}
+
+	for (size_t i = 0; i < perfdata->GetLength(); i++) {
 		String metric_name;
 		std::map<String, String> tags_new = tags;
 
 		// Do not break original functionality where perfdata labels form
 		// part of the metric name
 		if (!GetEnableGenericMetrics()) {
-			String escaped_key = EscapeMetric(pdv->GetLabel());
+			String escaped_key = EscapeMetric(perfdata->Labels[i]);
 			boost::algorithm::replace_all(escaped_key, "::", ".");
 			metric_name = metric + "." + escaped_key;
 		} else {
-			String escaped_key = EscapeTag(pdv->GetLabel());
+			String escaped_key = EscapeTag(perfdata->Labels[i]);
 			metric_name = metric;
 			tags_new["label"] = escaped_key;
 		}
 
-		SendMetric(checkable, metric_name, tags_new, pdv->GetValue(), ts);
+		SendMetric(checkable, metric_name, tags_new, perfdata->Values[i], ts);
 
-		if (!pdv->GetCrit().IsEmpty())
-			SendMetric(checkable, metric_name + "_crit", tags_new, pdv->GetCrit(), ts);
-		if (!pdv->GetWarn().IsEmpty())
-			SendMetric(checkable, metric_name + "_warn", tags_new, pdv->GetWarn(), ts);
-		if (!pdv->GetMin().IsEmpty())
-			SendMetric(checkable, metric_name + "_min", tags_new, pdv->GetMin(), ts);
-		if (!pdv->GetMax().IsEmpty())
-			SendMetric(checkable, metric_name + "_max", tags_new, pdv->GetMax(), ts);
+		if (!perfdata->Crit[i].IsEmpty())
+			SendMetric(checkable, metric_name + "_crit", tags_new, perfdata->Crit[i], ts);
+		if (!perfdata->Warn[i].IsEmpty())
+			SendMetric(checkable, metric_name + "_warn", tags_new, perfdata->Warn[i], ts);
+		if (!perfdata->Min[i].IsEmpty())
+			SendMetric(checkable, metric_name + "_min", tags_new, perfdata->Min[i], ts);
+		if (!perfdata->Max[i].IsEmpty())
+			SendMetric(checkable, metric_name + "_max", tags_new, perfdata->Max[i], ts);
 	}
 }
 
@@ -389,8 +439,12 @@ void OpenTsdbWriter::SendMetric(const Checkable::Ptr& checkable, const String& m
 
 	ObjectLock olock(this);
 
-	if (!GetConnected())
+	if (!GetConnected()) {
+		if (m_Spool)
+			m_Spool->Append(put);
+
 		return;
+	}
 
 	try {
 		Log(LogDebug, "OpenTsdbWriter")
@@ -401,6 +455,13 @@ void OpenTsdbWriter::SendMetric(const Checkable::Ptr& checkable, const String& m
 	} catch (const std::exception& ex) {
 		Log(LogCritical, "OpenTsdbWriter")
 			<< "Cannot write to TCP socket on host '" << GetHost() << "' port '" << GetPort() << "'.";
+
+		if (m_Spool) {
+			m_Spool->Append(put);
+
+			/* Let the reconnect timer open a new connection before replaying. */
+			SetConnected(false);
+		}
 	}
 }
 
@@ -523,3 +584,19 @@ void OpenTsdbWriter::ValidateServiceTemplate(const Lazy<Dictionary::Ptr>& lvalue
 		}
 	}
 }
+
+void OpenTsdbWriter::ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<OpenTsdbWriter>::ValidateSpoolMaxSize(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_max_size" }, "Value must be greater than 0."));
+}
+
+void OpenTsdbWriter::ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<OpenTsdbWriter>::ValidateSpoolReplayRate(lvalue, utils);
+
+	if (lvalue() <= 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "spool_replay_rate" }, "Value must be greater than 0."));
+}
@@ -4,6 +4,7 @@
 #define OPENTSDBWRITER_H
 
 #include "perfdata/opentsdbwriter-ti.hpp"
+#include "perfdata/perfdataspool.hpp"
 #include "icinga/service.hpp"
 #include "base/configobject.hpp"
 #include "base/tcpsocket.hpp"
@@ -28,6 +29,8 @@ public:
 
 	void ValidateHostTemplate(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils) override;
 	void ValidateServiceTemplate(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolMaxSize(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+	void ValidateSpoolReplayRate(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
 
 protected:
 	void OnConfigLoaded() override;
@@ -39,6 +42,9 @@ private:
 
 	Timer::Ptr m_ReconnectTimer;
 
+	PerfdataSpool::Ptr m_Spool;
+	Timer::Ptr m_SpoolTimer;
+
 	Dictionary::Ptr m_ServiceConfigTemplate;
 	Dictionary::Ptr m_HostConfigTemplate;
 
@@ -51,6 +57,7 @@ private:
 	static String EscapeMetric(const String& str);
 
 	void ReconnectTimerHandler();
+	void ReplaySpool();
 
 	void ReadConfigTemplate(const Dictionary::Ptr& stemplate, 
 		const Dictionary::Ptr& htemplate);
@@ -0,0 +1,254 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "perfdata/perfdataspool.hpp"
+#include "base/convert.hpp"
+#include "base/exception.hpp"
+#include "base/logger.hpp"
+#include "base/utility.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace icinga;
+
+PerfdataSpool::PerfdataSpool(String path, uint_fast64_t maxSize)
+	: m_Path(std::move(path)), m_MaxSize(maxSize)
+{
+	/* Keep at least four segments so that dropping one doesn't throw away most of the spool. */
+	m_SegmentSize = std::max<uint_fast64_t>(std::min<uint_fast64_t>(16 * 1024 * 1024, m_MaxSize / 4), 4096);
+
+	Utility::MkDirP(m_Path, 0750);
+
+	std::vector<uint_fast64_t> ids;
+
+	Utility::Glob(m_Path + "/*.spool", [&ids](const String& file) {
+		String name = Utility::BaseName(file);
+		ids.push_back(Convert::ToLong(name.SubStr(0, name.GetLength() - 6)));
+	}, GlobFile);
+
+	std::sort(ids.begin(), ids.end());
+
+	for (uint_fast64_t id : ids) {
+		std::ifstream fp (GetSegmentPath(id).CStr(), std::ios::binary | std::ios::ate);
+		uint_fast64_t size = fp ? static_cast<uint_fast64_t>(fp.tellg()) : 0;
+
+		m_Segments.push_back({ id, size });
+		m_Size += size;
+	}
+
+	std::ifstream offsetfp ((m_Path + "/offset").CStr());
+	uint_fast64_t id, offset;
+
+	if (!m_Segments.empty() && offsetfp >> id >> offset && id == m_Segments.front().ID) {
+		m_ReadOffset = std::min(offset, m_Segments.front().Size);
+		m_PeekOffset = m_ReadOffset;
+		m_Size -= m_ReadOffset;
+	}
+
+	if (m_Size > 0) {
+		Log(LogInformation, "PerfdataSpool")
+			<< "Found " << m_Size << " bytes of spooled data in '" << m_Path << "'.";
+	}
+}
+
+String PerfdataSpool::GetSegmentPath(uint_fast64_t id) const
+{
+	std::ostringstream msgbuf;
+	msgbuf << m_Path << "/" << std::setw(16) << std::setfill('0') << id << ".spool";
+	return msgbuf.str();
+}
+
+/**
+ * Appends a record. The caller is responsible for any delimiters the
+ * backend needs, records are replayed as they are.
+ */
+void PerfdataSpool::Append(const String& data)
+{
+	String record = Convert::ToString(data.GetLength()) + ":" + data + ",";
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (m_Segments.empty() || !m_Writer.is_open() || m_Segments.back().Size >= m_SegmentSize) {
+		uint_fast64_t id = m_Segments.empty() ? 1 : m_Segments.back().ID + 1;
+
+		if (m_Writer.is_open())
+			m_Writer.close();
+
+		m_Writer.clear();
+		m_Writer.open(GetSegmentPath(id).CStr(), std::ios::binary | std::ios::app);
+
+		if (!m_Writer)
+			BOOST_THROW_EXCEPTION(std::runtime_error("Could not open spool segment '" + GetSegmentPath(id) + "'."));
+
+		m_Segments.push_back({ id, 0 });
+	}
+
+	m_Writer.write(record.CStr(), record.GetLength());
+	m_Writer.flush();
+
+	if (!m_Writer)
+		BOOST_THROW_EXCEPTION(std::runtime_error("Could not write to spool segment in '" + m_Path + "'."));
+
+	m_Segments.back().Size += record.GetLength();
+	m_Size += record.GetLength();
+
+	if (m_Size > m_MaxSize && m_Segments.size() > 1) {
+		uint_fast64_t dropped = m_DroppedBytes;
+
+		while (m_Size > m_MaxSize && m_Segments.size() > 1)
+			DropFront();
+
+		Log(LogWarning, "PerfdataSpool")
+			<< "Spool '" << m_Path << "' exceeds its maximum size, dropped " << m_DroppedBytes - dropped << " bytes of the oldest data.";
+	}
+}
+
+void PerfdataSpool::DropFront()
+{
+	const Segment& front = m_Segments.front();
+	uint_fast64_t unread = front.Size - m_ReadOffset;
+
+	m_Size -= unread;
+	m_DroppedBytes += unread;
+
+	if (m_Segments.size() == 1)
+		m_Writer.close();
+
+	String segmentPath = GetSegmentPath(front.ID);
+
+	if (Utility::PathExists(segmentPath))
+		Utility::Remove(segmentPath);
+
+	m_Segments.pop_front();
+	m_ReadOffset = 0;
+	m_PeekOffset = 0;
+
+	SaveReadOffset();
+}
+
+/**
+ * Returns the oldest records, concatenated up to about maxBytes. The
+ * records are kept until Consume() is called.
+ */
+String PerfdataSpool::Peek(size_t maxBytes)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	String result;
+
+	while (!m_Segments.empty()) {
+		const Segment& front = m_Segments.front();
+
+		if (m_ReadOffset >= front.Size) {
+			/* The newest segment is kept open for appending. */
+			if (m_Segments.size() == 1)
+				break;
+
+			DropFront();
+			continue;
+		}
+
+		std::ifstream fp (GetSegmentPath(front.ID).CStr(), std::ios::binary);
+		fp.seekg(m_ReadOffset);
+
+		uint_fast64_t offset = m_ReadOffset;
+		bool corrupt = false;
+
+		while (offset < front.Size && result.GetLength() < maxBytes) {
+			size_t length;
+			char colon, comma;
+
+			if (!(fp >> length) || !fp.get(colon) || colon != ':') {
+				corrupt = true;
+				break;
+			}
+
+			std::string data (length, '\0');
+
+			if (!fp.read(&data[0], length) || !fp.get(comma) || comma != ',') {
+				corrupt = true;
+				break;
+			}
+
+			result += data;
+			offset += Convert::ToString(length).GetLength() + length + 2;
+		}
+
+		if (corrupt && result.IsEmpty()) {
+			Log(LogWarning, "PerfdataSpool")
+				<< "Skipping the corrupt remainder of spool segment '" << GetSegmentPath(front.ID) << "'.";
+
+			m_Size -= front.Size - m_ReadOffset;
+			m_ReadOffset = front.Size;
+			SaveReadOffset();
+			continue;
+		}
+
+		m_PeekOffset = offset;
+		break;
+	}
+
+	return result;
+}
+
+/**
+ * Removes the records returned by the last Peek().
+ */
+void PerfdataSpool::Consume()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (m_Segments.empty() || m_PeekOffset <= m_ReadOffset)
+		return;
+
+	m_Size -= m_PeekOffset - m_ReadOffset;
+	m_ReadOffset = m_PeekOffset;
+
+	if (m_ReadOffset >= m_Segments.front().Size)
+		DropFront();
+	else
+		SaveReadOffset();
+}
+
+void PerfdataSpool::SaveReadOffset()
+{
+	String offsetPath = m_Path + "/offset";
+
+	if (m_Segments.empty()) {
+		if (Utility::PathExists(offsetPath))
+			Utility::Remove(offsetPath);
+
+		return;
+	}
+
+	String tempPath = offsetPath + ".tmp";
+
+	{
+		std::ofstream fp (tempPath.CStr(), std::ios::trunc);
+		fp << m_Segments.front().ID << " " << m_ReadOffset << "\n";
+	}
+
+	Utility::RenameFile(tempPath, offsetPath);
+}
+
+bool PerfdataSpool::IsEmpty() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	return m_Size == 0;
+}
+
+uint_fast64_t PerfdataSpool::GetSize() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	return m_Size;
+}
+
+uint_fast64_t PerfdataSpool::GetDroppedBytes() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	return m_DroppedBytes;
+}
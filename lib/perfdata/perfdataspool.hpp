@@ -0,0 +1,68 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef PERFDATASPOOL_H
+#define PERFDATASPOOL_H
+
+#include "base/object.hpp"
+#include "base/string.hpp"
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+
+namespace icinga
+{
+
+/**
+ * An on-disk queue for the data a perfdata writer couldn't deliver.
+ *
+ * Records are appended as netstrings to segment files in a directory of
+ * their own. The oldest segments are dropped when the spool grows beyond
+ * its maximum size. Records are read back in order, the read position
+ * survives restarts.
+ *
+ * @ingroup perfdata
+ */
+class PerfdataSpool final : public Object
+{
+public:
+	DECLARE_PTR_TYPEDEFS(PerfdataSpool);
+
+	PerfdataSpool(String path, uint_fast64_t maxSize);
+
+	void Append(const String& data);
+
+	String Peek(size_t maxBytes);
+	void Consume();
+
+	bool IsEmpty() const;
+	uint_fast64_t GetSize() const;
+	uint_fast64_t GetDroppedBytes() const;
+
+private:
+	struct Segment
+	{
+		uint_fast64_t ID;
+		uint_fast64_t Size;
+	};
+
+	String m_Path;
+	uint_fast64_t m_MaxSize;
+	uint_fast64_t m_SegmentSize;
+
+	mutable std::mutex m_Mutex;
+	std::deque<Segment> m_Segments;
+	std::ofstream m_Writer;
+	uint_fast64_t m_ReadOffset{0};
+	uint_fast64_t m_PeekOffset{0};
+	uint_fast64_t m_Size{0};
+	uint_fast64_t m_DroppedBytes{0};
+
+	String GetSegmentPath(uint_fast64_t id) const;
+	void DropFront();
+	void SaveReadOffset();
+};
+
+}
+
+#endif /* PERFDATASPOOL_H */
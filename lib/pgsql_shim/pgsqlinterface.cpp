@@ -36,6 +36,12 @@ struct PgsqlInterfaceImpl final : public PgsqlInterface
 		return PQexec(conn, query);
 	}
 
+	PGresult *execPrepared(PGconn *conn, const char *stmtName, int nParams, const char * const *paramValues,
+		const int *paramLengths, const int *paramFormats, int resultFormat) const override
+	{
+		return PQexecPrepared(conn, stmtName, nParams, paramValues, paramLengths, paramFormats, resultFormat);
+	}
+
 	void finish(PGconn *conn) const override
 	{
 		PQfinish(conn);
@@ -71,6 +77,11 @@ struct PgsqlInterfaceImpl final : public PgsqlInterface
 		return PQntuples(res);
 	}
 
+	PGresult *prepare(PGconn *conn, const char *stmtName, const char *query, int nParams, const Oid *paramTypes) const override
+	{
+		return PQprepare(conn, stmtName, query, nParams, paramTypes);
+	}
+
 	char *resultErrorMessage(const PGresult *res) const override
 	{
 		return PQresultErrorMessage(res);
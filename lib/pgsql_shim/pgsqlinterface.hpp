@@ -22,6 +22,8 @@ struct PgsqlInterface
 	virtual char *errorMessage(const PGconn *conn) const = 0;
 	virtual size_t escapeStringConn(PGconn *conn, char *to, const char *from, size_t length, int *error) const = 0;
 	virtual PGresult *exec(PGconn *conn, const char *query) const = 0;
+	virtual PGresult *execPrepared(PGconn *conn, const char *stmtName, int nParams, const char * const *paramValues,
+		const int *paramLengths, const int *paramFormats, int resultFormat) const = 0;
 	virtual void finish(PGconn *conn) const = 0;
 	virtual char *fname(const PGresult *res, int field_num) const = 0;
 	virtual int getisnull(const PGresult *res, int tup_num, int field_num) const = 0;
@@ -29,6 +31,7 @@ struct PgsqlInterface
 	virtual int isthreadsafe() const = 0;
 	virtual int nfields(const PGresult *res) const = 0;
 	virtual int ntuples(const PGresult *res) const = 0;
+	virtual PGresult *prepare(PGconn *conn, const char *stmtName, const char *query, int nParams, const Oid *paramTypes) const = 0;
 	virtual char *resultErrorMessage(const PGresult *res) const = 0;
 	virtual ExecStatusType resultStatus(const PGresult *res) const = 0;
 	virtual int serverVersion(const PGconn *conn) const = 0;
@@ -8,6 +8,7 @@
 #include "remote/apifunction.hpp"
 #include "remote/configpackageutility.hpp"
 #include "remote/configobjectutility.hpp"
+#include "remote/replaylogsegment.hpp"
 #include "base/convert.hpp"
 #include "base/defer.hpp"
 #include "base/io-engine.hpp"
@@ -29,6 +30,7 @@
 #include <boost/asio/spawn.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
 #include <boost/system/error_code.hpp>
@@ -874,6 +876,7 @@ void ApiListener::ApiTimerHandler()
 			Log(LogNotice, "ApiListener")
 				<< "Removing old log file: " << path;
 			(void)unlink(path.CStr());
+			(void)unlink((path + ".idx").CStr());
 		}
 	}
 
@@ -1030,21 +1033,35 @@ void ApiListener::PersistMessage(const Dictionary::Ptr& message, const ConfigObj
 
 	ASSERT(ts != 0);
 
-	Dictionary::Ptr pmessage = new Dictionary();
-	pmessage->Set("timestamp", ts);
-
-	pmessage->Set("message", JsonEncode(message));
+	String jmessage = JsonEncode(message);
+	std::string secname;
 
 	if (secobj) {
-		Dictionary::Ptr secname = new Dictionary();
-		secname->Set("type", secobj->GetReflectionType()->GetName());
-		secname->Set("name", secobj->GetName());
-		pmessage->Set("secobj", secname);
+		secname = secobj->GetReflectionType()->GetName().GetData();
+		secname += '\0';
+		secname += secobj->GetName().GetData();
 	}
 
+	ReplayLogRecordHeader header;
+	header.Timestamp = ts;
+	header.SecobjLength = secname.size();
+	header.MessageLength = jmessage.GetLength();
+
 	std::unique_lock<std::mutex> lock(m_LogLock);
 	if (m_LogFile) {
-		NetString::WriteStringToStream(m_LogFile, JsonEncode(pmessage));
+		if (m_LogIndexFile && m_LogMessageCount % ReplayLogSegment::IndexInterval == 0) {
+			ReplayLogIndexEntry entry;
+			entry.Timestamp = ts;
+			entry.Offset = m_LogFileSize;
+
+			m_LogIndexFile->Write(&entry, sizeof(entry));
+		}
+
+		m_LogFile->Write(&header, sizeof(header));
+		m_LogFile->Write(secname.c_str(), secname.size());
+		m_LogFile->Write(jmessage.CStr(), jmessage.GetLength());
+
+		m_LogFileSize += sizeof(header) + secname.size() + jmessage.GetLength();
 		m_LogMessageCount++;
 		SetLogMessageTimestamp(ts);
 
@@ -1247,15 +1264,92 @@ void ApiListener::OpenLogFile()
 
 	Utility::MkDirP(Utility::DirName(path), 0750);
 
-	auto *fp = new std::fstream(path.CStr(), std::fstream::out | std::ofstream::app);
+	std::streamoff size = 0;
+	std::streamoff completeSize = 0;
+	bool legacy = false;
+
+	{
+		std::ifstream fp (path.CStr(), std::ifstream::in | std::ifstream::binary);
+
+		if (fp.good() && fp.seekg(0, std::ifstream::end).tellg() > 0) {
+			size = fp.tellg();
+			fp.seekg(0);
+
+			if (ReplayLogSegment::ReadMagic(fp))
+				completeSize = ReplayLogSegment::GetCompleteLength(fp);
+			else
+				legacy = true;
+		}
+	}
+
+	if (legacy) {
+		/* Segments written by older versions can't be appended to, rotate them away. */
+		RotateLogFile();
+
+		std::ifstream fp (path.CStr(), std::ifstream::in | std::ifstream::binary);
+
+		if (fp.good() && fp.seekg(0, std::ifstream::end).tellg() > 0) {
+			Log(LogCritical, "ApiListener")
+				<< "Cannot rotate replay log file '" << path << "' written by an older version, not logging any messages.";
+			return;
+		}
+
+		size = 0;
+	} else if (completeSize < size) {
+		/* Don't append after a torn record, the following ones couldn't be read anymore. */
+		Log(LogWarning, "ApiListener")
+			<< "Dropping incomplete record at the end of replay log file '" << path << "'.";
+
+		try {
+			boost::filesystem::resize_file(path.GetData(), completeSize);
+			ReplayLogSegment::TruncateIndex(path + ".idx", completeSize);
+			size = completeSize;
+		} catch (const std::exception& ex) {
+			Log(LogCritical, "ApiListener")
+				<< "Cannot truncate replay log file '" << path << "', not logging any messages: " << ex.what();
+			return;
+		}
+	}
+
+	std::ios_base::openmode mode = std::fstream::out | std::fstream::binary;
+
+	if (size > 0)
+		mode |= std::fstream::app;
+	else
+		mode |= std::fstream::trunc;
+
+	auto *fp = new std::fstream(path.CStr(), mode);
 
 	if (!fp->good()) {
+		delete fp;
+
 		Log(LogWarning, "ApiListener")
 			<< "Could not open spool file: " << path;
 		return;
 	}
 
 	m_LogFile = new StdioStream(fp, true);
+
+	std::streamoff magicLength = ReplayLogSegment::GetMagicLength();
+
+	if (size <= 0) {
+		m_LogFile->Write(ReplayLogSegment::GetMagic(), magicLength);
+		size = magicLength;
+	}
+
+	m_LogFileSize = size;
+
+	auto *ifp = new std::fstream((path + ".idx").CStr(), std::fstream::out | std::fstream::binary | (size > magicLength ? std::fstream::app : std::fstream::trunc));
+
+	if (ifp->good()) {
+		m_LogIndexFile = new StdioStream(ifp, true);
+	} else {
+		delete ifp;
+
+		Log(LogWarning, "ApiListener")
+			<< "Could not open spool index file: " << path << ".idx";
+	}
+
 	m_LogMessageCount = 0;
 	SetLogMessageTimestamp(Utility::GetTime());
 }
@@ -1263,6 +1357,11 @@ void ApiListener::OpenLogFile()
 /* must hold m_LogLock */
 void ApiListener::CloseLogFile()
 {
+	if (m_LogIndexFile) {
+		m_LogIndexFile->Close();
+		m_LogIndexFile.reset();
+	}
+
 	if (!m_LogFile)
 		return;
 
@@ -1286,6 +1385,9 @@ void ApiListener::RotateLogFile()
 	if (!Utility::PathExists(newpath)) {
 		try {
 			Utility::RenameFile(oldpath, newpath);
+
+			if (Utility::PathExists(oldpath + ".idx"))
+				Utility::RenameFile(oldpath + ".idx", newpath + ".idx");
 		} catch (const std::exception& ex) {
 			Log(LogCritical, "ApiListener")
 				<< "Cannot rotate replay log file from '" << oldpath << "' to '"
@@ -1340,6 +1442,9 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 		return;
 	}
 
+	/* Whether the peer may see messages for an object, keyed by "type\0name". */
+	std::map<String, bool> secobjAccess;
+
 	for (;;) {
 		std::unique_lock<std::mutex> lock(m_LogLock);
 
@@ -1373,48 +1478,90 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 				<< "Replaying log: " << file.second;
 
 			auto *fp = new std::fstream(file.second.CStr(), std::fstream::in | std::fstream::binary);
+			std::streamoff fileSize = fp->seekg(0, std::fstream::end).tellg();
+			fp->seekg(0);
+
+			bool legacy = !ReplayLogSegment::ReadMagic(*fp);
+
+			if (legacy) {
+				fp->clear();
+				fp->seekg(0);
+			} else {
+				/* Records are ordered by timestamp, skip straight to the peer's position. */
+				ReplayLogSegment::Seek(*fp, file.second + ".idx", peer_ts);
+			}
+
 			StdioStream::Ptr logStream = new StdioStream(fp, true);
 
 			String message;
 			StreamReadContext src;
+			ReplayLogRecord record;
+
 			while (true) {
-				Dictionary::Ptr pmessage;
+				if (legacy) {
+					Dictionary::Ptr pmessage;
+
+					try {
+						StreamReadStatus srs = NetString::ReadStringFromStream(logStream, &message, src);
+
+						if (srs == StatusEof)
+							break;
+
+						if (srs != StatusNewItem)
+							continue;
 
-				try {
-					StreamReadStatus srs = NetString::ReadStringFromStream(logStream, &message, src);
+						pmessage = JsonDecode(message);
+					} catch (const std::exception&) {
+						Log(LogWarning, "ApiListener")
+							<< "Unexpected end-of-file for cluster log: " << file.second;
 
-					if (srs == StatusEof)
+						/* Log files may be incomplete or corrupted. This is perfectly OK. */
 						break;
+					}
 
-					if (srs != StatusNewItem)
+					record.Timestamp = pmessage->Get("timestamp");
+
+					if (record.Timestamp <= peer_ts)
 						continue;
 
-					pmessage = JsonDecode(message);
-				} catch (const std::exception&) {
-					Log(LogWarning, "ApiListener")
-						<< "Unexpected end-of-file for cluster log: " << file.second;
+					Dictionary::Ptr secname = pmessage->Get("secobj");
+
+					if (secname)
+						record.Secobj = String(secname->Get("type")) + String(1, '\0') + String(secname->Get("name"));
+					else
+						record.Secobj = String();
+
+					record.Message = pmessage->Get("message");
+				} else if (!ReplayLogSegment::ReadRecord(*fp, fileSize, peer_ts, record)) {
+					if (!fp->eof()) {
+						Log(LogWarning, "ApiListener")
+							<< "Incomplete or corrupt record in cluster log, skipping the rest of it: " << file.second;
+					}
 
 					/* Log files may be incomplete or corrupted. This is perfectly OK. */
 					break;
 				}
 
-				if (pmessage->Get("timestamp") <= peer_ts)
-					continue;
+				if (!record.Secobj.IsEmpty()) {
+					auto access (secobjAccess.find(record.Secobj));
 
-				Dictionary::Ptr secname = pmessage->Get("secobj");
+					/* Look up each object only once per replay, not once per message. */
+					if (access == secobjAccess.end()) {
+						auto pos (record.Secobj.Find(String(1, '\0')));
+						ConfigObject::Ptr secobj;
 
-				if (secname) {
-					ConfigObject::Ptr secobj = ConfigObject::GetObject(secname->Get("type"), secname->Get("name"));
+						if (pos != String::NPos)
+							secobj = ConfigObject::GetObject(record.Secobj.SubStr(0, pos), record.Secobj.SubStr(pos + 1));
 
-					if (!secobj)
-						continue;
+						access = secobjAccess.emplace(record.Secobj, secobj && target_zone->CanAccessObject(secobj)).first;
+					}
 
-					if (!target_zone->CanAccessObject(secobj))
+					if (!access->second)
 						continue;
 				}
 
 				try  {
-					client->SendRawMessage(pmessage->Get("message"));
+					client->SendRawMessage(record.Message);
 					count++;
 				} catch (const std::exception& ex) {
 					Log(LogWarning, "ApiListener")
@@ -1426,7 +1573,7 @@ void ApiListener::ReplayLog(const JsonRpcConnection::Ptr& client)
 					break;
 				}
 
-				peer_ts = pmessage->Get("timestamp");
+				peer_ts = record.Timestamp;
 
 				if (file.first > logpos_ts + 10) {
 					logpos_ts = file.first;
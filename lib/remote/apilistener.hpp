@@ -199,7 +199,9 @@ private:
 
 	std::mutex m_LogLock;
 	Stream::Ptr m_LogFile;
+	Stream::Ptr m_LogIndexFile;
 	size_t m_LogMessageCount{0};
+	uint_fast64_t m_LogFileSize{0};
 
 	bool RelayMessageOne(const Zone::Ptr& zone, const MessageOrigin::Ptr& origin, const Dictionary::Ptr& message, const Endpoint::Ptr& currentZoneMaster);
 	void SyncRelayMessage(const MessageOrigin::Ptr& origin, const ConfigObject::Ptr& secobj, const Dictionary::Ptr& message, bool log);
@@ -0,0 +1,162 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/replaylogsegment.hpp"
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace icinga;
+
+/**
+ * Replay log segments start with this line. Segments written by older versions
+ * consist of netstring-encoded JSON wrappers and are still understood when replaying.
+ */
+static const char l_ReplayLogMagic[] = "icinga2-replay-log 1\n";
+
+const char *ReplayLogSegment::GetMagic()
+{
+	return l_ReplayLogMagic;
+}
+
+size_t ReplayLogSegment::GetMagicLength()
+{
+	return sizeof(l_ReplayLogMagic) - 1;
+}
+
+/**
+ * Checks whether the stream is positioned at the start of a replay log segment
+ * and skips the magic if so.
+ *
+ * @returns false for segments written by older versions.
+ */
+bool ReplayLogSegment::ReadMagic(std::istream& fp)
+{
+	char magic[sizeof(l_ReplayLogMagic) - 1];
+
+	return fp.read(magic, sizeof(magic)) && memcmp(magic, l_ReplayLogMagic, sizeof(magic)) == 0;
+}
+
+/**
+ * Positions the stream (just past the magic) at the last indexed record
+ * older than the specified timestamp.
+ */
+void ReplayLogSegment::Seek(std::istream& fp, const String& indexPath, double ts)
+{
+	std::ifstream index (indexPath.CStr(), std::ifstream::in | std::ifstream::binary);
+	std::vector<ReplayLogIndexEntry> entries;
+	ReplayLogIndexEntry entry;
+
+	while (index.read(reinterpret_cast<char *>(&entry), sizeof(entry)))
+		entries.push_back(entry);
+
+	auto it (std::lower_bound(entries.begin(), entries.end(), ts,
+		[](const ReplayLogIndexEntry& entry, double ts) { return entry.Timestamp < ts; }));
+
+	if (it == entries.begin())
+		return;
+
+	--it;
+
+	if (it->Offset >= GetMagicLength())
+		fp.seekg(it->Offset);
+}
+
+/**
+ * Checks the lengths of a record against the size limits and the rest of the file.
+ * The file may still be growing, so its size is looked up again before giving up.
+ */
+bool ReplayLogSegment::IsPlausible(const ReplayLogRecordHeader& header, std::istream& fp, std::streamoff& fileSize)
+{
+	if (header.SecobjLength > MaxSecobjLength || header.MessageLength > MaxMessageLength)
+		return false;
+
+	std::streamoff end = fp.tellg() + static_cast<std::streamoff>(header.SecobjLength) + header.MessageLength;
+
+	if (end > fileSize) {
+		std::streampos pos = fp.tellg();
+		fileSize = fp.seekg(0, std::istream::end).tellg();
+		fp.seekg(pos);
+	}
+
+	return end <= fileSize;
+}
+
+/**
+ * Reads the next record newer than the specified timestamp. Older records are
+ * skipped without reading their payload.
+ *
+ * @param fileSize The size of the segment, updated if it has grown in the meantime.
+ * @returns false on end-of-file or if the record is incomplete or corrupt. Only
+ *          in the first case the stream's eof bit is set.
+ */
+bool ReplayLogSegment::ReadRecord(std::istream& fp, std::streamoff& fileSize, double after, ReplayLogRecord& record)
+{
+	ReplayLogRecordHeader header;
+
+	for (;;) {
+		if (!fp.read(reinterpret_cast<char *>(&header), sizeof(header)))
+			return false;
+
+		if (!IsPlausible(header, fp, fileSize))
+			return false;
+
+		if (header.Timestamp > after)
+			break;
+
+		fp.seekg(static_cast<std::streamoff>(header.SecobjLength) + header.MessageLength, std::istream::cur);
+	}
+
+	record.Timestamp = header.Timestamp;
+
+	auto& secobj (record.Secobj.GetData());
+	secobj.resize(header.SecobjLength);
+
+	auto& message (record.Message.GetData());
+	message.resize(header.MessageLength);
+
+	return fp.read(&secobj[0], secobj.size()) && fp.read(&message[0], message.size());
+}
+
+/**
+ * Returns the length of the segment up to the end of its last complete record.
+ * The stream has to be positioned just past the magic.
+ */
+std::streamoff ReplayLogSegment::GetCompleteLength(std::istream& fp)
+{
+	std::streampos start = fp.tellg();
+	std::streamoff fileSize = fp.seekg(0, std::istream::end).tellg();
+	std::streamoff length = start;
+	ReplayLogRecordHeader header;
+
+	fp.seekg(start);
+
+	while (fp.read(reinterpret_cast<char *>(&header), sizeof(header)) && IsPlausible(header, fp, fileSize)) {
+		length = fp.tellg() + static_cast<std::streamoff>(header.SecobjLength) + header.MessageLength;
+		fp.seekg(length);
+	}
+
+	return length;
+}
+
+/**
+ * Drops the index entries which point beyond the specified segment length.
+ */
+void ReplayLogSegment::TruncateIndex(const String& indexPath, std::streamoff length)
+{
+	std::streamoff keep = 0;
+
+	{
+		std::ifstream index (indexPath.CStr(), std::ifstream::in | std::ifstream::binary);
+		ReplayLogIndexEntry entry;
+
+		while (index.read(reinterpret_cast<char *>(&entry), sizeof(entry)) && entry.Offset < static_cast<uint64_t>(length))
+			keep += sizeof(entry);
+	}
+
+	boost::system::error_code ec;
+
+	if (boost::filesystem::exists(indexPath.GetData(), ec))
+		boost::filesystem::resize_file(indexPath.GetData(), keep, ec);
+}
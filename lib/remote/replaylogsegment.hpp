@@ -0,0 +1,80 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef REPLAYLOGSEGMENT_H
+#define REPLAYLOGSEGMENT_H
+
+#include "remote/i2-remote.hpp"
+#include "base/string.hpp"
+#include <cstdint>
+#include <istream>
+
+namespace icinga
+{
+
+/**
+ * A record in a replay log segment. It's followed by the security object as
+ * "type\0name" (or nothing) and the already JSON-encoded message.
+ *
+ * @ingroup remote
+ */
+struct ReplayLogRecordHeader
+{
+	double Timestamp;
+	uint32_t SecobjLength;
+	uint32_t MessageLength;
+};
+
+/**
+ * An entry in the index file (<segment>.idx) next to each segment.
+ *
+ * @ingroup remote
+ */
+struct ReplayLogIndexEntry
+{
+	double Timestamp;
+	uint64_t Offset;
+};
+
+/**
+ * @ingroup remote
+ */
+struct ReplayLogRecord
+{
+	double Timestamp;
+	String Secobj;
+	String Message;
+};
+
+/**
+ * The on-disk format of the cluster replay log.
+ *
+ * @ingroup remote
+ */
+class ReplayLogSegment
+{
+public:
+	/* Every segment has an index with one entry per IndexInterval records. */
+	static const size_t IndexInterval = 1024;
+
+	/* Records claiming to be larger than this are considered corrupt. */
+	static const uint32_t MaxSecobjLength = 64 * 1024;
+	static const uint32_t MaxMessageLength = 512 * 1024 * 1024;
+
+	static const char *GetMagic();
+	static size_t GetMagicLength();
+
+	static bool ReadMagic(std::istream& fp);
+	static void Seek(std::istream& fp, const String& indexPath, double ts);
+	static bool ReadRecord(std::istream& fp, std::streamoff& fileSize, double after, ReplayLogRecord& record);
+	static std::streamoff GetCompleteLength(std::istream& fp);
+	static void TruncateIndex(const String& indexPath, std::streamoff length);
+
+private:
+	ReplayLogSegment();
+
+	static bool IsPlausible(const ReplayLogRecordHeader& header, std::istream& fp, std::streamoff& fileSize);
+};
+
+}
+
+#endif /* REPLAYLOGSEGMENT_H */
@@ -0,0 +1,111 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/logqueue.hpp"
+#include <BoostTestTargetConfig.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace icinga;
+
+static LogEntry MakeEntry(LogSeverity severity, const String& message)
+{
+	LogEntry entry;
+	entry.Timestamp = 0;
+	entry.Severity = severity;
+	entry.Facility = "test";
+	entry.Message = message;
+	return entry;
+}
+
+BOOST_AUTO_TEST_SUITE(base_logqueue)
+
+BOOST_AUTO_TEST_CASE(order)
+{
+	std::vector<String> messages;
+
+	/* The queue thread is detached and outlives the test case. */
+	auto *queue = new LogQueue(4, LogOverflowBlock, [&messages](const LogEntry& entry) {
+		BOOST_CHECK(LogQueue::IsQueueThread());
+		messages.push_back(entry.Message);
+	});
+
+	queue->Start();
+
+	std::vector<std::thread> producers;
+
+	for (int p = 0; p < 4; p++) {
+		producers.emplace_back([queue, p]() {
+			for (int i = 0; i < 1000; i++)
+				queue->Enqueue(MakeEntry(LogInformation, std::to_string(p) + ":" + std::to_string(i)));
+		});
+	}
+
+	for (auto& producer : producers)
+		producer.join();
+
+	queue->Flush();
+
+	BOOST_CHECK(!LogQueue::IsQueueThread());
+	BOOST_CHECK_EQUAL(messages.size(), 4000);
+	BOOST_CHECK_EQUAL(queue->GetDropped(), 0);
+
+	/* Entries of every single producer stay in order. */
+	std::vector<int> next(4, 0);
+
+	for (const String& message : messages) {
+		int p = std::stoi(message.SubStr(0, 1).GetData());
+		int i = std::stoi(message.SubStr(2).GetData());
+
+		BOOST_CHECK_EQUAL(i, next[p]);
+		next[p] = i + 1;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(drop)
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool release = false;
+	std::vector<String> messages;
+
+	auto *queue = new LogQueue(2, LogOverflowDropDebug, [&](const LogEntry& entry) {
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&release]() { return release; });
+		messages.push_back(entry.Message);
+	});
+
+	queue->Start();
+
+	/* One entry is held by the blocked handler, two fill the queue. */
+	for (int i = 0; i < 3; i++)
+		queue->Enqueue(MakeEntry(LogInformation, "info"));
+
+	for (int i = 0; i < 10; i++)
+		queue->Enqueue(MakeEntry(LogDebug, "debug"));
+
+	BOOST_CHECK_EQUAL(queue->GetDropped(), 10);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		release = true;
+		cv.notify_all();
+	}
+
+	queue->Enqueue(MakeEntry(LogWarning, "warning"));
+	queue->Flush();
+
+	BOOST_CHECK_EQUAL(messages.size() + queue->GetDropped(), 14);
+	BOOST_CHECK_EQUAL(messages.back(), "warning");
+}
+
+BOOST_AUTO_TEST_CASE(policy)
+{
+	BOOST_CHECK_EQUAL(LogQueue::StringToOverflowPolicy("block"), LogOverflowBlock);
+	BOOST_CHECK_EQUAL(LogQueue::StringToOverflowPolicy("drop-debug"), LogOverflowDropDebug);
+	BOOST_CHECK_EQUAL(LogQueue::StringToOverflowPolicy("drop-all"), LogOverflowDropAll);
+	BOOST_CHECK_THROW(LogQueue::StringToOverflowPolicy("ignore"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,7 +4,9 @@
 #include "base/value.hpp"
 #include "base/string.hpp"
 #include "base/array.hpp"
+#include "base/convert.hpp"
 #include "base/dictionary.hpp"
+#include "base/tlsutility.hpp"
 #include <BoostTestTargetConfig.h>
 #include <climits>
 #include <initializer_list>
@@ -96,6 +98,14 @@ static inline bool AssertPackObjectResult(Value in, std::initializer_list<int> o
 	auto actualOutput = PackObject(in);
 	bool equal = ComparePackObjectResult(actualOutput, out);
 
+	String streamedOutput;
+	PackObject(in, [&streamedOutput](const char* data, size_t length) { streamedOutput += String(data, data + length); });
+
+	if (streamedOutput != actualOutput) {
+		BOOST_TEST_MESSAGE("Streamed output differs from packed output");
+		equal = false;
+	}
+
 	if (!equal) {
 		std::ostringstream buf;
 		buf << std::setw(2) << std::setfill('0') << std::setbase(16);
@@ -261,4 +271,31 @@ BOOST_AUTO_TEST_CASE(pack_object)
 	));
 }
 
+BOOST_AUTO_TEST_CASE(pack_streamed)
+{
+	Array::Ptr objects = new Array();
+
+	for (int i = 0; i < 1000; i++) {
+		objects->Add(new Dictionary({
+			{ "name", "host-" + Convert::ToString(i) },
+			{ "vars", new Dictionary({ { "notes", String(i % 10 * 1000, 'x') } }) },
+			{ "check_interval", i * 0.5 },
+			{ "enable_active_checks", i % 2 == 0 }
+		}));
+	}
+
+	String packed = PackObject(objects);
+	String streamed;
+	size_t chunks = 0;
+
+	PackObject(objects, [&streamed, &chunks](const char* data, size_t length) {
+		streamed += String(data, data + length);
+		chunks++;
+	});
+
+	BOOST_CHECK(streamed == packed);
+	BOOST_CHECK(chunks > 1);
+	BOOST_CHECK_EQUAL(SHA1PackObject(objects), SHA1(packed));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,62 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/workqueue.hpp"
+#include <BoostTestTargetConfig.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_workqueue)
+
+BOOST_AUTO_TEST_CASE(join)
+{
+	WorkQueue wq (0, 4);
+	wq.SetName("Test");
+
+	std::atomic<int> count (0);
+
+	for (int i = 0; i < 1000; i++)
+		wq.Enqueue([&count]() { count++; });
+
+	wq.Join();
+
+	BOOST_CHECK_EQUAL(count.load(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(join_stop_nested)
+{
+	WorkQueue wq (0, 4);
+	wq.SetName("Test");
+
+	std::atomic<int> count (0);
+
+	/* Every task enqueues more tasks while Join() is already waiting. */
+	for (int i = 0; i < 100; i++) {
+		wq.Enqueue([&wq, &count]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			wq.Enqueue([&wq, &count]() {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+				wq.Enqueue([&count]() { count++; });
+				count++;
+			});
+
+			count++;
+		});
+	}
+
+	wq.Join(true);
+
+	BOOST_CHECK_EQUAL(count.load(), 300);
+
+	/* The queue can be used again after it has been stopped. */
+	wq.Enqueue([&count]() { count++; });
+	wq.Join(true);
+
+	BOOST_CHECK_EQUAL(count.load(), 301);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/array.hpp"
+#include "base/convert.hpp"
+#include "base/dictionary.hpp"
+#include "base/object-packer.hpp"
+#include "base/tlsutility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <chrono>
+#include <vector>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(bench_base_object_packer)
+
+static const size_t l_Rounds = 10;
+
+/* Shaped like the config and state attributes the Icinga DB feature hashes for hosts and services. */
+static std::vector<Value> MakeObjects()
+{
+	std::vector<Value> objects;
+
+	for (int i = 0; i < 10000; i++) {
+		String host = "web-" + Convert::ToString(i / 10) + ".example.com";
+
+		objects.emplace_back(new Dictionary({
+			{ "name", i % 10 ? "disk-" + Convert::ToString(i % 10) : host },
+			{ "display_name", i % 10 ? "Disk " + Convert::ToString(i % 10) : host },
+			{ "checkcommand", i % 10 ? "disk" : "hostalive" },
+			{ "max_check_attempts", 3 },
+			{ "check_timeout", Empty },
+			{ "check_interval", 60 },
+			{ "check_retry_interval", 30 },
+			{ "active_checks_enabled", true },
+			{ "passive_checks_enabled", true },
+			{ "notifications_enabled", true },
+			{ "flapping_threshold_low", 25 },
+			{ "flapping_threshold_high", 30 },
+			{ "notes", "Managed by the infrastructure team, see the runbook for escalation paths." },
+			{ "zone", "master" }
+		}));
+
+		objects.emplace_back(new Array({
+			"f1a3c9c8e7bb0e8c1e0ebc4f6b1f3f1a7b2c9d0e",
+			"disks",
+			new Dictionary({
+				{ "disk /", new Dictionary({ { "disk_partitions", "/" }, { "disk_wfree", "20%" }, { "disk_cfree", "10%" } }) },
+				{ "disk /var", new Dictionary({ { "disk_partitions", "/var" }, { "disk_wfree", "15%" }, { "disk_cfree", "5%" } }) }
+			})
+		}));
+
+		objects.emplace_back(new Dictionary({
+			{ "state", i % 4 ? 0 : 2 },
+			{ "state_type", 1 },
+			{ "check_attempt", 1 },
+			{ "output", "DISK OK - free space: / 3326 MB (56% inode=99%);" },
+			{ "performance_data", "/=2643MB;5948;6691;0;7435 /boot=68MB;88;99;0;110" },
+			{ "execution_time", 0.012 },
+			{ "latency", 0.001 },
+			{ "last_update", 1600000000000.0 + i }
+		}));
+	}
+
+	return objects;
+}
+
+static void Report(const char *name, size_t objects, std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_TEST_MESSAGE(name << ": " << objects << " values in " << elapsed.count() << "s ("
+		<< objects / elapsed.count() << " values/s)");
+}
+
+BOOST_AUTO_TEST_CASE(pack_then_sha1)
+{
+	std::vector<Value> objects = MakeObjects();
+	size_t hashes = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < l_Rounds; i++) {
+		for (const Value& object : objects) {
+			SHA1(PackObject(object));
+			hashes++;
+		}
+	}
+
+	Report("pack_then_sha1", hashes, start);
+}
+
+BOOST_AUTO_TEST_CASE(streamed_sha1)
+{
+	std::vector<Value> objects = MakeObjects();
+	size_t hashes = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < l_Rounds; i++) {
+		for (const Value& object : objects) {
+			SHA1PackObject(object);
+			hashes++;
+		}
+	}
+
+	Report("streamed_sha1", hashes, start);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/process.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#ifndef _WIN32
+#	include <sys/resource.h>
+#endif /* _WIN32 */
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(bench_base_process)
+
+#ifndef _WIN32
+static void BenchmarkProcesses(const Process::Arguments& arguments, size_t count)
+{
+	/* Every running process holds one pipe FD in the IO threads. */
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < count + 1024) {
+		rl.rlim_cur = std::min<rlim_t>(rl.rlim_max, count + 1024);
+		(void)setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<double> latencies;
+	size_t failed = 0;
+
+	latencies.reserve(count);
+
+	std::vector<Process::Ptr> processes;
+	processes.reserve(count);
+
+	double start = Utility::GetTime();
+
+	for (size_t i = 0; i < count; i++) {
+		Process::Ptr process = new Process(arguments);
+		process->SetTimeout(300);
+
+		process->Run([&mutex, &cv, &latencies, &failed](const ProcessResult& pr) {
+			double now = Utility::GetTime();
+
+			std::unique_lock<std::mutex> lock(mutex);
+
+			if (pr.ExitStatus != 0)
+				failed++;
+
+			latencies.push_back(now - pr.ExecutionStart);
+			cv.notify_all();
+		});
+
+		processes.emplace_back(std::move(process));
+	}
+
+	double spawned = Utility::GetTime() - start;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&latencies, count]() { return latencies.size() == count; });
+	}
+
+	double elapsed = Utility::GetTime() - start;
+
+	std::sort(latencies.begin(), latencies.end());
+
+	BOOST_TEST_MESSAGE(Process::PrettyPrintArguments(arguments) << " x " << count << ": spawned in " << spawned
+		<< "s, all done in " << elapsed << "s (" << count / elapsed << "/s), failed: " << failed
+		<< ", latency p50: " << latencies[count / 2] << "s, p99: " << latencies[count * 99 / 100]
+		<< "s, max: " << latencies.back() << "s");
+
+	BOOST_CHECK_EQUAL(failed, 0);
+}
+
+BOOST_AUTO_TEST_CASE(echo_10k)
+{
+	BenchmarkProcesses({ "/bin/echo", "OK - benchmark" }, 10000);
+}
+
+BOOST_AUTO_TEST_CASE(sleep_10k)
+{
+	BenchmarkProcesses({ "/bin/sleep", "1" }, 10000);
+}
+#endif /* _WIN32 */
+
+BOOST_AUTO_TEST_SUITE_END()
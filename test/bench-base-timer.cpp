@@ -0,0 +1,62 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/timer.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(bench_base_timer)
+
+static void BenchmarkReschedule(size_t liveTimers, size_t reschedules)
+{
+	std::vector<Timer::Ptr> timers;
+	timers.reserve(liveTimers);
+
+	std::mt19937 rng (42);
+	std::uniform_real_distribution<double> offset (60, 86400);
+	std::uniform_int_distribution<size_t> pick (0, liveTimers - 1);
+
+	double now = Utility::GetTime();
+
+	for (size_t i = 0; i < liveTimers; i++) {
+		Timer::Ptr timer = new Timer();
+		timer->SetInterval(86400);
+		timer->Start();
+		timer->Reschedule(now + offset(rng));
+		timers.emplace_back(std::move(timer));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < reschedules; i++)
+		timers[pick(rng)]->Reschedule(now + offset(rng));
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_TEST_MESSAGE(liveTimers << " live timers: " << reschedules << " reschedules in " << elapsed.count()
+		<< "s (" << reschedules / elapsed.count() << "/s)");
+
+	for (auto& timer : timers)
+		timer->Stop();
+}
+
+BOOST_AUTO_TEST_CASE(reschedule_1k)
+{
+	BenchmarkReschedule(1000, 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(reschedule_100k)
+{
+	BenchmarkReschedule(100000, 1000000);
+}
+
+BOOST_AUTO_TEST_CASE(reschedule_1m)
+{
+	BenchmarkReschedule(1000000, 1000000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
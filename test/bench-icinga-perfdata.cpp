@@ -0,0 +1,70 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/objectlock.hpp"
+#include "base/perfdatavalue.hpp"
+#include "icinga/checkresult.hpp"
+#include "icinga/pluginutility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <chrono>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(bench_icinga_perfdata)
+
+/* Output as produced by check_disk, check_ping and check_mysql_health. */
+static const char * const l_PluginOutputs[] = {
+	"/=2643MB;5948;6691;0;7435 /boot=68MB;88;99;0;110 /home=69357MB;253404;285080;0;316756 /var/log=818MB;970;1091;0;1213",
+	"rta=0.042000ms;100.000000;500.000000;0.000000 pl=0%;5;10;0",
+	"'connection_time'=0.01;1;5 'uptime'=1738201s;10:;5: 'threads_connected'=12;10;20 'threadcache_hitrate'=99.93%;90:;80: "
+		"'threadcache_hitrate_now'=100.00%;90:;80: 'connects_per_sec'=0.07;;"
+};
+
+static void BenchmarkParse(size_t checkResults, size_t writers)
+{
+	size_t values = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < checkResults; i++) {
+		Array::Ptr perfdata = PluginUtility::SplitPerfdata(l_PluginOutputs[i % (sizeof(l_PluginOutputs) / sizeof(l_PluginOutputs[0]))]);
+
+		if (writers == 0) {
+			ObjectLock olock(perfdata);
+
+			for (const Value& val : perfdata) {
+				PerfdataValue::Ptr pdv = PerfdataValue::Parse(val);
+				values++;
+			}
+
+			continue;
+		}
+
+		CheckResult::Ptr cr = new CheckResult();
+		cr->SetPerformanceData(perfdata);
+
+		for (size_t j = 0; j < writers; j++)
+			values += cr->GetParsedPerfdata()->GetLength();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_TEST_MESSAGE(checkResults << " check results, " << writers << " writers: " << values << " values in "
+		<< elapsed.count() << "s (" << checkResults / elapsed.count() << " check results/s)");
+}
+
+BOOST_AUTO_TEST_CASE(split_and_parse)
+{
+	BenchmarkParse(100000, 0);
+}
+
+BOOST_AUTO_TEST_CASE(cached_1_writer)
+{
+	BenchmarkParse(100000, 1);
+}
+
+BOOST_AUTO_TEST_CASE(cached_4_writers)
+{
+	BenchmarkParse(100000, 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
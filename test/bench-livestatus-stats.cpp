@@ -0,0 +1,153 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "livestatus/livestatusquery.hpp"
+#include "config/configcompiler.hpp"
+#include "config/configitem.hpp"
+#include "base/convert.hpp"
+#include "base/fifo.hpp"
+#include "base/function.hpp"
+#include "base/json.hpp"
+#include "base/scriptframe.hpp"
+#include <BoostTestTargetConfig.h>
+#include <chrono>
+#include <vector>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(bench_livestatus_stats)
+
+static const size_t l_Rounds = 5;
+
+/* 2000 hosts with 100 services each */
+static void CreateObjects()
+{
+	String config = R"CONFIG(
+object CheckCommand "bench-dummy" {
+  command = "/bin/echo"
+}
+
+for (i in range(2000)) {
+  object Host "bench-" + i {
+    check_command = "bench-dummy"
+  }
+}
+
+apply Service "disk-" for (i in range(100)) {
+  check_command = "bench-dummy"
+  assign where match("bench-*", host.name)
+}
+)CONFIG";
+
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<bench-livestatus-stats>", config);
+	expr->Evaluate(*ScriptFrame::GetCurrentFrame());
+}
+
+static void EnsureObjects()
+{
+	static bool created = false;
+
+	if (!created) {
+		BOOST_TEST_MESSAGE("Preparing 200000 services...");
+		ConfigItem::RunWithActivationContext(new Function("CreateObjects", CreateObjects));
+		created = true;
+	}
+}
+
+/* The kind of query a dashboard sends for its service state overview */
+static std::vector<String> MakeStatsQuery(const String& groupBy)
+{
+	std::vector<String> lines;
+	lines.emplace_back("GET services");
+
+	if (!groupBy.IsEmpty())
+		lines.emplace_back("Columns: " + groupBy);
+
+	for (int state = 0; state < 4; state++) {
+		lines.emplace_back("Stats: state = " + Convert::ToString(state));
+		lines.emplace_back("Stats: state = " + Convert::ToString(state));
+		lines.emplace_back("Stats: acknowledged = 0");
+		lines.emplace_back("StatsAnd: 2");
+		lines.emplace_back("Stats: state = " + Convert::ToString(state));
+		lines.emplace_back("Stats: scheduled_downtime_depth = 0");
+		lines.emplace_back("StatsAnd: 2");
+	}
+
+	lines.emplace_back("Stats: sum latency");
+	lines.emplace_back("Stats: avg latency");
+	lines.emplace_back("Stats: max execution_time");
+	lines.emplace_back("Stats: std execution_time");
+	lines.emplace_back("Stats: has_been_checked = 1");
+	lines.emplace_back("Stats: checks_enabled = 1");
+	lines.emplace_back("Stats: notifications_enabled = 1");
+	lines.emplace_back("Stats: is_flapping = 1");
+	lines.emplace_back("OutputFormat: json");
+
+	return lines;
+}
+
+/* Runs the query a few times and returns the last response */
+static String RunStatsQuery(const char *name, const std::vector<String>& lines, bool batched)
+{
+	EnsureObjects();
+
+	String body;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < l_Rounds; i++) {
+		FIFO::Ptr response = new FIFO();
+
+		LivestatusQuery::Ptr query = new LivestatusQuery(lines, "");
+		query->SetBatchedStats(batched);
+		query->Execute(response);
+
+		std::string data (response->GetAvailableBytes(), '\0');
+		response->Read(&data[0], data.size());
+		body = data;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_CHECK(!body.IsEmpty());
+	BOOST_TEST_MESSAGE(name << (batched ? " batched" : " row by row") << ": " << l_Rounds << " queries in " << elapsed.count() << "s ("
+		<< elapsed.count() / l_Rounds << "s per query, " << body.GetLength() << " bytes)");
+
+	return body;
+}
+
+/* Both ways of aggregating have to agree, apart from rounding. */
+static void CompareStatsQuery(const char *name, const std::vector<String>& lines)
+{
+	Array::Ptr rows = JsonDecode(RunStatsQuery(name, lines, false));
+	Array::Ptr batches = JsonDecode(RunStatsQuery(name, lines, true));
+
+	BOOST_REQUIRE_EQUAL(rows->GetLength(), batches->GetLength());
+
+	for (Array::SizeType i = 0; i < rows->GetLength(); i++) {
+		Array::Ptr row = rows->Get(i);
+		Array::Ptr batch = batches->Get(i);
+
+		BOOST_REQUIRE_EQUAL(row->GetLength(), batch->GetLength());
+
+		for (Array::SizeType j = 0; j < row->GetLength(); j++) {
+			Value value = row->Get(j);
+
+			if (value.IsNumber())
+				BOOST_CHECK_CLOSE(static_cast<double>(value), static_cast<double>(batch->Get(j)), 0.0001);
+			else
+				BOOST_CHECK_EQUAL(value, batch->Get(j));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(stats_20_lines)
+{
+	CompareStatsQuery("stats_20_lines", MakeStatsQuery(""));
+}
+
+BOOST_AUTO_TEST_CASE(stats_20_lines_by_host)
+{
+	CompareStatsQuery("stats_20_lines_by_host", MakeStatsQuery("host_name"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,121 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "perfdata/influxdbcommonwriter.hpp"
+#include "base/objectlock.hpp"
+#include <BoostTestTargetConfig.h>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(bench_perfdata_influxdb)
+
+static const size_t l_DataPoints = 1000000;
+
+/* Serialization as done before the data points were appended to a single buffer. */
+static String LegacyEscape(const String& str)
+{
+	String result = str;
+	boost::algorithm::replace_all(result, "\"", "\\\"");
+	boost::algorithm::replace_all(result, "=", "\\=");
+	boost::algorithm::replace_all(result, ",", "\\,");
+	boost::algorithm::replace_all(result, " ", "\\ ");
+
+	return result;
+}
+
+static Dictionary::Ptr MakeFields(size_t i)
+{
+	return new Dictionary({
+		{ "crit", 500 },
+		{ "min", 0 },
+		{ "unit", "ms" },
+		{ "value", i * 0.042 },
+		{ "warn", 100 }
+	});
+}
+
+static void Report(const char *name, size_t bytes, std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_TEST_MESSAGE(name << ": " << l_DataPoints << " data points, " << bytes << " bytes in "
+		<< elapsed.count() << "s (" << l_DataPoints / elapsed.count() << " data points/s)");
+}
+
+BOOST_AUTO_TEST_CASE(legacy_join)
+{
+	Dictionary::Ptr tags = new Dictionary({
+		{ "hostname", "web server 01" },
+		{ "service", "ping4" }
+	});
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<String> lines;
+
+	for (size_t i = 0; i < l_DataPoints; i++) {
+		Dictionary::Ptr fields = MakeFields(i);
+
+		std::ostringstream msgbuf;
+		msgbuf << LegacyEscape("ping4");
+
+		{
+			ObjectLock olock(tags);
+			for (const Dictionary::Pair& pair : tags)
+				msgbuf << "," << LegacyEscape(pair.first) << "=" << LegacyEscape(pair.second);
+		}
+
+		msgbuf << ",metric=" << LegacyEscape("rta") << " ";
+
+		bool first = true;
+
+		ObjectLock olock(fields);
+		for (const Dictionary::Pair& pair : fields) {
+			if (first)
+				first = false;
+			else
+				msgbuf << ",";
+
+			msgbuf << LegacyEscape(pair.first) << "=";
+
+			if (pair.second.IsString())
+				msgbuf << "\"" << LegacyEscape(pair.second) << "\"";
+			else
+				msgbuf << static_cast<String>(pair.second);
+		}
+
+		msgbuf << " " << 1600000000ul + i;
+		lines.emplace_back(msgbuf.str());
+	}
+
+	String body = boost::algorithm::join(lines, "\n");
+
+	Report("legacy_join", body.GetLength(), start);
+}
+
+BOOST_AUTO_TEST_CASE(append_buffer)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::string prefix;
+	InfluxdbCommonWriter::AppendKeyOrTagValue(prefix, "ping4");
+	prefix += ",hostname=";
+	InfluxdbCommonWriter::AppendKeyOrTagValue(prefix, "web server 01");
+	prefix += ",service=";
+	InfluxdbCommonWriter::AppendKeyOrTagValue(prefix, "ping4");
+
+	std::string buffer;
+
+	for (size_t i = 0; i < l_DataPoints; i++)
+		InfluxdbCommonWriter::AppendDataPoint(buffer, prefix, "rta", MakeFields(i), 1600000000ul + i);
+
+	String body (std::move(buffer));
+
+	Report("append_buffer", body.GetLength(), start);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/applyrule.hpp"
+#include "config/configcompiler.hpp"
+#include <BoostTestTargetConfig.h>
+#include <algorithm>
+
+using namespace icinga;
+
+static void AddTestRule(const String& type, const String& name, const String& filter, const String& fkvar = String())
+{
+	String forSpec;
+
+	if (!fkvar.IsEmpty())
+		forSpec = " for (" + fkvar + " in [])";
+
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>",
+		"apply " + type + " \"" + name + "\"" + forSpec + " { assign where " + filter + " }");
+
+	ScriptFrame frame(true);
+	expr->Evaluate(frame);
+}
+
+static std::vector<String> GetCandidateNames(const String& type, const Dictionary::Ptr& host)
+{
+	std::vector<String> names;
+
+	for (ApplyRule *rule : ApplyRule::GetCandidateRules(type, new Dictionary({ { "host", host } })))
+		names.push_back(rule->GetName());
+
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+BOOST_AUTO_TEST_SUITE(config_apply)
+
+BOOST_AUTO_TEST_CASE(candidates)
+{
+	String type = "ConfigApplyCandidatesTest";
+
+	ApplyRule::RegisterType(type, { "Host" });
+
+	AddTestRule(type, "equal", "host.vars.os == \"Linux\"");
+	AddTestRule(type, "equal_reverse", "\"Windows\" == host.vars.os");
+	AddTestRule(type, "in", "\"linux-servers\" in host.groups");
+	AddTestRule(type, "match", "match(\"WEB*\", host.name)");
+	AddTestRule(type, "or", "host.vars.os == \"BSD\" || match(\"db?\", host.name)");
+	AddTestRule(type, "and", "host.vars.os == \"Linux\" && host.vars.env != \"test\"");
+	AddTestRule(type, "unindexed", "host.vars.cores > 4");
+	AddTestRule(type, "partial_or", "host.vars.os == \"BSD\" || host.vars.cores > 4");
+	AddTestRule(type, "shadowed", "host.vars.os == \"BSD\"", "host");
+
+	Dictionary::Ptr web = new Dictionary({
+		{ "name", "web1" },
+		{ "groups", new Array({ "linux-servers" }) },
+		{ "vars", new Dictionary({ { "os", "Linux" } }) }
+	});
+
+	BOOST_CHECK((GetCandidateNames(type, web) == std::vector<String>{ "and", "equal", "in", "match", "partial_or", "shadowed", "unindexed" }));
+
+	Dictionary::Ptr db = new Dictionary({
+		{ "name", "db1" },
+		{ "vars", new Dictionary({ { "os", "Windows" } }) }
+	});
+
+	BOOST_CHECK((GetCandidateNames(type, db) == std::vector<String>{ "equal_reverse", "or", "partial_or", "shadowed", "unindexed" }));
+
+	/* Non-string values are left to the full evaluation. */
+	Dictionary::Ptr odd = new Dictionary({
+		{ "name", 42 },
+		{ "groups", "linux-servers" },
+		{ "vars", new Dictionary({ { "os", true } }) }
+	});
+
+	BOOST_CHECK((GetCandidateNames(type, odd) == std::vector<String>{ "and", "equal", "equal_reverse", "in", "match", "or", "partial_or", "shadowed", "unindexed" }));
+
+	/* New rules invalidate the index. */
+	AddTestRule(type, "added", "host.vars.os == \"Windows\"");
+
+	BOOST_CHECK((GetCandidateNames(type, db) == std::vector<String>{ "added", "equal_reverse", "or", "partial_or", "shadowed", "unindexed" }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,245 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "icinga/compatlogindex.hpp"
+#include "base/utility.hpp"
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <BoostTestTargetConfig.h>
+#include <fstream>
+#include <iterator>
+
+using namespace icinga;
+
+/* A compat log directory which is removed again after the test */
+struct CompatLogIndexFixture
+{
+	String Path;
+
+	CompatLogIndexFixture()
+	{
+		Path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("icinga2-compatlog-%%%%-%%%%")).string();
+		Utility::MkDirP(Path, 0750);
+	}
+
+	~CompatLogIndexFixture()
+	{
+		if (Utility::PathExists(Path))
+			Utility::RemoveDirRecursive(Path);
+	}
+
+	String GetLogPath() const
+	{
+		return Path + "/icinga.log";
+	}
+
+	uintmax_t GetIndexSize() const
+	{
+		return boost::filesystem::file_size(CompatLogIndex::GetIndexPath(GetLogPath()).GetData());
+	}
+
+	/* Appends to the log file and its index the same way CompatLogger does. */
+	void WriteLog(CompatLogIndex& index, const String& text) const
+	{
+		std::ofstream fp (GetLogPath().CStr(), std::ofstream::app | std::ofstream::binary);
+		uint64_t offset = fp.seekp(0, std::ofstream::end).tellp();
+
+		fp << text;
+		fp.close();
+
+		index.Append(text, offset);
+		index.Flush();
+	}
+
+	void WriteLog(const String& text) const
+	{
+		std::ofstream fp (GetLogPath().CStr(), std::ofstream::app | std::ofstream::binary);
+		fp << text;
+	}
+};
+
+static const char l_Lines[] =
+	"[1600000000] LOG VERSION: 2.0\n"
+	"[1600000001] CURRENT HOST STATE: test-01;UP;HARD;1;OK\n"
+	"\n"
+	"[1600000002] SERVICE ALERT: test-01;livestatus;CRITICAL;SOFT;1;failed\n"
+	"[1600000003] HOST NOTIFICATION: admin;test-01;PROBLEM;DOWN;mail;down\n";
+
+static void CheckPartition(const CompatLogPartition& partition)
+{
+	BOOST_REQUIRE_GE(partition.GetSize(), 4u);
+
+	BOOST_CHECK_EQUAL(partition.Time[0], 1600000000);
+	BOOST_CHECK_EQUAL(partition.Class[0], LogEntryClassProgram);
+	BOOST_CHECK_EQUAL(partition.HostName[0], CompatLogIndex::NoString);
+
+	BOOST_CHECK_EQUAL(partition.GetString(partition.HostName[1]), "test-01");
+	BOOST_CHECK_EQUAL(partition.ServiceDescription[1], CompatLogIndex::NoString);
+	BOOST_CHECK_EQUAL(partition.LogType[1], LogEntryTypeHostCurrentState);
+
+	BOOST_CHECK_EQUAL(partition.HostName[2], partition.HostName[1]);
+	BOOST_CHECK_EQUAL(partition.GetString(partition.ServiceDescription[2]), "livestatus");
+	BOOST_CHECK_EQUAL(partition.GetString(partition.StateType[2]), "SOFT");
+	BOOST_CHECK_EQUAL(partition.GetString(partition.Type[2]), "SERVICE ALERT");
+	BOOST_CHECK_EQUAL(partition.State[2], 2);
+	BOOST_CHECK_EQUAL(partition.Attempt[2], 1);
+	BOOST_CHECK_EQUAL(partition.Class[2], LogEntryClassAlert);
+	BOOST_CHECK_EQUAL(partition.LogType[2], LogEntryTypeServiceAlert);
+
+	BOOST_CHECK_EQUAL(partition.Class[3], LogEntryClassNotification);
+
+	/* Empty lines don't count, just like the lineno column. */
+	BOOST_CHECK_EQUAL(partition.ReadLine(2), "[1600000002] SERVICE ALERT: test-01;livestatus;CRITICAL;SOFT;1;failed");
+	BOOST_CHECK_EQUAL(partition.ReadLine(0), "[1600000000] LOG VERSION: 2.0");
+	BOOST_CHECK_EQUAL(partition.ReadLine(3), "[1600000003] HOST NOTIFICATION: admin;test-01;PROBLEM;DOWN;mail;down");
+
+	uint32_t id;
+	BOOST_CHECK(partition.FindString("test-01", id));
+	BOOST_CHECK_EQUAL(id, partition.HostName[1]);
+	BOOST_CHECK(!partition.FindString("test-02", id));
+}
+
+BOOST_FIXTURE_TEST_SUITE(icinga_compatlogindex, CompatLogIndexFixture)
+
+BOOST_AUTO_TEST_CASE(append)
+{
+	WriteLog("");
+
+	CompatLogIndex index;
+	index.Open(GetLogPath());
+	WriteLog(index, l_Lines);
+	index.Close();
+
+	CompatLogPartition partition;
+	BOOST_REQUIRE(partition.Load(GetLogPath(), false));
+	BOOST_CHECK_EQUAL(partition.GetSize(), 4u);
+	CheckPartition(partition);
+	BOOST_CHECK_EQUAL(partition.GetEnd(), sizeof(l_Lines) - 1);
+}
+
+BOOST_AUTO_TEST_CASE(reopen)
+{
+	WriteLog("");
+
+	CompatLogIndex index;
+	index.Open(GetLogPath());
+	WriteLog(index, "[1600000000] LOG VERSION: 2.0\n[1600000001] CURRENT HOST STATE: test-01;UP;HARD;1;OK\n\n");
+	index.Close();
+
+	/* The strings which are already in the index are reused. */
+	index.Open(GetLogPath());
+	WriteLog(index, "[1600000002] SERVICE ALERT: test-01;livestatus;CRITICAL;SOFT;1;failed\n"
+		"[1600000003] HOST NOTIFICATION: admin;test-01;PROBLEM;DOWN;mail;down\n");
+	index.Close();
+
+	CompatLogPartition partition;
+	BOOST_REQUIRE(partition.Load(GetLogPath(), false));
+	CheckPartition(partition);
+}
+
+BOOST_AUTO_TEST_CASE(catch_up)
+{
+	WriteLog("");
+
+	CompatLogIndex index;
+	index.Open(GetLogPath());
+	WriteLog(index, "[1600000000] LOG VERSION: 2.0\n[1600000001] CURRENT HOST STATE: test-01;UP;HARD;1;OK\n");
+	index.Close();
+
+	uintmax_t indexSize = GetIndexSize();
+
+	/* Lines which weren't indexed yet and a partial last line */
+	WriteLog("\n[1600000002] SERVICE ALERT: test-01;livestatus;CRITICAL;SOFT;1;failed\n"
+		"[1600000003] HOST NOTIFICATION: admin;test-01;PROBLEM;DOWN;mail;down\n[16000");
+
+	CompatLogPartition partition;
+	BOOST_REQUIRE(partition.Load(GetLogPath(), false));
+	BOOST_CHECK_EQUAL(partition.GetSize(), 4u);
+	CheckPartition(partition);
+	BOOST_CHECK_EQUAL(partition.GetEnd(), sizeof(l_Lines) - 1);
+
+	/* Only archives get their index updated by readers. */
+	BOOST_CHECK_EQUAL(GetIndexSize(), indexSize);
+}
+
+BOOST_AUTO_TEST_CASE(torn_tail)
+{
+	WriteLog("");
+
+	CompatLogIndex index;
+	index.Open(GetLogPath());
+	WriteLog(index, l_Lines);
+	index.Close();
+
+	String indexPath = CompatLogIndex::GetIndexPath(GetLogPath());
+	std::string data;
+
+	{
+		std::ifstream fp (indexPath.CStr(), std::ifstream::in | std::ifstream::binary);
+		data.assign(std::istreambuf_iterator<char>(fp), std::istreambuf_iterator<char>());
+	}
+
+	{
+		std::ofstream fp (indexPath.CStr(), std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+		fp.write(data.c_str(), data.size() - sizeof(CompatLogIndexRecord) / 2);
+	}
+
+	CompatLogPartition partition;
+	BOOST_REQUIRE(partition.Load(GetLogPath(), false));
+	CheckPartition(partition);
+
+	/* Reopening rewrites the index, it's complete again. */
+	index.Open(GetLogPath());
+	index.Close();
+
+	BOOST_CHECK_EQUAL(GetIndexSize(), data.size());
+}
+
+BOOST_AUTO_TEST_CASE(replaced_log)
+{
+	WriteLog("");
+
+	CompatLogIndex index;
+	index.Open(GetLogPath());
+	/* The same lines, one day earlier */
+	WriteLog(index, boost::algorithm::replace_all_copy(std::string(l_Lines), "[16", "[15"));
+	index.Close();
+
+	/* The log file was rotated, but its index wasn't. */
+	Utility::Remove(GetLogPath());
+	WriteLog(l_Lines);
+
+	CompatLogPartition partition;
+	BOOST_REQUIRE(partition.Load(GetLogPath(), false));
+	CheckPartition(partition);
+}
+
+BOOST_AUTO_TEST_CASE(persist)
+{
+	WriteLog(l_Lines);
+	WriteLog("[1600000004] x\n[16\n");
+
+	String indexPath = CompatLogIndex::GetIndexPath(GetLogPath());
+
+	{
+		CompatLogPartition partition;
+		BOOST_REQUIRE(partition.Load(GetLogPath(), true));
+		BOOST_CHECK_EQUAL(partition.GetSize(), 6u);
+	}
+
+	BOOST_CHECK(Utility::PathExists(indexPath));
+
+	/* The index doesn't cover this line, it's parsed. */
+	WriteLog("[1600000005] LOG VERSION: 2.0\n");
+
+	CompatLogPartition partition;
+	BOOST_REQUIRE(partition.Load(GetLogPath(), false));
+	BOOST_REQUIRE_EQUAL(partition.GetSize(), 7u);
+	CheckPartition(partition);
+
+	/* Lines which are too short to be parsed are kept, they count for lineno. */
+	BOOST_CHECK_EQUAL(partition.ReadLine(5), "[16");
+	BOOST_CHECK_EQUAL(partition.Class[5], LogEntryClassInfo);
+	BOOST_CHECK_EQUAL(partition.Time[6], 1600000005);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 
 #include "base/perfdatavalue.hpp"
 #include "icinga/pluginutility.hpp"
+#include "icinga/checkresult.hpp"
 #include <BoostTestTargetConfig.h>
 
 using namespace icinga;
@@ -389,4 +390,29 @@ BOOST_AUTO_TEST_CASE(parse_edgecases)
 	BOOST_CHECK(pv->GetUnit() == "bytes");
 }
 
+BOOST_AUTO_TEST_CASE(checkresult_cache)
+{
+	CheckResult::Ptr cr = new CheckResult();
+	cr->SetPerformanceData(PluginUtility::SplitPerfdata("'time'=1.5s;2;3;0 size=10B invalid=x"));
+
+	auto pd = cr->GetParsedPerfdata();
+	BOOST_CHECK(pd->GetLength() == 2);
+	BOOST_CHECK(pd->Labels[0] == "time");
+	BOOST_CHECK(pd->Values[0] == 1.5);
+	BOOST_CHECK(pd->Units[0] == "seconds");
+	BOOST_CHECK(pd->Warn[0] == 2);
+	BOOST_CHECK(pd->Crit[0] == 3);
+	BOOST_CHECK(pd->Min[0] == 0);
+	BOOST_CHECK(pd->Max[0].IsEmpty());
+	BOOST_CHECK(pd->Labels[1] == "size");
+	BOOST_CHECK(pd->Units[1] == "bytes");
+	BOOST_CHECK(pd->Invalid.size() == 1);
+
+	BOOST_CHECK(cr->GetParsedPerfdata() == pd);
+
+	cr->SetPerformanceData(PluginUtility::SplitPerfdata("other=1"));
+	BOOST_CHECK(cr->GetParsedPerfdata() != pd);
+	BOOST_CHECK(cr->GetParsedPerfdata()->Labels[0] == "other");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,16 +1,26 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "livestatus/livestatusquery.hpp"
+#include "icinga/host.hpp"
+#include "icinga/service.hpp"
 #include "base/application.hpp"
+#include "base/convert.hpp"
+#include "base/objectlock.hpp"
 #include "base/stdiostream.hpp"
 #include "base/json.hpp"
+#include "base/utility.hpp"
 #include <BoostTestTargetConfig.h>
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 
 using namespace icinga;
 
-String LivestatusQueryHelper(const std::vector<String>& lines)
+String LivestatusQueryHelper(const std::vector<String>& lines, const String& compat_log_path = "", bool batchedStats = true)
 {
-	LivestatusQuery::Ptr query = new LivestatusQuery(lines, "");
+	LivestatusQuery::Ptr query = new LivestatusQuery(lines, compat_log_path);
+	query->SetBatchedStats(batchedStats);
 
 	std::stringstream stream;
 	StdioStream::Ptr sstream = new StdioStream(&stream, false);
@@ -41,6 +51,258 @@ String LivestatusQueryHelper(const std::vector<String>& lines)
 	return output;
 }
 
+/* The rows of a JSON result in a stable order, livestatus doesn't sort them. */
+static std::vector<String> LivestatusRowsHelper(const std::vector<String>& lines, const String& compat_log_path = "")
+{
+	Array::Ptr result = JsonDecode(LivestatusQueryHelper(lines, compat_log_path));
+	std::vector<String> rows;
+
+	ObjectLock olock(result);
+	for (const Value& row : result) {
+		rows.push_back(JsonEncode(row));
+	}
+
+	std::sort(rows.begin(), rows.end());
+
+	return rows;
+}
+
+/* The filter lines have to leave exactly one filter on the stack. Wrapping it
+ * into a single Or doesn't change the result, but hides it from the index.
+ */
+static std::vector<String> FilteredRowsHelper(const String& table, const std::vector<String>& filter, bool useIndex)
+{
+	std::vector<String> lines;
+	lines.emplace_back("GET " + table);
+	lines.emplace_back(table == "hosts" ? "Columns: host_name state acknowledged" : "Columns: host_name description state acknowledged");
+	lines.emplace_back("OutputFormat: json");
+	lines.insert(lines.end(), filter.begin(), filter.end());
+
+	if (!useIndex)
+		lines.emplace_back("Or: 1");
+
+	lines.emplace_back("\n");
+
+	return LivestatusRowsHelper(lines);
+}
+
+static std::vector<String> SelectRows(const std::vector<String>& rows, const std::function<bool (const Array::Ptr&)>& predicate)
+{
+	std::vector<String> result;
+
+	for (const String& row : rows) {
+		if (predicate(JsonDecode(row)))
+			result.push_back(row);
+	}
+
+	return result;
+}
+
+/* test-02's service is critical, test-01's service stays unknown. test-01 and its service are acknowledged. */
+static void PrepareServiceStates()
+{
+	static bool prepared = false;
+
+	if (prepared)
+		return;
+
+	prepared = true;
+
+	Service::Ptr critical = Service::GetByNamePair("test-02", "livestatus");
+	BOOST_REQUIRE(critical);
+
+	CheckResult::Ptr cr = new CheckResult();
+	cr->SetState(ServiceCritical);
+	critical->ProcessCheckResult(cr);
+
+	BOOST_REQUIRE_EQUAL(critical->GetState(), ServiceCritical);
+
+	Service::Ptr acknowledged = Service::GetByNamePair("test-01", "livestatus");
+	BOOST_REQUIRE(acknowledged);
+	BOOST_REQUIRE_EQUAL(acknowledged->GetState(), ServiceUnknown);
+
+	acknowledged->AcknowledgeProblem("test", "test", AcknowledgementNormal, false, false, Utility::GetTime());
+	acknowledged->GetHost()->AcknowledgeProblem("test", "test", AcknowledgementNormal, false, false, Utility::GetTime());
+}
+
+/* Compares the indexed query with the same one scanning all rows. */
+static std::vector<String> CheckIndexedRows(const String& table, const std::vector<String>& filter)
+{
+	PrepareServiceStates();
+
+	std::vector<String> indexed = FilteredRowsHelper(table, filter, true);
+	std::vector<String> scanned = FilteredRowsHelper(table, filter, false);
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(indexed.begin(), indexed.end(), scanned.begin(), scanned.end());
+
+	return indexed;
+}
+
+/* Returns everything written to the stream, including the response header. */
+static String LivestatusRawQueryHelper(const std::vector<String>& lines)
+{
+	LivestatusQuery::Ptr query = new LivestatusQuery(lines, "");
+
+	std::stringstream stream;
+	StdioStream::Ptr sstream = new StdioStream(&stream, false);
+
+	query->Execute(sstream);
+
+	return stream.str();
+}
+
+/* Compares a result which is streamed in several batches with the same
+ * result rendered at once for the fixed16 header.
+ */
+static void CheckStreamedResult(const String& format)
+{
+	/* Repeating the columns makes the two hosts' rows large enough. */
+	String columns = "Columns:";
+
+	for (int i = 0; i < 3000; i++)
+		columns += " name address";
+
+	std::vector<String> lines;
+	lines.emplace_back("GET hosts");
+	lines.emplace_back(columns);
+	lines.emplace_back("OutputFormat: " + format);
+	lines.emplace_back("ColumnHeaders: on");
+	lines.emplace_back("ResponseHeader: off");
+	lines.emplace_back("\n");
+
+	String streamed = LivestatusRawQueryHelper(lines);
+
+	lines[4] = "ResponseHeader: fixed16";
+
+	String fixed = LivestatusRawQueryHelper(lines);
+
+	BOOST_REQUIRE(fixed.GetLength() > 16);
+	BOOST_CHECK_EQUAL(fixed.SubStr(0, 3), "200");
+
+	String body = fixed.SubStr(16);
+
+	BOOST_CHECK_EQUAL(fixed.SubStr(3, 12).Trim(), Convert::ToString(static_cast<long>(body.GetLength())));
+	BOOST_CHECK(streamed.GetLength() > 64 * 1024);
+	BOOST_CHECK(streamed == body);
+}
+
+/* Runs a stats query on the services, the rows are ordered by the values of the group columns. */
+static Array::Ptr StatsQueryHelper(const String& columns, const std::vector<String>& stats)
+{
+	PrepareServiceStates();
+
+	std::vector<String> lines;
+	lines.emplace_back("GET services");
+
+	if (!columns.IsEmpty())
+		lines.emplace_back("Columns: " + columns);
+
+	lines.insert(lines.end(), stats.begin(), stats.end());
+	lines.emplace_back("OutputFormat: json");
+	lines.emplace_back("\n");
+
+	return JsonDecode(LivestatusQueryHelper(lines));
+}
+
+static void CheckStatsRow(const Array::Ptr& row, size_t offset, const std::vector<double>& expected)
+{
+	BOOST_REQUIRE_EQUAL(row->GetLength(), offset + expected.size());
+
+	for (size_t i = 0; i < expected.size(); i++)
+		BOOST_CHECK_CLOSE(static_cast<double>(row->Get(offset + i)), expected[i], 0.0001);
+}
+
+/* Compares a stats query aggregated in batches with the same one aggregated row by row. */
+static void CheckBatchedStats(const String& table, const std::vector<String>& stats)
+{
+	PrepareServiceStates();
+
+	std::vector<String> lines;
+	lines.emplace_back("GET " + table);
+	lines.emplace_back("Columns: state");
+	lines.insert(lines.end(), stats.begin(), stats.end());
+	lines.emplace_back("OutputFormat: json");
+	lines.emplace_back("\n");
+
+	String batched = LivestatusQueryHelper(lines, "", true);
+	String rows = LivestatusQueryHelper(lines, "", false);
+
+	BOOST_CHECK(JsonDecode(batched).IsObjectType<Array>());
+	BOOST_CHECK_EQUAL(batched, rows);
+}
+
+/* A compat log directory with an archive and the current log file, removed again after the test */
+struct CompatLogDirectory
+{
+	String Path;
+
+	CompatLogDirectory()
+	{
+		Path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("icinga2-livestatus-%%%%-%%%%")).string();
+		Utility::MkDirP(Path + "/archives", 0750);
+
+		std::ofstream(GetArchivePath().CStr())
+			<< "[1600000000] LOG VERSION: 2.0\n"
+			<< "[1600000000] CURRENT HOST STATE: test-01;UP;HARD;1;OK\n"
+			<< "[1600000000] CURRENT HOST STATE: test-02;UP;HARD;1;OK\n"
+			<< "[1600000000] CURRENT SERVICE STATE: test-01;livestatus;OK;HARD;1;OK\n"
+			<< "[1600000000] CURRENT SERVICE STATE: test-02;livestatus;OK;HARD;1;OK\n"
+			<< "[1600000100] SERVICE ALERT: test-02;livestatus;CRITICAL;HARD;1;failed\n";
+
+		std::ofstream((Path + "/icinga.log").CStr())
+			<< "[1600086400] LOG VERSION: 2.0\n"
+			<< "\n"
+			<< "[1600086400] CURRENT SERVICE STATE: test-02;livestatus;CRITICAL;HARD;1;failed\n"
+			<< "[1600086500] SERVICE ALERT: test-02;livestatus;OK;HARD;1;recovered\n"
+			<< "[1600086500] SERVICE ALERT: test-01;livestatus;WARNING;SOFT;1;slow\n";
+	}
+
+	~CompatLogDirectory()
+	{
+		Utility::RemoveDirRecursive(Path);
+	}
+
+	String GetArchivePath() const
+	{
+		return Path + "/archives/icinga-09-13-2020-14.log";
+	}
+};
+
+/* Compares the query using the compat log index with the same one reading all lines. */
+static std::vector<String> CheckHistoryRows(const String& table, const String& columns, const std::vector<String>& filter)
+{
+	CompatLogDirectory compatLog;
+	std::vector<String> results[2];
+
+	for (int useIndex = 0; useIndex < 2; useIndex++) {
+		std::vector<String> lines;
+		lines.emplace_back("GET " + table);
+		lines.emplace_back("Columns: " + columns);
+		lines.emplace_back("OutputFormat: json");
+		lines.insert(lines.end(), filter.begin(), filter.end());
+
+		/* The same as in FilteredRowsHelper() */
+		if (!useIndex) {
+			if (filter.size() > 1)
+				lines.emplace_back("And: " + Convert::ToString(filter.size()));
+
+			lines.emplace_back("Or: 1");
+		}
+
+		lines.emplace_back("\n");
+
+		results[useIndex] = LivestatusRowsHelper(lines, compatLog.Path);
+	}
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(results[1].begin(), results[1].end(), results[0].begin(), results[0].end());
+
+	/* Only the archive's index is written by the query, CompatLogger maintains the other one. */
+	BOOST_CHECK(Utility::PathExists(compatLog.GetArchivePath() + ".idx"));
+	BOOST_CHECK(!Utility::PathExists(compatLog.Path + "/icinga.log.idx"));
+
+	return results[1];
+}
+
 //____________________________________________________________________________//
 
 BOOST_AUTO_TEST_SUITE(livestatus)
@@ -102,6 +364,260 @@ BOOST_AUTO_TEST_CASE(services)
 
 	BOOST_TEST_MESSAGE("Done with testing livestatus services...");
 }
+
+BOOST_AUTO_TEST_CASE(streamed_csv)
+{
+	CheckStreamedResult("csv");
+}
+
+BOOST_AUTO_TEST_CASE(streamed_json)
+{
+	CheckStreamedResult("json");
+}
+
+BOOST_AUTO_TEST_CASE(streamed_python)
+{
+	CheckStreamedResult("python");
+}
+
+BOOST_AUTO_TEST_CASE(filter_host_name)
+{
+	std::vector<String> rows = CheckIndexedRows("services", { "Filter: host_name = test-01" });
+	std::vector<String> expected = SelectRows(FilteredRowsHelper("services", {}, false), [](const Array::Ptr& row) {
+		return row->Get(0) == "test-01";
+	});
+
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+
+	rows = CheckIndexedRows("hosts", { "Filter: host_name = test-01" });
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+
+	BOOST_CHECK(CheckIndexedRows("services", { "Filter: host_name = no-such-host" }).empty());
+}
+
+BOOST_AUTO_TEST_CASE(filter_state)
+{
+	std::vector<String> rows = CheckIndexedRows("services", { "Filter: state = 2" });
+	std::vector<String> expected = SelectRows(FilteredRowsHelper("services", {}, false), [](const Array::Ptr& row) {
+		return row->Get(2) == 2;
+	});
+
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+
+	BOOST_CHECK(CheckIndexedRows("services", { "Filter: state = 1" }).empty());
+}
+
+BOOST_AUTO_TEST_CASE(filter_acknowledged)
+{
+	std::vector<String> rows = CheckIndexedRows("services", { "Filter: acknowledged = 1" });
+	std::vector<String> expected = SelectRows(FilteredRowsHelper("services", {}, false), [](const Array::Ptr& row) {
+		return row->Get(3) == 1;
+	});
+
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+
+	rows = CheckIndexedRows("hosts", { "Filter: acknowledged = 1" });
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(filter_negated)
+{
+	std::vector<String> all = FilteredRowsHelper("services", {}, false);
+
+	std::vector<String> rows = CheckIndexedRows("services", { "Filter: state != 2" });
+	std::vector<String> expected = SelectRows(all, [](const Array::Ptr& row) {
+		return row->Get(2) != 2;
+	});
+
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+
+	rows = CheckIndexedRows("services", { "Filter: acknowledged = 0", "Negate:" });
+	expected = SelectRows(all, [](const Array::Ptr& row) {
+		return row->Get(3) == 1;
+	});
+
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(filter_or)
+{
+	std::vector<String> all = FilteredRowsHelper("services", {}, false);
+
+	/* Neither condition holds for every row, so nothing may be narrowed down. */
+	std::vector<String> rows = CheckIndexedRows("services", { "Filter: host_name = test-01", "Filter: state = 2", "Or: 2" });
+
+	BOOST_CHECK_EQUAL(rows.size(), 2u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), all.begin(), all.end());
+
+	/* The Or doesn't stop the host_name index for the And around it. */
+	rows = CheckIndexedRows("services", { "Filter: host_name = test-02", "Filter: state = 2", "Filter: acknowledged = 1", "Or: 2", "And: 2" });
+	std::vector<String> expected = SelectRows(all, [](const Array::Ptr& row) {
+		return row->Get(0) == "test-02";
+	});
+
+	BOOST_CHECK_EQUAL(rows.size(), 1u);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+}
+BOOST_AUTO_TEST_CASE(stats_state)
+{
+	std::vector<String> stats = {
+		"Stats: state = 0",
+		"Stats: state = 2",
+		"Stats: state = 3",
+		"Stats: state = 2.0",
+		"Stats: state >= 2",
+		"Stats: state < 3",
+		"Stats: state != 2",
+		"Stats: host_name = test-01"
+	};
+
+	Array::Ptr result = StatsQueryHelper("", stats);
+
+	BOOST_REQUIRE_EQUAL(result->GetLength(), 1u);
+	CheckStatsRow(result->Get(0), 0, { 0, 1, 1, 1, 2, 1, 1, 1 });
+
+	/* Operands and columns are resolved per query, a second run has to agree. */
+	result = StatsQueryHelper("", stats);
+
+	BOOST_REQUIRE_EQUAL(result->GetLength(), 1u);
+	CheckStatsRow(result->Get(0), 0, { 0, 1, 1, 1, 2, 1, 1, 1 });
+}
+
+BOOST_AUTO_TEST_CASE(stats_and)
+{
+	Array::Ptr result = StatsQueryHelper("", {
+		"Stats: state = 2",
+		"Stats: acknowledged = 0",
+		"StatsAnd: 2",
+		"Stats: state = 3",
+		"Stats: acknowledged = 0",
+		"StatsAnd: 2",
+		"Stats: state = 3",
+		"Stats: acknowledged = 1",
+		"StatsAnd: 2",
+		"Stats: state = 2",
+		"Stats: state = 3",
+		"StatsOr: 2"
+	});
+
+	BOOST_REQUIRE_EQUAL(result->GetLength(), 1u);
+	CheckStatsRow(result->Get(0), 0, { 1, 0, 1, 2 });
+}
+
+BOOST_AUTO_TEST_CASE(stats_avg_std)
+{
+	Array::Ptr result = StatsQueryHelper("", {
+		"Stats: sum state",
+		"Stats: min state",
+		"Stats: max state",
+		"Stats: avg state",
+		"Stats: std state",
+		"Stats: avg acknowledged"
+	});
+
+	/* The states are 2 and 3, the sample standard deviation is sqrt(0.5). */
+	BOOST_REQUIRE_EQUAL(result->GetLength(), 1u);
+	CheckStatsRow(result->Get(0), 0, { 5, 2, 3, 2.5, std::sqrt(0.5), 0.5 });
+}
+
+BOOST_AUTO_TEST_CASE(stats_by_host_name)
+{
+	/* The same columns as in the group key, the filters and the aggregators. */
+	Array::Ptr result = StatsQueryHelper("host_name", {
+		"Stats: state = 2",
+		"Stats: state = 3",
+		"Stats: acknowledged = 0",
+		"StatsAnd: 2",
+		"Stats: acknowledged = 1",
+		"Stats: host_name = test-01",
+		"Stats: avg state",
+		"Stats: sum acknowledged"
+	});
+
+	BOOST_REQUIRE_EQUAL(result->GetLength(), 2u);
+
+	Array::Ptr row = result->Get(0);
+	BOOST_CHECK_EQUAL(row->Get(0), "test-01");
+	CheckStatsRow(row, 1, { 0, 0, 1, 1, 3, 1 });
+
+	row = result->Get(1);
+	BOOST_CHECK_EQUAL(row->Get(0), "test-02");
+	CheckStatsRow(row, 1, { 1, 0, 0, 0, 2, 0 });
+}
+
+BOOST_AUTO_TEST_CASE(stats_batched)
+{
+	/* Filters and aggregators on the columns which are read in batches,
+	 * mixed with ones on other columns. The hosts have no check results,
+	 * so their latency and execution time are empty.
+	 */
+	std::vector<String> stats = {
+		"Stats: state = 2",
+		"Stats: state >= 1",
+		"Stats: acknowledged = 1",
+		"StatsOr: 2",
+		"Stats: scheduled_downtime_depth = 0",
+		"Stats: latency < 1",
+		"StatsAnd: 2",
+		"Stats: execution_time >= 0",
+		"Stats: latency > -1",
+		"Stats: state != 3",
+		"Stats: acknowledged = 0",
+		"Stats: has_been_checked = 1",
+		"Stats: state = 2",
+		"Stats: has_been_checked = 0",
+		"StatsAnd: 2",
+		"Stats: sum latency",
+		"Stats: avg execution_time",
+		"Stats: avg state",
+		"Stats: min latency",
+		"Stats: max scheduled_downtime_depth",
+		"Stats: sum acknowledged",
+		"Stats: sum has_been_checked"
+	};
+
+	CheckBatchedStats("services", stats);
+	CheckBatchedStats("hosts", stats);
+}
+
+BOOST_AUTO_TEST_CASE(log_indexed)
+{
+	std::vector<String> rows = CheckHistoryRows("log", "time lineno type state", { "Filter: host_name = test-02" });
+	std::vector<String> expected {
+		"[1600000000,2,\"CURRENT HOST STATE\",0]",
+		"[1600000000,4,\"CURRENT SERVICE STATE\",0]",
+		"[1600000100,5,\"SERVICE ALERT\",2]",
+		"[1600086400,1,\"CURRENT SERVICE STATE\",2]",
+		"[1600086500,2,\"SERVICE ALERT\",0]"
+	};
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+
+	rows = CheckHistoryRows("log", "time lineno", { "Filter: host_name = test-02", "Filter: time <= 1600086400", "Filter: state = 2" });
+	expected = { "[1600000100,5]", "[1600086400,1]" };
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+
+	BOOST_CHECK(CheckHistoryRows("log", "time", { "Filter: host_name = no-such-host" }).empty());
+}
+
+BOOST_AUTO_TEST_CASE(statehist_indexed)
+{
+	std::vector<String> rows = CheckHistoryRows("statehist", "state from until", { "Filter: host_name = test-02", "Filter: service_description = livestatus" });
+	std::vector<String> expected {
+		"[0,1600000000,1600000100]",
+		"[0,1600086500,1600086501]",
+		"[2,1600000100,1600086500]"
+	};
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(rows.begin(), rows.end(), expected.begin(), expected.end());
+}
+
 //____________________________________________________________________________//
 
 BOOST_AUTO_TEST_SUITE_END()
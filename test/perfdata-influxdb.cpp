@@ -0,0 +1,75 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "perfdata/influxdbcommonwriter.hpp"
+#include <BoostTestTargetConfig.h>
+#include <string>
+
+using namespace icinga;
+
+static std::string KeyOrTagValue(const String& str)
+{
+	std::string buffer;
+	InfluxdbCommonWriter::AppendKeyOrTagValue(buffer, str);
+	return buffer;
+}
+
+static std::string FieldValue(const Value& value)
+{
+	std::string buffer;
+	InfluxdbCommonWriter::AppendValue(buffer, value);
+	return buffer;
+}
+
+BOOST_AUTO_TEST_SUITE(perfdata_influxdb)
+
+BOOST_AUTO_TEST_CASE(escape_key_or_tag_value)
+{
+	BOOST_CHECK_EQUAL(KeyOrTagValue(""), "");
+	BOOST_CHECK_EQUAL(KeyOrTagValue("ping4"), "ping4");
+	BOOST_CHECK_EQUAL(KeyOrTagValue("web server 01"), "web\\ server\\ 01");
+	BOOST_CHECK_EQUAL(KeyOrTagValue("a,b=c"), "a\\,b\\=c");
+	BOOST_CHECK_EQUAL(KeyOrTagValue("say \"hi\""), "say\\ \\\"hi\\\"");
+
+	/* Trailing backslashes would escape the following delimiter. */
+	BOOST_CHECK_EQUAL(KeyOrTagValue("C:\\"), "C:_");
+	BOOST_CHECK_EQUAL(KeyOrTagValue("C:\\Windows"), "C:\\Windows");
+	BOOST_CHECK_EQUAL(KeyOrTagValue("\\"), "_");
+
+	/* Appending doesn't touch what's already in the buffer. */
+	std::string buffer = "foo\\";
+	InfluxdbCommonWriter::AppendKeyOrTagValue(buffer, "");
+	BOOST_CHECK_EQUAL(buffer, "foo\\");
+}
+
+BOOST_AUTO_TEST_CASE(escape_value)
+{
+	BOOST_CHECK_EQUAL(FieldValue(42), "42");
+	BOOST_CHECK_EQUAL(FieldValue(0.5), "0.5");
+	BOOST_CHECK_EQUAL(FieldValue(true), "true");
+	BOOST_CHECK_EQUAL(FieldValue(false), "false");
+	BOOST_CHECK_EQUAL(FieldValue("ms"), "\"ms\"");
+	BOOST_CHECK_EQUAL(FieldValue("a b,c=\"d\""), "\"a\\ b\\,c\\=\\\"d\\\"\"");
+}
+
+BOOST_AUTO_TEST_CASE(data_point)
+{
+	std::string prefix;
+	InfluxdbCommonWriter::AppendKeyOrTagValue(prefix, "ping4");
+	prefix += ",hostname=";
+	InfluxdbCommonWriter::AppendKeyOrTagValue(prefix, "web server 01");
+
+	Dictionary::Ptr fields = new Dictionary({
+		{ "unit", "ms" },
+		{ "value", 0.5 }
+	});
+
+	std::string buffer;
+	InfluxdbCommonWriter::AppendDataPoint(buffer, prefix, "rta time", fields, 1600000000.7);
+	InfluxdbCommonWriter::AppendDataPoint(buffer, prefix, "", fields, 1600000001);
+
+	BOOST_CHECK_EQUAL(buffer,
+		"ping4,hostname=web\\ server\\ 01,metric=rta\\ time unit=\"ms\",value=0.5 1600000000\n"
+		"ping4,hostname=web\\ server\\ 01 unit=\"ms\",value=0.5 1600000001\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "perfdata/perfdataspool.hpp"
+#include "base/convert.hpp"
+#include "base/utility.hpp"
+#include <boost/filesystem/operations.hpp>
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+/* A spool directory which is removed again after the test */
+struct PerfdataSpoolFixture
+{
+	String Path;
+
+	PerfdataSpoolFixture()
+	{
+		Path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("icinga2-perfdata-spool-%%%%-%%%%")).string();
+	}
+
+	~PerfdataSpoolFixture()
+	{
+		if (Utility::PathExists(Path))
+			Utility::RemoveDirRecursive(Path);
+	}
+
+	String GetSegmentPath(int id) const
+	{
+		return Path + "/" + String(16 - Convert::ToString(id).GetLength(), '0') + Convert::ToString(id) + ".spool";
+	}
+};
+
+BOOST_FIXTURE_TEST_SUITE(perfdata_spool, PerfdataSpoolFixture)
+
+BOOST_AUTO_TEST_CASE(append_peek_consume)
+{
+	PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 1024 * 1024);
+
+	BOOST_CHECK(spool->IsEmpty());
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "");
+
+	spool->Append("a 1\n");
+	spool->Append("b 2\n");
+
+	BOOST_CHECK(!spool->IsEmpty());
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "a 1\nb 2\n");
+
+	/* Without Consume() the same records are returned again. */
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "a 1\nb 2\n");
+
+	spool->Consume();
+
+	BOOST_CHECK(spool->IsEmpty());
+	BOOST_CHECK_EQUAL(spool->GetSize(), 0u);
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "");
+}
+
+BOOST_AUTO_TEST_CASE(peek_limit)
+{
+	PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 1024 * 1024);
+
+	spool->Append("a 1\n");
+	spool->Append("b 2\n");
+	spool->Append("c 3\n");
+
+	/* Records are never split, the first one is returned even if it's too large. */
+	BOOST_CHECK_EQUAL(spool->Peek(1), "a 1\n");
+	spool->Consume();
+
+	BOOST_CHECK_EQUAL(spool->Peek(5), "b 2\nc 3\n");
+	spool->Consume();
+
+	BOOST_CHECK(spool->IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(restart)
+{
+	{
+		PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 1024 * 1024);
+
+		spool->Append("a 1\n");
+		spool->Append("b 2\n");
+		spool->Append("c 3\n");
+
+		BOOST_CHECK_EQUAL(spool->Peek(1), "a 1\n");
+		spool->Consume();
+
+		/* Peeked but not consumed, so it has to come back after the restart. */
+		BOOST_CHECK_EQUAL(spool->Peek(1), "b 2\n");
+	}
+
+	PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 1024 * 1024);
+
+	BOOST_CHECK(!spool->IsEmpty());
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "b 2\nc 3\n");
+
+	spool->Append("d 4\n");
+	spool->Consume();
+
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "d 4\n");
+	spool->Consume();
+
+	BOOST_CHECK(spool->IsEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(truncated)
+{
+	{
+		PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 1024 * 1024);
+
+		spool->Append("a 1\n");
+		spool->Append("b 2\n");
+	}
+
+	/* Cut the last record in half as a crash while writing it would. */
+	String segment = GetSegmentPath(1);
+	boost::filesystem::resize_file(segment.GetData(), boost::filesystem::file_size(segment.GetData()) - 4);
+
+	PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 1024 * 1024);
+
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "a 1\n");
+	spool->Consume();
+
+	/* The torn record is skipped rather than blocking the spool. */
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "");
+	BOOST_CHECK(spool->IsEmpty());
+
+	spool->Append("c 3\n");
+
+	BOOST_CHECK_EQUAL(spool->Peek(1024), "c 3\n");
+}
+
+BOOST_AUTO_TEST_CASE(max_size)
+{
+	PerfdataSpool::Ptr spool = new PerfdataSpool(Path, 16 * 1024);
+	String record (1000, 'x');
+
+	for (int i = 0; i < 100; i++)
+		spool->Append(record);
+
+	BOOST_CHECK(spool->GetDroppedBytes() > 0);
+	BOOST_CHECK(spool->GetSize() <= 16 * 1024);
+
+	/* Only whole records survive. */
+	String data = spool->Peek(1024 * 1024);
+	BOOST_CHECK(!data.IsEmpty());
+	BOOST_CHECK_EQUAL(data.GetLength() % record.GetLength(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
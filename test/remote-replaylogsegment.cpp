@@ -0,0 +1,128 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/replaylogsegment.hpp"
+#include <BoostTestTargetConfig.h>
+#include <sstream>
+#include <string>
+
+using namespace icinga;
+
+static void WriteRecord(std::ostream& fp, double ts, const std::string& secobj, const std::string& message)
+{
+	ReplayLogRecordHeader header;
+	header.Timestamp = ts;
+	header.SecobjLength = secobj.size();
+	header.MessageLength = message.size();
+
+	fp.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	fp.write(secobj.c_str(), secobj.size());
+	fp.write(message.c_str(), message.size());
+}
+
+static std::string MakeSegment()
+{
+	std::ostringstream fp;
+
+	fp.write(ReplayLogSegment::GetMagic(), ReplayLogSegment::GetMagicLength());
+	WriteRecord(fp, 1, std::string("Host\0h1", 7), "{\"a\":1}");
+	WriteRecord(fp, 2, "", "{\"b\":2}");
+
+	return fp.str();
+}
+
+BOOST_AUTO_TEST_SUITE(remote_replaylogsegment)
+
+BOOST_AUTO_TEST_CASE(read)
+{
+	std::string data = MakeSegment();
+	std::istringstream fp (data);
+	std::streamoff fileSize = data.size();
+	ReplayLogRecord record;
+
+	BOOST_REQUIRE(ReplayLogSegment::ReadMagic(fp));
+
+	BOOST_REQUIRE(ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK_EQUAL(record.Timestamp, 1);
+	BOOST_CHECK(record.Secobj == String(std::string("Host\0h1", 7)));
+	BOOST_CHECK_EQUAL(record.Message, "{\"a\":1}");
+
+	BOOST_REQUIRE(ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK_EQUAL(record.Timestamp, 2);
+	BOOST_CHECK(record.Secobj.IsEmpty());
+
+	BOOST_CHECK(!ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(fp.eof());
+
+	BOOST_CHECK_EQUAL(ReplayLogSegment::GetMagicLength(), 21);
+}
+
+BOOST_AUTO_TEST_CASE(skip_older)
+{
+	std::string data = MakeSegment();
+	std::istringstream fp (data);
+	std::streamoff fileSize = data.size();
+	ReplayLogRecord record;
+
+	BOOST_REQUIRE(ReplayLogSegment::ReadMagic(fp));
+	BOOST_REQUIRE(ReplayLogSegment::ReadRecord(fp, fileSize, 1, record));
+	BOOST_CHECK_EQUAL(record.Timestamp, 2);
+}
+
+BOOST_AUTO_TEST_CASE(truncated)
+{
+	std::string complete = MakeSegment();
+
+	std::ostringstream out;
+	out << complete;
+	WriteRecord(out, 3, "", "{\"c\":3}");
+
+	/* Cut the last record in half, like a crash while writing it would. */
+	std::string data = out.str();
+	data.resize(data.size() - 4);
+
+	std::istringstream fp (data);
+	std::streamoff fileSize = data.size();
+	ReplayLogRecord record;
+
+	BOOST_REQUIRE(ReplayLogSegment::ReadMagic(fp));
+	BOOST_CHECK(ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(!ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(!fp.eof());
+
+	std::istringstream fp2 (data);
+	BOOST_REQUIRE(ReplayLogSegment::ReadMagic(fp2));
+	BOOST_CHECK_EQUAL(ReplayLogSegment::GetCompleteLength(fp2), static_cast<std::streamoff>(complete.size()));
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_length)
+{
+	std::string complete = MakeSegment();
+
+	std::ostringstream out;
+	out << complete;
+
+	ReplayLogRecordHeader header;
+	header.Timestamp = 3;
+	header.SecobjLength = 0;
+	header.MessageLength = 0xffffffff;
+	out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	out << "garbage";
+
+	std::string data = out.str();
+	std::istringstream fp (data);
+	std::streamoff fileSize = data.size();
+	ReplayLogRecord record;
+
+	BOOST_REQUIRE(ReplayLogSegment::ReadMagic(fp));
+	BOOST_CHECK(ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(!ReplayLogSegment::ReadRecord(fp, fileSize, 0, record));
+	BOOST_CHECK(!fp.eof());
+
+	std::istringstream fp2 (data);
+	BOOST_REQUIRE(ReplayLogSegment::ReadMagic(fp2));
+	BOOST_CHECK_EQUAL(ReplayLogSegment::GetCompleteLength(fp2), static_cast<std::streamoff>(complete.size()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()